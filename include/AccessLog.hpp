@@ -0,0 +1,50 @@
+#ifndef ACCESSLOG_HPP
+#define ACCESSLOG_HPP
+
+#include "RequestTiming.hpp"
+#include "ServerConfig.hpp"
+#include <netinet/in.h>
+#include <string>
+
+class Request;
+
+// nginx의 combined 형식
+#define ACCESS_LOG_COMBINED_FORMAT                                                                                      \
+    "$remote_addr - - [$time_local] \"$request\" $status $body_bytes_sent \"$http_referer\" \"$http_user_agent\""
+
+// 느린 요청 로그 형식 ($phases: 단계별 소요 시간, 밀리초)
+#define SLOW_REQUEST_LOG_FORMAT "[$time_local] $remote_addr \"$request\" $status $body_bytes_sent $request_time $phases"
+
+// 접근 로그 한 줄에 필요한 값
+struct AccessLogEntry
+{
+    in_addr_t remote_addr;  // 네트워크 바이트 순서
+    const Request *request; // 파싱에 실패한 요청이면 NULL
+    int status;
+    size_t body_bytes_sent;
+    const RequestTiming *timing; // 단계별 시각 (없으면 시간 변수는 "-")
+
+    AccessLogEntry() : remote_addr(0), request(NULL), status(0), body_bytes_sent(0), timing(NULL)
+    {
+    }
+};
+
+// log_format 문자열을 시작 시 한 번 컴파일해 두고, 요청마다 스택 버퍼에 한 줄을 만들어
+// AsyncLog 링에 넣습니다.
+class AccessLog
+{
+  public:
+    // 서버 블록의 access_log/log_format 설정으로 로거를 만들고 번호를 돌려줍니다.
+    // access_log off이면 -1
+    static int configure(const ServerConfig &server_config);
+    // slow_request_log 설정으로 로거를 만듭니다. 설정이 없으면 -1
+    static int configureSlowLog(const ServerConfig &server_config);
+    static void log(int id, const ServerConfig &server_config, const AccessLogEntry &entry);
+
+  private:
+    AccessLog();
+
+    static int open(const std::string &path, const std::string &format);
+};
+
+#endif // ACCESSLOG_HPP
@@ -0,0 +1,168 @@
+#ifndef ARENA_HPP
+#define ARENA_HPP
+
+#include "Define.hpp"
+#include <cstddef>
+#include <new>
+
+// 아레나 사용량 통계 (모든 스레드의 연결 누적, 원자적으로 갱신)
+struct ArenaStats
+{
+    size_t high_water;      // 한 요청이 사용한 최대 바이트 수
+    size_t block_allocs;    // 블록 할당(malloc) 횟수
+    size_t oversize_allocs; // 블록보다 커서 별도 블록을 할당한 횟수
+    size_t resets;          // reset() 호출 횟수 (처리된 요청 수)
+
+    ArenaStats() : high_water(0), block_allocs(0), oversize_allocs(0), resets(0)
+    {
+    }
+};
+
+// 연결 단위 bump-pointer 할당기
+// 요청 하나를 처리하는 동안 작은 문자열/맵 노드를 여기서 할당하고,
+// keep-alive 요청 사이에 reset()으로 한 번에 해제합니다. (개별 해제 없음)
+class Arena
+{
+  public:
+    explicit Arena(size_t block_size = ARENA_BLOCK_SIZE);
+    ~Arena();
+
+    void *allocate(size_t size);
+    // 첫 블록만 남기고 모두 해제합니다.
+    void reset();
+
+    size_t bytesUsed() const;
+    size_t highWater() const;
+
+    // 현재 요청 처리 중인 아레나 (ArenaScope로 설정, 스레드별)
+    static Arena *current();
+    // 각 값을 원자적으로 읽은 사본 (다른 스레드가 갱신하는 중에도 읽을 수 있음)
+    static ArenaStats stats();
+
+  private:
+    Arena(const Arena &);
+    Arena &operator=(const Arena &);
+
+    struct Block
+    {
+        Block *next;
+        size_t size;
+    };
+
+    Block *_first;
+    Block *_extra;
+    char *_cursor;
+    char *_limit;
+    size_t _block_size;
+    size_t _used;
+    size_t _high_water;
+
+    static Block *newBlock(size_t size);
+    static __thread Arena *_current;
+    static ArenaStats _stats;
+
+    friend class ArenaScope;
+};
+
+// 스코프 동안 Arena::current()를 교체합니다.
+class ArenaScope
+{
+  public:
+    explicit ArenaScope(Arena *arena);
+    ~ArenaScope();
+
+  private:
+    ArenaScope(const ArenaScope &);
+    ArenaScope &operator=(const ArenaScope &);
+
+    Arena *_prev;
+};
+
+// STL 컨테이너용 할당기
+// 생성 시점의 Arena::current()를 사용하며, 아레나가 없으면 operator new로 동작합니다.
+template <typename T> class ArenaAllocator
+{
+  public:
+    typedef T value_type;
+    typedef T *pointer;
+    typedef const T *const_pointer;
+    typedef T &reference;
+    typedef const T &const_reference;
+    typedef size_t size_type;
+    typedef ptrdiff_t difference_type;
+
+    template <typename U> struct rebind
+    {
+        typedef ArenaAllocator<U> other;
+    };
+
+    ArenaAllocator() : _arena(Arena::current())
+    {
+    }
+    explicit ArenaAllocator(Arena *arena) : _arena(arena)
+    {
+    }
+    ArenaAllocator(const ArenaAllocator &other) : _arena(other._arena)
+    {
+    }
+    template <typename U> ArenaAllocator(const ArenaAllocator<U> &other) : _arena(other.arena())
+    {
+    }
+    ~ArenaAllocator()
+    {
+    }
+
+    pointer address(reference x) const
+    {
+        return &x;
+    }
+    const_pointer address(const_reference x) const
+    {
+        return &x;
+    }
+
+    pointer allocate(size_type n, const void * = 0)
+    {
+        if (_arena)
+            return static_cast<pointer>(_arena->allocate(n * sizeof(T)));
+        return static_cast<pointer>(::operator new(n * sizeof(T)));
+    }
+    void deallocate(pointer p, size_type)
+    {
+        if (!_arena)
+            ::operator delete(p);
+    }
+
+    size_type max_size() const
+    {
+        return static_cast<size_type>(-1) / sizeof(T);
+    }
+    void construct(pointer p, const T &value)
+    {
+        new (p) T(value);
+    }
+    void destroy(pointer p)
+    {
+        p->~T();
+    }
+
+    Arena *arena() const
+    {
+        return _arena;
+    }
+
+  private:
+    Arena *_arena;
+};
+
+template <typename T, typename U> bool operator==(const ArenaAllocator<T> &a, const ArenaAllocator<U> &b)
+{
+    return a.arena() == b.arena();
+}
+
+template <typename T, typename U> bool operator!=(const ArenaAllocator<T> &a, const ArenaAllocator<U> &b)
+{
+    return a.arena() != b.arena();
+}
+
+#endif // ARENA_HPP
@@ -0,0 +1,58 @@
+#ifndef ASYNCLOG_HPP
+#define ASYNCLOG_HPP
+
+#include "Define.hpp"
+#include <pthread.h>
+#include <string>
+#include <sys/types.h>
+
+struct AsyncLogStats
+{
+    size_t bytes_written; // 파일/콘솔에 기록된 바이트 수
+    size_t writes;        // writev 호출 수
+    size_t dropped;       // 링이 가득 차서 버려진 줄 수
+    size_t reopens;       // SIGUSR1로 다시 연 횟수
+
+    AsyncLogStats() : bytes_written(0), writes(0), dropped(0), reopens(0)
+    {
+    }
+};
+
+// 로그 줄을 스레드별 SPSC 링에 넣으면 전용 writer 스레드가 모아서 writev로 기록합니다.
+// 요청 처리 경로에서는 시스템 콜 없이 memcpy만 일어납니다.
+class AsyncLog
+{
+  public:
+    // path에 대한 채널 번호를 돌려줍니다. 같은 경로는 같은 채널을 공유합니다.
+    // 빈 경로는 표준 에러(콘솔)입니다. 실패하면 -1
+    static int openChannel(const std::string &path);
+    // 한 줄(개행 포함)을 채널에 넣습니다. 링이 가득 차면 버리고 dropped를 올립니다.
+    // writer 스레드가 없으면 바로 write합니다.
+    static void write(int channel, const char *data, size_t len);
+
+    static bool start();
+    // 남은 로그를 모두 기록하고 writer 스레드를 종료합니다.
+    static void stop();
+    // 시그널 핸들러에서 호출 가능 (플래그만 설정)
+    static void requestReopen();
+    static AsyncLogStats stats();
+
+  private:
+    AsyncLog();
+    static void *writerMain(void *arg);
+};
+
+// 초 단위로 캐시되는 로그용 시각 문자열 (스레드별)
+class LogClock
+{
+  public:
+    // "2024-01-31 13:45:00"
+    static const char *localTime(size_t &len);
+    // "31/Jan/2024:13:45:00 +0900"
+    static const char *commonLogTime(size_t &len);
+
+  private:
+    LogClock();
+};
+
+#endif // ASYNCLOG_HPP
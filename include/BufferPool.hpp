@@ -0,0 +1,95 @@
+#ifndef BUFFERPOOL_HPP
+#define BUFFERPOOL_HPP
+
+#include "Define.hpp"
+#include <string>
+#include <sys/types.h>
+
+// 고정 크기 수신 버퍼
+struct RecvBuffer
+{
+    RecvBuffer *next;
+    size_t end; // 기록된 데이터 끝
+    char data[RECV_BUFFER_SIZE];
+};
+
+// 모든 스레드의 합계 (원자적으로 갱신)
+struct BufferPoolStats
+{
+    size_t allocated; // 현재 할당되어 있는 버퍼 수
+    size_t in_use;    // 연결에 연결(link)된 버퍼 수
+    size_t free;      // 풀에 대기 중인 버퍼 수
+    size_t hits;      // 풀에서 재사용한 횟수
+    size_t misses;    // 새로 할당한 횟수
+
+    BufferPoolStats() : allocated(0), in_use(0), free(0), hits(0), misses(0)
+    {
+    }
+};
+
+// 수신 버퍼 풀 (재사용, 스레드마다 최대 RECV_POOL_MAX_FREE개까지 보관)
+// 연결의 버퍼는 그 연결을 맡은 이벤트 루프 스레드에서만 받고 돌려주므로 잠금 없이 스레드별 목록을 씁니다.
+class BufferPool
+{
+  public:
+    static RecvBuffer *acquire();
+    static void release(RecvBuffer *buffer);
+    // 스레드가 끝날 때 그 스레드가 보관하던 버퍼를 해제합니다.
+    static void releaseThreadCache();
+    // 이벤트 루프가 갱신하는 중에도 읽을 수 있도록 각 값을 원자적으로 읽은 사본을 돌려줍니다.
+    static BufferPoolStats stats();
+
+  private:
+    BufferPool();
+    static void adjust(size_t &slot, long delta);
+    static __thread RecvBuffer *_free_list;
+    static __thread size_t _free_count;
+    friend class RecvChain;
+    static BufferPoolStats _stats;
+};
+
+// 연결별 수신 버퍼 체인
+// 요청이 완성될 때까지 풀 버퍼에 readv로 직접 받고, 완성되면 한 번에 이어 붙입니다.
+// 비어 있는 체인은 버퍼를 하나도 갖지 않습니다.
+class RecvChain
+{
+  public:
+    enum FrameStatus
+    {
+        FRAME_INCOMPLETE,
+        FRAME_COMPLETE,
+        FRAME_HEADER_TOO_LARGE
+    };
+
+    RecvChain();
+    ~RecvChain();
+
+    // 소켓에서 한 번 읽습니다. recv()와 같은 반환값
+    ssize_t readFrom(int fd);
+    // 헤더 끝(CRLFCRLF)과 Content-Length로 요청 하나가 모두 도착했는지 확인합니다.
+    FrameStatus frameStatus();
+    size_t size() const;
+    bool empty() const;
+    // 모든 데이터를 out 뒤에 붙이고 버퍼를 풀에 반환합니다.
+    void drainTo(std::string &out);
+    void append(const char *data, size_t len);
+    void clear();
+
+  private:
+    RecvChain(const RecvChain &);
+    RecvChain &operator=(const RecvChain &);
+
+    void linkBuffer(RecvBuffer *buffer);
+    void parseContentLength();
+
+    RecvBuffer *_head;
+    RecvBuffer *_tail;
+    size_t _size;
+    size_t _scanned;    // 헤더 끝을 찾기 위해 이미 검사한 바이트 수
+    int _match;         // "\r\n\r\n" 중 일치한 길이
+    char _prev;         // 마지막으로 검사한 바이트
+    size_t _header_end; // 헤더 블록 길이 (빈 줄 포함), 0이면 아직 모름
+    size_t _content_length;
+};
+
+#endif // BUFFERPOOL_HPP
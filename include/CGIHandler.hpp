@@ -8,6 +8,7 @@
 #include <iostream>
 #include <map>
 #include <sstream>
+#include <stdint.h>
 #include <string>
 #include <sys/stat.h>
 #include <sys/types.h>
@@ -17,6 +18,26 @@
 
 class Request;
 class Response;
+struct ServerConfig;
+
+// CGI 응답 헤더 (스크립트가 보낸 순서)
+typedef std::vector<std::pair<std::string, std::string> > CgiHeaders;
+
+// 실행 중인 CGI의 stdin/stdout. 헤더를 읽은 뒤 이벤트 루프가 남은 요청 본문을 stdin에 쓰고,
+// 남은 출력은 도착하는 대로 응답 본문으로 보냅니다. 응답 복사본들과 송신 중인 연결이 참조를 나눠 가집니다.
+struct CgiStream
+{
+    int fd;           // stdout 파이프 읽기 끝
+    int in_fd;        // stdin 파이프 쓰기 끝 (요청 본문을 다 썼으면 -1)
+    size_t in_offset; // stdin에 쓴 요청 본문 바이트 수
+    pid_t pid;
+    std::string head;  // 헤더와 함께 읽힌 본문 앞부분
+    bool chunked;      // chunked로 감싸 보냄 (아니면 다 보낸 뒤 연결을 닫음)
+    bool discard;      // 본문이 없는 상태(1xx/204/304)라 출력을 읽어 버림
+    bool eof;          // stdout을 끝까지 읽음 (release()가 스크립트를 멈추지 않음)
+    uint64_t start_us; // 실행 시작 시각 (CGI 지연 시간 메트릭)
+    unsigned refs;
+};
 
 class CGIHandler
 {
@@ -24,11 +45,27 @@ class CGIHandler
     CGIHandler();
     ~CGIHandler();
 
-    bool execute(const Request &request, const std::string &script_path, std::string &cgi_output,
-                 std::string &content_type);
+    // interpreter로 스크립트를 실행하고 헤더를 끝까지 읽어 headers에 담습니다. 그동안 요청 본문을 stdin에 씁니다. 실패하면 NULL
+    // 헤더가 없는 출력은 모두 본문으로 봅니다. (headers가 빈 채로 돌아감)
+    CgiStream *execute(const Request &request, const std::string &script_path, const std::string &interpreter,
+                       const ServerConfig &server_config, CgiHeaders &headers);
+    // 요청 본문의 남은 부분을 stdin에 쓸 수 있는 만큼 씁니다. 다 썼거나 스크립트가 stdin을 닫았으면 true (in_fd는 호출한 쪽이 닫음)
+    static bool writeBody(CgiStream &stream, const std::string &body);
+
+    // 종료 대기 시간이 지났을 때 호출합니다. 아직 헤더를 기다리는 execute()는 실패로 돌아가고 자식은 종료됩니다.
+    static void abortPending();
+
+    static void retain(CgiStream *stream);
+    // 마지막 참조가 놓이면 파이프를 닫고 자식을 거둡니다. 출력을 끝까지 읽기 전이면 자식을 종료시키고,
+    // 다 읽었는데 아직 실행 중이면 reapExited()가 나중에 거둡니다.
+    static void release(CgiStream *stream);
+    // release()가 남겨 둔 자식 중 끝난 것을 거둡니다. (주 루프가 반복마다 호출)
+    static void reapExited();
 
   private:
-    void setEnvironmentVariables(const Request &request, const std::string &script_path);
+    void buildEnvironment(const Request &request, const std::string &script_path, const ServerConfig &server_config,
+                          std::vector<std::string> &env);
+    bool readHeaders(CgiStream &stream, const std::string &body, CgiHeaders &headers);
 
     CGIHandler(const CGIHandler &);
     CGIHandler &operator=(const CGIHandler &);
@@ -3,6 +3,7 @@
 
 #include "Define.hpp"
 #include "Log.hpp"
+#include "MimeTypes.hpp"
 #include "ServerConfig.hpp"
 #include "Utils.hpp"
 #include <fstream>
@@ -19,9 +20,22 @@ class Configuration
 {
   public:
     Configuration()
+        : worker_connections(WORKER_CONNECTIONS), reject_overflow(false),
+          shutdown_timeout_us(SHUTDOWN_TIMEOUT_MS * 1000ULL), worker_threads(1),
+          io_threads(IO_THREADS), mmap_cache_size(MMAP_CACHE_SIZE), mmap_min_file(MMAP_MIN_FILE),
+          mmap_max_file(MMAP_MAX_FILE)
     {
     }
     std::vector<ServerConfig> servers; // 서버 설정 리스트
+    size_t worker_connections;        // 동시에 열어 둘 클라이언트 연결 수 상한
+    bool reject_overflow;             // 상한 도달 시 true: 수락 후 503, false: 리스너 일시 중지
+    uint64_t shutdown_timeout_us;     // 종료/바이너리 교체 때 진행 중인 연결을 기다리는 최대 시간
+    size_t worker_threads;            // 이벤트 루프 스레드 수 (시작할 때만 적용)
+    size_t io_threads;                // 디스크 작업 대기열마다의 스레드 수 (0이면 이벤트 루프에서 처리, 시작할 때만 적용)
+    size_t mmap_cache_size;           // 정적 파일 매핑 캐시 크기 (0이면 끔)
+    size_t mmap_min_file;             // 매핑해서 보낼 파일 크기 범위
+    size_t mmap_max_file;
+    MimeTypeList mime_types;          // types { } / include mime.types (비어 있으면 내장 표)
 
     // 구성 파일 파싱
     bool parseConfigFile(const std::string &filename);
@@ -37,10 +51,15 @@ class Configuration
     Configuration &operator=(const Configuration &);
 
     // 파싱 관련 함수 (ConfigurationParse.cpp에 구현)
+    void parseGlobalConfig(const std::string &line);
     void parseServerConfig(const std::string &line, ServerConfig &server_config);
     void parseLocationConfig(const std::string &line, LocationConfig &location_config);
     void processServerLine(const std::string &line, ServerConfig &server_config);
     void processLocationLine(const std::string &line, LocationConfig &location_config);
+    // types 블록 안의 한 줄: <MIME 타입> <확장자>...
+    void parseTypesLine(const std::string &line);
+    // include <파일>: nginx mime.types 형식 (types { ... })
+    bool parseTypesFile(const std::string &path);
 };
 
 #endif // CONFIGURATION_HPP
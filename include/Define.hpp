@@ -4,19 +4,60 @@
 #define LOG_DIR "./logs"
 #define STATUS_SUCCESS_LOG_FILE "./logs/status_success.log"
 #define STATUS_ERROR_LOG_FILE "./logs/status_error.log"
+#define ACCESS_LOG_FILE "./logs/access.log"
 #define INTERNAL_ERROR_LOG_FILE "./logs/internal_error.log"
+#define SERVER_INFO_LOG_FILE "./logs/server_info.log"
 #define SERVER_CONFIG_LOG_FILE "./logs/server_config.log"
 #define ROOT_DIRECTORY "./www/html"
 #define DEFAULT_INDEX_PATH "./www/html/index.html"
-#define SUCCESS_200 "200 SUCCESS"
-#define REDIRECTION_301 "301 Moved Permanently"
-#define NOT_FOUND_400 "400 Not Found"
-#define BAD_REQUEST_404 "404 Bad Request"
-#define METHOD_NOT_ALLOWED_405 "405 Method Not Allowed"
-#define INTERNAL_SERVER_ERROR_500 "500 Internal Server Error"
-#define PAYLOAD_TOO_LARGE_413 "413 Payload Too Lage"
 #define MAX_EVENTS 1024
+#define WORKER_CONNECTIONS 1024
+#define FD_RESERVE_MARGIN 64       // 리스너, 로그, CGI 파이프, 파일 열기에 남겨 둘 fd 수
+#define ACCEPT_RETRY_MS 500        // EMFILE 후 리스너를 다시 켜기까지의 대기 시간
+#define ACCEPT_RESUME_PERCENT 90   // 연결 수가 worker_connections의 이 비율 아래로 내려가면 accept 재개
+#define WORKER_THREADS_MAX 64      // worker_threads 상한
+#define LOOP_CHECK_MS 50           // 주 루프가 다른 루프의 연결 수 변화를 기다릴 때의 확인 간격
+#define IO_THREADS 2               // io_threads 기본값 (IoPool 대기열마다)
+#define IO_THREADS_MAX 64          // io_threads 상한
+#define MMAP_CACHE_SIZE (64 << 20) // mmap_cache 기본 크기 (매핑해 둘 파일 크기 합)
+#define MMAP_MIN_FILE (16 << 10)   // 이보다 작은 파일은 읽어서 보냄 (매핑 비용이 복사보다 큼)
+#define MMAP_MAX_FILE (16 << 20)   // 이보다 큰 파일은 캐시하지 않음
+#define AUTOINDEX_PAGE_SIZE 1000   // autoindex 한 페이지의 기본 항목 수 (?limit=)
+#define AUTOINDEX_PAGE_MAX 10000   // ?limit= 상한
+#define AUTOINDEX_CACHE_DIRS 64    // 목록을 캐시해 둘 디렉터리 수
+#define AUTOINDEX_CACHE_PAGES 32   // 디렉터리마다 캐시해 둘 페이지 수
+#define UPLOAD_BLOB_DIR ".blobs"     // upload_store: 업로드 디렉터리 안의 내용 주소 저장소
+#define UPLOAD_SESSION_DIR ".sessions" // upload_resumable: 이어 올리기 세션 (<id>.info, <id>.part)
+#define UPLOAD_SESSION_TTL 86400       // upload_resumable: 이만큼(초) 조각이 오지 않은 세션은 지움
+#define UPLOAD_SESSION_SWEEP 60        // 오래된 세션을 찾아보는 간격 (초)
+#define UPLOAD_FSYNC_BATCH_MS 10         // upload_fsync batched: 묶음을 모으는 시간
+#define UPLOAD_FSYNC_BATCH_MAX 64        // 이만큼 모이면 시간을 기다리지 않고 내려 씀
+#define RATE_LIMIT_ZONE_SIZE (1 << 20) // zone=name에 크기가 없을 때 (32바이트 칸 약 3만 개)
+#define RATE_LIMIT_WAYS 8              // 주소 해시 하나가 가리키는 칸 수
+#define RATE_LIMIT_MAX_ZONES 16
+#define SHUTDOWN_TIMEOUT_MS 10000          // 종료/바이너리 교체 때 진행 중인 연결을 기다리는 기본 시간
+#define LISTEN_FDS_ENV "WEBSERV_LISTEN_FDS" // SIGUSR2: 새 바이너리에 넘기는 리스너 ("port:fd;...")
+#define READY_FD_ENV "WEBSERV_READY_FD"     // SIGUSR2: 새 바이너리가 준비되면 쓰는 파이프
 #define BUFFER_SIZE 4096
+#define ARENA_BLOCK_SIZE 8192
+#define RECV_BUFFER_SIZE 16384
+#define RECV_POOL_MAX_FREE 1024
+#define RECV_MAX_HEADER_SIZE 65536
+#define IO_URING_ENTRIES 256
+#define IO_URING_SEND_CANCEL_ROUNDS 20 // 종료할 때 취소한 송신의 완료를 기다리는 횟수 (LOOP_CHECK_MS마다)
+#define IO_URING_RECV_BUFFERS 128 // io_uring 수신용 제공 버퍼 수 (2의 거듭제곱, 크기는 RECV_BUFFER_SIZE)
+#define LOG_RING_SIZE (1 << 18) // 2의 거듭제곱
+#define LOG_MAX_CHANNELS 16
+#define ACCESS_LOG_MAX 64 // 컴파일된 (파일, 형식) 조합 수
+#define LOG_FLUSH_INTERVAL_MS 100
+#define LOG_LINE_MAX 4096
+#define SLOW_REQUEST_THRESHOLD_MS 1000
+#define METRICS_CACHE_LINE 64
+#define METRICS_LATENCY_BUCKETS 24 // 1us .. 2^23us(약 8초)
+#define CGI_HEADER_MAX 16384     // CGI 응답 헤더 상한 (넘으면 500)
+#define CGI_READ_SIZE 16384      // 이벤트 루프가 CGI 파이프에서 한 번에 읽는 크기
+#define CGI_STREAM_BUFFER 65536  // 송신 버퍼에 이만큼 쌓이면 클라이언트가 받을 때까지 CGI 출력을 읽지 않음
+#define CGI_ABORT_CHECK_MS 100   // 헤더를 기다리는 동안 종료 요청(abortPending)을 확인하는 간격
 #define PYTHON_PATH "/usr/bin/python3"
 #define ASCII_ART_PATH "./assets/ascii_art"
 
@@ -0,0 +1,45 @@
+#ifndef DIRECTORYLISTING_HPP
+#define DIRECTORYLISTING_HPP
+
+#include "Define.hpp"
+#include "HttpRequestParser.hpp"
+#include <string>
+#include <vector>
+
+enum ListingFormat
+{
+    LISTING_HTML,
+    LISTING_JSON
+};
+
+// autoindex 쿼리 파라미터: ?format=html|json&order=asc|desc&page=N&limit=M
+struct ListingQuery
+{
+    ListingFormat format;
+    bool descending; // 이름 역순 (디렉터리는 항상 파일보다 앞)
+    size_t page;     // 1부터
+    size_t limit;    // 한 페이지의 항목 수 (AUTOINDEX_PAGE_MAX 이하)
+
+    ListingQuery() : format(LISTING_HTML), descending(false), page(1), limit(AUTOINDEX_PAGE_SIZE)
+    {
+    }
+};
+
+// 디렉터리 목록 (autoindex, 업로드 목록)
+// readdir의 d_type으로 항목 종류를 알아내므로 항목마다 stat()하지 않습니다. (d_type을 주지 않는 파일 시스템만 stat)
+// 정렬한 목록과 만든 페이지는 디렉터리의 mtime/inode가 같은 동안 캐시해 두고 모든 스레드가 함께 씁니다.
+class DirectoryListing
+{
+  public:
+    static ListingQuery parseQuery(const HeaderMap &params);
+    // dir의 목록 한 페이지를 body에 만듭니다. uri는 링크의 기준이 되는 요청 경로('/'로 끝남). 열 수 없으면 false
+    static bool render(const std::string &dir, const std::string &uri, const ListingQuery &query, std::string &body);
+    // 일반 파일 이름만 담은 업로드 목록 JSON ({ "files": [...] })
+    static bool renderFileList(const std::string &dir, std::string &body);
+    static void clear();
+
+  private:
+    DirectoryListing();
+};
+
+#endif // DIRECTORYLISTING_HPP
@@ -0,0 +1,62 @@
+#ifndef FILECACHE_HPP
+#define FILECACHE_HPP
+
+#include "Define.hpp"
+#include <string>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+// 읽기 전용으로 매핑한 파일 하나. 캐시 테이블과 이를 보내는 응답들이 참조를 나눠 가집니다.
+struct MappedFile
+{
+    std::string path;
+    const char *data;
+    size_t size;
+    dev_t dev;
+    ino_t ino;
+    time_t mtime;
+    long mtime_nsec;
+    const std::string *mime; // 매핑할 때 찾은 Content-Type (MimeTypes 표의 문자열)
+    unsigned mime_generation; // mime을 찾은 표의 번호. 설정을 다시 읽어 표가 바뀌면 다시 찾습니다.
+    unsigned refs;    // 테이블에 있는 동안 1 + 응답 수 (0이 되면 munmap)
+    MappedFile *prev; // LRU 목록 (앞쪽이 최근)
+    MappedFile *next;
+};
+
+struct FileCacheStats
+{
+    size_t entries;
+    size_t bytes;       // 테이블에 있는 매핑의 크기 합
+    size_t hits;
+    size_t misses;
+    size_t evictions;   // 캐시 크기를 넘어 밀어낸 횟수
+    size_t invalidated; // 파일이 바뀌어 다시 매핑한 횟수
+
+    FileCacheStats() : entries(0), bytes(0), hits(0), misses(0), evictions(0), invalidated(0)
+    {
+    }
+};
+
+// 정적 파일 매핑 캐시 (mmap_cache)
+// 파일을 한 번 매핑해 모든 연결이 참조 카운트로 공유하고, 응답은 헤더 뒤에 매핑을 그대로 송신합니다.
+// 캐시 크기를 넘으면 가장 오래 쓰지 않은 항목을, 요청 때 mtime/크기가 바뀌었으면 그 항목을 테이블에서 빼고,
+// 보내는 중인 응답이 있으면 마지막 참조가 놓일 때 munmap합니다. 모든 스레드가 잠금 하나를 함께 씁니다.
+class FileCache
+{
+  public:
+    // 시작할 때와 설정을 다시 읽을 때 호출합니다. cache_size가 0이면 끕니다.
+    static void configure(size_t cache_size, size_t min_file, size_t max_file);
+    // st는 path를 stat한 결과입니다. 캐시 대상 크기의 일반 파일이면 참조를 하나 잡은 매핑을,
+    // 대상이 아니거나 매핑에 실패하면 NULL을 돌려줍니다. (호출한 쪽이 읽어서 보냄)
+    static MappedFile *acquire(const std::string &path, const struct stat &st);
+    static void retain(MappedFile *file);
+    static void release(MappedFile *file);
+    // 테이블을 비웁니다. 보내는 중인 매핑은 마지막 참조가 놓일 때 해제됩니다.
+    static void clear();
+    static FileCacheStats stats();
+
+  private:
+    FileCache();
+};
+
+#endif // FILECACHE_HPP
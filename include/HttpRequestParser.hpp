@@ -1,6 +1,7 @@
 #ifndef PARSER_HPP
 #define PARSER_HPP
 
+#include "Arena.hpp"
 #include "LocationConfig.hpp"
 #include <algorithm>
 #include <cctype>
@@ -10,14 +11,20 @@
 #include <string>
 #include <vector>
 
+// 요청 단위로 생성되는 맵은 연결의 아레나에서 노드를 할당합니다.
+typedef std::map<std::string, std::string, std::less<std::string>,
+                 ArenaAllocator<std::pair<const std::string, std::string> > >
+    HeaderMap;
+
 // 파싱 결과를 한 번에 전달하기 위한 구조체
 struct ParsedRequest
 {
     std::string method;
     std::string path;
     std::string query_string;
-    std::map<std::string, std::string> queryParams;
-    std::map<std::string, std::string> headers;
+    std::string path_info; // 스크립트 경로 뒤에 붙은 부분 (CGI PATH_INFO)
+    HeaderMap queryParams;
+    HeaderMap headers;
     std::string body;
     std::vector<UploadedFile> uploaded_files;
     std::map<std::string, std::string> form_fields;
@@ -39,9 +46,9 @@ class Parser
     Parser(const Parser &);
     Parser &operator=(const Parser &);
 
-    // HttpRequestParser.cpp – 메인 파싱 로직 (각 함수 25줄 이하)
-    bool parseRequestLine(const std::string &line, ParsedRequest &req);
-    bool parseHeaders(const std::string &data, size_t &offset, std::map<std::string, std::string> &headers,
+    // HttpRequestParser.cpp – 메인 파싱 로직 (각 함수 25줄 이하, 스캔은 HttpTokenizer 사용)
+    bool parseRequestLine(const char *line, size_t len, ParsedRequest &req);
+    bool parseHeaders(const std::string &data, size_t &offset, HeaderMap &headers,
                       bool &isPartial);
 
     // HttpParserUtils.cpp – 유틸리티 함수들
@@ -0,0 +1,23 @@
+#ifndef HTTPSTATUS_HPP
+#define HTTPSTATUS_HPP
+
+#include <cstddef>
+
+// 상태 코드로 바로 인덱싱되는 미리 포맷된 상태 라인 테이블
+// 예: statusLine(404) -> "HTTP/1.1 404 Not Found\r\n"
+class HttpStatus
+{
+  public:
+    static const int MAX_CODE = 600;
+
+    static const char *reason(int code);
+    static const char *statusLine(int code, size_t &len);
+
+    // "Date: Sun, 06 Nov 1994 08:49:37 GMT\r\n" (초 단위로 캐시)
+    static const char *dateHeader(size_t &len);
+
+  private:
+    HttpStatus();
+};
+
+#endif // HTTPSTATUS_HPP
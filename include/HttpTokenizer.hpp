@@ -0,0 +1,40 @@
+#ifndef HTTPTOKENIZER_HPP
+#define HTTPTOKENIZER_HPP
+
+#include <cstddef>
+
+// 요청 라인/헤더 스캐너 (picohttpparser 방식)
+// CRLF와 허용되지 않는 제어 문자, 헤더 이름 끝의 ':'(tchar가 아닌 첫 바이트)를 SSE4.2/AVX2로 16/32바이트씩 찾고,
+// 지원하지 않는 CPU에서는 스칼라 구현을 사용합니다. (CPUID로 런타임 선택)
+class HttpTokenizer
+{
+  public:
+    enum LineStatus
+    {
+        LINE_OK,
+        LINE_PARTIAL,
+        LINE_INVALID
+    };
+
+    // buf[0, len)에서 첫 줄의 끝(CR 위치)을 찾습니다.
+    // HTAB 이외의 제어 문자나 단독 LF가 있으면 LINE_INVALID를 반환합니다.
+    static LineStatus scanLine(const char *buf, size_t len, size_t &line_end);
+
+    // HTAB을 제외한 첫 번째 제어 문자(CTL)의 위치, 없으면 len
+    static size_t findCtl(const char *buf, size_t len);
+
+    // RFC 9110 tchar / token 검사
+    static bool isTokenChar(unsigned char c);
+    static bool isToken(const char *buf, size_t len);
+
+    // 헤더 이름을 검증하며 ':' 위치를 찾습니다. 이름이 잘못되었으면 false
+    static bool scanHeaderName(const char *buf, size_t len, size_t &colon);
+
+    // 현재 선택된 구현 이름 ("avx2", "sse4.2", "scalar")
+    static const char *implementationName();
+
+  private:
+    HttpTokenizer();
+};
+
+#endif // HTTPTOKENIZER_HPP
@@ -0,0 +1,63 @@
+#ifndef IOPOOL_HPP
+#define IOPOOL_HPP
+
+#include "Define.hpp"
+#include <pthread.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+// 작업 종류별 대기열. 느린 디렉터리 조회나 CGI가 정적 파일 읽기를 막지 않도록 스레드를 따로 둡니다.
+enum IoQueue
+{
+    IO_QUEUE_NONE = -1, // 디스크를 쓰지 않음: 이벤트 루프에서 바로 처리
+    IO_QUEUE_FILE,      // 정적 파일, 에러 페이지 읽기
+    IO_QUEUE_UPLOAD,    // POST 업로드 저장
+    IO_QUEUE_DIRECTORY, // 업로드 목록 조회, 파일 삭제
+    IO_QUEUE_CGI,       // CGI 실행
+    IO_QUEUE_COUNT
+};
+
+// 이벤트 루프 대신 풀 스레드에서 실행할 작업
+class IoTask
+{
+  public:
+    virtual ~IoTask()
+    {
+    }
+    // 풀 스레드에서 실행합니다.
+    virtual void run() = 0;
+    // run() 직후 같은 스레드에서 호출합니다. 작업을 맡긴 쪽에 결과를 돌려줍니다. (이후 작업은 맡긴 쪽 소유)
+    virtual void complete() = 0;
+};
+
+struct IoQueueStats
+{
+    size_t threads;
+    size_t depth;       // 시작을 기다리는 작업 수
+    size_t active;      // 실행 중인 작업 수
+    uint64_t completed; // 끝난 작업 수
+
+    IoQueueStats() : threads(0), depth(0), active(0), completed(0)
+    {
+    }
+};
+
+// 대기열마다 고정된 수의 스레드가 작업을 꺼내 실행합니다. (io_threads)
+class IoPool
+{
+  public:
+    // 대기열마다 threads개의 스레드를 시작합니다. 0이거나 실패하면 false (작업은 호출한 스레드에서 처리)
+    static bool start(size_t threads);
+    // 남은 작업을 모두 실행한 뒤 스레드를 종료합니다.
+    static void stop();
+    // 풀이 실행 중이 아니면 false (작업은 맡겨지지 않음)
+    static bool submit(IoQueue queue, IoTask *task);
+    static IoQueueStats stats(IoQueue queue);
+    static const char *queueName(IoQueue queue);
+
+  private:
+    IoPool();
+    static void *workerMain(void *arg);
+};
+
+#endif // IOPOOL_HPP
@@ -0,0 +1,114 @@
+#ifndef IOURINGPOLLER_HPP
+#define IOURINGPOLLER_HPP
+
+#if defined(__linux__) && defined(WEBSERV_IO_URING)
+
+#include "Define.hpp"
+#include "Log.hpp"
+#include "Poller.hpp"
+#include <linux/io_uring.h>
+#include <map>
+#include <stdint.h>
+#include <sys/socket.h>
+#include <vector>
+
+// io_uring 기반 Poller (liburing 없이 시스템 콜을 직접 사용)
+// 클라이언트 소켓은 완료 기반으로 처리합니다. (커널 6.0 이상)
+//   - 리스너: multishot accept 하나가 받은 연결마다 POLLER_ACCEPTED를 냅니다.
+//   - 수신: multishot recv가 제공 버퍼(IORING_OP_PROVIDE_BUFFERS)에 받아 POLLER_RECEIVED로 넘깁니다.
+//     넘긴 버퍼는 다음 poll()에서 커널에 돌려줍니다.
+//   - 송신: IORING_OP_SENDMSG 하나가 헤더와 매핑된 본문을 함께 보내고 POLLER_SENT로 보낸 바이트를 알립니다.
+// CGI 파이프와 깨움 fd는 IORING_OP_POLL_ADD를 걸고, 이벤트가 오면 다음 poll()에서 다시 겁니다.
+// 모든 제출과 재등록은 SQ에 모아 두었다가 poll()의 io_uring_enter 한 번으로 제출합니다.
+class IoUringPoller : public Poller
+{
+  public:
+    IoUringPoller();
+    ~IoUringPoller();
+
+    bool add(int fd, uint32_t events);
+    bool modify(int fd, uint32_t events);
+    bool remove(int fd);
+    int poll(std::vector<Event> &events, int timeout = -1);
+
+    bool completionIo() const;
+    bool addAcceptor(int listen_fd);
+    bool addReceiver(int fd);
+    bool send(int fd, const struct iovec *iov, int iovcnt);
+
+  private:
+    IoUringPoller(const IoUringPoller &);
+    IoUringPoller &operator=(const IoUringPoller &);
+
+    // 등록 종류 (user_data에도 넣어 등록이 사라진 뒤의 완료도 구분합니다)
+    enum Kind
+    {
+        KIND_POLL,
+        KIND_ACCEPT,
+        KIND_RECV,
+        KIND_SEND
+    };
+
+    struct FdState
+    {
+        uint32_t events;
+        uint32_t generation;
+        Kind kind;
+        bool armed; // 커널에 걸려 있음 (multishot은 F_MORE 없는 마지막 완료까지)
+    };
+
+    // 완료될 때까지 커널이 읽는 SENDMSG 인자
+    struct SendState
+    {
+        struct msghdr msg;
+        struct iovec iov[2];
+    };
+
+    int _ring_fd;
+    unsigned _sq_entries;
+    unsigned _cq_entries;
+
+    void *_sq_ring;
+    void *_cq_ring;
+    size_t _sq_ring_size;
+    size_t _cq_ring_size;
+    struct io_uring_sqe *_sqes;
+    size_t _sqes_size;
+
+    unsigned *_sq_head;
+    unsigned *_sq_tail;
+    unsigned *_sq_mask;
+    unsigned *_sq_array;
+    unsigned *_cq_head;
+    unsigned *_cq_tail;
+    unsigned *_cq_mask;
+    struct io_uring_cqe *_cqes;
+
+    // 수신용 제공 버퍼 (없으면 완료 기반 I/O를 쓰지 않음)
+    char *_buffers;
+    size_t _buffers_size;
+    std::vector<unsigned> _lent; // 지난 poll()에서 넘겨준 버퍼 (다음 poll()에서 커널에 돌려줌)
+
+    unsigned _pending; // 아직 제출하지 않은 SQE 수
+    uint32_t _next_generation;
+    std::map<int, FdState> _fds;
+    std::map<int, SendState> _sends; // 완료를 기다리는 송신
+    std::vector<int> _rearm;
+
+    struct io_uring_sqe *getSqe();
+    bool registerFd(int fd, uint32_t events, Kind kind);
+    uint32_t nextGeneration();
+    bool queueArm(int fd, FdState &state);
+    bool queueCancel(uint64_t user_data, Kind kind);
+    bool setupBuffers();
+    bool queueProvide(unsigned first, unsigned count);
+    void recycleBuffers();
+    void handleCompletion(const struct io_uring_cqe &cqe, std::vector<Event> &events_out);
+    int enter(unsigned to_submit, unsigned min_complete, int timeout);
+    void rearmFired();
+    void releaseRing();
+};
+
+#endif
+
+#endif
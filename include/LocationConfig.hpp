@@ -1,7 +1,9 @@
 #ifndef LOCATIONCONFIG_HPP
 #define LOCATIONCONFIG_HPP
 
+#include "Define.hpp"
 #include <map>
+#include <stdint.h>
 #include <string>
 #include <vector>
 
@@ -16,6 +18,50 @@ struct UploadedFile
     size_t filesize;
 };
 
+// 설정 파일 대신 서버 상태를 보여주는 location
+enum StatusPage
+{
+    STATUS_PAGE_NONE,
+    STATUS_PAGE_STUB,      // stub_status (nginx 형식)
+    STATUS_PAGE_PROMETHEUS // metrics (Prometheus 텍스트 형식)
+};
+
+// upload_fsync off|file|batched; 업로드를 이름으로 옮기기 전에 내용을 디스크에 내려 쓰는 방식
+enum UploadFsync
+{
+    UPLOAD_FSYNC_OFF,    // 페이지 캐시에만 (원자적 교체는 그대로)
+    UPLOAD_FSYNC_FILE,   // 파일마다 fsync, 이름을 옮긴 뒤 디렉터리도 fsync
+    UPLOAD_FSYNC_BATCHED // 여러 업로드를 모아 syncfs 한 번 (UploadSync)
+};
+
+// limit_req zone=<name>[:size] rate=<N>r/s|r/m [burst=N] [nodelay];
+struct LimitReqConfig
+{
+    std::string zone; // 비어 있으면 제한하지 않음
+    size_t zone_size; // zone 공유 메모리 크기 (바이트)
+    uint64_t rate;    // 초당 요청 수 * 1000
+    uint64_t burst;   // 지연시켜 받아 줄 초과 요청 수 (넘으면 거절)
+    bool nodelay;     // burst 안의 초과 요청도 지연 없이 처리
+    int zone_id;      // RateLimit::registerZone()이 돌려준 번호
+
+    LimitReqConfig() : zone_size(RATE_LIMIT_ZONE_SIZE), rate(0), burst(0), nodelay(false), zone_id(-1)
+    {
+    }
+};
+
+// limit_conn zone=<name>[:size] <N>; (주소별 동시에 처리 중인 요청 수)
+struct LimitConnConfig
+{
+    std::string zone;
+    size_t zone_size;
+    uint32_t limit;
+    int zone_id;
+
+    LimitConnConfig() : zone_size(RATE_LIMIT_ZONE_SIZE), limit(0), zone_id(-1)
+    {
+    }
+};
+
 struct LocationConfig
 {
     std::string root;
@@ -25,6 +71,7 @@ struct LocationConfig
     std::string index;
     std::vector<std::string> cgi_extension;
     std::vector<std::string> cgi_path;
+    std::map<std::string, std::string> cgi_interpreters; // 확장자(점 없이 소문자) → 인터프리터. 설정을 읽을 때 위 둘을 짝지어 만듦
     std::map<int, std::string> error_pages; // location별 에러 페이지 (없으면 비어있음)
     std::string default_file;               // default file for directory request
     bool directory_listing;
@@ -34,11 +81,19 @@ struct LocationConfig
     // 업로드 관련 설정
     std::string upload_directory;
     std::vector<std::string> allowed_extensions;
+    bool upload_store; // 같은 내용은 SHA-256 이름의 blob 하나에 하드 링크로 저장
+    bool upload_resumable; // tus 방식 이어 올리기 (POST/HEAD/PATCH <location>/<id>)
+    UploadFsync upload_fsync;
     // 추가적인 설정 항목
+    StatusPage status_page;
+    int metrics_id; // Metrics::registerLocation()이 돌려준 번호
+    // 없으면 server 블록의 설정을 물려받습니다.
+    LimitReqConfig limit_req;
+    LimitConnConfig limit_conn;
 
     LocationConfig()
         : path("/"), redirect(""), index("index.html"), 
-        directory_listing(false), client_max_body_size(0)
+        directory_listing(false), client_max_body_size(0), upload_store(false), upload_resumable(false), upload_fsync(UPLOAD_FSYNC_OFF), status_page(STATUS_PAGE_NONE), metrics_id(-1)
     {
     }
 };
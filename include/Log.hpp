@@ -25,6 +25,8 @@ class LogConfig
     static void reportSuccess(int status, const std::string &message);
     static void reportError(int status, const std::string &message);
     static void reportInternalError(const std::string &message);
+    // 오류가 아닌 서버 상태 변화 (재시작, 설정 다시 읽기, 종료 대기 등)
+    static void reportInfo(const std::string &message);
     static void printColoredMessage(const std::string &message, const char *time_str, const std::string &color);
 };
 
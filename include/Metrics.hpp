@@ -0,0 +1,58 @@
+#ifndef METRICS_HPP
+#define METRICS_HPP
+
+#include "Define.hpp"
+#include <stdint.h>
+#include <string>
+
+enum MetricCounter
+{
+    METRIC_ACCEPTS,
+    METRIC_HANDLED,
+    METRIC_REQUESTS,
+    METRIC_RESPONSES_1XX,
+    METRIC_RESPONSES_2XX,
+    METRIC_RESPONSES_3XX,
+    METRIC_RESPONSES_4XX,
+    METRIC_RESPONSES_5XX,
+    METRIC_BYTES_IN,
+    METRIC_BYTES_OUT,
+    METRIC_CGI_SPAWNS,
+    METRIC_CGI_FAILURES,
+    METRIC_REJECTED,      // 과부하로 503 응답 후 닫은 연결
+    METRIC_ACCEPT_PAUSES, // 리스너를 poller에서 뺀 횟수
+    METRIC_LIMIT_REQ_DELAYED,
+    METRIC_LIMIT_REQ_REJECTED,
+    METRIC_LIMIT_CONN_REJECTED,
+    // 게이지: 이벤트 루프가 반복마다 현재 값을 기록합니다.
+    METRIC_CONNECTIONS_ACTIVE,
+    METRIC_CONNECTIONS_READING,
+    METRIC_CONNECTIONS_WRITING,
+    METRIC_COUNTER_COUNT
+};
+
+// 워커(스레드)별 카운터는 각자 캐시 라인에 정렬되어 있고 소유 스레드만 갱신합니다.
+// 스크레이프할 때만 모든 워커의 값을 더합니다.
+class Metrics
+{
+  public:
+    // 설정 로드 시 location마다 한 번 호출합니다. 반환값은 LocationConfig::metrics_id
+    static int registerLocation(const std::string &server, const std::string &location);
+
+    static void add(MetricCounter counter, uint64_t n = 1);
+    static void set(MetricCounter counter, uint64_t value);
+    static void countResponse(int status);
+    // 요청 처리 시간 (마이크로초)을 location별 log2 히스토그램에 기록합니다.
+    static void observeRequest(int location_id, uint64_t usec);
+    static void observeCgi(uint64_t usec, bool ok);
+
+    // Prometheus 텍스트 형식
+    static void renderPrometheus(std::string &out);
+    // nginx stub_status 형식
+    static void renderStubStatus(std::string &out);
+
+  private:
+    Metrics();
+};
+
+#endif // METRICS_HPP
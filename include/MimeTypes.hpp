@@ -0,0 +1,29 @@
+#ifndef MIMETYPES_HPP
+#define MIMETYPES_HPP
+
+#include <string>
+#include <utility>
+#include <vector>
+
+// (소문자 확장자, MIME 타입)
+typedef std::vector<std::pair<std::string, std::string> > MimeTypeList;
+
+// 확장자 -> MIME 타입 표 (types { ... } / include mime.types)
+// 설정을 읽을 때 최소 완전 해시(hash-and-displace)로 만들어 두므로, 조회는 해시 두 번과 비교 한 번입니다.
+// 설정을 다시 읽으면 새 표로 바꾸고, 이전 표는 그 문자열을 가리키는 캐시가 있을 수 있어 clear()까지 남겨 둡니다.
+class MimeTypes
+{
+  public:
+    // 비어 있으면 내장 기본 표를 씁니다.
+    static void install(const MimeTypeList &types);
+    // 경로의 확장자로 찾고, 없으면 application/octet-stream. generation에는 찾은 표의 번호를 돌려줍니다.
+    static const std::string &lookup(const std::string &path, unsigned *generation = 0);
+    // 지금 쓰는 표의 번호 (install할 때마다 바뀜)
+    static unsigned generation();
+    static void clear();
+
+  private:
+    MimeTypes();
+};
+
+#endif // MIMETYPES_HPP
@@ -1,17 +1,29 @@
 #ifndef POLLER_HPP
 #define POLLER_HPP
 
+#include <cstddef>
 #include <stdint.h>
+#include <sys/uio.h>
 #include <vector>
 
 // Poller 추상화 클래스에서 사용할 자체 이벤트 플래그 정의
 const uint32_t POLLER_READ = 1 << 0;
 const uint32_t POLLER_WRITE = 1 << 1;
+// 완료 기반 백엔드(io_uring)가 끝낸 작업. result는 해당 시스템 콜의 반환값 (실패면 -errno)
+const uint32_t POLLER_ACCEPTED = 1 << 2; // fd: 리스너, result: 받은 연결
+const uint32_t POLLER_RECEIVED = 1 << 3; // data/result: 받은 바이트 (다음 poll()까지 유효, 0이면 EOF)
+const uint32_t POLLER_SENT = 1 << 4;     // result: 보낸 바이트 수
 
 struct Event
 {
     int fd;
     uint32_t events;
+    int result;
+    const char *data;
+
+    Event() : fd(-1), events(0), result(0), data(NULL)
+    {
+    }
 };
 
 class Poller
@@ -24,6 +36,28 @@ class Poller
     virtual bool modify(int fd, uint32_t events) = 0;
     virtual bool remove(int fd) = 0;
     virtual int poll(std::vector<Event> &events, int timeout = -1) = 0;
+
+    // 완료 기반 I/O. 지원하는 백엔드에서만 true이고, 아니면 서버가 준비 이벤트를 받아 직접 accept/recv/send합니다.
+    virtual bool completionIo() const
+    {
+        return false;
+    }
+    // 리스너에서 계속 받아 POLLER_ACCEPTED로 알립니다. remove()로 멈춥니다.
+    virtual bool addAcceptor(int)
+    {
+        return false;
+    }
+    // 연결에서 계속 받아 POLLER_RECEIVED로 알립니다. modify()에서 POLLER_READ를 빼면 멈추고, 다시 넣으면 이어 받습니다.
+    virtual bool addReceiver(int)
+    {
+        return false;
+    }
+    // iov(최대 2개)를 보내고 POLLER_SENT로 알립니다. 연결마다 하나씩만 제출하고, 완료될 때까지 iov가 가리키는
+    // 메모리와 fd를 그대로 두어야 합니다. remove()는 제출한 송신을 취소하지만 완료는 그래도 알립니다.
+    virtual bool send(int, const struct iovec *, int)
+    {
+        return false;
+    }
 };
 
 #endif
@@ -0,0 +1,41 @@
+#ifndef RATELIMIT_HPP
+#define RATELIMIT_HPP
+
+#include "Define.hpp"
+#include <netinet/in.h>
+#include <stdint.h>
+#include <string>
+
+// limit_req / limit_conn 판정 결과
+enum LimitResult
+{
+    LIMIT_PASS,
+    LIMIT_DELAY,  // burst 안의 초과 요청: delay_us 뒤에 처리
+    LIMIT_REJECT  // burst를 넘었거나 동시 요청 수 초과
+};
+
+// 클라이언트 주소별 상태를 담는 고정 크기 테이블(zone)
+// 설정을 읽을 때 MAP_SHARED로 한 번 할당하므로 fork한 워커 프로세스도 같은 상태를 보고,
+// 요청 처리 중의 조회/갱신은 할당 없이 O(1)입니다.
+// 주소 해시로 RATE_LIMIT_WAYS칸짜리 묶음을 고르고, 묶음이 가득 차면 가장 오래 쓰지 않은 칸을 재사용합니다.
+class RateLimit
+{
+  public:
+    // zone=<name>[:size] 마다 호출합니다. 같은 이름은 같은 zone을 돌려줍니다. 실패하면 -1
+    static int registerZone(const std::string &name, size_t bytes);
+
+    // 누적 초과분(leaky bucket) 판정. rate는 초당 요청 수 * 1000, burst는 요청 수
+    static LimitResult acquireRequest(int zone, in_addr_t addr, uint64_t rate, uint64_t burst, bool nodelay,
+                                      uint64_t now_us, uint64_t &delay_us);
+    // 처리 중인 요청 수를 하나 늘립니다. limit에 도달해 있으면 LIMIT_REJECT
+    static LimitResult acquireConn(int zone, in_addr_t addr, uint32_t limit, uint64_t now_us);
+    static void releaseConn(int zone, in_addr_t addr);
+
+    // 칸이 모자라 다른 주소의 상태를 밀어낸 횟수 (모든 zone 합계)
+    static uint64_t evictions();
+
+  private:
+    RateLimit();
+};
+
+#endif // RATELIMIT_HPP
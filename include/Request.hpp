@@ -11,6 +11,7 @@
 #include "Utils.hpp"
 
 #include <map>
+#include <netinet/in.h>
 #include <sstream>
 #include <string>
 #include <vector>
@@ -28,29 +29,35 @@ class Request
     // Getter
     const std::vector<UploadedFile> &getUploadedFiles() const;
     const std::map<std::string, std::string> &getFormFields() const;
-    std::string getMethod() const;
-    std::string getPath() const;
-    std::string getQueryString() const;
-    std::string getHTTPVersion() const;
-    std::map<std::string, std::string> getQueryParams() const;
-    std::map<std::string, std::string> getHeaders() const;
-    std::string getBody() const;
+    const std::string &getMethod() const;
+    const std::string &getPath() const;
+    const std::string &getQueryString() const;
+    const std::string &getPathInfo() const;
+    const std::string &getHTTPVersion() const;
+    const HeaderMap &getQueryParams() const;
+    const HeaderMap &getHeaders() const;
+    const std::string &getBody() const;
+    in_addr_t getRemoteAddr() const;
 
     // Setter
     void setUploadedFiles(const std::vector<UploadedFile> &files);
     void setFormFields(const std::map<std::string, std::string> &fields);
     void setBody(const std::string &body_data);
+    // 연결의 상대 주소 (CGI REMOTE_ADDR)
+    void setRemoteAddr(in_addr_t addr);
 
   private:
     std::string _method;
     std::string _path;
     std::string _query_string;
-    std::map<std::string, std::string> _queryParams;
-    std::map<std::string, std::string> _headers;
+    std::string _path_info;
+    HeaderMap _queryParams;
+    HeaderMap _headers;
     std::vector<UploadedFile> _uploaded_files;
     std::map<std::string, std::string> _form_fields;
     std::string _httpVersion;
     std::string _body;
+    in_addr_t _remote_addr;
 };
 
 #endif // REQUEST_HPP
@@ -0,0 +1,76 @@
+#ifndef REQUESTTIMING_HPP
+#define REQUESTTIMING_HPP
+
+#include <stdint.h>
+#include <string>
+
+// 요청 처리 단계의 경계. 순서대로 지나갑니다. (UPSTREAM은 CGI 요청에만 있음)
+enum TimingPhase
+{
+    PHASE_IDLE_START,     // 연결 수락 또는 keep-alive 연결에서 이전 응답 완료
+    PHASE_RECV_START,     // 요청의 첫 바이트 수신
+    PHASE_RECV_END,       // 요청 전체 수신
+    PHASE_PARSED,         // 파싱 완료
+    PHASE_RESOLVED,       // location/realpath 확인 완료
+    PHASE_UPSTREAM_START, // CGI 실행 시작
+    PHASE_UPSTREAM_END,   // CGI 출력 수신 완료 (헤더를 읽으면 기록하고 본문을 다 읽으면 다시 기록)
+    PHASE_HANDLED,        // 응답 생성 완료
+    PHASE_FIRST_BYTE,     // 응답 첫 바이트 송신
+    PHASE_LAST_BYTE,      // 응답 마지막 바이트 송신
+    PHASE_COUNT
+};
+
+// 요청 하나의 단계별 CLOCK_MONOTONIC 시각 (마이크로초, 0이면 지나지 않은 단계)
+class RequestTiming
+{
+  public:
+    RequestTiming();
+
+    void mark(TimingPhase phase);
+    // 아직 기록되지 않은 경우에만 기록합니다.
+    void markOnce(TimingPhase phase);
+    uint64_t at(TimingPhase phase) const;
+    // from..to 구간 (마이크로초). 둘 중 하나라도 없으면 0
+    uint64_t span(TimingPhase from, TimingPhase to) const;
+    // 요청 시작부터 마지막 바이트 송신(아직이면 현재)까지
+    uint64_t total() const;
+    // 다음 keep-alive 요청을 위해 비웁니다. 현재 시각이 새 PHASE_IDLE_START가 됩니다.
+    void reset();
+
+    // Server-Timing 헤더 값 (응답 생성 시점까지의 단계, 밀리초)
+    void serverTiming(std::string &out) const;
+    // "idle=0.120 recv=0.004 ... total=3.210" 형식의 전체 단계 (밀리초, 느린 요청 로그용)
+    size_t formatPhases(char *buf, size_t size) const;
+
+    // 현재 요청을 처리하는 동안의 타이밍 (TimingScope로 설정, 스레드별). 핸들러 깊은 곳에서 단계를 기록할 때 사용
+    static RequestTiming *current();
+    static void markCurrent(TimingPhase phase);
+
+  private:
+    uint64_t _at[PHASE_COUNT];
+
+    static __thread RequestTiming *_current;
+
+    friend class TimingScope;
+};
+
+// 스코프 동안 RequestTiming::current()를 교체합니다.
+class TimingScope
+{
+  public:
+    explicit TimingScope(RequestTiming *timing);
+    ~TimingScope();
+
+  private:
+    TimingScope(const TimingScope &);
+    TimingScope &operator=(const TimingScope &);
+
+    RequestTiming *_prev;
+};
+
+// 마이크로초를 "초.밀리초" (nginx $request_time 형식)로 씁니다. 반환값은 길이
+size_t formatSeconds(char *buf, uint64_t usec);
+// 마이크로초를 "밀리초.마이크로초"로 씁니다. 반환값은 길이
+size_t formatMillis(char *buf, uint64_t usec);
+
+#endif // REQUESTTIMING_HPP
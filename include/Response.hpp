@@ -1,9 +1,11 @@
 #ifndef RESPONSE_HPP
 #define RESPONSE_HPP
 
-#include "CGIHandler.hpp" // 필요 시
+#include "CGIHandler.hpp"
 #include "Configuration.hpp"
 #include "Define.hpp"
+#include "FileCache.hpp"
+#include "IoPool.hpp"
 #include "Log.hpp"
 #include "Request.hpp"
 #include "ResponseUtils.hpp"
@@ -24,10 +26,16 @@
 #include <sys/stat.h>
 #include <unistd.h>
 
+// 응답 헤더는 삽입 순서대로 직렬화됩니다.
+typedef std::vector<std::pair<std::string, std::string>, ArenaAllocator<std::pair<std::string, std::string> > >
+    HeaderList;
+
 class Response
 {
   public:
     Response();
+    Response(const Response &other);
+    Response &operator=(const Response &other);
     ~Response();
 
     static Response createResponse(const Request &request, const LocationConfig &location_config,
@@ -35,20 +43,37 @@ class Response
     static Response buildResponse(const Request &request, const ServerConfig &server_config,
                                   const LocationConfig *location_config);
     static Response createErrorResponse(int status, const ServerConfig &server_config);
+    // 응답을 만들 때 디스크를 쓰는지 보고 맡길 IoPool 대기열을 고릅니다. (메모리만 쓰면 IO_QUEUE_NONE)
+    static IoQueue ioQueue(const Request &request, const LocationConfig *location_config);
 
+    // out 뒤에 직렬화된 응답을 덧붙입니다. (송신 버퍼에 직접 기록)
+    // 본문이 매핑된 파일이면 헤더까지만 기록하고, 본문은 getFile()을 송신 버퍼 뒤에 이어 보냅니다.
+    // CGI 출력(getStream())이면 헤더와 함께 읽힌 본문 앞부분도 이벤트 루프가 보냅니다.
+    void serialize(std::string &out) const;
     std::string toString() const;
-    std::string getStatus() const;
+    int getStatusCode() const;
+    size_t getBodySize() const;
+    MappedFile *getFile() const;
+    CgiStream *getStream() const;
 
-    void setStatus(const std::string &status_code);
+    void setStatus(int status_code);
     void setHeader(const std::string &key, const std::string &value);
+    // 같은 이름이 있어도 교체하지 않고 덧붙입니다. (Set-Cookie처럼 여러 번 오는 헤더)
+    void addHeader(const std::string &key, const std::string &value);
     void setBody(const std::string &content);
+    // FileCache::acquire()로 얻은 참조를 넘겨받아 본문으로 씁니다.
+    void setFileBody(MappedFile *file);
+    // CGIHandler::execute()로 얻은 참조를 넘겨받아 본문으로 씁니다.
+    void setStreamBody(CgiStream *stream);
 
     void setCookie(const std::string &key, const std::string &value, const std::string &path = "/", int max_age = 0);
 
   private:
-    std::string _status;
-    std::map<std::string, std::string> _headers;
+    int _status;
+    HeaderList _headers;
     std::string _body;
+    MappedFile *_file;
+    CgiStream *_stream;
 
     static std::string readErrorPageFromFile(const std::string &file_path, int status);
 
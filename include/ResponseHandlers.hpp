@@ -12,19 +12,25 @@ class ResponseHandler
 {
   public:
     static Response handleRedirection(const LocationConfig &location_config);
-    static Response handleCGI(const Request &request, const std::string &real_path, const ServerConfig &server_config);
+    static Response handleCGI(const Request &request, const std::string &real_path,
+                              const LocationConfig &location_config, const ServerConfig &server_config);
     static Response handleStaticFile(const std::string &real_path, const ServerConfig &server_config);
     static Response handleUpload(const std::string &real_path, const Request &request,
                                  const LocationConfig &location_config, const ServerConfig &server_config);
+    static Response handleUploadProbe(const Request &request, const LocationConfig &location_config,
+                                      const ServerConfig &server_config);
     static Response handleFileList(const Request &request, const LocationConfig &location_config,
                                    const ServerConfig &server_config);
     static Response handleDeleteFile(const Request &request, const LocationConfig &location_config,
                                      const ServerConfig &server_config);
     static Response handleDeleteAllFiles(const LocationConfig &location_config, const ServerConfig &server_config);
     static Response handleGetFileList(const LocationConfig &location_config, const ServerConfig &server_config);
+    static Response handleAutoindex(const Request &request, const std::string &real_path,
+                                    const ServerConfig &server_config);
     static Response handleMethodNotAllowed(const LocationConfig &location_config, const ServerConfig &server_config);
     static Response handleQuery(const std::string &real_path, const Request &request, const ServerConfig &server_config);
     static Response handleCookieAndSession(const Request &request);
+    static Response handleStatusPage(const LocationConfig &location_config);
     static Response handlePost(const Request &request, const LocationConfig &location_config, const ServerConfig &server_config);
     // 추가: 메서드 유효성 검사 및 CGI 요청 여부 판단
     static bool validateMethod(const Request &request, const LocationConfig &location_config);
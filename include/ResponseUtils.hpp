@@ -14,14 +14,22 @@ class ResponseUtil
     static bool isMethodAllowed(const std::string &method, const LocationConfig &location_config);
     static bool ensureDirectoryExists(const std::string &fullPath);
     static bool createSingleDir(const std::string &path);
-    static std::string generateFileListJSON(const std::vector<std::string> &files);
     static bool validateUploadedFiles(const std::vector<UploadedFile> &files);
     static bool getUploadDirectory(const LocationConfig &location_config, const ServerConfig &server_config,
                                    std::string &upload_dir);
     static bool isFileExtensionAllowed(const std::string &filename, const std::vector<std::string> &allowed_extensions);
+    // 임시 파일에 다 쓴 뒤 rename으로 바꿔 끼웁니다. fsync_policy는 location의 upload_fsync
     static bool saveUploadedFile(const std::string &upload_dir, const UploadedFile &file,
-                                 std::string &sanitized_filename);
-    static bool listUploadedFiles(const std::string &upload_dir, std::vector<std::string> &files);
+                                 std::string &sanitized_filename, UploadFsync fsync_policy);
+    // 이미 다 쓴 파일(path, fd)을 정책대로 내려 쓰고 upload_dir/sanitized_filename으로 옮깁니다.
+    // 같은 이름이 있으면 덮어쓰지 않고 false를 돌려주며 errno는 EEXIST입니다.
+    static bool commitUploadedFile(int fd, const std::string &path, const std::string &upload_dir,
+                                   const std::string &sanitized_filename, UploadFsync fsync_policy);
+    // upload_store: 내용을 <upload_dir>/.blobs/<2>/<62>에 한 번만 쓰고 sanitized_filename을 그 blob에 하드 링크합니다.
+    static bool storeUploadedFile(const std::string &upload_dir, const UploadedFile &file,
+                                  const std::string &sanitized_filename, std::string &digest,
+                                  UploadFsync fsync_policy);
+    static bool blobExists(const std::string &upload_dir, const std::string &digest);
     static std::string generateSuccessResponse(const std::string &jsonContent);
     static bool deleteUploadedFile(const std::string &upload_dir, const std::string &filename);
     static bool deleteAllUploadedFiles(const std::string &upload_dir);
@@ -0,0 +1,36 @@
+#ifndef RESUMABLEUPLOAD_HPP
+#define RESUMABLEUPLOAD_HPP
+
+#include "Configuration.hpp"
+#include "Request.hpp"
+#include "Response.hpp"
+
+// tus 1.0 방식의 이어 올리기 (upload_resumable on;)
+//   POST  <location>        Upload-Length, Upload-Metadata(filename) -> 201 Location: <location>/<id>
+//   HEAD  <location>/<id>   -> Upload-Offset / Upload-Length
+//   PATCH <location>/<id>   Upload-Offset + application/offset+octet-stream 본문 -> 204
+//   DELETE <location>/<id>  세션 취소
+// 세션은 <upload_directory>/.sessions/ 아래 <id>.info (길이, 받은 위치, 파일 이름)와 <id>.part로 남으므로
+// 서버를 다시 시작해도 이어 받을 수 있습니다. 다 받으면 .part를 upload_fsync 정책대로 업로드 디렉터리의 이름으로
+// 옮기고(같은 이름이 있으면 409) 세션을 지웁니다. UPLOAD_SESSION_TTL 동안 조각이 오지 않은 세션도 지웁니다.
+class ResumableUpload
+{
+  public:
+    static bool isRequest(const Request &request, const LocationConfig &location_config);
+    static Response handle(const Request &request, const LocationConfig &location_config,
+                           const ServerConfig &server_config);
+
+  private:
+    ResumableUpload();
+    static Response create(const Request &request, const LocationConfig &location_config,
+                           const ServerConfig &server_config, const std::string &upload_dir,
+                           const std::string &session_dir);
+    static Response status(const std::string &session_dir, const std::string &id, const ServerConfig &server_config);
+    static Response append(const Request &request, const LocationConfig &location_config,
+                           const ServerConfig &server_config, const std::string &upload_dir,
+                           const std::string &session_dir, const std::string &id);
+    static Response terminate(const std::string &session_dir, const std::string &id,
+                              const ServerConfig &server_config);
+};
+
+#endif // RESUMABLEUPLOAD_HPP
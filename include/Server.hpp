@@ -1,18 +1,28 @@
 #ifndef SERVER_HPP
 #define SERVER_HPP
 
+#include "AccessLog.hpp"
+#include "Arena.hpp"
+#include "AsyncLog.hpp"
+#include "Metrics.hpp"
+#include "BufferPool.hpp"
 #include "Configuration.hpp"
+#include "IoPool.hpp"
 #include "Log.hpp"
 
 #ifdef __linux__
 #include "EpollPoller.hpp"
+#include "IoUringPoller.hpp"
 #elif defined(__APPLE__)
 #include "KqueuePoller.hpp"
 #endif
 
 #include "Poller.hpp"
+#include "RateLimit.hpp"
+#include "RequestTiming.hpp"
 #include "Response.hpp"
 #include "ServerConfig.hpp"
+#include "ServerWriteHelper.hpp"
 #include "SocketManager.hpp"
 #include "Utils.hpp"
 
@@ -20,14 +30,69 @@
 #include <iostream>
 #include <map>
 #include <memory>
+#include <pthread.h>
 #include <set>
 #include <string>
+#include <sys/types.h>
 #include <vector>
 
+// 한 번 읽은 설정. SIGHUP마다 새로 만들어 교체하고, 이전 것은 그 설정으로 보내던 응답이 모두 끝나면 해제합니다.
+struct ConfigSnapshot
+{
+    std::vector<ServerConfig> servers;
+    int refs; // 이 스냅샷을 쓰는 이벤트 루프와 ResponseRecord 수 (원자적으로 갱신, 0이 되면 해제)
+
+    ConfigSnapshot() : refs(0)
+    {
+    }
+};
+
+// 주 루프가 accept해서 워커 루프에 넘기는 연결
+struct PendingClient
+{
+    int fd;
+    in_addr_t addr;
+};
+
+// 응답의 마지막 바이트를 보낸 뒤 메트릭/접근 로그에 기록할 정보 (요청은 _requestMap에 남아 있음)
+struct ResponseRecord
+{
+    ConfigSnapshot *config; // server_config, location이 속한 스냅샷 (기록할 때까지 유지)
+    const ServerConfig *server_config;
+    const LocationConfig *location;
+    int status;
+    size_t body_size;
+
+    ResponseRecord() : config(NULL), server_config(NULL), location(NULL), status(0), body_size(0)
+    {
+    }
+};
+
+class Server;
+
+// 디스크를 쓰는 응답 생성(Response::buildResponse)을 IoPool 스레드에서 실행합니다.
+// 작업 중에는 이벤트 루프가 요청, 아레나, 타이밍을 건드리지 않고, 끝나면 루프의 깨움 fd로 돌려받아 보냅니다.
+struct ResponseTask : public IoTask
+{
+    Server *loop;
+    int fd;
+    const Request *request;
+    const ServerConfig *server_config;
+    const LocationConfig *location;
+    ConfigSnapshot *config; // server_config, location이 속한 스냅샷 (작업을 돌려받을 때까지 유지)
+    Arena *arena;
+    RequestTiming *timing;
+    Response response;
+
+    void run();
+    void complete();
+};
+
 class Server
 {
   public:
-    Server(const std::string &configFile);
+    // executable은 SIGUSR2 바이너리 교체 때 다시 실행할 경로 (argv[0])
+    Server(const std::string &configFile, const std::string &executable);
     ~Server();
     void start();
     // graceful shutdown을 위한 stop() 메소드 추가
@@ -37,42 +102,171 @@ class Server
     // Rule of Three 준수를 위해 복사 생성자와 복사 대입 연산자를 private으로 선언 (정의하지 않음)
     Server(const Server &);
     Server &operator=(const Server &);
+    friend struct ResponseTask;
+    // worker_threads의 워커 루프 (group의 설정을 공유하고 poller와 연결 상태는 따로 가집니다)
+    explicit Server(Server *group);
 
     // private 멤버 변수에 언더바 접두사 추가
-    std::vector<ServerConfig> _server_configs;
+    std::string _config_file;
+    std::string _executable;
+    ConfigSnapshot *_config;                 // 새 요청에 적용할 설정
     std::auto_ptr<Poller> _poller;
-    std::map<int, std::string> _partialRequests;
+    std::map<int, RecvChain *> _recvChains; // 연결별 수신 버퍼 (유휴 연결은 항목 없음)
     std::map<int, std::string> _outgoingData;
+    std::map<int, OutgoingFile> _outgoingFiles; // 송신 버퍼 뒤에 이어 보낼 매핑된 본문 (mmap_cache)
+    std::map<int, OutgoingStream> _outgoingStreams; // 송신 버퍼로 이어 보내는 CGI 출력
+    std::map<int, OutgoingSend> _sending;           // [io_uring] 제출해서 완료를 기다리는 송신
+    std::map<int, int> _streamPipes;                // CGI stdout/stdin 파이프 fd -> 연결
     std::map<int, Request> _requestMap;
+    std::map<int, Arena *> _arenas; // 연결별 요청 아레나
+    std::map<int, in_addr_t> _peerAddrs; // 열려 있는 클라이언트 연결 -> 주소 (접근 로그용)
+    std::map<int, RequestTiming> _timings; // 연결별 현재 요청의 단계 시각
+    std::map<int, ResponseRecord> _pendingRecords; // 송신 중인 응답 (다 보내면 기록 후 다음 요청)
+    std::map<int, uint64_t> _delayed;              // limit_req로 지연된 요청 -> 다시 처리할 시각 (0: 다시 처리 중)
+    std::map<int, int> _connLimitZones;            // limit_conn 카운트를 잡고 있는 연결 -> zone
+    std::map<int, ResponseTask *> _inflight;       // IoPool에서 응답을 만드는 중인 연결
+    std::set<int> _detached;                       // 작업/송신 중에 끊겨 poller에서 뺀 연결 (완료되면 닫음)
 
     bool _is_running;
+    bool _completion_io; // poller가 accept/recv/send를 대신 하고 완료를 알려 줌 (io_uring)
+
+    // 연결 수 제한 (worker_connections)
+    size_t _worker_connections; // RLIMIT_NOFILE에 맞춰 조정된 상한
+    bool _reject_overflow;      // 상한 도달 시 true: 수락 후 503, false: 리스너 일시 중지
+    bool _accept_paused;        // 리스너가 poller에서 빠져 있는 상태
+    uint64_t _accept_resume_us; // 이 시각 이후 재개 (0이면 연결 수가 줄어들 때 재개)
+    int _reserve_fd;            // EMFILE일 때 연결 하나를 받아 거절하기 위해 남겨 둔 fd
+
+    // 설정 재적용(SIGHUP), 바이너리 교체(SIGUSR2), 종료 대기
+    uint64_t _shutdown_timeout_us; // 종료할 때 진행 중인 연결을 기다리는 최대 시간
+    bool _draining;                // 리스너를 닫고 남은 연결이 끝나기를 기다리는 중
+    uint64_t _drain_deadline_us;   // 이 시각이 지나면 남은 연결이 있어도 종료
+    pid_t _upgrade_pid;            // 교체 중인 새 바이너리 (없으면 -1)
+    int _upgrade_fd;               // 새 바이너리가 준비되면 한 바이트를 쓰는 파이프 (없으면 -1)
+
+    // worker_threads: 스레드마다 Server 하나가 자기 poller와 연결 맵으로 이벤트 루프를 돌립니다.
+    // 주 루프(main 스레드)만 accept, 시그널, 설정 교체를 처리하고 받은 연결을 루프들에 차례로 나눠 줍니다.
+    Server *_group;                         // 주 루프 (주 루프에서는 this)
+    std::vector<Server *> _loops;           // [주 루프] 워커 루프
+    std::vector<pthread_t> _threads;        // [주 루프] _loops[i]를 돌리는 스레드
+    size_t _next_loop;                      // [주 루프] 다음 연결을 맡을 루프 (0은 주 루프 자신)
+    size_t _connection_count;               // [주 루프] 모든 루프의 열린 연결 수 (원자적으로 갱신)
+    unsigned _config_generation;            // 주 루프는 _config를 바꿀 때마다 늘리고, 워커는 따라간 값을 둡니다.
+    pthread_mutex_t _config_lock;           // [주 루프] _config 교체와 워커의 참조 획득
+    pthread_mutex_t _wake_lock;             // _handoff, _completed 보호
+    std::vector<PendingClient> _handoff;    // [워커] 주 루프가 넘긴 연결
+    std::vector<ResponseTask *> _completed; // IoPool에서 끝난 응답 작업
+    int _wake_fds[2];                       // 새 연결, 끝난 작업, 종료 요청을 알리는 fd (Linux: eventfd 하나)
+    bool _drain_requested;                  // [워커] 주 루프가 종료 대기를 시작함 (_drain_deadline_us 함께 설정)
+    bool _stop_requested;                   // [워커] 바로 멈춤
 
     // [ServerCore.cpp]
+    void createPoller();
     void initSockets();
+    void prepareServers(std::vector<ServerConfig> &servers);
+    void applyGlobalConfig(const Configuration &config);
+    void fitConnectionLimit();
     bool processPollerEvents(std::vector<Event> &events);
 
     // [ServerEvents.cpp]
     void processEvents(const std::vector<Event> &events);
     void handleNewConnection(int server_fd);
-    void handleClientRead(int client_fd, const ServerConfig &server_config);
-    bool readClientData(int client_fd, std::string &buffer);
+    void handleAccepted(int server_fd, int result);
+    bool addListener(int server_fd);
+    void rejectConnection(int client_fd);
+    void rejectWithReserveFd(int server_fd);
+    void pauseAccept(uint64_t delay_ms);
+    void resumeAcceptIfReady();
+    void handleClientRead(int client_fd, const ServerConfig &server_config, const Event &event);
+    bool readClientData(int client_fd, RecvChain &chain, const Event &event);
     bool handleReceivedData(int client_fd, const ServerConfig &server_config, std::string &buffer);
+    void processBufferedRequest(int client_fd, const ServerConfig &server_config);
 
     // [ServerWrite.cpp]
-    void writePendingData(int client_fd);
+    bool writePendingData(int client_fd);
+    bool outputPending(int client_fd) const;
+    void attachFile(int client_fd, const Response &response);
+    void releaseFile(int client_fd);
+    void finishResponse(int client_fd);
     bool checkKeepAliveNeeded(int client_fd);
     void handleClientWrite(int client_fd);
+    bool submitSend(int client_fd, std::string &buf, OutgoingFile *file);
+    void handleSent(int client_fd, int result);
+    void waitForSends();
     bool setNonBlocking(int fd);
     bool isServerSocket(int fd, ServerConfig **matched_server) const;
 
+    // [ServerStream.cpp]
+    void attachStream(int client_fd, const Response &response);
+    void handleStreamEvent(int pipe_fd);
+    void handleStreamRead(int pipe_fd);
+    void handleStreamWrite(int pipe_fd);
+    void closeStreamInput(int client_fd);
+    void pauseStream(int client_fd);
+    void resumeStream(int client_fd);
+    void endStream(int client_fd, bool eof);
+    void releaseStream(int client_fd);
+
+    // [ServerReload.cpp]
+    void reloadConfig();
+    bool rebindListeners(std::vector<ServerConfig> &servers);
+    void publishConfig(ConfigSnapshot *next);
+    static void retainConfig(ConfigSnapshot *config);
+    static void releaseConfig(ConfigSnapshot *config);
+    void startBinaryUpgrade();
+    void handleUpgradeReady();
+    void notifyUpgradeParent();
+    void beginDrain();
+    bool drainFinished() const;
+    void closeAllConnections();
+
+    // [ServerThreads.cpp]
+    void startLoops(size_t count);
+    void stopLoops();
+    static void *runLoop(void *arg);
+    bool followGroup();
+    void handOff(int client_fd, in_addr_t addr);
+    void enqueueClient(int client_fd, in_addr_t addr);
+    bool openWakeFd();
+    void closeWakeFd();
+    void handleWake();
+    void registerClient(int client_fd, in_addr_t addr);
+    void wake();
+    size_t connectionCount() const;
+    void countConnection(long delta);
+
+    // [ServerTasks.cpp]
+    bool dispatchResponse(int client_fd, const Request &request, const ServerConfig &server_config,
+                          const LocationConfig *location);
+    void postCompletion(ResponseTask *task);
+    void completeTask(ResponseTask *task);
+    void waitForTasks();
+
+    // [ServerLimit.cpp]
+    LimitResult checkLimits(int client_fd, const LocationConfig &location);
+    void releaseConnLimit(int client_fd);
+    void runDelayedRequests();
+    int delayedTimeout(int timeout) const;
+
     // [ServerUtils.cpp]
-    static std::set<int> &getClosedFds();
     ServerConfig &findMatchingServerConfig(int fd);
     void safelyCloseClient(int client_fd);
+    void closeConnection(int client_fd);
     bool processClientRequest(int client_fd, const ServerConfig &server_config, const std::string &request_str,
                               int &consumed);
-    void sendResponse(int client_fd, const Response &response);
+    void queueResponse(int client_fd, const ServerConfig &server_config, const LocationConfig *location,
+                       Response &response, ConfigSnapshot *config);
+    void queueDirectResponse(int client_fd, const Response &response);
     void sendBadRequestResponse(int client_fd, const ServerConfig &server_config);
+    void queueRecord(int client_fd, const ServerConfig &server_config, const LocationConfig *location,
+                     const Response &response, ConfigSnapshot *config = NULL);
+    void flushRecord(int client_fd);
+    void recordResponse(int client_fd, const ServerConfig &server_config, const Request *request,
+                        const LocationConfig *location, int status, size_t body_size);
+    Arena *getArena(int client_fd);
+    RecvChain *getRecvChain(int client_fd);
+    void releaseRecvChain(int client_fd);
+    void releaseArena(int client_fd);
 };
 
 #endif // SERVER_HPP
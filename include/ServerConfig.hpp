@@ -1,9 +1,12 @@
 #ifndef SERVERCONFIG_HPP
 #define SERVERCONFIG_HPP
 
+#include "Define.hpp"
 #include "LocationConfig.hpp" // LocationConfig 포함
 #include <map>
 #include <netinet/in.h> // sockaddr_in
+#include <sys/socket.h> // SOMAXCONN
+#include <stdint.h>
 #include <string>
 #include <vector>
 
@@ -11,19 +14,37 @@
 struct ServerConfig
 {
     int port;                               // 서버가 청취할 포트
+    int listen_backlog;                     // listen() 대기열 길이 (listen ... backlog=N)
     std::string server_name;                // 서버 이름
     std::string root;                       // 루트 디렉토리 경로
     size_t client_max_body_size;            // 최대 요청 본문 크기 (바이트)
     std::vector<LocationConfig> locations;  // 위치 블록 리스트
     std::map<int, std::string> error_pages; // 에러 코드에 대한 에러 페이지 경로 매핑
     std::vector<int> server_sockets;        // 서버 소켓 리스트
+    std::string access_log;                 // 접근 로그 경로 ("off"이면 기록하지 않음)
+    std::string access_log_format;          // 사용할 log_format 이름
+    std::map<std::string, std::string> log_formats; // log_format 이름 -> 형식 문자열
+    int access_log_id;                      // AccessLog::configure()가 돌려준 번호
+    bool server_timing;                     // 응답에 Server-Timing 헤더 추가
+    std::string slow_request_log;           // 느린 요청 로그 경로 (비어 있으면 기록하지 않음)
+    uint64_t slow_request_threshold_us;     // 이 시간 이상 걸린 요청만 느린 요청 로그에 기록
+    int slow_request_log_id;                // AccessLog::configureSlowLog()가 돌려준 번호
+    LimitReqConfig limit_req;               // location에 없을 때 적용할 limit_req
+    LimitConnConfig limit_conn;             // location에 없을 때 적용할 limit_conn
 
     // 생성자: 기본값 설정
     ServerConfig()
       : port(8080),                      // 포트를 0으로 초기화
+        listen_backlog(SOMAXCONN),
         server_name(""),                 // 빈 문자열로 초기화 (자동으로 이루어짐)
         root(""),                        // 빈 문자열로 초기화 (자동으로 이루어짐)
-        client_max_body_size(1048576)    // 예: 1MB 기본값 설정
+        client_max_body_size(1048576),   // 예: 1MB 기본값 설정
+        access_log(ACCESS_LOG_FILE),
+        access_log_format("combined"),
+        access_log_id(-1),
+        server_timing(false),
+        slow_request_threshold_us(SLOW_REQUEST_THRESHOLD_MS * 1000ULL),
+        slow_request_log_id(-1)
     {
     }
     ~ServerConfig() {};
@@ -1,10 +1,41 @@
 #ifndef SERVER_WRITE_HELPER_HPP
 #define SERVER_WRITE_HELPER_HPP
 
+#include "CGIHandler.hpp"
+#include "FileCache.hpp"
 #include "Poller.hpp"
 #include <set>
 #include <string>
+#include <sys/socket.h>
 
-bool writePendingDataHelper(Poller *poller, int client_fd, std::string &buf);
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0 // macOS: 소켓에 SO_NOSIGPIPE가 없으면 SIGPIPE가 발생할 수 있음
+#endif
+
+// 송신 버퍼(헤더) 뒤에 이어 보낼 매핑된 파일 본문
+struct OutgoingFile
+{
+    MappedFile *file;
+    size_t offset; // 보낸 바이트 수
+};
+
+// 송신 버퍼로 이어 보내는 CGI 출력. 파이프가 EOF에 닿으면 stream을 놓고, 남은 버퍼를 다 보낼 때까지 항목은 남습니다.
+struct OutgoingStream
+{
+    CgiStream *stream; // 아직 읽는 중인 파이프 (다 읽었으면 NULL)
+    bool paused;       // 송신 버퍼가 차서 파이프를 poller에서 뺌
+    bool close_after;  // 본문 끝을 연결 종료로 알림 (chunked가 아니거나 출력이 중간에 끊김)
+};
+
+// io_uring: 제출해서 완료를 기다리는 송신. 송신 버퍼에서 옮겨 온 head 뒤에 파일 본문 file_len 바이트를 보냅니다.
+// 완료될 때까지 커널이 head와 매핑된 본문을 읽으므로 둘 다 그대로 둡니다.
+struct OutgoingSend
+{
+    std::string head;
+    size_t file_len;
+};
+
+// buf를 보낸 뒤 file(없으면 NULL)의 남은 부분을 보냅니다. 둘은 한 번의 호출로 함께 보냅니다.
+bool writePendingDataHelper(Poller *poller, int client_fd, std::string &buf, OutgoingFile *file);
 
 #endif // SERVER_WRITE_HELPER_HPP
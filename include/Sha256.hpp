@@ -0,0 +1,29 @@
+#ifndef SHA256_HPP
+#define SHA256_HPP
+
+#include <cstddef>
+#include <stdint.h>
+#include <string>
+
+// SHA-256 (FIPS 180-4). 데이터를 나눠서 update()로 넣을 수 있습니다.
+class Sha256
+{
+  public:
+    Sha256();
+    void update(const void *data, size_t len);
+    // 64자리 소문자 16진수 다이제스트. 호출한 뒤에는 다시 쓸 수 없습니다.
+    std::string hexDigest();
+
+    static std::string hex(const void *data, size_t len);
+    static bool isHexDigest(const std::string &value);
+
+  private:
+    uint32_t _state[8];
+    uint64_t _length; // 넣은 바이트 수
+    unsigned char _block[64];
+    size_t _used; // _block에 모인 바이트 수
+
+    void transform(const unsigned char *block);
+};
+
+#endif // SHA256_HPP
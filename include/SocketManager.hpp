@@ -18,7 +18,9 @@ class SocketManager
     static int createSocket(int port);
     static void setSocketNonBlocking(int sockfd, int port);
     static void bindSocket(int sockfd, int port);
-    static void startListening(int sockfd, int port);
+    static void startListening(int sockfd, int port, int backlog);
+    // 위 단계를 모두 거친 논블로킹 리스너. 실패하면 예외
+    static int openListener(int port, int backlog);
     static bool readFromSocketOnce(int client_socket, std::string &data);
 };
 
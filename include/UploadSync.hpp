@@ -0,0 +1,22 @@
+#ifndef UPLOADSYNC_HPP
+#define UPLOADSYNC_HPP
+
+#include "Define.hpp"
+
+// upload_fsync batched: 여러 업로드의 fsync를 모아 파일 시스템마다 syncfs() 한 번으로 처리합니다. (그룹 커밋)
+// 첫 업로드가 들어온 뒤 UPLOAD_FSYNC_BATCH_MS 동안 (또는 UPLOAD_FSYNC_BATCH_MAX개가 모일 때까지) 기다렸다가
+// 한꺼번에 내려 쓰므로, 동시에 들어온 업로드가 많을수록 한 건당 비용이 줄어듭니다.
+class UploadSync
+{
+  public:
+    // fd의 내용이 디스크에 기록될 때까지 기다립니다. 실패하면 false
+    static bool commit(int fd);
+    // 남은 요청을 처리한 뒤 스레드를 종료합니다.
+    static void stop();
+
+  private:
+    UploadSync();
+    static void *flusherMain(void *arg);
+};
+
+#endif // UPLOADSYNC_HPP
@@ -11,6 +11,7 @@
 #include <limits.h>
 #include <netinet/in.h>
 #include <sstream>
+#include <stdint.h>
 #include <stdlib.h>
 #include <string>
 #include <sys/stat.h>
@@ -24,6 +25,8 @@ std::string trim(const std::string &str);
 
 // C++98 호환을 위한 int to string 변환 함수 선언
 std::string intToString(int number);
+std::string sizeToString(size_t number);
+size_t formatDecimal(char *buf, unsigned long value);
 std::string toLower(const std::string &str);
 std::string sanitizeFilename(const std::string &filename);
 
@@ -39,4 +42,7 @@ void trimString(std::string &str);
 
 size_t parseClientBodySize(const std::string &str);
 
+// CLOCK_MONOTONIC 기준 마이크로초
+uint64_t monotonicMicros();
+
 #endif // UTILS_HPP
@@ -0,0 +1,398 @@
+#include "AccessLog.hpp"
+#include "AsyncLog.hpp"
+#include "Log.hpp"
+#include "Request.hpp"
+#include "Utils.hpp"
+#include <arpa/inet.h>
+#include <cctype>
+#include <cerrno>
+#include <cstring>
+#include <strings.h>
+#include <sys/time.h>
+#include <unistd.h>
+#include <vector>
+
+enum LogVariable
+{
+    VAR_LITERAL,
+    VAR_REMOTE_ADDR,
+    VAR_TIME_LOCAL,
+    VAR_MSEC,
+    VAR_REQUEST,
+    VAR_REQUEST_METHOD,
+    VAR_REQUEST_URI,
+    VAR_URI,
+    VAR_ARGS,
+    VAR_SERVER_PROTOCOL,
+    VAR_STATUS,
+    VAR_BODY_BYTES_SENT,
+    VAR_SERVER_NAME,
+    VAR_SERVER_PORT,
+    VAR_PID,
+    VAR_REQUEST_TIME,  // 첫 바이트 수신 ~ 마지막 바이트 송신 (초.밀리초)
+    VAR_UPSTREAM_TIME, // CGI 실행 시간
+    VAR_TTFB,          // 첫 바이트 수신 ~ 응답 첫 바이트 송신
+    VAR_PARSE_TIME,
+    VAR_HANDLER_TIME,
+    VAR_SEND_TIME,     // 응답 생성 ~ 마지막 바이트 송신 (소켓 백프레셔 포함)
+    VAR_PHASES,        // 단계별 소요 시간 전체 (밀리초)
+    VAR_HTTP_HEADER // $http_user_agent -> User-Agent
+};
+
+struct VariableDef
+{
+    const char *name;
+    LogVariable var;
+};
+
+static const VariableDef VARIABLES[] = {{"remote_addr", VAR_REMOTE_ADDR},
+                                        {"time_local", VAR_TIME_LOCAL},
+                                        {"msec", VAR_MSEC},
+                                        {"request", VAR_REQUEST},
+                                        {"request_method", VAR_REQUEST_METHOD},
+                                        {"request_uri", VAR_REQUEST_URI},
+                                        {"uri", VAR_URI},
+                                        {"args", VAR_ARGS},
+                                        {"server_protocol", VAR_SERVER_PROTOCOL},
+                                        {"status", VAR_STATUS},
+                                        {"body_bytes_sent", VAR_BODY_BYTES_SENT},
+                                        {"server_name", VAR_SERVER_NAME},
+                                        {"server_port", VAR_SERVER_PORT},
+                                        {"pid", VAR_PID},
+                                        {"request_time", VAR_REQUEST_TIME},
+                                        {"upstream_time", VAR_UPSTREAM_TIME},
+                                        {"ttfb", VAR_TTFB},
+                                        {"parse_time", VAR_PARSE_TIME},
+                                        {"handler_time", VAR_HANDLER_TIME},
+                                        {"send_time", VAR_SEND_TIME},
+                                        {"phases", VAR_PHASES}};
+
+struct LogSegment
+{
+    LogVariable var;
+    std::string text; // 리터럴 문자열 또는 헤더 이름
+};
+
+struct CompiledLog
+{
+    int channel;
+    std::string format;
+    std::vector<LogSegment> segments;
+};
+
+// 설정을 읽을 때 주 스레드가 뒤에 추가하기만 합니다. 다른 이벤트 루프 스레드는 g_log_count로 공개된 항목만 읽습니다.
+static CompiledLog g_logs[ACCESS_LOG_MAX];
+static int g_log_count = 0;
+
+static void compileFormat(const std::string &format, std::vector<LogSegment> &segments)
+{
+    LogSegment literal;
+    literal.var = VAR_LITERAL;
+    size_t i = 0;
+    while (i < format.size())
+    {
+        if (format[i] != '$')
+        {
+            literal.text += format[i++];
+            continue;
+        }
+        size_t start = ++i;
+        while (i < format.size() && (isalnum(static_cast<unsigned char>(format[i])) || format[i] == '_'))
+            ++i;
+        std::string name = format.substr(start, i - start);
+        LogSegment segment;
+        segment.var = VAR_LITERAL;
+        if (name.compare(0, 5, "http_") == 0 && name.size() > 5)
+        {
+            segment.var = VAR_HTTP_HEADER;
+            segment.text = name.substr(5);
+            for (size_t k = 0; k < segment.text.size(); ++k)
+            {
+                if (segment.text[k] == '_')
+                    segment.text[k] = '-';
+            }
+        }
+        for (size_t k = 0; k < sizeof(VARIABLES) / sizeof(VARIABLES[0]); ++k)
+        {
+            if (name == VARIABLES[k].name)
+                segment.var = VARIABLES[k].var;
+        }
+        if (segment.var == VAR_LITERAL)
+        {
+            LogConfig::reportInternalError("log_format: unknown variable \"$" + name + "\"");
+            literal.text += "$" + name;
+            continue;
+        }
+        if (!literal.text.empty())
+        {
+            segments.push_back(literal);
+            literal.text.clear();
+        }
+        segments.push_back(segment);
+    }
+    if (!literal.text.empty())
+        segments.push_back(literal);
+}
+
+int AccessLog::configure(const ServerConfig &server_config)
+{
+    if (server_config.access_log == "off")
+        return -1;
+    std::string format = ACCESS_LOG_COMBINED_FORMAT;
+    if (server_config.access_log_format != "combined")
+    {
+        std::map<std::string, std::string>::const_iterator it =
+            server_config.log_formats.find(server_config.access_log_format);
+        if (it == server_config.log_formats.end())
+            LogConfig::reportInternalError("access_log: unknown log_format \"" + server_config.access_log_format +
+                                           "\", using combined");
+        else
+            format = it->second;
+    }
+    return open(server_config.access_log, format);
+}
+
+int AccessLog::configureSlowLog(const ServerConfig &server_config)
+{
+    if (server_config.slow_request_log.empty() || server_config.slow_request_log == "off")
+        return -1;
+    return open(server_config.slow_request_log, SLOW_REQUEST_LOG_FORMAT);
+}
+
+int AccessLog::open(const std::string &path, const std::string &format)
+{
+    CompiledLog log;
+    log.channel = AsyncLog::openChannel(path);
+    if (log.channel == -1)
+    {
+        LogConfig::reportInternalError("failed to open log " + path + ": " + std::string(strerror(errno)));
+        return -1;
+    }
+    // 설정을 다시 읽을 때 같은 파일, 같은 형식이면 이미 컴파일한 것을 씁니다.
+    for (int i = 0; i < g_log_count; ++i)
+    {
+        if (g_logs[i].channel == log.channel && g_logs[i].format == format)
+            return i;
+    }
+    if (g_log_count == ACCESS_LOG_MAX)
+    {
+        LogConfig::reportInternalError("failed to open log " + path + ": too many log formats");
+        return -1;
+    }
+    log.format = format;
+    compileFormat(format, log.segments);
+    g_logs[g_log_count] = log;
+    __atomic_store_n(&g_log_count, g_log_count + 1, __ATOMIC_RELEASE);
+    return g_log_count - 1;
+}
+
+// 고정 크기 버퍼에 덧붙이며, 넘치는 부분은 잘라냅니다.
+struct LineCursor
+{
+    char *pos;
+    char *end;
+
+    void put(const char *s, size_t n)
+    {
+        if (n > static_cast<size_t>(end - pos))
+            n = end - pos;
+        memcpy(pos, s, n);
+        pos += n;
+    }
+    void put(const std::string &s)
+    {
+        put(s.data(), s.size());
+    }
+    void putNumber(unsigned long value)
+    {
+        char buf[24];
+        put(buf, formatDecimal(buf, value));
+    }
+    // 구간이 없으면 "-"
+    void putSeconds(const RequestTiming *timing, TimingPhase from, TimingPhase to)
+    {
+        char buf[32];
+        if (!timing || !timing->at(from) || !timing->at(to))
+            put("-", 1);
+        else
+            put(buf, formatSeconds(buf, timing->span(from, to)));
+    }
+    // 요청에서 온 값은 따옴표/제어 문자를 \xHH로 이스케이프합니다.
+    void putEscaped(const std::string &s)
+    {
+        static const char HEX[] = "0123456789ABCDEF";
+        if (s.empty())
+        {
+            put("-", 1);
+            return;
+        }
+        for (size_t i = 0; i < s.size() && pos < end; ++i)
+        {
+            unsigned char c = static_cast<unsigned char>(s[i]);
+            if (c < 0x20 || c >= 0x7f || c == '"' || c == '\\')
+            {
+                char esc[4] = {'\\', 'x', HEX[c >> 4], HEX[c & 0x0f]};
+                put(esc, 4);
+            }
+            else
+                *pos++ = static_cast<char>(c);
+        }
+    }
+};
+
+static const std::string *findHeader(const Request &request, const std::string &name)
+{
+    const HeaderMap &headers = request.getHeaders();
+    for (HeaderMap::const_iterator it = headers.begin(); it != headers.end(); ++it)
+    {
+        if (strcasecmp(it->first.c_str(), name.c_str()) == 0)
+            return &it->second;
+    }
+    return NULL;
+}
+
+void AccessLog::log(int id, const ServerConfig &server_config, const AccessLogEntry &entry)
+{
+    if (id < 0 || id >= __atomic_load_n(&g_log_count, __ATOMIC_ACQUIRE))
+        return;
+    const CompiledLog &log = g_logs[id];
+    const Request *request = entry.request;
+    char line[LOG_LINE_MAX];
+    LineCursor out;
+    out.pos = line;
+    out.end = line + sizeof(line) - 1; // 개행 자리
+    for (size_t i = 0; i < log.segments.size(); ++i)
+    {
+        const LogSegment &segment = log.segments[i];
+        switch (segment.var)
+        {
+        case VAR_LITERAL:
+            out.put(segment.text);
+            break;
+        case VAR_REMOTE_ADDR:
+        {
+            char addr[INET_ADDRSTRLEN];
+            struct in_addr in;
+            in.s_addr = entry.remote_addr;
+            if (inet_ntop(AF_INET, &in, addr, sizeof(addr)))
+                out.put(addr, strlen(addr));
+            else
+                out.put("-", 1);
+            break;
+        }
+        case VAR_TIME_LOCAL:
+        {
+            size_t len;
+            const char *time_str = LogClock::commonLogTime(len);
+            out.put(time_str, len);
+            break;
+        }
+        case VAR_MSEC:
+        {
+            struct timeval tv;
+            gettimeofday(&tv, NULL);
+            char ms[4] = {'.', static_cast<char>('0' + tv.tv_usec / 100000),
+                          static_cast<char>('0' + tv.tv_usec / 10000 % 10),
+                          static_cast<char>('0' + tv.tv_usec / 1000 % 10)};
+            out.putNumber(tv.tv_sec);
+            out.put(ms, 4);
+            break;
+        }
+        case VAR_REQUEST:
+            if (!request)
+            {
+                out.put("-", 1);
+                break;
+            }
+            out.putEscaped(request->getMethod());
+            out.put(" ", 1);
+            out.putEscaped(request->getPath());
+            if (!request->getQueryString().empty())
+            {
+                out.put("?", 1);
+                out.putEscaped(request->getQueryString());
+            }
+            out.put(" ", 1);
+            out.putEscaped(request->getHTTPVersion());
+            break;
+        case VAR_REQUEST_METHOD:
+            out.putEscaped(request ? request->getMethod() : std::string());
+            break;
+        case VAR_REQUEST_URI:
+            if (!request)
+            {
+                out.put("-", 1);
+                break;
+            }
+            out.putEscaped(request->getPath());
+            if (!request->getQueryString().empty())
+            {
+                out.put("?", 1);
+                out.putEscaped(request->getQueryString());
+            }
+            break;
+        case VAR_URI:
+            out.putEscaped(request ? request->getPath() : std::string());
+            break;
+        case VAR_ARGS:
+            out.putEscaped(request ? request->getQueryString() : std::string());
+            break;
+        case VAR_SERVER_PROTOCOL:
+            out.putEscaped(request ? request->getHTTPVersion() : std::string());
+            break;
+        case VAR_STATUS:
+            out.putNumber(entry.status);
+            break;
+        case VAR_BODY_BYTES_SENT:
+            out.putNumber(entry.body_bytes_sent);
+            break;
+        case VAR_SERVER_NAME:
+            out.putEscaped(server_config.server_name);
+            break;
+        case VAR_SERVER_PORT:
+            out.putNumber(server_config.port);
+            break;
+        case VAR_PID:
+            out.putNumber(getpid());
+            break;
+        case VAR_REQUEST_TIME:
+        {
+            char buf[32];
+            if (entry.timing && entry.timing->at(PHASE_RECV_START))
+                out.put(buf, formatSeconds(buf, entry.timing->total()));
+            else
+                out.put("-", 1);
+            break;
+        }
+        case VAR_UPSTREAM_TIME:
+            out.putSeconds(entry.timing, PHASE_UPSTREAM_START, PHASE_UPSTREAM_END);
+            break;
+        case VAR_TTFB:
+            out.putSeconds(entry.timing, PHASE_RECV_START, PHASE_FIRST_BYTE);
+            break;
+        case VAR_PARSE_TIME:
+            out.putSeconds(entry.timing, PHASE_RECV_END, PHASE_PARSED);
+            break;
+        case VAR_HANDLER_TIME:
+            out.putSeconds(entry.timing, PHASE_PARSED, PHASE_HANDLED);
+            break;
+        case VAR_SEND_TIME:
+            out.putSeconds(entry.timing, PHASE_HANDLED, PHASE_LAST_BYTE);
+            break;
+        case VAR_PHASES:
+            if (entry.timing)
+                out.pos += entry.timing->formatPhases(out.pos, out.end - out.pos);
+            else
+                out.put("-", 1);
+            break;
+        case VAR_HTTP_HEADER:
+        {
+            const std::string *value = request ? findHeader(*request, segment.text) : NULL;
+            out.putEscaped(value ? *value : std::string());
+            break;
+        }
+        }
+    }
+    *out.pos++ = '\n';
+    AsyncLog::write(log.channel, line, out.pos - line);
+}
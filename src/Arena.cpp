@@ -0,0 +1,144 @@
+#include "Arena.hpp"
+#include <cstdlib>
+
+static const size_t ARENA_ALIGN = 16;
+
+static size_t alignUp(size_t n)
+{
+    return (n + ARENA_ALIGN - 1) & ~(ARENA_ALIGN - 1);
+}
+
+static void countStat(size_t &slot)
+{
+    __atomic_add_fetch(&slot, 1, __ATOMIC_RELAXED);
+}
+
+static const size_t BLOCK_HEADER = (sizeof(void *) * 2 + ARENA_ALIGN - 1) & ~(ARENA_ALIGN - 1);
+
+__thread Arena *Arena::_current = NULL;
+ArenaStats Arena::_stats;
+
+Arena::Arena(size_t block_size)
+    : _first(NULL), _extra(NULL), _cursor(NULL), _limit(NULL), _block_size(block_size), _used(0), _high_water(0)
+{
+}
+
+Arena::~Arena()
+{
+    while (_extra)
+    {
+        Block *next = _extra->next;
+        ::operator delete(_extra);
+        _extra = next;
+    }
+    if (_first)
+        ::operator delete(_first);
+}
+
+Arena::Block *Arena::newBlock(size_t size)
+{
+    Block *block = static_cast<Block *>(::operator new(BLOCK_HEADER + size));
+    block->next = NULL;
+    block->size = size;
+    countStat(_stats.block_allocs);
+    return block;
+}
+
+void *Arena::allocate(size_t size)
+{
+    size = alignUp(size == 0 ? 1 : size);
+    _used += size;
+    if (_used > _high_water)
+    {
+        // 전체 최댓값은 이 아레나의 최댓값이 늘어날 때만 확인합니다.
+        _high_water = _used;
+        size_t seen = __atomic_load_n(&_stats.high_water, __ATOMIC_RELAXED);
+        while (_used > seen &&
+               !__atomic_compare_exchange_n(&_stats.high_water, &seen, _used, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+            ;
+    }
+    if (static_cast<size_t>(_limit - _cursor) >= size)
+    {
+        void *p = _cursor;
+        _cursor += size;
+        return p;
+    }
+    // 큰 요청은 전용 블록으로 할당하고 현재 블록은 계속 사용합니다.
+    if (size > _block_size / 4 && _first)
+    {
+        Block *big = newBlock(size);
+        big->next = _extra;
+        _extra = big;
+        countStat(_stats.oversize_allocs);
+        return reinterpret_cast<char *>(big) + BLOCK_HEADER;
+    }
+    Block *block;
+    if (!_first)
+    {
+        block = newBlock(size > _block_size ? size : _block_size);
+        _first = block;
+    }
+    else
+    {
+        block = newBlock(size > _block_size ? size : _block_size);
+        block->next = _extra;
+        _extra = block;
+    }
+    _cursor = reinterpret_cast<char *>(block) + BLOCK_HEADER;
+    _limit = _cursor + block->size;
+    void *p = _cursor;
+    _cursor += size;
+    return p;
+}
+
+void Arena::reset()
+{
+    while (_extra)
+    {
+        Block *next = _extra->next;
+        ::operator delete(_extra);
+        _extra = next;
+    }
+    if (_first)
+    {
+        _cursor = reinterpret_cast<char *>(_first) + BLOCK_HEADER;
+        _limit = _cursor + _first->size;
+    }
+    _used = 0;
+    countStat(_stats.resets);
+}
+
+size_t Arena::bytesUsed() const
+{
+    return _used;
+}
+
+size_t Arena::highWater() const
+{
+    return _high_water;
+}
+
+Arena *Arena::current()
+{
+    return _current;
+}
+
+ArenaStats Arena::stats()
+{
+    ArenaStats snapshot;
+    snapshot.high_water = __atomic_load_n(&_stats.high_water, __ATOMIC_RELAXED);
+    snapshot.block_allocs = __atomic_load_n(&_stats.block_allocs, __ATOMIC_RELAXED);
+    snapshot.oversize_allocs = __atomic_load_n(&_stats.oversize_allocs, __ATOMIC_RELAXED);
+    snapshot.resets = __atomic_load_n(&_stats.resets, __ATOMIC_RELAXED);
+    return snapshot;
+}
+
+ArenaScope::ArenaScope(Arena *arena) : _prev(Arena::_current)
+{
+    Arena::_current = arena;
+}
+
+ArenaScope::~ArenaScope()
+{
+    Arena::_current = _prev;
+}
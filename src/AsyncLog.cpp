@@ -0,0 +1,392 @@
+#include "AsyncLog.hpp"
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <ctime>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+// 생산자(요청 처리 스레드) 하나, 소비자(writer 스레드) 하나인 바이트 링
+// head는 생산자만, tail은 소비자만 갱신합니다. 줄 단위로만 넣으므로 중간이 잘리지 않습니다.
+struct LogRing
+{
+    char *data;
+    size_t head;
+    size_t tail;
+    int channel;
+    bool orphaned; // 소유 스레드가 종료됨 -> 비우고 나면 해제
+    LogRing *next;
+};
+
+struct LogChannel
+{
+    std::string path; // 빈 문자열이면 표준 에러
+    int fd;
+};
+
+// 스레드별 채널 -> 링 테이블 (pthread key로 등록)
+struct ThreadRings
+{
+    unsigned epoch;
+    LogRing *rings[LOG_MAX_CHANNELS];
+};
+
+static pthread_mutex_t g_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t g_wakeup = PTHREAD_COND_INITIALIZER;
+static LogChannel g_channels[LOG_MAX_CHANNELS];
+static int g_channel_count = 0;
+static LogRing *g_rings = NULL;
+static pthread_key_t g_ring_key;
+static pthread_once_t g_key_once = PTHREAD_ONCE_INIT;
+static pthread_t g_writer;
+static bool g_running = false;
+static unsigned g_epoch = 1; // stop()으로 링이 모두 해제될 때마다 증가
+static volatile sig_atomic_t g_reopen = 0;
+static AsyncLogStats g_stats;
+static size_t g_dropped = 0;
+
+static void releaseThreadRings(void *arg)
+{
+    ThreadRings *tr = static_cast<ThreadRings *>(arg);
+    pthread_mutex_lock(&g_lock);
+    if (tr->epoch == g_epoch)
+    {
+        for (int i = 0; i < LOG_MAX_CHANNELS; ++i)
+        {
+            if (tr->rings[i])
+                __atomic_store_n(&tr->rings[i]->orphaned, true, __ATOMIC_RELEASE);
+        }
+    }
+    pthread_mutex_unlock(&g_lock);
+    delete tr;
+}
+
+static void createRingKey()
+{
+    pthread_key_create(&g_ring_key, releaseThreadRings);
+}
+
+static LogRing *threadRing(int channel)
+{
+    pthread_once(&g_key_once, createRingKey);
+    ThreadRings *tr = static_cast<ThreadRings *>(pthread_getspecific(g_ring_key));
+    unsigned epoch = __atomic_load_n(&g_epoch, __ATOMIC_ACQUIRE);
+    if (!tr)
+    {
+        tr = new ThreadRings();
+        pthread_setspecific(g_ring_key, tr);
+        tr->epoch = 0;
+    }
+    if (tr->epoch != epoch)
+    {
+        memset(tr->rings, 0, sizeof(tr->rings));
+        tr->epoch = epoch;
+    }
+    LogRing *ring = tr->rings[channel];
+    if (ring)
+        return ring;
+    ring = new LogRing();
+    ring->data = new char[LOG_RING_SIZE];
+    ring->head = 0;
+    ring->tail = 0;
+    ring->channel = channel;
+    ring->orphaned = false;
+    pthread_mutex_lock(&g_lock);
+    ring->next = g_rings;
+    g_rings = ring;
+    pthread_mutex_unlock(&g_lock);
+    tr->rings[channel] = ring;
+    return ring;
+}
+
+static int openLogFile(const std::string &path)
+{
+    // 로그 디렉토리가 없으면 한 단계만 만들어 둡니다.
+    size_t slash = path.rfind('/');
+    if (slash != std::string::npos && slash > 0)
+    {
+        std::string dir = path.substr(0, slash);
+        struct stat st;
+        if (stat(dir.c_str(), &st) == -1)
+            mkdir(dir.c_str(), 0755);
+    }
+    return open(path.c_str(), O_WRONLY | O_APPEND | O_CREAT | O_CLOEXEC, 0644);
+}
+
+static void reopenChannels()
+{
+    for (int i = 0; i < g_channel_count; ++i)
+    {
+        if (g_channels[i].path.empty())
+            continue;
+        int fd = openLogFile(g_channels[i].path);
+        if (fd == -1)
+            continue;
+        // fd 번호를 유지한 채 새 파일로 교체합니다.
+        dup2(fd, g_channels[i].fd);
+        close(fd);
+    }
+    ++g_stats.reopens;
+}
+
+// iov를 모두 쓰거나 더 이상 쓸 수 없을 때까지 기록하고, 처리한 바이트 수를 돌려줍니다.
+static size_t writeAll(int fd, struct iovec *iov, int iovcnt)
+{
+    size_t done = 0;
+    while (iovcnt > 0)
+    {
+        ssize_t n = writev(fd, iov, iovcnt);
+        if (n < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            break;
+        }
+        ++g_stats.writes;
+        g_stats.bytes_written += n;
+        done += n;
+        size_t left = static_cast<size_t>(n);
+        while (iovcnt > 0 && left >= iov->iov_len)
+        {
+            left -= iov->iov_len;
+            ++iov;
+            --iovcnt;
+        }
+        if (iovcnt > 0)
+        {
+            iov->iov_base = static_cast<char *>(iov->iov_base) + left;
+            iov->iov_len -= left;
+        }
+    }
+    return done;
+}
+
+// 모든 링을 한 번 비웁니다. g_lock을 잡은 상태로 호출합니다.
+static size_t drainRings()
+{
+    size_t drained = 0;
+    LogRing **link = &g_rings;
+    while (*link)
+    {
+        LogRing *ring = *link;
+        bool orphaned = __atomic_load_n(&ring->orphaned, __ATOMIC_ACQUIRE);
+        size_t head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+        size_t tail = ring->tail;
+        if (head != tail)
+        {
+            size_t start = tail & (LOG_RING_SIZE - 1);
+            size_t pending = head - tail;
+            struct iovec iov[2];
+            int iovcnt = 1;
+            iov[0].iov_base = ring->data + start;
+            iov[0].iov_len = pending < LOG_RING_SIZE - start ? pending : LOG_RING_SIZE - start;
+            if (iov[0].iov_len < pending)
+            {
+                iov[1].iov_base = ring->data;
+                iov[1].iov_len = pending - iov[0].iov_len;
+                iovcnt = 2;
+            }
+            // 기록에 실패한 부분은 버립니다. (디스크 가득 참 등으로 무한 재시도하지 않도록)
+            writeAll(g_channels[ring->channel].fd, iov, iovcnt);
+            __atomic_store_n(&ring->tail, head, __ATOMIC_RELEASE);
+            drained += pending;
+        }
+        if (orphaned && head == __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE))
+        {
+            *link = ring->next;
+            delete[] ring->data;
+            delete ring;
+            continue;
+        }
+        link = &ring->next;
+    }
+    return drained;
+}
+
+static void freeAllRings()
+{
+    while (g_rings)
+    {
+        LogRing *next = g_rings->next;
+        delete[] g_rings->data;
+        delete g_rings;
+        g_rings = next;
+    }
+}
+
+void *AsyncLog::writerMain(void *arg)
+{
+    (void)arg;
+    pthread_mutex_lock(&g_lock);
+    while (true)
+    {
+        if (g_reopen)
+        {
+            g_reopen = 0;
+            reopenChannels();
+        }
+        size_t drained = drainRings();
+        if (!g_running)
+        {
+            if (drained == 0)
+                break;
+            continue;
+        }
+        // 주기적으로 깨어나 모아서 기록합니다. 링이 절반 이상 차면 생산자가 일찍 깨웁니다.
+        struct timeval now;
+        gettimeofday(&now, NULL);
+        struct timespec deadline;
+        long usec = now.tv_usec + LOG_FLUSH_INTERVAL_MS * 1000L;
+        deadline.tv_sec = now.tv_sec + usec / 1000000L;
+        deadline.tv_nsec = (usec % 1000000L) * 1000L;
+        pthread_cond_timedwait(&g_wakeup, &g_lock, &deadline);
+    }
+    pthread_mutex_unlock(&g_lock);
+    return NULL;
+}
+
+int AsyncLog::openChannel(const std::string &path)
+{
+    pthread_mutex_lock(&g_lock);
+    for (int i = 0; i < g_channel_count; ++i)
+    {
+        if (g_channels[i].path == path)
+        {
+            pthread_mutex_unlock(&g_lock);
+            return i;
+        }
+    }
+    int id = -1;
+    if (g_channel_count < LOG_MAX_CHANNELS)
+    {
+        int fd = path.empty() ? STDERR_FILENO : openLogFile(path);
+        if (fd != -1)
+        {
+            id = g_channel_count;
+            g_channels[id].path = path;
+            g_channels[id].fd = fd;
+            __atomic_store_n(&g_channel_count, id + 1, __ATOMIC_RELEASE);
+        }
+    }
+    pthread_mutex_unlock(&g_lock);
+    return id;
+}
+
+void AsyncLog::write(int channel, const char *data, size_t len)
+{
+    if (channel < 0 || channel >= __atomic_load_n(&g_channel_count, __ATOMIC_ACQUIRE))
+        return;
+    if (!__atomic_load_n(&g_running, __ATOMIC_ACQUIRE))
+    {
+        ssize_t ret = ::write(g_channels[channel].fd, data, len);
+        (void)ret;
+        return;
+    }
+    LogRing *ring = threadRing(channel);
+    size_t head = ring->head;
+    size_t tail = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+    if (len > LOG_RING_SIZE - (head - tail))
+    {
+        __atomic_add_fetch(&g_dropped, 1, __ATOMIC_RELAXED);
+        return;
+    }
+    size_t start = head & (LOG_RING_SIZE - 1);
+    size_t first = len < LOG_RING_SIZE - start ? len : LOG_RING_SIZE - start;
+    memcpy(ring->data + start, data, first);
+    memcpy(ring->data, data + first, len - first);
+    __atomic_store_n(&ring->head, head + len, __ATOMIC_RELEASE);
+    if (head + len - tail > LOG_RING_SIZE / 2)
+        pthread_cond_signal(&g_wakeup);
+}
+
+bool AsyncLog::start()
+{
+    pthread_mutex_lock(&g_lock);
+    if (g_running)
+    {
+        pthread_mutex_unlock(&g_lock);
+        return true;
+    }
+    // writer 스레드는 시그널을 받지 않도록 모두 막은 채로 생성합니다.
+    sigset_t all, old;
+    sigfillset(&all);
+    pthread_sigmask(SIG_SETMASK, &all, &old);
+    int err = pthread_create(&g_writer, NULL, writerMain, NULL);
+    pthread_sigmask(SIG_SETMASK, &old, NULL);
+    if (err == 0)
+        __atomic_store_n(&g_running, true, __ATOMIC_RELEASE);
+    pthread_mutex_unlock(&g_lock);
+    return err == 0;
+}
+
+void AsyncLog::stop()
+{
+    pthread_mutex_lock(&g_lock);
+    if (!g_running)
+    {
+        pthread_mutex_unlock(&g_lock);
+        return;
+    }
+    __atomic_store_n(&g_running, false, __ATOMIC_RELEASE);
+    pthread_cond_signal(&g_wakeup);
+    pthread_mutex_unlock(&g_lock);
+    pthread_join(g_writer, NULL);
+
+    pthread_mutex_lock(&g_lock);
+    drainRings();
+    freeAllRings();
+    __atomic_add_fetch(&g_epoch, 1, __ATOMIC_RELEASE);
+    pthread_mutex_unlock(&g_lock);
+}
+
+void AsyncLog::requestReopen()
+{
+    g_reopen = 1;
+}
+
+AsyncLogStats AsyncLog::stats()
+{
+    pthread_mutex_lock(&g_lock);
+    AsyncLogStats snapshot = g_stats;
+    pthread_mutex_unlock(&g_lock);
+    snapshot.dropped = __atomic_load_n(&g_dropped, __ATOMIC_RELAXED);
+    return snapshot;
+}
+
+static __thread time_t t_local_sec = -1;
+static __thread char t_local[32];
+static __thread size_t t_local_len = 0;
+static __thread time_t t_common_sec = -1;
+static __thread char t_common[40];
+static __thread size_t t_common_len = 0;
+
+const char *LogClock::localTime(size_t &len)
+{
+    time_t now = time(NULL);
+    if (now != t_local_sec)
+    {
+        struct tm local;
+        localtime_r(&now, &local);
+        t_local_len = strftime(t_local, sizeof(t_local), "%Y-%m-%d %H:%M:%S", &local);
+        t_local_sec = now;
+    }
+    len = t_local_len;
+    return t_local;
+}
+
+const char *LogClock::commonLogTime(size_t &len)
+{
+    time_t now = time(NULL);
+    if (now != t_common_sec)
+    {
+        struct tm local;
+        localtime_r(&now, &local);
+        t_common_len = strftime(t_common, sizeof(t_common), "%d/%b/%Y:%H:%M:%S %z", &local);
+        t_common_sec = now;
+    }
+    len = t_common_len;
+    return t_common;
+}
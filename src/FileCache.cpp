@@ -0,0 +1,252 @@
+#include "FileCache.hpp"
+#include "Log.hpp"
+#include "MimeTypes.hpp"
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <map>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <vector>
+
+#ifndef O_CLOEXEC
+#define O_CLOEXEC 0
+#endif
+
+typedef std::map<std::string, MappedFile *> FileTable;
+
+static pthread_mutex_t g_lock = PTHREAD_MUTEX_INITIALIZER;
+static FileTable g_table;
+static MappedFile *g_head = NULL; // 가장 최근에 쓴 항목
+static MappedFile *g_tail = NULL;
+static size_t g_cache_size = MMAP_CACHE_SIZE;
+static size_t g_min_file = MMAP_MIN_FILE;
+static size_t g_max_file = MMAP_MAX_FILE;
+static FileCacheStats g_stats;
+
+static long mtimeNsec(const struct stat &st)
+{
+#ifdef __APPLE__
+    return st.st_mtimespec.tv_nsec;
+#else
+    return st.st_mtim.tv_nsec;
+#endif
+}
+
+// 매핑한 뒤 파일이 바뀌었는지 (같은 경로에 다른 파일이 생겼거나, 내용을 고쳐 썼거나)
+static bool isStale(const MappedFile *file, const struct stat &st)
+{
+    return file->dev != st.st_dev || file->ino != st.st_ino || file->size != static_cast<size_t>(st.st_size) ||
+           file->mtime != st.st_mtime || file->mtime_nsec != mtimeNsec(st);
+}
+
+static void unlinkLru(MappedFile *file)
+{
+    if (file->prev)
+        file->prev->next = file->next;
+    else
+        g_head = file->next;
+    if (file->next)
+        file->next->prev = file->prev;
+    else
+        g_tail = file->prev;
+    file->prev = file->next = NULL;
+}
+
+static void pushFront(MappedFile *file)
+{
+    file->prev = NULL;
+    file->next = g_head;
+    if (g_head)
+        g_head->prev = file;
+    g_head = file;
+    if (!g_tail)
+        g_tail = file;
+}
+
+static void destroy(MappedFile *file)
+{
+    munmap(const_cast<char *>(file->data), file->size);
+    delete file;
+}
+
+// (잠금 안에서 호출) 테이블에서 빼고 테이블의 참조를 돌려줍니다. 마지막 참조였으면 잠금 밖에서 해제하도록 돌려줌
+static MappedFile *detach(MappedFile *file)
+{
+    g_table.erase(file->path);
+    unlinkLru(file);
+    g_stats.entries--;
+    g_stats.bytes -= file->size;
+    if (__atomic_sub_fetch(&file->refs, 1, __ATOMIC_ACQ_REL) == 0)
+        return file;
+    return NULL;
+}
+
+// (잠금 안에서 호출) 캐시 크기 안으로 들어올 때까지 오래된 항목부터 뺍니다.
+static void evict(std::vector<MappedFile *> &dead)
+{
+    while (g_stats.bytes > g_cache_size && g_tail)
+    {
+        MappedFile *file = detach(g_tail);
+        g_stats.evictions++;
+        if (file)
+            dead.push_back(file);
+    }
+}
+
+static void destroyAll(std::vector<MappedFile *> &dead)
+{
+    for (size_t i = 0; i < dead.size(); ++i)
+        destroy(dead[i]);
+    dead.clear();
+}
+
+// 파일을 열어 읽기 전용으로 매핑합니다. 실패하면 NULL (호출한 쪽이 읽어서 보냄)
+static MappedFile *mapFile(const std::string &path)
+{
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd == -1)
+        return NULL;
+    struct stat st;
+    if (fstat(fd, &st) == -1 || !S_ISREG(st.st_mode) || st.st_size == 0)
+    {
+        close(fd);
+        return NULL;
+    }
+    size_t size = static_cast<size_t>(st.st_size);
+    void *data = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED)
+    {
+        LogConfig::reportInternalError("mmap() failed: " + path + ": " + std::string(strerror(errno)));
+        return NULL;
+    }
+    // 처음부터 끝까지 한 번씩 보내므로 미리 읽기를 키우고 바로 읽어 들이게 합니다.
+    madvise(data, size, MADV_SEQUENTIAL);
+    madvise(data, size, MADV_WILLNEED);
+    MappedFile *file = new MappedFile();
+    file->path = path;
+    file->data = static_cast<const char *>(data);
+    file->size = size;
+    file->dev = st.st_dev;
+    file->ino = st.st_ino;
+    file->mtime = st.st_mtime;
+    file->mtime_nsec = mtimeNsec(st);
+    file->mime = &MimeTypes::lookup(path, &file->mime_generation);
+    file->refs = 1;
+    file->prev = file->next = NULL;
+    return file;
+}
+
+void FileCache::configure(size_t cache_size, size_t min_file, size_t max_file)
+{
+    std::vector<MappedFile *> dead;
+    pthread_mutex_lock(&g_lock);
+    g_cache_size = cache_size;
+    g_min_file = min_file;
+    g_max_file = max_file < cache_size ? max_file : cache_size;
+    evict(dead);
+    pthread_mutex_unlock(&g_lock);
+    destroyAll(dead);
+}
+
+MappedFile *FileCache::acquire(const std::string &path, const struct stat &st)
+{
+    size_t size = static_cast<size_t>(st.st_size);
+    std::vector<MappedFile *> dead;
+    pthread_mutex_lock(&g_lock);
+    size_t min_file = g_min_file, max_file = g_max_file;
+    if (g_cache_size == 0 || !S_ISREG(st.st_mode) || size == 0 || size < min_file || size > max_file)
+    {
+        pthread_mutex_unlock(&g_lock);
+        return NULL;
+    }
+    FileTable::iterator it = g_table.find(path);
+    if (it != g_table.end())
+    {
+        MappedFile *file = it->second;
+        if (!isStale(file, st))
+        {
+            unlinkLru(file);
+            pushFront(file);
+            __atomic_add_fetch(&file->refs, 1, __ATOMIC_RELAXED);
+            g_stats.hits++;
+            pthread_mutex_unlock(&g_lock);
+            return file;
+        }
+        // 보내는 중인 응답은 이전 매핑을 끝까지 보내고, 새 요청부터 바뀐 파일을 매핑합니다.
+        if (MappedFile *old = detach(file))
+            dead.push_back(old);
+        g_stats.invalidated++;
+    }
+    g_stats.misses++;
+    pthread_mutex_unlock(&g_lock);
+    destroyAll(dead);
+
+    // 매핑은 잠금 밖에서 합니다. 그 사이 다른 스레드가 같은 파일을 넣었으면 그쪽을 씁니다.
+    MappedFile *file = mapFile(path);
+    if (!file)
+        return NULL;
+    if (file->size < min_file || file->size > max_file)
+        return file; // stat 이후 크기가 바뀜: 이번 응답에만 씁니다. (release()에서 해제)
+    pthread_mutex_lock(&g_lock);
+    it = g_table.find(path);
+    if (it != g_table.end())
+    {
+        MappedFile *existing = it->second;
+        if (existing->ino == file->ino && existing->dev == file->dev && existing->size == file->size &&
+            existing->mtime == file->mtime && existing->mtime_nsec == file->mtime_nsec)
+        {
+            __atomic_add_fetch(&existing->refs, 1, __ATOMIC_RELAXED);
+            pthread_mutex_unlock(&g_lock);
+            destroy(file);
+            return existing;
+        }
+        if (MappedFile *old = detach(existing))
+            dead.push_back(old);
+    }
+    // 테이블과 호출한 쪽이 참조를 하나씩 가집니다.
+    file->refs = 2;
+    g_table[path] = file;
+    pushFront(file);
+    g_stats.entries++;
+    g_stats.bytes += file->size;
+    evict(dead);
+    pthread_mutex_unlock(&g_lock);
+    destroyAll(dead);
+    return file;
+}
+
+void FileCache::retain(MappedFile *file)
+{
+    __atomic_add_fetch(&file->refs, 1, __ATOMIC_RELAXED);
+}
+
+// 테이블에 있는 동안에는 테이블의 참조가 남아 있으므로 0이 되는 것은 테이블에서 빠진 매핑뿐입니다.
+void FileCache::release(MappedFile *file)
+{
+    if (__atomic_sub_fetch(&file->refs, 1, __ATOMIC_ACQ_REL) == 0)
+        destroy(file);
+}
+
+void FileCache::clear()
+{
+    std::vector<MappedFile *> dead;
+    pthread_mutex_lock(&g_lock);
+    while (g_head)
+    {
+        if (MappedFile *file = detach(g_head))
+            dead.push_back(file);
+    }
+    pthread_mutex_unlock(&g_lock);
+    destroyAll(dead);
+}
+
+FileCacheStats FileCache::stats()
+{
+    pthread_mutex_lock(&g_lock);
+    FileCacheStats stats = g_stats;
+    pthread_mutex_unlock(&g_lock);
+    return stats;
+}
@@ -0,0 +1,149 @@
+#include "IoPool.hpp"
+#include "Log.hpp"
+#include "Utils.hpp"
+#include <csignal>
+#include <cstring>
+#include <deque>
+#include <vector>
+
+struct IoQueueState
+{
+    pthread_mutex_t lock;
+    pthread_cond_t ready;
+    std::deque<IoTask *> tasks;
+    std::vector<pthread_t> threads;
+    size_t active;
+    uint64_t completed;
+    bool stopping;
+};
+
+static IoQueueState g_queues[IO_QUEUE_COUNT];
+static bool g_initialized = false;
+static bool g_running = false;
+
+static const char *const QUEUE_NAMES[IO_QUEUE_COUNT] = {"file", "upload", "directory", "cgi"};
+
+bool IoPool::start(size_t threads)
+{
+    if (threads == 0 || g_running)
+        return false;
+    if (!g_initialized)
+    {
+        for (int q = 0; q < IO_QUEUE_COUNT; ++q)
+        {
+            pthread_mutex_init(&g_queues[q].lock, NULL);
+            pthread_cond_init(&g_queues[q].ready, NULL);
+        }
+        g_initialized = true;
+    }
+    // 시그널은 주 스레드만 받습니다.
+    sigset_t all, old;
+    sigfillset(&all);
+    pthread_sigmask(SIG_SETMASK, &all, &old);
+    bool ok = true;
+    for (int q = 0; q < IO_QUEUE_COUNT && ok; ++q)
+    {
+        IoQueueState &queue = g_queues[q];
+        queue.stopping = false;
+        for (size_t i = 0; i < threads; ++i)
+        {
+            pthread_t thread;
+            int err = pthread_create(&thread, NULL, workerMain, &queue);
+            if (err != 0)
+            {
+                LogConfig::reportInternalError("Failed to start I/O thread: " + std::string(strerror(err)));
+                ok = false;
+                break;
+            }
+            queue.threads.push_back(thread);
+        }
+    }
+    pthread_sigmask(SIG_SETMASK, &old, NULL);
+    __atomic_store_n(&g_running, true, __ATOMIC_RELEASE);
+    if (!ok)
+    {
+        // 스레드가 없는 대기열이 생기지 않도록 모두 멈추고 이벤트 루프에서 처리합니다.
+        stop();
+        return false;
+    }
+    LogConfig::reportInfo("Running " + sizeToString(threads) + " I/O threads per queue (" +
+                          sizeToString(IO_QUEUE_COUNT) + " queues)");
+    return true;
+}
+
+void IoPool::stop()
+{
+    if (!__atomic_load_n(&g_running, __ATOMIC_ACQUIRE))
+        return;
+    __atomic_store_n(&g_running, false, __ATOMIC_RELEASE);
+    for (int q = 0; q < IO_QUEUE_COUNT; ++q)
+    {
+        IoQueueState &queue = g_queues[q];
+        pthread_mutex_lock(&queue.lock);
+        queue.stopping = true;
+        pthread_cond_broadcast(&queue.ready);
+        pthread_mutex_unlock(&queue.lock);
+        for (size_t i = 0; i < queue.threads.size(); ++i)
+            pthread_join(queue.threads[i], NULL);
+        queue.threads.clear();
+    }
+}
+
+bool IoPool::submit(IoQueue queue, IoTask *task)
+{
+    if (queue < 0 || queue >= IO_QUEUE_COUNT || !__atomic_load_n(&g_running, __ATOMIC_ACQUIRE))
+        return false;
+    IoQueueState &state = g_queues[queue];
+    pthread_mutex_lock(&state.lock);
+    state.tasks.push_back(task);
+    pthread_cond_signal(&state.ready);
+    pthread_mutex_unlock(&state.lock);
+    return true;
+}
+
+IoQueueStats IoPool::stats(IoQueue queue)
+{
+    IoQueueStats stats;
+    if (queue < 0 || queue >= IO_QUEUE_COUNT || !__atomic_load_n(&g_running, __ATOMIC_ACQUIRE))
+        return stats;
+    IoQueueState &state = g_queues[queue];
+    pthread_mutex_lock(&state.lock);
+    stats.threads = state.threads.size();
+    stats.depth = state.tasks.size();
+    stats.active = state.active;
+    stats.completed = state.completed;
+    pthread_mutex_unlock(&state.lock);
+    return stats;
+}
+
+const char *IoPool::queueName(IoQueue queue)
+{
+    if (queue < 0 || queue >= IO_QUEUE_COUNT)
+        return "none";
+    return QUEUE_NAMES[queue];
+}
+
+// 멈추라는 요청을 받아도 대기열에 남은 작업은 모두 실행하고 끝납니다.
+void *IoPool::workerMain(void *arg)
+{
+    IoQueueState *queue = static_cast<IoQueueState *>(arg);
+    pthread_mutex_lock(&queue->lock);
+    while (true)
+    {
+        while (queue->tasks.empty() && !queue->stopping)
+            pthread_cond_wait(&queue->ready, &queue->lock);
+        if (queue->tasks.empty())
+            break;
+        IoTask *task = queue->tasks.front();
+        queue->tasks.pop_front();
+        ++queue->active;
+        pthread_mutex_unlock(&queue->lock);
+        task->run();
+        task->complete();
+        pthread_mutex_lock(&queue->lock);
+        --queue->active;
+        ++queue->completed;
+    }
+    pthread_mutex_unlock(&queue->lock);
+    return NULL;
+}
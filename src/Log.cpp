@@ -1,4 +1,5 @@
 #include "Log.hpp"
+#include "AsyncLog.hpp"
 #include "Utils.hpp" // for intToString
 #include <sys/stat.h>
 #include <sys/types.h>
@@ -14,6 +15,7 @@ const std::string YELLOW_COLOR = "\033[33m";
 const std::string RED_COLOR = "\033[31m";
 const std::string GREEN_COLOR = "\033[32m";
 const std::string MAGENTA_COLOR = "\033[35m";
+const std::string CYAN_COLOR = "\033[36m";
 
 void LogConfig::printColoredMessage(const std::string &message, const char *time_str, const std::string &color)
 {
@@ -22,10 +24,9 @@ void LogConfig::printColoredMessage(const std::string &message, const char *time
 
 std::string LogConfig::getCurrentTimeStr()
 {
-    time_t now = time(NULL);
-    char buffer[100];
-    strftime(buffer, sizeof(buffer), "%Y-%m-%d %H:%M:%S", localtime(&now));
-    return std::string(buffer);
+    size_t len;
+    const char *time_str = LogClock::localTime(len);
+    return std::string(time_str, len);
 }
 
 void LogConfig::ensureLogDirectoryExists()
@@ -77,6 +78,13 @@ void LogConfig::printServerConfig(const ServerConfig &server, size_t index, std:
         ofs << std::endl;
         ofs << "      Root: " << location.root << std::endl;
         ofs << "      Upload Directory: " << location.upload_directory << std::endl;
+        ofs << "      Upload Store: " << (location.upload_store ? "on" : "off") << std::endl;
+        ofs << "      Resumable Upload: " << (location.upload_resumable ? "on" : "off") << std::endl;
+        ofs << "      Upload fsync: "
+            << (location.upload_fsync == UPLOAD_FSYNC_FILE      ? "file"
+                : location.upload_fsync == UPLOAD_FSYNC_BATCHED ? "batched"
+                                                                : "off")
+            << std::endl;
         ofs << "      Client max body size: " << location.client_max_body_size << std::endl;
         ofs << "      Allowed Extensions: ";
         for (size_t k = 0; k < location.allowed_extensions.size(); ++k)
@@ -140,121 +148,54 @@ void LogConfig::printAllConfigurations(const std::vector<ServerConfig> &servers)
 #endif
 }
 
-void LogConfig::reportSuccess(int status, const std::string &message)
+// 콘솔/상태 로그는 AsyncLog 링을 거쳐 writer 스레드가 모아서 기록합니다.
+static void emitStatusLine(const char *file, const std::string &color, const std::string &message)
 {
-    std::string time_str = getCurrentTimeStr();
+    static int console = AsyncLog::openChannel("");
+    size_t time_len;
+    const char *time_str = LogClock::localTime(time_len);
+    std::string line;
+    line.reserve(color.size() + time_len + message.size() + RESET_COLOR.size() + 8);
+    line.append(color).append("[").append(time_str, time_len).append("] ").append(message);
+    line.append(RESET_COLOR).append("\n");
+    AsyncLog::write(console, line.data(), line.size());
 #ifdef DEV_MODE
-    ensureLogDirectoryExists();
-
-    std::ofstream log_file(STATUS_SUCCESS_LOG_FILE, std::ios::app);
-    if (!log_file.is_open())
+    int channel = AsyncLog::openChannel(file);
+    if (channel == -1)
     {
-        std::ofstream create_file(STATUS_SUCCESS_LOG_FILE);
-        if (!create_file.is_open())
-        {
-            std::cerr << WHITE_COLOR << "[" << time_str << "] Error: Failed to create log file "
-                      << STATUS_SUCCESS_LOG_FILE << RESET_COLOR << std::endl;
-            printColoredMessage("Status: " + intToString(status) + ", Message: " + message, time_str.c_str(), GREEN_COLOR);
-            return;
-        }
-        create_file.close();
-        log_file.open(STATUS_SUCCESS_LOG_FILE, std::ios::app);
-        if (!log_file.is_open())
-        {
-            std::cerr << WHITE_COLOR << "[" << time_str << "] Error: Failed to open newly created log file "
-                      << STATUS_SUCCESS_LOG_FILE << RESET_COLOR << std::endl;
-            printColoredMessage("Status: " + intToString(status) + ", Message: " + message, time_str.c_str(), GREEN_COLOR);
-            return;
-        }
+        std::string err = WHITE_COLOR + "[" + std::string(time_str, time_len) + "] Error: Failed to open log file " +
+                          file + RESET_COLOR + "\n";
+        AsyncLog::write(console, err.data(), err.size());
+        return;
     }
-
-    log_file << "[" << time_str << "] "
-             << "Status: " << status << ", Message: " << message << std::endl;
-    log_file.close();
+    line.assign("[").append(time_str, time_len).append("] ").append(message).append("\n");
+    AsyncLog::write(channel, line.data(), line.size());
+#else
+    (void)file;
 #endif
-    printColoredMessage("Status: " + intToString(status) + ", Message: " + message, time_str.c_str(), GREEN_COLOR);
 }
 
-void LogConfig::reportError(int status, const std::string &message)
+void LogConfig::reportSuccess(int status, const std::string &message)
 {
-    std::string time_str = getCurrentTimeStr();
-#ifdef DEV_MODE
-    ensureLogDirectoryExists();
-
-    std::ofstream log_file(STATUS_ERROR_LOG_FILE, std::ios::app);
-    if (!log_file.is_open())
-    {
-        std::ofstream create_file(STATUS_ERROR_LOG_FILE);
-        if (!create_file.is_open())
-        {
-            std::cerr << WHITE_COLOR << "[" << time_str << "] Error: Failed to create log file "
-                      << STATUS_ERROR_LOG_FILE << RESET_COLOR << std::endl;
-            std::string color = WHITE_COLOR;
-            if (status >= 500)
-                color = RED_COLOR;
-            else if (status >= 400 && status < 500)
-                color = YELLOW_COLOR;
-            printColoredMessage("Status: " + intToString(status) + ", Message: " + message, time_str.c_str(), color);
-            return;
-        }
-        create_file.close();
-        log_file.open(STATUS_ERROR_LOG_FILE, std::ios::app);
-        if (!log_file.is_open())
-        {
-            std::cerr << WHITE_COLOR << "[" << time_str << "] Error: Failed to open newly created log file "
-                      << STATUS_ERROR_LOG_FILE << RESET_COLOR << std::endl;
-            std::string color = WHITE_COLOR;
-            if (status >= 500)
-                color = RED_COLOR;
-            else if (status >= 400 && status < 500)
-                color = YELLOW_COLOR;
-            printColoredMessage("Status: " + intToString(status) + ", Message: " + message, time_str.c_str(), color);
-            return;
-        }
-    }
+    emitStatusLine(STATUS_SUCCESS_LOG_FILE, GREEN_COLOR, "Status: " + intToString(status) + ", Message: " + message);
+}
 
-    log_file << "[" << time_str << "] "
-             << "Status: " << status << ", Message: " << message << std::endl;
-    log_file.close();
-#endif
+void LogConfig::reportError(int status, const std::string &message)
+{
     std::string color = WHITE_COLOR;
     if (status >= 500)
         color = RED_COLOR;
     else if (status >= 400 && status < 500)
         color = YELLOW_COLOR;
-    printColoredMessage("Status: " + intToString(status) + ", Message: " + message, time_str.c_str(), color);
+    emitStatusLine(STATUS_ERROR_LOG_FILE, color, "Status: " + intToString(status) + ", Message: " + message);
 }
 
 void LogConfig::reportInternalError(const std::string &message)
 {
-    std::string time_str = getCurrentTimeStr();
-#ifdef DEV_MODE
-    ensureLogDirectoryExists();
-
-    std::ofstream log_file(INTERNAL_ERROR_LOG_FILE, std::ios::app);
-    if (!log_file.is_open())
-    {
-        std::ofstream create_file(INTERNAL_ERROR_LOG_FILE);
-        if (!create_file.is_open())
-        {
-            std::cerr << WHITE_COLOR << "[" << time_str << "] Error: Failed to create log file "
-                      << INTERNAL_ERROR_LOG_FILE << RESET_COLOR << std::endl;
-            printColoredMessage(message, time_str.c_str(), MAGENTA_COLOR);
-            return;
-        }
-        create_file.close();
-        log_file.open(INTERNAL_ERROR_LOG_FILE, std::ios::app);
-        if (!log_file.is_open())
-        {
-            std::cerr << WHITE_COLOR << "[" << time_str << "] Error: Failed to open newly created log file "
-                      << INTERNAL_ERROR_LOG_FILE << RESET_COLOR << std::endl;
-            printColoredMessage(message, time_str.c_str(), MAGENTA_COLOR);
-            return;
-        }
-    }
+    emitStatusLine(INTERNAL_ERROR_LOG_FILE, MAGENTA_COLOR, "INTERNAL ERROR: " + message);
+}
 
-    log_file << "[" << time_str << "] INTERNAL ERROR: " << message << std::endl;
-    log_file.close();
-#endif
-    printColoredMessage("INTERNAL ERROR: " + message, time_str.c_str(), MAGENTA_COLOR);
+void LogConfig::reportInfo(const std::string &message)
+{
+    emitStatusLine(SERVER_INFO_LOG_FILE, CYAN_COLOR, "INFO: " + message);
 }
@@ -0,0 +1,385 @@
+#include "Metrics.hpp"
+#include "Arena.hpp"
+#include "AsyncLog.hpp"
+#include "BufferPool.hpp"
+#include "FileCache.hpp"
+#include "IoPool.hpp"
+#include "RateLimit.hpp"
+#include "Utils.hpp"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <pthread.h>
+#include <vector>
+
+// 버킷 i는 2^i 마이크로초 이하, 마지막 칸은 그 이상(+Inf)
+struct LatencyHistogram
+{
+    uint64_t buckets[METRICS_LATENCY_BUCKETS + 1];
+    uint64_t count;
+    uint64_t sum_us;
+};
+
+struct WorkerMetrics
+{
+    uint64_t counters[METRIC_COUNTER_COUNT];
+    LatencyHistogram cgi_duration;
+    LatencyHistogram *locations;
+    size_t location_count;
+    WorkerMetrics *next;
+} __attribute__((aligned(METRICS_CACHE_LINE)));
+
+struct LocationLabel
+{
+    std::string server;
+    std::string location;
+};
+
+static pthread_mutex_t g_registry_lock = PTHREAD_MUTEX_INITIALIZER;
+static WorkerMetrics *g_workers = NULL;
+static std::vector<LocationLabel> g_locations;
+static __thread WorkerMetrics *t_worker = NULL;
+
+static void *allocateAligned(size_t size)
+{
+    void *ptr = NULL;
+    if (posix_memalign(&ptr, METRICS_CACHE_LINE, size) != 0)
+        return NULL;
+    memset(ptr, 0, size);
+    return ptr;
+}
+
+// 처음 호출한 스레드의 카운터 블록을 만들어 등록합니다. (스레드 종료 후에도 값은 남겨 둡니다)
+static WorkerMetrics *localWorker()
+{
+    if (t_worker)
+        return t_worker;
+    WorkerMetrics *worker = static_cast<WorkerMetrics *>(allocateAligned(sizeof(WorkerMetrics)));
+    if (!worker)
+        abort();
+    pthread_mutex_lock(&g_registry_lock);
+    worker->location_count = g_locations.size();
+    if (worker->location_count > 0)
+        worker->locations = static_cast<LatencyHistogram *>(
+            allocateAligned(worker->location_count * sizeof(LatencyHistogram)));
+    if (!worker->locations)
+        worker->location_count = 0;
+    worker->next = g_workers;
+    g_workers = worker;
+    pthread_mutex_unlock(&g_registry_lock);
+    t_worker = worker;
+    return worker;
+}
+
+// 단일 작성자이므로 lock 접두사 없이 relaxed load/store로 충분합니다.
+static inline void bump(uint64_t &slot, uint64_t n)
+{
+    __atomic_store_n(&slot, __atomic_load_n(&slot, __ATOMIC_RELAXED) + n, __ATOMIC_RELAXED);
+}
+
+static inline uint64_t readSlot(const uint64_t &slot)
+{
+    return __atomic_load_n(&slot, __ATOMIC_RELAXED);
+}
+
+static void observe(LatencyHistogram &histogram, uint64_t usec)
+{
+    size_t index = usec <= 1 ? 0 : 64 - __builtin_clzll(usec - 1);
+    if (index > METRICS_LATENCY_BUCKETS)
+        index = METRICS_LATENCY_BUCKETS;
+    bump(histogram.buckets[index], 1);
+    bump(histogram.count, 1);
+    bump(histogram.sum_us, usec);
+}
+
+static void accumulate(LatencyHistogram &total, const LatencyHistogram &histogram)
+{
+    for (size_t i = 0; i <= METRICS_LATENCY_BUCKETS; ++i)
+        total.buckets[i] += readSlot(histogram.buckets[i]);
+    total.count += readSlot(histogram.count);
+    total.sum_us += readSlot(histogram.sum_us);
+}
+
+// 설정을 다시 읽어 새 location이 등록된 뒤 처음 보는 번호이면 히스토그램 배열을 늘립니다.
+// 배열은 이 스레드만 기록하고 collect()는 잠금 안에서만 읽으므로, 잠금 안에서 바꿔 끼우면 됩니다.
+static bool growLocations(WorkerMetrics *worker, size_t location_id)
+{
+    pthread_mutex_lock(&g_registry_lock);
+    size_t count = g_locations.size();
+    if (location_id >= count)
+    {
+        pthread_mutex_unlock(&g_registry_lock);
+        return false;
+    }
+    LatencyHistogram *locations = static_cast<LatencyHistogram *>(allocateAligned(count * sizeof(LatencyHistogram)));
+    if (!locations)
+    {
+        pthread_mutex_unlock(&g_registry_lock);
+        return false;
+    }
+    if (worker->location_count > 0)
+        memcpy(locations, worker->locations, worker->location_count * sizeof(LatencyHistogram));
+    free(worker->locations);
+    worker->locations = locations;
+    worker->location_count = count;
+    pthread_mutex_unlock(&g_registry_lock);
+    return true;
+}
+
+int Metrics::registerLocation(const std::string &server, const std::string &location)
+{
+    pthread_mutex_lock(&g_registry_lock);
+    // 설정을 다시 읽어도 같은 location은 같은 번호를 써서 히스토그램이 이어지도록 합니다.
+    for (size_t i = 0; i < g_locations.size(); ++i)
+    {
+        if (g_locations[i].server == server && g_locations[i].location == location)
+        {
+            pthread_mutex_unlock(&g_registry_lock);
+            return static_cast<int>(i);
+        }
+    }
+    LocationLabel label;
+    label.server = server;
+    label.location = location;
+    g_locations.push_back(label);
+    int id = static_cast<int>(g_locations.size() - 1);
+    pthread_mutex_unlock(&g_registry_lock);
+    return id;
+}
+
+void Metrics::add(MetricCounter counter, uint64_t n)
+{
+    bump(localWorker()->counters[counter], n);
+}
+
+void Metrics::set(MetricCounter counter, uint64_t value)
+{
+    __atomic_store_n(&localWorker()->counters[counter], value, __ATOMIC_RELAXED);
+}
+
+void Metrics::countResponse(int status)
+{
+    WorkerMetrics *worker = localWorker();
+    bump(worker->counters[METRIC_REQUESTS], 1);
+    int status_class = status / 100;
+    if (status_class >= 1 && status_class <= 5)
+        bump(worker->counters[METRIC_RESPONSES_1XX + status_class - 1], 1);
+}
+
+void Metrics::observeRequest(int location_id, uint64_t usec)
+{
+    WorkerMetrics *worker = localWorker();
+    if (location_id < 0)
+        return;
+    if (static_cast<size_t>(location_id) >= worker->location_count && !growLocations(worker, location_id))
+        return;
+    observe(worker->locations[location_id], usec);
+}
+
+void Metrics::observeCgi(uint64_t usec, bool ok)
+{
+    WorkerMetrics *worker = localWorker();
+    bump(worker->counters[METRIC_CGI_SPAWNS], 1);
+    if (!ok)
+        bump(worker->counters[METRIC_CGI_FAILURES], 1);
+    observe(worker->cgi_duration, usec);
+}
+
+// 모든 워커의 값을 합산합니다.
+static void collect(uint64_t *counters, LatencyHistogram &cgi, std::vector<LatencyHistogram> &locations)
+{
+    memset(counters, 0, sizeof(uint64_t) * METRIC_COUNTER_COUNT);
+    memset(&cgi, 0, sizeof(cgi));
+    pthread_mutex_lock(&g_registry_lock);
+    LatencyHistogram empty;
+    memset(&empty, 0, sizeof(empty));
+    locations.assign(g_locations.size(), empty);
+    for (WorkerMetrics *worker = g_workers; worker; worker = worker->next)
+    {
+        for (size_t i = 0; i < METRIC_COUNTER_COUNT; ++i)
+            counters[i] += readSlot(worker->counters[i]);
+        accumulate(cgi, worker->cgi_duration);
+        for (size_t i = 0; i < worker->location_count && i < locations.size(); ++i)
+            accumulate(locations[i], worker->locations[i]);
+    }
+    pthread_mutex_unlock(&g_registry_lock);
+}
+
+static void appendMetric(std::string &out, const char *name, const char *labels, uint64_t value)
+{
+    char digits[24];
+    out.append(name);
+    if (labels && *labels)
+        out.append("{").append(labels).append("}");
+    out.append(" ").append(digits, formatDecimal(digits, value)).append("\n");
+}
+
+static void appendHeader(std::string &out, const char *name, const char *type, const char *help)
+{
+    out.append("# HELP ").append(name).append(" ").append(help).append("\n");
+    out.append("# TYPE ").append(name).append(" ").append(type).append("\n");
+}
+
+// 레이블 값의 \, ", 개행을 이스케이프합니다.
+static std::string escapeLabel(const std::string &value)
+{
+    std::string escaped;
+    for (size_t i = 0; i < value.size(); ++i)
+    {
+        if (value[i] == '\\' || value[i] == '"')
+            escaped += '\\';
+        if (value[i] == '\n')
+            escaped += "\\n";
+        else
+            escaped += value[i];
+    }
+    return escaped;
+}
+
+static std::string queueLabel(IoQueue queue)
+{
+    return std::string("queue=\"") + IoPool::queueName(queue) + "\"";
+}
+
+static void appendHistogram(std::string &out, const char *name, const std::string &labels,
+                            const LatencyHistogram &histogram)
+{
+    char buf[128];
+    uint64_t cumulative = 0;
+    std::string prefix = labels.empty() ? "" : labels + ",";
+    for (size_t i = 0; i < METRICS_LATENCY_BUCKETS; ++i)
+    {
+        cumulative += histogram.buckets[i];
+        snprintf(buf, sizeof(buf), "le=\"%.6f\"", static_cast<double>(1UL << i) / 1000000.0);
+        appendMetric(out, (std::string(name) + "_bucket").c_str(), (prefix + buf).c_str(), cumulative);
+    }
+    cumulative += histogram.buckets[METRICS_LATENCY_BUCKETS];
+    appendMetric(out, (std::string(name) + "_bucket").c_str(), (prefix + "le=\"+Inf\"").c_str(), cumulative);
+    snprintf(buf, sizeof(buf), " %.6f\n", static_cast<double>(histogram.sum_us) / 1000000.0);
+    out.append(name).append("_sum");
+    if (!labels.empty())
+        out.append("{").append(labels).append("}");
+    out.append(buf);
+    appendMetric(out, (std::string(name) + "_count").c_str(), labels.c_str(), histogram.count);
+}
+
+void Metrics::renderPrometheus(std::string &out)
+{
+    uint64_t c[METRIC_COUNTER_COUNT];
+    LatencyHistogram cgi;
+    std::vector<LatencyHistogram> locations;
+    collect(c, cgi, locations);
+
+    uint64_t busy = c[METRIC_CONNECTIONS_READING] + c[METRIC_CONNECTIONS_WRITING];
+    uint64_t idle = c[METRIC_CONNECTIONS_ACTIVE] > busy ? c[METRIC_CONNECTIONS_ACTIVE] - busy : 0;
+    appendHeader(out, "webserv_connections", "gauge", "Client connections by state.");
+    appendMetric(out, "webserv_connections", "state=\"active\"", c[METRIC_CONNECTIONS_ACTIVE]);
+    appendMetric(out, "webserv_connections", "state=\"reading\"", c[METRIC_CONNECTIONS_READING]);
+    appendMetric(out, "webserv_connections", "state=\"writing\"", c[METRIC_CONNECTIONS_WRITING]);
+    appendMetric(out, "webserv_connections", "state=\"idle\"", idle);
+    appendHeader(out, "webserv_accepts_total", "counter", "Accepted client connections.");
+    appendMetric(out, "webserv_accepts_total", NULL, c[METRIC_ACCEPTS]);
+    appendHeader(out, "webserv_handled_total", "counter", "Accepted connections registered with the poller.");
+    appendMetric(out, "webserv_handled_total", NULL, c[METRIC_HANDLED]);
+    appendHeader(out, "webserv_rejected_total", "counter", "Connections answered with 503 because of overload.");
+    appendMetric(out, "webserv_rejected_total", NULL, c[METRIC_REJECTED]);
+    appendHeader(out, "webserv_accept_pauses_total", "counter", "Times the listeners were paused at capacity or on EMFILE.");
+    appendMetric(out, "webserv_accept_pauses_total", NULL, c[METRIC_ACCEPT_PAUSES]);
+    appendHeader(out, "webserv_limit_req_delayed_total", "counter", "Requests delayed by limit_req.");
+    appendMetric(out, "webserv_limit_req_delayed_total", NULL, c[METRIC_LIMIT_REQ_DELAYED]);
+    appendHeader(out, "webserv_limit_req_rejected_total", "counter", "Requests rejected by limit_req.");
+    appendMetric(out, "webserv_limit_req_rejected_total", NULL, c[METRIC_LIMIT_REQ_REJECTED]);
+    appendHeader(out, "webserv_limit_conn_rejected_total", "counter", "Requests rejected by limit_conn.");
+    appendMetric(out, "webserv_limit_conn_rejected_total", NULL, c[METRIC_LIMIT_CONN_REJECTED]);
+    appendHeader(out, "webserv_limit_zone_evictions_total", "counter", "Client addresses evicted from full limit zones.");
+    appendMetric(out, "webserv_limit_zone_evictions_total", NULL, RateLimit::evictions());
+    appendHeader(out, "webserv_requests_total", "counter", "Responses sent.");
+    appendMetric(out, "webserv_requests_total", NULL, c[METRIC_REQUESTS]);
+    appendHeader(out, "webserv_responses_total", "counter", "Responses sent by status class.");
+    static const char *CLASSES[] = {"class=\"1xx\"", "class=\"2xx\"", "class=\"3xx\"", "class=\"4xx\"",
+                                    "class=\"5xx\""};
+    for (int i = 0; i < 5; ++i)
+        appendMetric(out, "webserv_responses_total", CLASSES[i], c[METRIC_RESPONSES_1XX + i]);
+    appendHeader(out, "webserv_received_bytes_total", "counter", "Bytes read from client sockets.");
+    appendMetric(out, "webserv_received_bytes_total", NULL, c[METRIC_BYTES_IN]);
+    appendHeader(out, "webserv_sent_bytes_total", "counter", "Bytes written to client sockets.");
+    appendMetric(out, "webserv_sent_bytes_total", NULL, c[METRIC_BYTES_OUT]);
+    appendHeader(out, "webserv_cgi_spawns_total", "counter", "CGI processes started.");
+    appendMetric(out, "webserv_cgi_spawns_total", NULL, c[METRIC_CGI_SPAWNS]);
+    appendHeader(out, "webserv_cgi_failures_total", "counter", "CGI executions that failed.");
+    appendMetric(out, "webserv_cgi_failures_total", NULL, c[METRIC_CGI_FAILURES]);
+    appendHeader(out, "webserv_cgi_duration_seconds", "histogram", "CGI execution time.");
+    appendHistogram(out, "webserv_cgi_duration_seconds", "", cgi);
+
+    appendHeader(out, "webserv_request_duration_seconds", "histogram", "Request handling time by location.");
+    pthread_mutex_lock(&g_registry_lock);
+    std::vector<LocationLabel> labels(g_locations);
+    pthread_mutex_unlock(&g_registry_lock);
+    for (size_t i = 0; i < locations.size() && i < labels.size(); ++i)
+    {
+        std::string label =
+            "server=\"" + escapeLabel(labels[i].server) + "\",location=\"" + escapeLabel(labels[i].location) + "\"";
+        appendHistogram(out, "webserv_request_duration_seconds", label, locations[i]);
+    }
+
+    BufferPoolStats pool = BufferPool::stats();
+    appendHeader(out, "webserv_recv_buffers", "gauge", "Pooled receive buffers by state.");
+    appendMetric(out, "webserv_recv_buffers", "state=\"in_use\"", pool.in_use);
+    appendMetric(out, "webserv_recv_buffers", "state=\"free\"", pool.free);
+    appendHeader(out, "webserv_recv_buffer_cache_total", "counter", "Receive buffer acquisitions served from the pool.");
+    appendMetric(out, "webserv_recv_buffer_cache_total", "result=\"hit\"", pool.hits);
+    appendMetric(out, "webserv_recv_buffer_cache_total", "result=\"miss\"", pool.misses);
+    ArenaStats arena = Arena::stats();
+    appendHeader(out, "webserv_arena_high_water_bytes", "gauge", "Largest per-connection arena usage.");
+    appendMetric(out, "webserv_arena_high_water_bytes", NULL, arena.high_water);
+    appendHeader(out, "webserv_arena_block_allocations_total", "counter", "Arena blocks allocated.");
+    appendMetric(out, "webserv_arena_block_allocations_total", NULL, arena.block_allocs);
+    appendHeader(out, "webserv_io_queue_depth", "gauge", "File I/O tasks waiting for a pool thread, by queue.");
+    IoQueueStats io[IO_QUEUE_COUNT];
+    for (int q = 0; q < IO_QUEUE_COUNT; ++q)
+    {
+        io[q] = IoPool::stats(static_cast<IoQueue>(q));
+        appendMetric(out, "webserv_io_queue_depth", queueLabel(static_cast<IoQueue>(q)).c_str(), io[q].depth);
+    }
+    appendHeader(out, "webserv_io_tasks_active", "gauge", "File I/O tasks running on pool threads, by queue.");
+    for (int q = 0; q < IO_QUEUE_COUNT; ++q)
+        appendMetric(out, "webserv_io_tasks_active", queueLabel(static_cast<IoQueue>(q)).c_str(), io[q].active);
+    appendHeader(out, "webserv_io_tasks_total", "counter", "File I/O tasks completed, by queue.");
+    for (int q = 0; q < IO_QUEUE_COUNT; ++q)
+        appendMetric(out, "webserv_io_tasks_total", queueLabel(static_cast<IoQueue>(q)).c_str(), io[q].completed);
+    FileCacheStats files = FileCache::stats();
+    appendHeader(out, "webserv_mmap_cache_bytes", "gauge", "Bytes of static files kept mapped by mmap_cache.");
+    appendMetric(out, "webserv_mmap_cache_bytes", NULL, files.bytes);
+    appendHeader(out, "webserv_mmap_cache_files", "gauge", "Static files kept mapped by mmap_cache.");
+    appendMetric(out, "webserv_mmap_cache_files", NULL, files.entries);
+    appendHeader(out, "webserv_mmap_cache_total", "counter", "Static file lookups in mmap_cache.");
+    appendMetric(out, "webserv_mmap_cache_total", "result=\"hit\"", files.hits);
+    appendMetric(out, "webserv_mmap_cache_total", "result=\"miss\"", files.misses);
+    appendHeader(out, "webserv_mmap_cache_unmaps_total", "counter", "Mappings dropped from mmap_cache, by reason.");
+    appendMetric(out, "webserv_mmap_cache_unmaps_total", "reason=\"evicted\"", files.evictions);
+    appendMetric(out, "webserv_mmap_cache_unmaps_total", "reason=\"modified\"", files.invalidated);
+    AsyncLogStats log = AsyncLog::stats();
+    appendHeader(out, "webserv_log_written_bytes_total", "counter", "Bytes written by the log writer thread.");
+    appendMetric(out, "webserv_log_written_bytes_total", NULL, log.bytes_written);
+    appendHeader(out, "webserv_log_dropped_total", "counter", "Log lines dropped because a ring was full.");
+    appendMetric(out, "webserv_log_dropped_total", NULL, log.dropped);
+}
+
+void Metrics::renderStubStatus(std::string &out)
+{
+    uint64_t c[METRIC_COUNTER_COUNT];
+    LatencyHistogram cgi;
+    std::vector<LatencyHistogram> locations;
+    collect(c, cgi, locations);
+    uint64_t busy = c[METRIC_CONNECTIONS_READING] + c[METRIC_CONNECTIONS_WRITING];
+    uint64_t idle = c[METRIC_CONNECTIONS_ACTIVE] > busy ? c[METRIC_CONNECTIONS_ACTIVE] - busy : 0;
+    char buf[256];
+    snprintf(buf, sizeof(buf),
+             "Active connections: %lu \nserver accepts handled requests\n %lu %lu %lu \n"
+             "Reading: %lu Writing: %lu Waiting: %lu \n",
+             static_cast<unsigned long>(c[METRIC_CONNECTIONS_ACTIVE]), static_cast<unsigned long>(c[METRIC_ACCEPTS]),
+             static_cast<unsigned long>(c[METRIC_HANDLED]), static_cast<unsigned long>(c[METRIC_REQUESTS]),
+             static_cast<unsigned long>(c[METRIC_CONNECTIONS_READING]),
+             static_cast<unsigned long>(c[METRIC_CONNECTIONS_WRITING]), static_cast<unsigned long>(idle));
+    out.append(buf);
+}
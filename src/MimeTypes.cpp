@@ -0,0 +1,280 @@
+#include "MimeTypes.hpp"
+#include <algorithm>
+#include <pthread.h>
+#include <stdint.h>
+
+#define DEFAULT_MIME_TYPE "application/octet-stream"
+#define MAX_DISPLACEMENT 100000 // 넘으면 표를 두 배로 늘려 다시 만듭니다.
+
+// 설정에 types가 없을 때의 표 (config/mime.types와 같은 내용)
+static const char *const BUILTIN_TYPES[][2] = {
+    {"text/html", "html htm shtml"},
+    {"text/css", "css"},
+    {"text/xml", "xml"},
+    {"text/plain", "txt"},
+    {"text/csv", "csv"},
+    {"text/markdown", "md"},
+    {"text/javascript", "js mjs"},
+    {"application/json", "json map"},
+    {"application/manifest+json", "webmanifest"},
+    {"application/wasm", "wasm"},
+    {"application/pdf", "pdf"},
+    {"application/zip", "zip"},
+    {"application/gzip", "gz"},
+    {"application/x-tar", "tar"},
+    {"application/x-7z-compressed", "7z"},
+    {"application/rtf", "rtf"},
+    {"application/xhtml+xml", "xhtml"},
+    {"application/rss+xml", "rss"},
+    {"application/atom+xml", "atom"},
+    {"application/msword", "doc"},
+    {"application/vnd.openxmlformats-officedocument.wordprocessingml.document", "docx"},
+    {"application/vnd.ms-excel", "xls"},
+    {"application/vnd.openxmlformats-officedocument.spreadsheetml.sheet", "xlsx"},
+    {"application/vnd.ms-powerpoint", "ppt"},
+    {"application/vnd.openxmlformats-officedocument.presentationml.presentation", "pptx"},
+    {"application/octet-stream", "bin exe dll iso img"},
+    {"image/png", "png"},
+    {"image/jpeg", "jpg jpeg"},
+    {"image/gif", "gif"},
+    {"image/webp", "webp"},
+    {"image/avif", "avif"},
+    {"image/svg+xml", "svg svgz"},
+    {"image/x-icon", "ico"},
+    {"image/bmp", "bmp"},
+    {"image/tiff", "tif tiff"},
+    {"font/woff", "woff"},
+    {"font/woff2", "woff2"},
+    {"font/ttf", "ttf"},
+    {"font/otf", "otf"},
+    {"application/vnd.ms-fontobject", "eot"},
+    {"audio/mpeg", "mp3"},
+    {"audio/ogg", "ogg oga opus"},
+    {"audio/wav", "wav"},
+    {"audio/flac", "flac"},
+    {"audio/aac", "aac"},
+    {"audio/mp4", "m4a"},
+    {"video/mp4", "mp4 m4v"},
+    {"video/webm", "webm"},
+    {"video/ogg", "ogv"},
+    {"video/quicktime", "mov"},
+    {"video/x-matroska", "mkv"},
+    {"video/x-msvideo", "avi"},
+    {"video/mp2t", "ts"},
+    {"application/vnd.apple.mpegurl", "m3u8"},
+    {"application/dash+xml", "mpd"},
+};
+
+// 만들어진 표. 슬롯 수 = 버킷 수 = keys.size()
+struct MimeTable
+{
+    std::vector<std::string> keys;  // 슬롯별 확장자 (빈 칸은 "")
+    std::vector<std::string> types; // 슬롯별 MIME 타입
+    std::vector<int32_t> displace;  // 버킷별: >0 두 번째 해시의 seed, <0 -(슬롯+1)
+    unsigned generation;
+};
+
+static pthread_mutex_t g_lock = PTHREAD_MUTEX_INITIALIZER;
+static MimeTable *g_table = NULL;
+static std::vector<MimeTable *> g_retired;
+static unsigned g_generation = 0;
+static const std::string g_default(DEFAULT_MIME_TYPE);
+
+static inline char lowerChar(char c)
+{
+    return (c >= 'A' && c <= 'Z') ? static_cast<char>(c - 'A' + 'a') : c;
+}
+
+// FNV-1a. seed 0은 버킷을, 그 밖의 seed는 버킷 안에서 슬롯을 고릅니다. 대소문자는 구분하지 않습니다.
+static inline uint32_t hashExt(uint32_t seed, const char *s, size_t len)
+{
+    uint32_t h = seed ? seed : 2166136261u;
+    for (size_t i = 0; i < len; ++i)
+        h = (h ^ static_cast<unsigned char>(lowerChar(s[i]))) * 16777619u;
+    return h;
+}
+
+struct BucketBySize
+{
+    const std::vector<std::vector<size_t> > *buckets;
+    bool operator()(size_t a, size_t b) const
+    {
+        return (*buckets)[a].size() > (*buckets)[b].size();
+    }
+};
+
+// 큰 버킷부터 모든 키가 빈 슬롯에 떨어지는 seed를 찾고, 키 하나인 버킷은 남은 슬롯에 바로 넣습니다.
+static bool buildTable(const MimeTypeList &entries, size_t size, MimeTable &table)
+{
+    std::vector<std::vector<size_t> > buckets(size);
+    for (size_t i = 0; i < entries.size(); ++i)
+    {
+        const std::string &key = entries[i].first;
+        buckets[hashExt(0, key.data(), key.size()) % size].push_back(i);
+    }
+    std::vector<size_t> order(size);
+    for (size_t b = 0; b < size; ++b)
+        order[b] = b;
+    BucketBySize by_size;
+    by_size.buckets = &buckets;
+    std::stable_sort(order.begin(), order.end(), by_size);
+
+    table.keys.assign(size, std::string());
+    table.types.assign(size, std::string());
+    table.displace.assign(size, 0);
+    std::vector<bool> used(size, false);
+    size_t next_free = 0;
+    for (size_t o = 0; o < size; ++o)
+    {
+        const std::vector<size_t> &bucket = buckets[order[o]];
+        if (bucket.empty())
+            break;
+        if (bucket.size() == 1)
+        {
+            while (used[next_free])
+                ++next_free;
+            table.displace[order[o]] = -static_cast<int32_t>(next_free) - 1;
+            used[next_free] = true;
+            table.keys[next_free] = entries[bucket[0]].first;
+            table.types[next_free] = entries[bucket[0]].second;
+            continue;
+        }
+        std::vector<size_t> slots(bucket.size());
+        uint32_t seed = 1;
+        for (; seed < MAX_DISPLACEMENT; ++seed)
+        {
+            size_t k = 0;
+            for (; k < bucket.size(); ++k)
+            {
+                const std::string &key = entries[bucket[k]].first;
+                slots[k] = hashExt(seed, key.data(), key.size()) % size;
+                if (used[slots[k]] || std::find(slots.begin(), slots.begin() + k, slots[k]) != slots.begin() + k)
+                    break;
+            }
+            if (k == bucket.size())
+                break;
+        }
+        if (seed == MAX_DISPLACEMENT)
+            return false;
+        table.displace[order[o]] = static_cast<int32_t>(seed);
+        for (size_t k = 0; k < bucket.size(); ++k)
+        {
+            used[slots[k]] = true;
+            table.keys[slots[k]] = entries[bucket[k]].first;
+            table.types[slots[k]] = entries[bucket[k]].second;
+        }
+    }
+    return true;
+}
+
+static void appendBuiltinTypes(MimeTypeList &types)
+{
+    for (size_t i = 0; i < sizeof(BUILTIN_TYPES) / sizeof(BUILTIN_TYPES[0]); ++i)
+    {
+        std::string exts = BUILTIN_TYPES[i][1];
+        size_t start = 0;
+        while (start < exts.size())
+        {
+            size_t end = exts.find(' ', start);
+            if (end == std::string::npos)
+                end = exts.size();
+            types.push_back(std::make_pair(exts.substr(start, end - start), std::string(BUILTIN_TYPES[i][0])));
+            start = end + 1;
+        }
+    }
+}
+
+static MimeTable *makeTable(const MimeTypeList &types)
+{
+    MimeTypeList entries;
+    if (types.empty())
+        appendBuiltinTypes(entries);
+    else
+        entries = types;
+    // 같은 확장자가 여러 번 나오면 나중 것을 씁니다.
+    MimeTypeList unique;
+    for (size_t i = entries.size(); i-- > 0;)
+    {
+        for (size_t k = 0; k < entries[i].first.size(); ++k)
+            entries[i].first[k] = lowerChar(entries[i].first[k]);
+        bool seen = false;
+        for (size_t j = 0; j < unique.size() && !seen; ++j)
+            seen = unique[j].first == entries[i].first;
+        if (!seen && !entries[i].first.empty())
+            unique.push_back(entries[i]);
+    }
+    MimeTable *table = new MimeTable();
+    size_t size = unique.empty() ? 1 : unique.size();
+    while (!buildTable(unique, size, *table))
+        size *= 2;
+    return table;
+}
+
+void MimeTypes::install(const MimeTypeList &types)
+{
+    MimeTable *table = makeTable(types);
+    pthread_mutex_lock(&g_lock);
+    table->generation = ++g_generation;
+    if (g_table)
+        g_retired.push_back(g_table);
+    __atomic_store_n(&g_table, table, __ATOMIC_RELEASE);
+    pthread_mutex_unlock(&g_lock);
+}
+
+static MimeTable *currentTable()
+{
+    MimeTable *table = __atomic_load_n(&g_table, __ATOMIC_ACQUIRE);
+    if (table)
+        return table;
+    // 설정 없이 쓰는 경우 (도구, 테스트): 처음 한 번 기본 표를 만듭니다.
+    pthread_mutex_lock(&g_lock);
+    if (!g_table)
+    {
+        table = makeTable(MimeTypeList());
+        table->generation = ++g_generation;
+        __atomic_store_n(&g_table, table, __ATOMIC_RELEASE);
+    }
+    table = g_table;
+    pthread_mutex_unlock(&g_lock);
+    return table;
+}
+
+const std::string &MimeTypes::lookup(const std::string &path, unsigned *generation)
+{
+    const MimeTable *table = currentTable();
+    if (generation)
+        *generation = table->generation;
+    size_t dot = path.find_last_of("./");
+    if (dot == std::string::npos || path[dot] != '.' || dot + 1 == path.size())
+        return g_default;
+    const char *ext = path.data() + dot + 1;
+    size_t len = path.size() - dot - 1;
+    size_t size = table->keys.size();
+    int32_t d = table->displace[hashExt(0, ext, len) % size];
+    size_t slot = d < 0 ? static_cast<size_t>(-d - 1) : hashExt(static_cast<uint32_t>(d), ext, len) % size;
+    const std::string &key = table->keys[slot];
+    if (key.size() != len)
+        return g_default;
+    for (size_t i = 0; i < len; ++i)
+    {
+        if (lowerChar(ext[i]) != key[i])
+            return g_default;
+    }
+    return table->types[slot];
+}
+
+unsigned MimeTypes::generation()
+{
+    return currentTable()->generation;
+}
+
+void MimeTypes::clear()
+{
+    pthread_mutex_lock(&g_lock);
+    for (size_t i = 0; i < g_retired.size(); ++i)
+        delete g_retired[i];
+    g_retired.clear();
+    delete g_table;
+    __atomic_store_n(&g_table, static_cast<MimeTable *>(NULL), __ATOMIC_RELEASE);
+    pthread_mutex_unlock(&g_lock);
+}
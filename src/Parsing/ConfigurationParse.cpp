@@ -1,8 +1,81 @@
 #include "Configuration.hpp"
 #include "Utils.hpp"
+#include <cctype>
+#include <cstdlib>
 #include <fstream>
 #include <iostream>
 #include <sstream>
+#include <unistd.h>
+
+// 500ms, 2s 같은 시간 값을 마이크로초로 바꿉니다. 단위가 없으면 밀리초
+static uint64_t parseDuration(std::string value)
+{
+    uint64_t scale = 1000;
+    if (value.size() > 2 && value.compare(value.size() - 2, 2, "ms") == 0)
+        value.erase(value.size() - 2);
+    else if (value.size() > 1 && value[value.size() - 1] == 's')
+    {
+        value.erase(value.size() - 1);
+        scale = 1000000;
+    }
+    return strtoull(value.c_str(), NULL, 10) * scale;
+}
+
+// zone=<name>[:size] (크기는 limit_client_max_body_size와 같은 K/M 단위)
+static void parseLimitZone(const std::string &option, std::string &zone, size_t &zone_size)
+{
+    std::string value = option.substr(5);
+    size_t colon = value.find(':');
+    zone = value.substr(0, colon);
+    if (colon != std::string::npos)
+        zone_size = parseClientBodySize(value.substr(colon + 1));
+}
+
+// limit_req zone=<name>[:size] rate=<N>r/s|r/m [burst=N] [nodelay]
+static void parseLimitReq(std::istringstream &iss, LimitReqConfig &limit)
+{
+    limit = LimitReqConfig();
+    std::string option;
+    while (iss >> option)
+    {
+        if (option.compare(0, 5, "zone=") == 0)
+            parseLimitZone(option, limit.zone, limit.zone_size);
+        else if (option.compare(0, 5, "rate=") == 0)
+        {
+            char *end = NULL;
+            uint64_t rate = strtoull(option.c_str() + 5, &end, 10) * 1000;
+            limit.rate = (std::string(end) == "r/m") ? rate / 60 : rate;
+        }
+        else if (option.compare(0, 6, "burst=") == 0)
+            limit.burst = strtoull(option.c_str() + 6, NULL, 10);
+        else if (option == "nodelay")
+            limit.nodelay = true;
+    }
+    if (limit.zone.empty() || limit.rate == 0)
+    {
+        LogConfig::reportInternalError("limit_req needs zone= and rate=, ignoring");
+        limit = LimitReqConfig();
+    }
+}
+
+// limit_conn zone=<name>[:size] <N>
+static void parseLimitConn(std::istringstream &iss, LimitConnConfig &limit)
+{
+    limit = LimitConnConfig();
+    std::string option;
+    while (iss >> option)
+    {
+        if (option.compare(0, 5, "zone=") == 0)
+            parseLimitZone(option, limit.zone, limit.zone_size);
+        else
+            limit.limit = static_cast<uint32_t>(strtoul(option.c_str(), NULL, 10));
+    }
+    if (limit.zone.empty() || limit.limit == 0)
+    {
+        LogConfig::reportInternalError("limit_conn needs zone= and a positive limit, ignoring");
+        limit = LimitConnConfig();
+    }
+}
 
 void Configuration::parseLocationConfig(const std::string &line, LocationConfig &location_config)
 {
@@ -24,8 +97,9 @@ void Configuration::parseLocationConfig(const std::string &line, LocationConfig
         iss >> status; //status code
         iss >> location_config.redirect;
     }
-    else if (key == "directory_listing")
+    else if (key == "directory_listing" || key == "autoindex")
     {
+        // autoindex on|off; (directory_listing과 같음)
         std::string value;
         iss >> value;
         location_config.directory_listing = (value == "on");
@@ -36,6 +110,34 @@ void Configuration::parseLocationConfig(const std::string &line, LocationConfig
         iss >> location_config.default_file;
     else if (key == "upload_directory")
         iss >> location_config.upload_directory;
+    else if (key == "upload_store")
+    {
+        // upload_store on|off;
+        std::string value;
+        iss >> value;
+        location_config.upload_store = (value == "on");
+    }
+    else if (key == "upload_resumable")
+    {
+        // upload_resumable on|off;
+        std::string value;
+        iss >> value;
+        location_config.upload_resumable = (value == "on");
+    }
+    else if (key == "upload_fsync")
+    {
+        // upload_fsync off|file|batched;
+        std::string value;
+        iss >> value;
+        if (value == "off")
+            location_config.upload_fsync = UPLOAD_FSYNC_OFF;
+        else if (value == "file")
+            location_config.upload_fsync = UPLOAD_FSYNC_FILE;
+        else if (value == "batched")
+            location_config.upload_fsync = UPLOAD_FSYNC_BATCHED;
+        else
+            LogConfig::reportInternalError("Invalid upload_fsync: " + value + ", ignoring");
+    }
     else if (key == "allowed_extensions")
     {
         std::string ext;
@@ -63,6 +165,20 @@ void Configuration::parseLocationConfig(const std::string &line, LocationConfig
         while (iss >> path)
             location_config.cgi_path.push_back(path);
     }
+    else if (key == "stub_status" || key == "metrics")
+    {
+        // stub_status; | stub_status on|off; (metrics도 동일)
+        std::string value;
+        iss >> value;
+        if (value == "off")
+            location_config.status_page = STATUS_PAGE_NONE;
+        else
+            location_config.status_page = (key == "metrics") ? STATUS_PAGE_PROMETHEUS : STATUS_PAGE_STUB;
+    }
+    else if (key == "limit_req")
+        parseLimitReq(iss, location_config.limit_req);
+    else if (key == "limit_conn")
+        parseLimitConn(iss, location_config.limit_conn);
 }
 
 void Configuration::parseServerConfig(const std::string &line, ServerConfig &server_config)
@@ -71,7 +187,16 @@ void Configuration::parseServerConfig(const std::string &line, ServerConfig &ser
     std::string key;
     iss >> key;
     if (key == "listen")
+    {
+        // listen <port> [backlog=N];
         iss >> server_config.port;
+        std::string option;
+        while (iss >> option)
+        {
+            if (option.compare(0, 8, "backlog=") == 0)
+                server_config.listen_backlog = std::atoi(option.c_str() + 8);
+        }
+    }
     else if (key == "server_name")
         iss >> server_config.server_name;
     else if (key == "root")
@@ -103,6 +228,44 @@ void Configuration::parseServerConfig(const std::string &line, ServerConfig &ser
         iss >> value;
         server_config.client_max_body_size = parseClientBodySize(value);
     }
+    else if (key == "access_log")
+    {
+        // access_log off; | access_log <path> [format_name];
+        iss >> server_config.access_log;
+        std::string format_name;
+        if (iss >> format_name)
+            server_config.access_log_format = format_name;
+    }
+    else if (key == "server_timing")
+    {
+        std::string value;
+        iss >> value;
+        server_config.server_timing = (value == "on");
+    }
+    else if (key == "slow_request_log")
+    {
+        // slow_request_log <path> [threshold]; (예: 500ms, 2s, 단위가 없으면 밀리초)
+        iss >> server_config.slow_request_log;
+        std::string threshold;
+        if (iss >> threshold)
+            server_config.slow_request_threshold_us = parseDuration(threshold);
+    }
+    else if (key == "log_format")
+    {
+        // log_format <name> '<format>'; (따옴표는 벗겨냅니다)
+        std::string name, format;
+        iss >> name;
+        std::getline(iss, format);
+        format = trim(format);
+        if (format.size() >= 2 && (format[0] == '\'' || format[0] == '"') && format[format.size() - 1] == format[0])
+            format = format.substr(1, format.size() - 2);
+        if (!name.empty())
+            server_config.log_formats[name] = format;
+    }
+    else if (key == "limit_req")
+        parseLimitReq(iss, server_config.limit_req);
+    else if (key == "limit_conn")
+        parseLimitConn(iss, server_config.limit_conn);
 }
 
 void Configuration::processServerLine(const std::string &line, ServerConfig &server_config)
@@ -115,6 +278,148 @@ void Configuration::processLocationLine(const std::string &line, LocationConfig
     parseLocationConfig(line, location_config);
 }
 
+// server 블록 밖의 전역 설정
+void Configuration::parseGlobalConfig(const std::string &line)
+{
+    std::istringstream iss(line);
+    std::string key;
+    iss >> key;
+    if (key == "worker_connections")
+    {
+        // worker_connections <N> [pause|reject];
+        long value = 0;
+        if (iss >> value && value > 0)
+            worker_connections = static_cast<size_t>(value);
+        std::string overflow;
+        if (iss >> overflow)
+            reject_overflow = (overflow == "reject");
+    }
+    else if (key == "worker_threads")
+    {
+        // worker_threads <N|auto>; (auto: 온라인 CPU 수)
+        std::string value;
+        iss >> value;
+        long count = value == "auto" ? sysconf(_SC_NPROCESSORS_ONLN) : std::atol(value.c_str());
+        if (count > 0)
+            worker_threads = static_cast<size_t>(count < WORKER_THREADS_MAX ? count : WORKER_THREADS_MAX);
+        else
+            LogConfig::reportInternalError("Invalid worker_threads: " + value);
+    }
+    else if (key == "io_threads")
+    {
+        // io_threads <N>; (IoPool 대기열마다 N개, 0이면 이벤트 루프에서 바로 처리)
+        std::string value;
+        iss >> value;
+        long count = std::atol(value.c_str());
+        if (count > 0 || value == "0")
+            io_threads = static_cast<size_t>(count < IO_THREADS_MAX ? count : IO_THREADS_MAX);
+        else
+            LogConfig::reportInternalError("Invalid io_threads: " + value);
+    }
+    else if (key == "mmap_cache")
+    {
+        // mmap_cache <크기>|off [min=<크기>] [max=<크기>]; (예: mmap_cache 128M min=32K max=8M)
+        std::string value;
+        iss >> value;
+        mmap_cache_size = value == "off" ? 0 : parseClientBodySize(value);
+        std::string option;
+        while (iss >> option)
+        {
+            if (option.compare(0, 4, "min=") == 0)
+                mmap_min_file = parseClientBodySize(option.substr(4));
+            else if (option.compare(0, 4, "max=") == 0)
+                mmap_max_file = parseClientBodySize(option.substr(4));
+            else
+                LogConfig::reportInternalError("Invalid mmap_cache option: " + option);
+        }
+    }
+    else if (key == "shutdown_timeout")
+    {
+        // shutdown_timeout <시간>; (예: 30s, 500ms)
+        std::string value;
+        if (iss >> value)
+            shutdown_timeout_us = parseDuration(value);
+    }
+}
+
+// 따옴표 밖에서 공백 뒤에 오는 '#'부터 줄 끝까지를 주석으로 보고 지웁니다.
+static std::string stripTrailingComment(const std::string &line)
+{
+    char quote = 0;
+    for (size_t i = 0; i < line.size(); ++i)
+    {
+        if (quote)
+        {
+            if (line[i] == quote)
+                quote = 0;
+        }
+        else if (line[i] == '\'' || line[i] == '"')
+            quote = line[i];
+        else if (line[i] == '#' && i > 0 && isspace(static_cast<unsigned char>(line[i - 1])))
+            return line.substr(0, i);
+    }
+    return line;
+}
+
+void Configuration::parseTypesLine(const std::string &line)
+{
+    std::istringstream iss(line);
+    std::string type, ext;
+    iss >> type;
+    while (iss >> ext)
+        mime_types.push_back(std::make_pair(ext, type));
+}
+
+bool Configuration::parseTypesFile(const std::string &path)
+{
+    std::ifstream file(path.c_str());
+    if (!file.is_open())
+    {
+        std::cerr << "Failed to open types file: " << path << std::endl;
+        return false;
+    }
+    std::string line;
+    while (getline(file, line))
+    {
+        line = trim(stripTrailingComment(line));
+        if (!line.empty() && line[line.size() - 1] == ';')
+            line.erase(line.size() - 1);
+        if (line.empty() || line[0] == '#' || line == "}" || line.compare(0, 5, "types") == 0)
+            continue;
+        parseTypesLine(line);
+    }
+    return true;
+}
+
+// cgi_extension과 cgi_path를 순서대로 짝지어 확장자별 인터프리터 표를 만듭니다.
+// cgi_path가 모자라면 알려진 확장자(py, sh, pl)는 기본 인터프리터를 씁니다. 찾지 못한 확장자는
+// 스크립트 원문이 정적 파일로 나가지 않도록 빈 경로로 남겨 실행 때 500으로 답합니다.
+static void buildCgiInterpreters(LocationConfig &location_config)
+{
+    location_config.cgi_interpreters.clear();
+    for (size_t i = 0; i < location_config.cgi_extension.size(); ++i)
+    {
+        std::string ext = location_config.cgi_extension[i];
+        if (!ext.empty() && ext[0] == '.')
+            ext.erase(0, 1);
+        ext = toLower(ext);
+        std::string interpreter;
+        if (i < location_config.cgi_path.size())
+            interpreter = location_config.cgi_path[i];
+        else if (ext == "py")
+            interpreter = PYTHON_PATH;
+        else if (ext == "sh")
+            interpreter = "/bin/bash";
+        else if (ext == "pl")
+            interpreter = "/usr/bin/perl";
+        if (interpreter.empty())
+            LogConfig::reportInternalError("cgi_extension ." + ext + " has no cgi_path in " + location_config.path);
+        else if (access(interpreter.c_str(), X_OK) != 0)
+            LogConfig::reportInternalError("CGI interpreter is not executable: " + interpreter);
+        location_config.cgi_interpreters[ext] = interpreter;
+    }
+}
+
 bool Configuration::parseConfigFile(const std::string &filename)
 {
     std::ifstream file(filename.c_str());
@@ -126,14 +431,36 @@ bool Configuration::parseConfigFile(const std::string &filename)
     std::string line;
     ServerConfig current_server;
     LocationConfig current_location;
-    bool in_server = false, in_location = false;
+    bool in_server = false, in_location = false, in_types = false;
+    // include 경로는 설정 파일이 있는 디렉터리 기준입니다.
+    std::string base_dir = filename.find('/') == std::string::npos ? "" : filename.substr(0, filename.rfind('/') + 1);
     while (getline(file, line))
     {
-        line = trim(line);
+        line = trim(stripTrailingComment(line));
         if (line.empty() || line[0] == '#')
             continue;
         if (line[line.size() - 1] == ';')
             line.erase(line.size() - 1);
+        if (in_types)
+        {
+            if (line == "}")
+                in_types = false;
+            else
+                parseTypesLine(line);
+            continue;
+        }
+        if (!in_server && line.compare(0, 5, "types") == 0 && line.find('{') != std::string::npos)
+        {
+            in_types = true;
+            continue;
+        }
+        if (!in_server && line.compare(0, 8, "include ") == 0)
+        {
+            std::string path = trim(line.substr(8));
+            if (!parseTypesFile(path[0] == '/' ? path : base_dir + path))
+                return false;
+            continue;
+        }
         if (line.find("server {") != std::string::npos)
         {
             in_server = true;
@@ -146,6 +473,7 @@ bool Configuration::parseConfigFile(const std::string &filename)
             {
                 if (in_location)
                 {
+                    buildCgiInterpreters(current_location);
                     current_server.locations.push_back(current_location);
                     in_location = false;
                 }
@@ -166,6 +494,7 @@ bool Configuration::parseConfigFile(const std::string &filename)
             {
                 if (line.find("}") != std::string::npos)
                 {
+                    buildCgiInterpreters(current_location);
                     current_server.locations.push_back(current_location);
                     in_location = false;
                     continue;
@@ -177,6 +506,8 @@ bool Configuration::parseConfigFile(const std::string &filename)
                 processServerLine(line, current_server);
             }
         }
+        else
+            parseGlobalConfig(line);
     }
     file.close();
     printConfiguration();
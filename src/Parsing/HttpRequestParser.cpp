@@ -1,8 +1,11 @@
 #include "HttpRequestParser.hpp"
+#include "HttpTokenizer.hpp"
 #include "Utils.hpp" // trimString, urlDecode 등 유틸 함수 포함
 #include <cstdlib>
+#include <cstring>
 #include <iostream>
 #include <sstream>
+#include <strings.h>
 
 Parser::Parser()
 {
@@ -15,18 +18,22 @@ bool Parser::parse(const std::string &data, ParsedRequest &req)
 {
     req.consumed = 0;
     req.isPartial = false;
-    size_t line_end = data.find("\r\n");
-    if (line_end == std::string::npos)
+    size_t line_end = 0;
+    HttpTokenizer::LineStatus status = HttpTokenizer::scanLine(data.data(), data.size(), line_end);
+    if (status == HttpTokenizer::LINE_INVALID)
+        return false;
+    if (status == HttpTokenizer::LINE_PARTIAL)
     {
         req.isPartial = true;
         return true;
     }
-    std::string request_line = data.substr(0, line_end);
-    if (!parseRequestLine(request_line, req))
+    if (!parseRequestLine(data.data(), line_end, req))
         return false;
     size_t offset = line_end + 2;
     if (!parseHeaders(data, offset, req.headers, req.isPartial))
         return false;
+    if (req.isPartial)
+        return true;
     int content_length = 0;
     if (req.headers.find("Content-Length") != req.headers.end())
     {
@@ -42,13 +49,13 @@ bool Parser::parse(const std::string &data, ParsedRequest &req)
     }
     req.body = data.substr(offset, content_length);
 
-    // 디버그: Content-Type 값 출력
-    if (req.headers.find("Content-Type") != req.headers.end())
+    HeaderMap::const_iterator ct_it = req.headers.find("Content-Type");
+    if (ct_it != req.headers.end())
     {
-        std::string ct = req.headers["Content-Type"];
-        // 대소문자 무시, 앞뒤 공백 제거
-        std::string ct_lower = toLower(trim(ct));
-        if (ct_lower.find("multipart/form-data") != std::string::npos)
+        const std::string &ct = ct_it->second;
+        // 헤더 값은 이미 앞뒤 공백이 제거되어 있으므로 복사 없이 대소문자 무시 비교
+        static const char multipart[] = "multipart/form-data";
+        if (ct.size() >= sizeof(multipart) - 1 && strncasecmp(ct.c_str(), multipart, sizeof(multipart) - 1) == 0)
         {
             std::string boundary;
             if (!extractBoundary(ct, boundary))
@@ -62,25 +69,31 @@ bool Parser::parse(const std::string &data, ParsedRequest &req)
 }
 
 
-bool Parser::parseRequestLine(const std::string &line, ParsedRequest &req)
+bool Parser::parseRequestLine(const char *line, size_t len, ParsedRequest &req)
 {
-    size_t firstSpace = line.find(' ');
-    if (firstSpace == std::string::npos)
+    // request-line = method SP request-target SP HTTP-version
+    const char *end = line + len;
+    const char *first_space = static_cast<const char *>(memchr(line, ' ', len));
+    if (first_space == NULL || !HttpTokenizer::isToken(line, first_space - line))
         return false;
-
-    size_t secondSpace = line.find(' ', firstSpace + 1);
-    if (secondSpace == std::string::npos)
+    const char *target = first_space + 1;
+    const char *second_space = static_cast<const char *>(memchr(target, ' ', end - target));
+    if (second_space == NULL)
     {
-        secondSpace = line.size();
+        second_space = end;
         req.httpVersion = "HTTP/1.1";
     }
     else
     {
-        req.httpVersion = line.substr(secondSpace + 1);
+        req.httpVersion.assign(second_space + 1, end);
+        if (req.httpVersion.compare(0, 5, "HTTP/") != 0)
+            return false;
     }
+    if (second_space == target)
+        return false;
 
-    req.method = line.substr(0, firstSpace);
-    std::string url = line.substr(firstSpace + 1, secondSpace - firstSpace - 1);
+    req.method.assign(line, first_space);
+    std::string url(target, second_space);
     size_t qmark = url.find('?');
     if (qmark != std::string::npos)
     {
@@ -93,27 +106,17 @@ bool Parser::parseRequestLine(const std::string &line, ParsedRequest &req)
     }
 
     // Split URL into req.path and PATH_INFO
+    // (요청마다 값이 다르므로 프로세스 환경 변수가 아닌 요청에 담고, CGI 자식에서 설정합니다)
+    req.path_info.clear();
     size_t dot_pos = url.find_last_of('.');
-    if (dot_pos != std::string::npos)
+    size_t slash_pos = dot_pos != std::string::npos ? url.find('/', dot_pos) : std::string::npos;
+    if (slash_pos != std::string::npos)
     {
-        size_t slash_pos = url.find('/', dot_pos);
-        if (slash_pos != std::string::npos)
-        {
-            std::string path_info = url.substr(slash_pos);
-            setenv("PATH_INFO", path_info.c_str(), 1);
-            req.path = url.substr(0, slash_pos);
-        }
-        else
-        {
-            setenv("PATH_INFO", "", 1); // Set PATH_INFO to empty if no slash found
-            req.path = url;
-        }
+        req.path_info = url.substr(slash_pos);
+        req.path = url.substr(0, slash_pos);
     }
     else
-    {
-        setenv("PATH_INFO", "", 1); // Set PATH_INFO to empty if no dot found
         req.path = url;
-    }
 
     // Parse query parameters if present
     if (!req.query_string.empty())
@@ -139,26 +142,39 @@ bool Parser::parseRequestLine(const std::string &line, ParsedRequest &req)
     return true;
 }
 
-bool Parser::parseHeaders(const std::string &data, size_t &offset, std::map<std::string, std::string> &headers,
+bool Parser::parseHeaders(const std::string &data, size_t &offset, HeaderMap &headers,
                           bool &isPartial)
 {
+    const char *buf = data.data();
     while (1)
     {
-        size_t next_end = data.find("\r\n", offset);
-        if (next_end == std::string::npos)
+        size_t line_len = 0;
+        HttpTokenizer::LineStatus status = HttpTokenizer::scanLine(buf + offset, data.size() - offset, line_len);
+        if (status == HttpTokenizer::LINE_INVALID)
+            return false;
+        if (status == HttpTokenizer::LINE_PARTIAL)
         {
             isPartial = true;
             return true;
         }
-        if (next_end == offset)
+        if (line_len == 0)
         {
             offset += 2;
             break;
         }
-        std::string line = data.substr(offset, next_end - offset);
-        if (!parseHeaderLine(line, headers))
+        // field-name ":" OWS field-value OWS
+        const char *line = buf + offset;
+        size_t colon = 0;
+        if (!HttpTokenizer::scanHeaderName(line, line_len, colon))
             return false;
-        offset = next_end + 2;
+        size_t value_begin = colon + 1;
+        size_t value_end = line_len;
+        while (value_begin < value_end && (line[value_begin] == ' ' || line[value_begin] == '\t'))
+            ++value_begin;
+        while (value_end > value_begin && (line[value_end - 1] == ' ' || line[value_end - 1] == '\t'))
+            --value_end;
+        headers[std::string(line, colon)].assign(line + value_begin, value_end - value_begin);
+        offset += line_len + 2;
     }
     return true;
 }
@@ -0,0 +1,211 @@
+#include "HttpTokenizer.hpp"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define TOKENIZER_X86 1
+#include <immintrin.h>
+#endif
+
+// RFC 9110 5.6.2 tchar = "!" / "#" / "$" / "%" / "&" / "'" / "*" / "+" / "-" / "." /
+//                        "^" / "_" / "`" / "|" / "~" / DIGIT / ALPHA
+static const unsigned char TOKEN_CHAR_MAP[256] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 1, 0, 1, 1, 1, 1, 1, 0, 0, 1, 1, 0, 1, 1, 0, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0, 0,
+    0, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0, 0, 0, 1, 1,
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0, 1, 0, 1, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0};
+
+static inline bool isCtl(unsigned char c)
+{
+    return (c < 0x20 && c != '\t') || c == 0x7f;
+}
+
+static size_t findCtlScalar(const char *buf, size_t len)
+{
+    for (size_t i = 0; i < len; ++i)
+    {
+        if (isCtl(static_cast<unsigned char>(buf[i])))
+            return i;
+    }
+    return len;
+}
+
+static size_t findNonTokenScalar(const char *buf, size_t len)
+{
+    for (size_t i = 0; i < len; ++i)
+    {
+        if (!TOKEN_CHAR_MAP[static_cast<unsigned char>(buf[i])])
+            return i;
+    }
+    return len;
+}
+
+#ifdef TOKENIZER_X86
+
+// PCMPESTRI 범위 비교: [0x00-0x08] [0x0A-0x1F] [0x7F-0x7F]
+__attribute__((target("sse4.2"))) static size_t findCtlSse42(const char *buf, size_t len)
+{
+    static const char ranges[16] = "\000\010\012\037\177\177";
+    const __m128i r = _mm_loadu_si128(reinterpret_cast<const __m128i *>(ranges));
+    size_t i = 0;
+    while (i + 16 <= len)
+    {
+        __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i *>(buf + i));
+        int idx = _mm_cmpestri(r, 6, b, 16, _SIDD_LEAST_SIGNIFICANT | _SIDD_CMP_RANGES | _SIDD_UBYTE_OPS);
+        if (idx != 16)
+            return i + idx;
+        i += 16;
+    }
+    return i + findCtlScalar(buf + i, len - i);
+}
+
+// 32바이트씩: (b <= 0x1F && b != HTAB) || b == 0x7F
+__attribute__((target("avx2"))) static size_t findCtlAvx2(const char *buf, size_t len)
+{
+    const __m256i ctl_max = _mm256_set1_epi8(0x1f);
+    const __m256i tab = _mm256_set1_epi8('\t');
+    const __m256i del = _mm256_set1_epi8(0x7f);
+    size_t i = 0;
+    while (i + 32 <= len)
+    {
+        __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(buf + i));
+        __m256i low = _mm256_cmpeq_epi8(_mm256_max_epu8(b, ctl_max), ctl_max);
+        low = _mm256_andnot_si256(_mm256_cmpeq_epi8(b, tab), low);
+        __m256i hit = _mm256_or_si256(low, _mm256_cmpeq_epi8(b, del));
+        unsigned int mask = static_cast<unsigned int>(_mm256_movemask_epi8(hit));
+        if (mask != 0)
+            return i + __builtin_ctz(mask);
+        i += 32;
+    }
+    return i + findCtlSse42(buf + i, len - i);
+}
+
+// tchar 집합을 니블 비트맵으로 나눈 표 (PSHUFB 조회용)
+// TOKEN_LOW_NIBBLE[lo]의 hi번째 비트가 1이면 (hi << 4 | lo)가 tchar입니다. 0x80 이상은 tchar가 아니므로
+// TOKEN_HIGH_BIT[8..15]는 0입니다.
+static const unsigned char TOKEN_LOW_NIBBLE[32] = {
+    0xe8, 0xfc, 0xf8, 0xfc, 0xfc, 0xfc, 0xfc, 0xfc, 0xf8, 0xf8, 0xf4, 0x54, 0xd0, 0x54, 0xf4, 0x70,
+    0xe8, 0xfc, 0xf8, 0xfc, 0xfc, 0xfc, 0xfc, 0xfc, 0xf8, 0xf8, 0xf4, 0x54, 0xd0, 0x54, 0xf4, 0x70};
+static const unsigned char TOKEN_HIGH_BIT[32] = {
+    0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, 0x80, 0, 0, 0, 0, 0, 0, 0, 0,
+    0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, 0x80, 0, 0, 0, 0, 0, 0, 0, 0};
+
+// 16바이트씩 tchar가 아닌 첫 바이트(헤더 이름이면 보통 ':')를 찾습니다.
+__attribute__((target("sse4.2"))) static size_t findNonTokenSse42(const char *buf, size_t len)
+{
+    const __m128i low_table = _mm_loadu_si128(reinterpret_cast<const __m128i *>(TOKEN_LOW_NIBBLE));
+    const __m128i high_table = _mm_loadu_si128(reinterpret_cast<const __m128i *>(TOKEN_HIGH_BIT));
+    const __m128i nibble = _mm_set1_epi8(0x0f);
+    size_t i = 0;
+    while (i + 16 <= len)
+    {
+        __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i *>(buf + i));
+        __m128i low = _mm_shuffle_epi8(low_table, _mm_and_si128(b, nibble));
+        __m128i high = _mm_shuffle_epi8(high_table, _mm_and_si128(_mm_srli_epi16(b, 4), nibble));
+        __m128i miss = _mm_cmpeq_epi8(_mm_and_si128(low, high), _mm_setzero_si128());
+        unsigned int mask = static_cast<unsigned int>(_mm_movemask_epi8(miss));
+        if (mask != 0)
+            return i + __builtin_ctz(mask);
+        i += 16;
+    }
+    return i + findNonTokenScalar(buf + i, len - i);
+}
+
+__attribute__((target("avx2"))) static size_t findNonTokenAvx2(const char *buf, size_t len)
+{
+    const __m256i low_table = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(TOKEN_LOW_NIBBLE));
+    const __m256i high_table = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(TOKEN_HIGH_BIT));
+    const __m256i nibble = _mm256_set1_epi8(0x0f);
+    size_t i = 0;
+    while (i + 32 <= len)
+    {
+        __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(buf + i));
+        __m256i low = _mm256_shuffle_epi8(low_table, _mm256_and_si256(b, nibble));
+        __m256i high = _mm256_shuffle_epi8(high_table, _mm256_and_si256(_mm256_srli_epi16(b, 4), nibble));
+        __m256i miss = _mm256_cmpeq_epi8(_mm256_and_si256(low, high), _mm256_setzero_si256());
+        unsigned int mask = static_cast<unsigned int>(_mm256_movemask_epi8(miss));
+        if (mask != 0)
+            return i + __builtin_ctz(mask);
+        i += 32;
+    }
+    return i + findNonTokenSse42(buf + i, len - i);
+}
+
+#endif
+
+typedef size_t (*FindCtlFn)(const char *, size_t);
+
+struct CtlScanner
+{
+    FindCtlFn fn;
+    FindCtlFn non_token; // tchar가 아닌 첫 바이트
+    const char *name;
+
+    CtlScanner() : fn(findCtlScalar), non_token(findNonTokenScalar), name("scalar")
+    {
+#ifdef TOKENIZER_X86
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("sse4.2"))
+        {
+            fn = findCtlAvx2;
+            non_token = findNonTokenAvx2;
+            name = "avx2";
+        }
+        else if (__builtin_cpu_supports("sse4.2"))
+        {
+            fn = findCtlSse42;
+            non_token = findNonTokenSse42;
+            name = "sse4.2";
+        }
+#endif
+    }
+};
+
+// 프로그램 시작 시 한 번만 CPUID를 확인합니다.
+static const CtlScanner g_scanner;
+
+size_t HttpTokenizer::findCtl(const char *buf, size_t len)
+{
+    return g_scanner.fn(buf, len);
+}
+
+const char *HttpTokenizer::implementationName()
+{
+    return g_scanner.name;
+}
+
+HttpTokenizer::LineStatus HttpTokenizer::scanLine(const char *buf, size_t len, size_t &line_end)
+{
+    size_t pos = g_scanner.fn(buf, len);
+    if (pos == len)
+        return LINE_PARTIAL;
+    if (buf[pos] != '\r')
+        return LINE_INVALID;
+    if (pos + 1 == len)
+        return LINE_PARTIAL;
+    if (buf[pos + 1] != '\n')
+        return LINE_INVALID;
+    line_end = pos;
+    return LINE_OK;
+}
+
+bool HttpTokenizer::isTokenChar(unsigned char c)
+{
+    return TOKEN_CHAR_MAP[c] != 0;
+}
+
+bool HttpTokenizer::isToken(const char *buf, size_t len)
+{
+    return len != 0 && g_scanner.non_token(buf, len) == len;
+}
+
+bool HttpTokenizer::scanHeaderName(const char *buf, size_t len, size_t &colon)
+{
+    size_t i = g_scanner.non_token(buf, len);
+    if (i == 0 || i == len || buf[i] != ':')
+        return false;
+    colon = i;
+    return true;
+}
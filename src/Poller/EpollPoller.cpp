@@ -85,27 +85,31 @@ int EpollPoller::poll(std::vector<Event> &events_out, int timeout)
     {
         if (_events[i].events & EPOLLERR)
         {
-            int err = 0;
-            socklen_t len = sizeof(err);
-            if (getsockopt(_events[i].data.fd, SOL_SOCKET, SO_ERROR, &err, &len) == 0)
+            // SO_ERROR는 읽으면 지워지므로 소켓인지만 SO_TYPE으로 확인합니다.
+            int type = 0;
+            socklen_t len = sizeof(type);
+            if (getsockopt(_events[i].data.fd, SOL_SOCKET, SO_TYPE, &type, &len) == -1 && errno == ENOTSOCK)
             {
-                std::string errMsg =
-                    "epoll event error on fd " + intToString(_events[i].data.fd) + ": " + std::string(strerror(err));
-                LogConfig::reportInternalError(errMsg);
+                // 읽는 쪽이 닫힌 파이프(CGI stdin): 쓰기 가능으로 알려 write()가 EPIPE를 보게 합니다.
+                Event ev;
+                ev.fd = _events[i].data.fd;
+                ev.events = POLLER_WRITE;
+                events_out.push_back(ev);
+                continue;
             }
-            else
-            {
-                std::string errMsg =
-                    "epoll event error on fd " + intToString(_events[i].data.fd) + ": unable to get error";
-                LogConfig::reportInternalError(errMsg);
-            }
-            remove(_events[i].data.fd);
+            // 소켓 오류(연결 리셋 등)는 읽기/쓰기 가능으로 알려 서버가 recv()/send()에서 오류를 보고 연결을 닫게 합니다.
+            // 여기서 poller에서 빼면 서버는 연결을 계속 열어 두고, 나중에 닫을 때 다시 빼려다 실패합니다.
+            Event ev;
+            ev.fd = _events[i].data.fd;
+            ev.events = POLLER_READ | POLLER_WRITE;
+            events_out.push_back(ev);
             continue;
         }
         Event ev;
         ev.fd = _events[i].data.fd;
         ev.events = 0;
-        if (_events[i].events & EPOLLIN)
+        // 쓰는 쪽이 닫힌 파이프(CGI 출력 끝)는 EPOLLHUP만 옵니다. read()가 0을 돌려주도록 읽기로 알립니다.
+        if (_events[i].events & (EPOLLIN | EPOLLHUP))
             ev.events |= POLLER_READ;
         if (_events[i].events & EPOLLOUT)
             ev.events |= POLLER_WRITE;
@@ -0,0 +1,540 @@
+#if defined(__linux__) && defined(WEBSERV_IO_URING)
+
+#include "IoUringPoller.hpp"
+#include "Utils.hpp" // for intToString
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <poll.h>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/utsname.h>
+#include <unistd.h>
+
+// POLL_REMOVE/ASYNC_CANCEL, PROVIDE_BUFFERS 요청의 완료 이벤트를 구분하기 위한 태그
+static const uint64_t REMOVE_TAG = 0xffffffffffffffffULL;
+static const uint64_t PROVIDE_TAG = 0xfffffffffffffffeULL;
+// user_data: [63:62] 종류, [61:32] 세대, [31:0] fd
+static const uint32_t GENERATION_MASK = 0x3fffffffU;
+static const uint16_t RECV_BUFFER_GROUP = 0;
+
+static uint64_t makeUserData(int fd, uint32_t generation, unsigned kind)
+{
+    return (static_cast<uint64_t>(kind) << 62) | (static_cast<uint64_t>(generation & GENERATION_MASK) << 32) |
+           static_cast<uint32_t>(fd);
+}
+
+static void *ringOffset(void *base, unsigned offset)
+{
+    return static_cast<char *>(base) + offset;
+}
+
+// multishot recv(6.0)가 있는 커널인지
+static bool kernelSupportsMultishotRecv()
+{
+    struct utsname name;
+    int major = 0;
+    return uname(&name) == 0 && sscanf(name.release, "%d", &major) == 1 && major >= 6;
+}
+
+IoUringPoller::IoUringPoller()
+    : _ring_fd(-1), _sq_ring(MAP_FAILED), _cq_ring(MAP_FAILED), _sqes(NULL), _buffers(NULL), _buffers_size(0),
+      _pending(0), _next_generation(1)
+{
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    _ring_fd = static_cast<int>(syscall(__NR_io_uring_setup, IO_URING_ENTRIES, &params));
+    if (_ring_fd == -1)
+        throw std::runtime_error("io_uring_setup failed: " + std::string(strerror(errno)));
+    // 타임아웃을 io_uring_enter 인자로 넘기기 위해 EXT_ARG(5.11+)가 필요합니다.
+    if (!(params.features & IORING_FEAT_EXT_ARG))
+    {
+        close(_ring_fd);
+        throw std::runtime_error("io_uring: IORING_FEAT_EXT_ARG is not supported by this kernel");
+    }
+    _sq_entries = params.sq_entries;
+    _cq_entries = params.cq_entries;
+    _sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    _cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    bool single_mmap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+    if (single_mmap && _cq_ring_size > _sq_ring_size)
+        _sq_ring_size = _cq_ring_size;
+
+    _sq_ring = mmap(NULL, _sq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, _ring_fd,
+                    IORING_OFF_SQ_RING);
+    if (_sq_ring != MAP_FAILED)
+        _cq_ring = single_mmap ? _sq_ring
+                               : mmap(NULL, _cq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                                      _ring_fd, IORING_OFF_CQ_RING);
+    _sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+    void *sqes = MAP_FAILED;
+    if (_cq_ring != MAP_FAILED)
+        sqes = mmap(NULL, _sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, _ring_fd, IORING_OFF_SQES);
+    if (sqes == MAP_FAILED)
+    {
+        std::string errMsg = "io_uring mmap failed: " + std::string(strerror(errno));
+        releaseRing();
+        throw std::runtime_error(errMsg);
+    }
+    _sqes = static_cast<struct io_uring_sqe *>(sqes);
+
+    _sq_head = static_cast<unsigned *>(ringOffset(_sq_ring, params.sq_off.head));
+    _sq_tail = static_cast<unsigned *>(ringOffset(_sq_ring, params.sq_off.tail));
+    _sq_mask = static_cast<unsigned *>(ringOffset(_sq_ring, params.sq_off.ring_mask));
+    _sq_array = static_cast<unsigned *>(ringOffset(_sq_ring, params.sq_off.array));
+    _cq_head = static_cast<unsigned *>(ringOffset(_cq_ring, params.cq_off.head));
+    _cq_tail = static_cast<unsigned *>(ringOffset(_cq_ring, params.cq_off.tail));
+    _cq_mask = static_cast<unsigned *>(ringOffset(_cq_ring, params.cq_off.ring_mask));
+    _cqes = static_cast<struct io_uring_cqe *>(ringOffset(_cq_ring, params.cq_off.cqes));
+
+    // 완료 기반 I/O를 못 쓰면 모든 fd를 POLL_ADD로 처리합니다. (서버가 직접 accept/recv/send)
+    if (!kernelSupportsMultishotRecv())
+        LogConfig::reportInfo("io_uring: multishot recv needs Linux 6.0, using readiness polling");
+    else if (!setupBuffers())
+        LogConfig::reportInfo("io_uring: provided buffers unavailable (" + std::string(strerror(errno)) +
+                              "), using readiness polling");
+}
+
+IoUringPoller::~IoUringPoller()
+{
+    releaseRing();
+}
+
+void IoUringPoller::releaseRing()
+{
+    if (_sqes)
+        munmap(_sqes, _sqes_size);
+    if (_cq_ring != MAP_FAILED && _cq_ring != _sq_ring)
+        munmap(_cq_ring, _cq_ring_size);
+    if (_sq_ring != MAP_FAILED)
+        munmap(_sq_ring, _sq_ring_size);
+    // 링을 닫아 커널이 버퍼를 더 쓰지 않게 한 뒤 버퍼를 해제합니다.
+    if (_ring_fd != -1)
+        close(_ring_fd);
+    if (_buffers)
+        munmap(_buffers, _buffers_size);
+    _sqes = NULL;
+    _sq_ring = MAP_FAILED;
+    _cq_ring = MAP_FAILED;
+    _ring_fd = -1;
+    _buffers = NULL;
+}
+
+// 수신 버퍼 IO_URING_RECV_BUFFERS개를 IORING_OP_PROVIDE_BUFFERS로 커널에 맡깁니다.
+// 커널은 받을 때마다 하나를 골라 쓰고 그 번호를 완료에 적습니다. 지원 여부는 첫 등록의 완료로 확인합니다.
+bool IoUringPoller::setupBuffers()
+{
+    _buffers_size = static_cast<size_t>(IO_URING_RECV_BUFFERS) * RECV_BUFFER_SIZE;
+    void *buffers = mmap(NULL, _buffers_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (buffers == MAP_FAILED)
+        return false;
+    _buffers = static_cast<char *>(buffers);
+    if (!queueProvide(0, IO_URING_RECV_BUFFERS) || enter(_pending, 1, -1) < 0)
+    {
+        int err = errno;
+        munmap(_buffers, _buffers_size);
+        _buffers = NULL;
+        errno = err;
+        return false;
+    }
+    _pending = 0;
+    unsigned head = *_cq_head;
+    int res = _cqes[head & *_cq_mask].res;
+    __atomic_store_n(_cq_head, head + 1, __ATOMIC_RELEASE);
+    if (res < 0)
+    {
+        munmap(_buffers, _buffers_size);
+        _buffers = NULL;
+        errno = -res;
+        return false;
+    }
+    return true;
+}
+
+// 버퍼 [first, first + count)를 수신 버퍼 그룹에 넣는 요청을 SQ에 둡니다.
+bool IoUringPoller::queueProvide(unsigned first, unsigned count)
+{
+    struct io_uring_sqe *sqe = getSqe();
+    if (!sqe)
+        return false;
+    sqe->opcode = IORING_OP_PROVIDE_BUFFERS;
+    sqe->fd = static_cast<int>(count);
+    sqe->addr = reinterpret_cast<uint64_t>(_buffers + static_cast<size_t>(first) * RECV_BUFFER_SIZE);
+    sqe->len = RECV_BUFFER_SIZE;
+    sqe->off = first;
+    sqe->buf_group = RECV_BUFFER_GROUP;
+    sqe->user_data = PROVIDE_TAG;
+    return true;
+}
+
+// 지난 poll()에서 넘겨준 버퍼를 커널에 돌려줍니다. (서버는 그 사이에 RecvChain으로 복사해 두었음)
+// 연속된 번호는 요청 하나로 묶고, 같은 제출에서 재등록보다 먼저 처리되도록 rearmFired() 전에 부릅니다.
+void IoUringPoller::recycleBuffers()
+{
+    if (_lent.empty())
+        return;
+    std::sort(_lent.begin(), _lent.end());
+    size_t run = 0;
+    for (size_t i = 1; i <= _lent.size(); ++i)
+    {
+        if (i < _lent.size() && _lent[i] == _lent[i - 1] + 1)
+            continue;
+        if (!queueProvide(_lent[run], static_cast<unsigned>(i - run)))
+            LogConfig::reportInternalError("io_uring: submission queue full for provide buffers");
+        run = i;
+    }
+    _lent.clear();
+}
+
+bool IoUringPoller::completionIo() const
+{
+    return _buffers != NULL;
+}
+
+int IoUringPoller::enter(unsigned to_submit, unsigned min_complete, int timeout)
+{
+    if (min_complete == 0)
+        return static_cast<int>(syscall(__NR_io_uring_enter, _ring_fd, to_submit, 0, 0, NULL, 0));
+    struct __kernel_timespec ts;
+    struct io_uring_getevents_arg arg;
+    memset(&arg, 0, sizeof(arg));
+    if (timeout >= 0)
+    {
+        ts.tv_sec = timeout / 1000;
+        ts.tv_nsec = (timeout % 1000) * 1000000LL;
+        arg.ts = reinterpret_cast<uint64_t>(&ts);
+    }
+    return static_cast<int>(syscall(__NR_io_uring_enter, _ring_fd, to_submit, min_complete,
+                                    IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG, &arg, sizeof(arg)));
+}
+
+struct io_uring_sqe *IoUringPoller::getSqe()
+{
+    unsigned head = __atomic_load_n(_sq_head, __ATOMIC_ACQUIRE);
+    unsigned tail = *_sq_tail;
+    if (tail - head >= _sq_entries)
+    {
+        // SQ가 가득 차면 대기 없이 먼저 제출합니다.
+        if (enter(_pending, 0, 0) < 0)
+            return NULL;
+        _pending = 0;
+        head = __atomic_load_n(_sq_head, __ATOMIC_ACQUIRE);
+        if (tail - head >= _sq_entries)
+            return NULL;
+    }
+    unsigned index = tail & *_sq_mask;
+    struct io_uring_sqe *sqe = &_sqes[index];
+    memset(sqe, 0, sizeof(*sqe));
+    _sq_array[index] = index;
+    __atomic_store_n(_sq_tail, tail + 1, __ATOMIC_RELEASE);
+    ++_pending;
+    return sqe;
+}
+
+uint32_t IoUringPoller::nextGeneration()
+{
+    uint32_t generation = _next_generation;
+    _next_generation = (_next_generation + 1) & GENERATION_MASK;
+    if (_next_generation == 0)
+        _next_generation = 1;
+    return generation;
+}
+
+// 등록 종류에 맞는 요청을 겁니다: POLL_ADD(한 번), multishot ACCEPT, 제공 버퍼로 받는 multishot RECV
+bool IoUringPoller::queueArm(int fd, FdState &state)
+{
+    struct io_uring_sqe *sqe = getSqe();
+    if (!sqe)
+    {
+        LogConfig::reportInternalError("io_uring: submission queue full for fd " + intToString(fd));
+        return false;
+    }
+    sqe->fd = fd;
+    sqe->user_data = makeUserData(fd, state.generation, state.kind);
+    if (state.kind == KIND_ACCEPT)
+    {
+        sqe->opcode = IORING_OP_ACCEPT;
+        sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+        sqe->accept_flags = SOCK_NONBLOCK | SOCK_CLOEXEC;
+    }
+    else if (state.kind == KIND_RECV)
+    {
+        sqe->opcode = IORING_OP_RECV;
+        sqe->ioprio = IORING_RECV_MULTISHOT;
+        sqe->flags = IOSQE_BUFFER_SELECT;
+        sqe->buf_group = RECV_BUFFER_GROUP;
+    }
+    else
+    {
+        uint32_t mask = 0;
+        if (state.events & POLLER_READ)
+            mask |= POLLIN;
+        if (state.events & POLLER_WRITE)
+            mask |= POLLOUT;
+        sqe->opcode = IORING_OP_POLL_ADD;
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+        mask = (mask << 16) | (mask >> 16);
+#endif
+        sqe->poll32_events = mask;
+    }
+    state.armed = true;
+    return true;
+}
+
+bool IoUringPoller::queueCancel(uint64_t user_data, Kind kind)
+{
+    struct io_uring_sqe *sqe = getSqe();
+    if (!sqe)
+    {
+        LogConfig::reportInternalError("io_uring: submission queue full for cancel");
+        return false;
+    }
+    sqe->opcode = kind == KIND_POLL ? IORING_OP_POLL_REMOVE : IORING_OP_ASYNC_CANCEL;
+    sqe->fd = -1;
+    sqe->addr = user_data;
+    sqe->user_data = REMOVE_TAG;
+    return true;
+}
+
+bool IoUringPoller::registerFd(int fd, uint32_t events, Kind kind)
+{
+    if (_fds.find(fd) != _fds.end())
+    {
+        LogConfig::reportInternalError("io_uring add failed for fd " + intToString(fd) + ": already registered");
+        return false;
+    }
+    FdState state;
+    state.events = events;
+    state.generation = nextGeneration();
+    state.kind = kind;
+    state.armed = false;
+    if (!queueArm(fd, state))
+        return false;
+    _fds[fd] = state;
+    return true;
+}
+
+bool IoUringPoller::add(int fd, uint32_t events)
+{
+    return registerFd(fd, events, KIND_POLL);
+}
+
+bool IoUringPoller::addAcceptor(int listen_fd)
+{
+    return completionIo() && registerFd(listen_fd, POLLER_READ, KIND_ACCEPT);
+}
+
+bool IoUringPoller::addReceiver(int fd)
+{
+    return completionIo() && registerFd(fd, POLLER_READ, KIND_RECV);
+}
+
+bool IoUringPoller::modify(int fd, uint32_t events)
+{
+    std::map<int, FdState>::iterator it = _fds.find(fd);
+    if (it == _fds.end())
+    {
+        errno = ENOENT;
+        LogConfig::reportInternalError("io_uring modify failed for fd " + intToString(fd) + ": not registered");
+        return false;
+    }
+    FdState &state = it->second;
+    if (state.events == events)
+        return true;
+    if (state.kind == KIND_RECV)
+    {
+        // 받기를 멈출 때는 취소만 합니다. 그 전에 받은 데이터는 마지막 완료까지 그대로 전달되고,
+        // 그때 POLLER_READ가 다시 켜져 있으면 이어서 겁니다.
+        bool was_reading = (state.events & POLLER_READ) != 0;
+        state.events = events;
+        if (!(events & POLLER_READ) && was_reading && state.armed)
+            return queueCancel(makeUserData(fd, state.generation, state.kind), state.kind);
+        if ((events & POLLER_READ) && !state.armed)
+            return queueArm(fd, state);
+        return true;
+    }
+    state.events = events;
+    // 이미 걸려 있으면 취소하고 새 세대로 다시 겁니다. 발생 후 대기 중이면 재등록 시 반영됩니다.
+    if (state.armed)
+    {
+        if (!queueCancel(makeUserData(fd, state.generation, state.kind), state.kind))
+            return false;
+        state.generation = nextGeneration();
+        return queueArm(fd, state);
+    }
+    return true;
+}
+
+bool IoUringPoller::remove(int fd)
+{
+    bool ok = true;
+    std::map<int, SendState>::iterator send = _sends.find(fd);
+    if (send != _sends.end())
+        ok = queueCancel(makeUserData(fd, 0, KIND_SEND), KIND_SEND);
+    std::map<int, FdState>::iterator it = _fds.find(fd);
+    if (it == _fds.end())
+    {
+        if (send != _sends.end())
+            return ok;
+        LogConfig::reportInternalError("io_uring remove failed for fd " + intToString(fd) + ": not registered");
+        return false;
+    }
+    if (it->second.armed)
+        ok = queueCancel(makeUserData(fd, it->second.generation, it->second.kind), it->second.kind) && ok;
+    _fds.erase(it);
+    return ok;
+}
+
+bool IoUringPoller::send(int fd, const struct iovec *iov, int iovcnt)
+{
+    if (!completionIo() || iovcnt < 1 || iovcnt > 2 || _sends.find(fd) != _sends.end())
+    {
+        errno = EINVAL;
+        return false;
+    }
+    struct io_uring_sqe *sqe = getSqe();
+    if (!sqe)
+    {
+        errno = EBUSY;
+        return false;
+    }
+    // 커널이 완료 전까지 읽을 수 있으므로 msghdr와 iovec은 _sends에 둡니다. (map 항목의 주소는 바뀌지 않음)
+    SendState &state = _sends[fd];
+    memset(&state.msg, 0, sizeof(state.msg));
+    for (int i = 0; i < iovcnt; ++i)
+        state.iov[i] = iov[i];
+    state.msg.msg_iov = state.iov;
+    state.msg.msg_iovlen = iovcnt;
+    sqe->opcode = IORING_OP_SENDMSG;
+    sqe->fd = fd;
+    sqe->addr = reinterpret_cast<uint64_t>(&state.msg);
+    sqe->len = 1;
+    sqe->msg_flags = MSG_NOSIGNAL;
+    sqe->user_data = makeUserData(fd, 0, KIND_SEND);
+    return true;
+}
+
+void IoUringPoller::rearmFired()
+{
+    for (size_t i = 0; i < _rearm.size(); ++i)
+    {
+        std::map<int, FdState>::iterator it = _fds.find(_rearm[i]);
+        if (it == _fds.end() || it->second.armed)
+            continue;
+        if (it->second.kind == KIND_RECV && !(it->second.events & POLLER_READ))
+            continue;
+        queueArm(it->first, it->second);
+    }
+    _rearm.clear();
+}
+
+void IoUringPoller::handleCompletion(const struct io_uring_cqe &cqe, std::vector<Event> &events_out)
+{
+    unsigned kind = static_cast<unsigned>(cqe.user_data >> 62);
+    int fd = static_cast<int>(cqe.user_data & 0xffffffffU);
+    uint32_t generation = static_cast<uint32_t>(cqe.user_data >> 32) & GENERATION_MASK;
+    Event ev;
+    ev.fd = fd;
+    ev.result = cqe.res;
+    // 송신 완료는 등록이 사라졌어도 알립니다. (서버는 완료 전까지 송신 버퍼를 해제하지 않음)
+    if (kind == KIND_SEND)
+    {
+        _sends.erase(fd);
+        ev.events = POLLER_SENT;
+        events_out.push_back(ev);
+        return;
+    }
+    std::map<int, FdState>::iterator it = _fds.find(fd);
+    bool current = it != _fds.end() && it->second.generation == generation && it->second.kind == kind;
+    bool more = (cqe.flags & IORING_CQE_F_MORE) != 0;
+    if (kind == KIND_ACCEPT)
+    {
+        // 받은 연결은 리스너를 뺀 뒤에 도착해도 서버에 넘깁니다. (그러지 않으면 fd가 샙니다)
+        if (cqe.res >= 0 || (current && cqe.res != -ECANCELED))
+        {
+            ev.events = POLLER_ACCEPTED;
+            events_out.push_back(ev);
+        }
+        if (current && !more)
+        {
+            it->second.armed = false;
+            _rearm.push_back(fd);
+        }
+        return;
+    }
+    if (kind == KIND_RECV)
+    {
+        bool eof_or_error = cqe.res == 0 || (cqe.res < 0 && cqe.res != -ECANCELED && cqe.res != -ENOBUFS);
+        if (cqe.flags & IORING_CQE_F_BUFFER)
+        {
+            unsigned bid = cqe.flags >> IORING_CQE_BUFFER_SHIFT;
+            _lent.push_back(bid);
+            ev.data = _buffers + static_cast<size_t>(bid) * RECV_BUFFER_SIZE;
+        }
+        // 취소한 뒤에 도착한 데이터도 이미 소켓에서 읽은 것이므로 버리지 않습니다.
+        if (current && (cqe.res > 0 || eof_or_error))
+        {
+            ev.events = POLLER_RECEIVED;
+            events_out.push_back(ev);
+        }
+        // 버퍼가 모자라 멈췄으면(ENOBUFS) 버퍼를 돌려준 뒤 다시 겁니다.
+        if (current && !more)
+        {
+            it->second.armed = false;
+            if (!eof_or_error)
+                _rearm.push_back(fd);
+        }
+        return;
+    }
+    // 이미 제거/변경된 등록의 완료는 버립니다.
+    if (!current)
+        return;
+    it->second.armed = false;
+    _rearm.push_back(fd);
+    if (cqe.res < 0)
+    {
+        if (cqe.res != -ECANCELED)
+            LogConfig::reportInternalError("io_uring poll error on fd " + intToString(fd) + ": " +
+                                           std::string(strerror(-cqe.res)));
+        return;
+    }
+    ev.result = 0;
+    if (cqe.res & (POLLIN | POLLHUP | POLLERR))
+        ev.events |= POLLER_READ;
+    if (cqe.res & POLLOUT)
+        ev.events |= POLLER_WRITE;
+    ev.events &= it->second.events | POLLER_READ;
+    events_out.push_back(ev);
+}
+
+int IoUringPoller::poll(std::vector<Event> &events_out, int timeout)
+{
+    events_out.clear();
+    recycleBuffers();
+    rearmFired();
+    int ret = enter(_pending, 1, timeout);
+    if (ret < 0 && errno != ETIME && errno != EINTR && errno != EBUSY)
+    {
+        LogConfig::reportInternalError("io_uring_enter failed: " + std::string(strerror(errno)));
+        return -1;
+    }
+    if (ret >= 0)
+        _pending -= (static_cast<unsigned>(ret) < _pending) ? static_cast<unsigned>(ret) : _pending;
+
+    unsigned head = *_cq_head;
+    unsigned tail = __atomic_load_n(_cq_tail, __ATOMIC_ACQUIRE);
+    for (; head != tail; ++head)
+    {
+        const struct io_uring_cqe &cqe = _cqes[head & *_cq_mask];
+        if (cqe.user_data == PROVIDE_TAG && cqe.res < 0)
+            LogConfig::reportInternalError("io_uring provide buffers failed: " + std::string(strerror(-cqe.res)));
+        else if (cqe.user_data != REMOVE_TAG && cqe.user_data != PROVIDE_TAG)
+            handleCompletion(cqe, events_out);
+    }
+    __atomic_store_n(_cq_head, head, __ATOMIC_RELEASE);
+    return static_cast<int>(events_out.size());
+}
+
+#endif
@@ -0,0 +1,197 @@
+#include "RateLimit.hpp"
+#include "Log.hpp"
+#include <cerrno>
+#include <cstring>
+#include <sys/mman.h>
+
+// 주소 하나의 상태 (32바이트)
+struct RateLimitNode
+{
+    in_addr_t addr;      // 0이면 빈 칸 (0.0.0.0은 클라이언트 주소가 될 수 없음)
+    uint32_t conns;      // limit_conn: 처리 중인 요청 수
+    uint64_t excess;     // limit_req: 아직 비워지지 않은 초과 요청 (요청 수 * 1000)
+    uint64_t last_us;    // excess를 마지막으로 갱신한 시각
+    uint64_t touched_us; // LRU 기준 시각
+};
+
+// 공유 메모리 맨 앞의 헤더. 노드 배열이 바로 뒤에 이어집니다.
+struct RateLimitZone
+{
+    bool lock; // 프로세스 간 스핀락
+    uint32_t set_mask;
+    uint64_t evictions;
+};
+
+struct ZoneSlot
+{
+    std::string name;
+    RateLimitZone *zone;
+};
+
+// 설정을 읽을 때 주 스레드가 뒤에 추가하기만 하고, g_zone_count를 늘려 다른 스레드에 공개합니다.
+static ZoneSlot g_zones[RATE_LIMIT_MAX_ZONES];
+static int g_zone_count = 0;
+
+static RateLimitZone *findZone(int zone_id)
+{
+    if (zone_id < 0 || zone_id >= __atomic_load_n(&g_zone_count, __ATOMIC_ACQUIRE))
+        return NULL;
+    return g_zones[zone_id].zone;
+}
+
+static RateLimitNode *zoneNodes(RateLimitZone *zone)
+{
+    return reinterpret_cast<RateLimitNode *>(zone + 1);
+}
+
+static void lockZone(RateLimitZone *zone)
+{
+    while (__atomic_test_and_set(&zone->lock, __ATOMIC_ACQUIRE))
+        ;
+}
+
+static void unlockZone(RateLimitZone *zone)
+{
+    __atomic_clear(&zone->lock, __ATOMIC_RELEASE);
+}
+
+int RateLimit::registerZone(const std::string &name, size_t bytes)
+{
+    for (int i = 0; i < g_zone_count; ++i)
+    {
+        if (g_zones[i].name == name)
+            return i;
+    }
+    if (g_zone_count == RATE_LIMIT_MAX_ZONES)
+    {
+        LogConfig::reportInternalError("limit zone \"" + name + "\": too many zones");
+        return -1;
+    }
+    // 묶음 수는 2의 거듭제곱으로 내림합니다.
+    size_t set_bytes = sizeof(RateLimitNode) * RATE_LIMIT_WAYS;
+    size_t sets = 1;
+    while (sizeof(RateLimitZone) + sets * 2 * set_bytes <= bytes)
+        sets *= 2;
+    size_t size = sizeof(RateLimitZone) + sets * set_bytes;
+    // 익명 공유 매핑은 0으로 채워져 있으므로 모든 칸이 빈 상태로 시작합니다.
+    void *mem = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (mem == MAP_FAILED)
+    {
+        LogConfig::reportInternalError("limit zone \"" + name + "\": mmap failed: " + std::string(strerror(errno)));
+        return -1;
+    }
+    RateLimitZone *zone = static_cast<RateLimitZone *>(mem);
+    zone->set_mask = static_cast<uint32_t>(sets - 1);
+    g_zones[g_zone_count].name = name;
+    g_zones[g_zone_count].zone = zone;
+    __atomic_store_n(&g_zone_count, g_zone_count + 1, __ATOMIC_RELEASE);
+    return g_zone_count - 1;
+}
+
+// 주소의 칸을 찾습니다. 없고 created가 주어지면 빈 칸이나 가장 오래 쓰지 않은 칸을 새로 내줍니다.
+// 처리 중인 요청이 있는 칸(conns > 0)은 밀어내지 않습니다. 그런 칸뿐이면 NULL
+static RateLimitNode *findNode(RateLimitZone *zone, in_addr_t addr, uint64_t now_us, bool *created)
+{
+    uint32_t hash = (static_cast<uint32_t>(addr) * 2654435761u) >> 7;
+    RateLimitNode *set = zoneNodes(zone) + (hash & zone->set_mask) * RATE_LIMIT_WAYS;
+    RateLimitNode *victim = NULL;
+    for (int i = 0; i < RATE_LIMIT_WAYS; ++i)
+    {
+        if (set[i].addr == addr)
+        {
+            if (now_us)
+                set[i].touched_us = now_us;
+            return &set[i];
+        }
+        if (set[i].conns == 0 && (!victim || set[i].touched_us < victim->touched_us))
+            victim = &set[i];
+    }
+    if (!created || !victim)
+        return NULL;
+    *created = true;
+    if (victim->addr)
+        ++zone->evictions;
+    victim->addr = addr;
+    victim->conns = 0;
+    victim->excess = 0;
+    victim->last_us = now_us;
+    victim->touched_us = now_us;
+    return victim;
+}
+
+LimitResult RateLimit::acquireRequest(int zone_id, in_addr_t addr, uint64_t rate, uint64_t burst, bool nodelay,
+                                      uint64_t now_us, uint64_t &delay_us)
+{
+    delay_us = 0;
+    RateLimitZone *zone = findZone(zone_id);
+    if (!zone || rate == 0)
+        return LIMIT_PASS;
+    lockZone(zone);
+    bool created = false;
+    RateLimitNode *node = findNode(zone, addr, now_us, &created);
+    if (!node)
+    {
+        // 추적할 칸이 없으면 막지 않습니다.
+        unlockZone(zone);
+        return LIMIT_PASS;
+    }
+    // 이번 요청만큼 늘리고 지난 시간만큼 빠져나간 양을 뺍니다. 처음 보는 주소의 첫 요청은 초과가 아닙니다.
+    uint64_t excess = 0;
+    if (!created)
+    {
+        uint64_t elapsed = now_us > node->last_us ? now_us - node->last_us : 0;
+        // 오래 쉬었으면 곱셈이 넘치기 전에 모두 비워진 것으로 봅니다.
+        uint64_t drained = elapsed >= 3600ULL * 1000000 ? ~0ULL : rate * elapsed / 1000000;
+        excess = node->excess + 1000 > drained ? node->excess + 1000 - drained : 0;
+    }
+    if (excess > burst * 1000)
+    {
+        unlockZone(zone);
+        return LIMIT_REJECT;
+    }
+    node->excess = excess;
+    node->last_us = now_us;
+    unlockZone(zone);
+    if (nodelay || excess == 0)
+        return LIMIT_PASS;
+    delay_us = excess * 1000000 / rate;
+    return delay_us ? LIMIT_DELAY : LIMIT_PASS;
+}
+
+LimitResult RateLimit::acquireConn(int zone_id, in_addr_t addr, uint32_t limit, uint64_t now_us)
+{
+    RateLimitZone *zone = findZone(zone_id);
+    if (!zone || limit == 0)
+        return LIMIT_PASS;
+    lockZone(zone);
+    bool created = false;
+    RateLimitNode *node = findNode(zone, addr, now_us, &created);
+    LimitResult result = LIMIT_PASS;
+    if (node && node->conns >= limit)
+        result = LIMIT_REJECT;
+    else if (node)
+        ++node->conns;
+    unlockZone(zone);
+    return result;
+}
+
+void RateLimit::releaseConn(int zone_id, in_addr_t addr)
+{
+    RateLimitZone *zone = findZone(zone_id);
+    if (!zone)
+        return;
+    lockZone(zone);
+    RateLimitNode *node = findNode(zone, addr, 0, NULL);
+    if (node && node->conns)
+        --node->conns;
+    unlockZone(zone);
+}
+
+uint64_t RateLimit::evictions()
+{
+    uint64_t total = 0;
+    int count = __atomic_load_n(&g_zone_count, __ATOMIC_ACQUIRE);
+    for (int i = 0; i < count; ++i)
+        total += __atomic_load_n(&g_zones[i].zone->evictions, __ATOMIC_RELAXED);
+    return total;
+}
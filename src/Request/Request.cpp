@@ -1,7 +1,7 @@
 #include "Request.hpp"
 #include "HttpRequestParser.hpp" // 새 Parser 인터페이스 포함
 
-Request::Request() : _method("GET"), _path("/"), _query_string(""), _httpVersion("HTTP/1.0")
+Request::Request() : _method("GET"), _path("/"), _query_string(""), _httpVersion("HTTP/1.0"), _remote_addr(0)
 {
 }
 
@@ -19,41 +19,51 @@ const std::map<std::string, std::string> &Request::getFormFields() const
     return _form_fields;
 }
 
-std::string Request::getMethod() const
+const std::string &Request::getMethod() const
 {
     return _method;
 }
 
-std::string Request::getPath() const
+const std::string &Request::getPath() const
 {
     return _path;
 }
 
-std::string Request::getQueryString() const
+const std::string &Request::getQueryString() const
 {
     return _query_string;
 }
 
-std::string Request::getHTTPVersion() const
+const std::string &Request::getPathInfo() const
+{
+    return _path_info;
+}
+
+const std::string &Request::getHTTPVersion() const
 {
     return _httpVersion;
 }
 
-std::map<std::string, std::string> Request::getQueryParams() const
+const HeaderMap &Request::getQueryParams() const
 {
     return _queryParams;
 }
 
-std::map<std::string, std::string> Request::getHeaders() const
+const HeaderMap &Request::getHeaders() const
 {
     return _headers;
 }
 
-std::string Request::getBody() const
+const std::string &Request::getBody() const
 {
     return _body;
 }
 
+in_addr_t Request::getRemoteAddr() const
+{
+    return _remote_addr;
+}
+
 void Request::setUploadedFiles(const std::vector<UploadedFile> &files)
 {
     _uploaded_files = files;
@@ -69,6 +79,11 @@ void Request::setBody(const std::string &body_data)
     _body = body_data;
 }
 
+void Request::setRemoteAddr(in_addr_t addr)
+{
+    _remote_addr = addr;
+}
+
 bool Request::parse(const std::string &data, int &consumed, bool &isPartial)
 {
     Parser parser;
@@ -76,15 +91,17 @@ bool Request::parse(const std::string &data, int &consumed, bool &isPartial)
     bool result = parser.parse(data, parsed);
     if (result)
     {
-        _method = parsed.method;
-        _path = parsed.path;
-        _query_string = parsed.query_string;
-        _queryParams = parsed.queryParams;
-        _headers = parsed.headers;
-        _body = parsed.body;
-        _uploaded_files = parsed.uploaded_files;
-        _form_fields = parsed.form_fields;
-        _httpVersion = parsed.httpVersion;
+        // 복사 대신 swap으로 파싱 결과를 넘겨받습니다.
+        _method.swap(parsed.method);
+        _path.swap(parsed.path);
+        _query_string.swap(parsed.query_string);
+        _path_info.swap(parsed.path_info);
+        _queryParams.swap(parsed.queryParams);
+        _headers.swap(parsed.headers);
+        _body.swap(parsed.body);
+        _uploaded_files.swap(parsed.uploaded_files);
+        _form_fields.swap(parsed.form_fields);
+        _httpVersion.swap(parsed.httpVersion);
         consumed = parsed.consumed;
         isPartial = parsed.isPartial;
     }
@@ -0,0 +1,155 @@
+#include "RequestTiming.hpp"
+#include "Utils.hpp"
+#include <cstring>
+
+__thread RequestTiming *RequestTiming::_current = NULL;
+
+RequestTiming::RequestTiming()
+{
+    memset(_at, 0, sizeof(_at));
+    _at[PHASE_IDLE_START] = monotonicMicros();
+}
+
+void RequestTiming::mark(TimingPhase phase)
+{
+    _at[phase] = monotonicMicros();
+}
+
+void RequestTiming::markOnce(TimingPhase phase)
+{
+    if (!_at[phase])
+        _at[phase] = monotonicMicros();
+}
+
+uint64_t RequestTiming::at(TimingPhase phase) const
+{
+    return _at[phase];
+}
+
+uint64_t RequestTiming::span(TimingPhase from, TimingPhase to) const
+{
+    if (!_at[from] || !_at[to] || _at[to] < _at[from])
+        return 0;
+    return _at[to] - _at[from];
+}
+
+uint64_t RequestTiming::total() const
+{
+    if (!_at[PHASE_RECV_START])
+        return 0;
+    uint64_t end = _at[PHASE_LAST_BYTE] ? _at[PHASE_LAST_BYTE] : monotonicMicros();
+    return end - _at[PHASE_RECV_START];
+}
+
+void RequestTiming::reset()
+{
+    memset(_at, 0, sizeof(_at));
+    _at[PHASE_IDLE_START] = monotonicMicros();
+}
+
+RequestTiming *RequestTiming::current()
+{
+    return _current;
+}
+
+void RequestTiming::markCurrent(TimingPhase phase)
+{
+    if (_current)
+        _current->mark(phase);
+}
+
+// 출력 항목: 이름과 구간
+struct PhaseSpan
+{
+    const char *name;
+    TimingPhase from;
+    TimingPhase to;
+};
+
+static const PhaseSpan SERVER_TIMING_SPANS[] = {{"recv", PHASE_RECV_START, PHASE_RECV_END},
+                                                {"parse", PHASE_RECV_END, PHASE_PARSED},
+                                                {"resolve", PHASE_PARSED, PHASE_RESOLVED},
+                                                {"upstream", PHASE_UPSTREAM_START, PHASE_UPSTREAM_END},
+                                                {"handler", PHASE_PARSED, PHASE_HANDLED}};
+
+static const PhaseSpan SLOW_LOG_SPANS[] = {{"idle", PHASE_IDLE_START, PHASE_RECV_START},
+                                           {"recv", PHASE_RECV_START, PHASE_RECV_END},
+                                           {"parse", PHASE_RECV_END, PHASE_PARSED},
+                                           {"resolve", PHASE_PARSED, PHASE_RESOLVED},
+                                           {"upstream", PHASE_UPSTREAM_START, PHASE_UPSTREAM_END},
+                                           {"handler", PHASE_PARSED, PHASE_HANDLED},
+                                           {"ttfb", PHASE_RECV_START, PHASE_FIRST_BYTE},
+                                           {"send", PHASE_HANDLED, PHASE_LAST_BYTE}};
+
+void RequestTiming::serverTiming(std::string &out) const
+{
+    char num[32];
+    for (size_t i = 0; i < sizeof(SERVER_TIMING_SPANS) / sizeof(SERVER_TIMING_SPANS[0]); ++i)
+    {
+        const PhaseSpan &s = SERVER_TIMING_SPANS[i];
+        if (!_at[s.from] || !_at[s.to])
+            continue;
+        if (!out.empty())
+            out += ", ";
+        out += s.name;
+        out += ";dur=";
+        out.append(num, formatMillis(num, span(s.from, s.to)));
+    }
+}
+
+size_t RequestTiming::formatPhases(char *buf, size_t size) const
+{
+    // 항목 하나는 최대 "upstream=" + 24자리 + 공백
+    char tmp[sizeof(SLOW_LOG_SPANS) / sizeof(SLOW_LOG_SPANS[0]) * 40 + 40];
+    size_t len = 0;
+    for (size_t i = 0; i < sizeof(SLOW_LOG_SPANS) / sizeof(SLOW_LOG_SPANS[0]); ++i)
+    {
+        const PhaseSpan &s = SLOW_LOG_SPANS[i];
+        if (!_at[s.from] || !_at[s.to])
+            continue;
+        size_t name_len = strlen(s.name);
+        memcpy(tmp + len, s.name, name_len);
+        len += name_len;
+        tmp[len++] = '=';
+        len += formatMillis(tmp + len, span(s.from, s.to));
+        tmp[len++] = ' ';
+    }
+    memcpy(tmp + len, "total=", 6);
+    len += 6;
+    len += formatMillis(tmp + len, total());
+    if (len > size)
+        len = size;
+    memcpy(buf, tmp, len);
+    return len;
+}
+
+TimingScope::TimingScope(RequestTiming *timing) : _prev(RequestTiming::_current)
+{
+    RequestTiming::_current = timing;
+}
+
+TimingScope::~TimingScope()
+{
+    RequestTiming::_current = _prev;
+}
+
+static size_t formatFixed3(char *buf, uint64_t whole, uint64_t fraction)
+{
+    size_t len = formatDecimal(buf, whole);
+    buf[len++] = '.';
+    buf[len++] = static_cast<char>('0' + fraction / 100);
+    buf[len++] = static_cast<char>('0' + fraction / 10 % 10);
+    buf[len++] = static_cast<char>('0' + fraction % 10);
+    return len;
+}
+
+size_t formatSeconds(char *buf, uint64_t usec)
+{
+    uint64_t msec = usec / 1000;
+    return formatFixed3(buf, msec / 1000, msec % 1000);
+}
+
+size_t formatMillis(char *buf, uint64_t usec)
+{
+    return formatFixed3(buf, usec / 1000, usec % 1000);
+}
@@ -1,15 +1,20 @@
 #include "CGIHandler.hpp"
 #include "Log.hpp"
 #include "Request.hpp"
+#include "ServerConfig.hpp"
+#include "Utils.hpp"
+#include <arpa/inet.h>
+#include <cctype>
+#include <climits>
+#include <csignal>
 #include <iostream>
+#include <poll.h>
+#include <pthread.h>
+#include <spawn.h>
 #include <sstream>
 #include <sys/wait.h>
 #include <unistd.h>
 
-#ifdef __APPLE__
-extern char **environ;
-#endif
-
 CGIHandler::CGIHandler()
 {
 }
@@ -18,142 +23,372 @@ CGIHandler::~CGIHandler()
 {
 }
 
-void CGIHandler::setEnvironmentVariables(const Request &request, const std::string &script_path)
+// 종료 대기 시간이 지나 헤더를 기다리는 CGI를 모두 중단합니다. (프로세스가 끝날 때까지 되돌리지 않음)
+static bool g_abort_pending = false;
+
+// 출력을 끝까지 보냈지만 release() 때 아직 끝나지 않은 자식 (reapExited()가 거둠)
+static pthread_mutex_t g_unreaped_lock = PTHREAD_MUTEX_INITIALIZER;
+static std::vector<pid_t> g_unreaped;
+
+static void addVariable(std::vector<std::string> &env, const char *name, const std::string &value)
 {
-    std::string path = request.getPath();
-    setenv("REQUEST_METHOD", path.c_str(), 1);
-    setenv("SCRIPT_FILENAME", script_path.c_str(), 1);
-    setenv("QUERY_STRING", request.getQueryString().c_str(), 1);
-    std::map<std::string, std::string> headers = request.getHeaders();
-    if (headers.find("Content-Length") != headers.end())
-        setenv("CONTENT_LENGTH", headers["Content-Length"].c_str(), 1);
-    else
-        setenv("CONTENT_LENGTH", "0", 1);
-    if (headers.find("Content-Type") != headers.end())
-        setenv("CONTENT_TYPE", headers["Content-Type"].c_str(), 1);
-    else
-        setenv("CONTENT_TYPE", "text/plain", 1);
-    setenv("SERVER_PROTOCOL", "HTTP/1.1", 1);
-    setenv("GATEWAY_INTERFACE", "CGI/1.1", 1);
-    setenv("SERVER_SOFTWARE", "Webserv/1.0", 1);
+    env.push_back(std::string(name) + "=" + value);
 }
 
-bool CGIHandler::execute(const Request &request, const std::string &script_path, std::string &cgi_output,
-                         std::string &content_type)
+// CGI/1.1 (RFC 3875) 메타 변수와 요청 헤더(HTTP_*). 서버 자신의 환경은 바꾸지 않고 자식에게 넘길 목록을 만듭니다.
+void CGIHandler::buildEnvironment(const Request &request, const std::string &script_path,
+                                  const ServerConfig &server_config, std::vector<std::string> &env)
 {
+    const HeaderMap &headers = request.getHeaders();
+    env.reserve(24 + headers.size());
+    addVariable(env, "GATEWAY_INTERFACE", "CGI/1.1");
+    addVariable(env, "SERVER_SOFTWARE", "Webserv/1.0");
+    addVariable(env, "SERVER_PROTOCOL", request.getHTTPVersion());
+    std::string server_name = server_config.server_name;
+    HeaderMap::const_iterator host = headers.find("Host");
+    if (server_name.empty() && host != headers.end())
+        server_name = host->second.substr(0, host->second.find(':'));
+    addVariable(env, "SERVER_NAME", server_name.empty() ? "localhost" : server_name);
+    addVariable(env, "SERVER_PORT", intToString(server_config.port));
+    addVariable(env, "REQUEST_METHOD", request.getMethod());
+    std::string uri = request.getPath() + request.getPathInfo();
+    if (!request.getQueryString().empty())
+        uri += "?" + request.getQueryString();
+    addVariable(env, "REQUEST_URI", uri);
+    addVariable(env, "SCRIPT_NAME", request.getPath());
+    addVariable(env, "SCRIPT_FILENAME", script_path);
+    addVariable(env, "QUERY_STRING", request.getQueryString());
+    addVariable(env, "PATH_INFO", request.getPathInfo());
+    // 스크립트 파일 경로에서 SCRIPT_NAME을 뺀 부분이 문서 루트입니다.
+    const std::string &script_name = request.getPath();
+    if (!request.getPathInfo().empty() && script_path.size() >= script_name.size() &&
+        script_path.compare(script_path.size() - script_name.size(), script_name.size(), script_name) == 0)
+        addVariable(env, "PATH_TRANSLATED",
+                    script_path.substr(0, script_path.size() - script_name.size()) + request.getPathInfo());
+    char addr[INET_ADDRSTRLEN];
+    struct in_addr in;
+    in.s_addr = request.getRemoteAddr();
+    if (inet_ntop(AF_INET, &in, addr, sizeof(addr)))
+        addVariable(env, "REMOTE_ADDR", addr);
+    HeaderMap::const_iterator it = headers.find("Content-Type");
+    if (it != headers.end())
+        addVariable(env, "CONTENT_TYPE", it->second);
+    if (!request.getBody().empty() || headers.find("Content-Length") != headers.end())
+        addVariable(env, "CONTENT_LENGTH", sizeToString(request.getBody().size()));
+    // php-cgi는 웹 서버를 거친 요청인지 이것으로 확인합니다.
+    addVariable(env, "REDIRECT_STATUS", "200");
+    const char *path = getenv("PATH");
+    addVariable(env, "PATH", path ? path : "/usr/local/bin:/usr/bin:/bin");
+    for (it = headers.begin(); it != headers.end(); ++it)
+    {
+        // 본문 헤더는 CONTENT_*로 넘겼고, Proxy는 HTTP_PROXY로 스크립트의 프록시 설정을 바꿀 수 있어 뺍니다.
+        if (iequals(it->first, "Content-Type") || iequals(it->first, "Content-Length") || iequals(it->first, "Proxy"))
+            continue;
+        std::string var = "HTTP_";
+        for (size_t i = 0; i < it->first.size(); ++i)
+        {
+            char c = it->first[i];
+            var += (c == '-') ? '_' : static_cast<char>(std::toupper(static_cast<unsigned char>(c)));
+        }
+        env.push_back(var + "=" + it->second);
+    }
+}
 
-    // Check extension validity
-    std::string extension = script_path.substr(script_path.find_last_of('.') + 1);
+// 다른 스레드가 동시에 실행한 CGI가 이 파이프를 물려받으면 EOF가 오지 않으므로 exec할 때 닫히게 만듭니다.
+static bool openPipe(int pipefd[2])
+{
+#ifdef __linux__
+    return pipe2(pipefd, O_CLOEXEC) == 0;
+#else
+    if (pipe(pipefd) == -1)
+        return false;
+    fcntl(pipefd[0], F_SETFD, FD_CLOEXEC);
+    fcntl(pipefd[1], F_SETFD, FD_CLOEXEC);
+    return true;
+#endif
+}
+
+// s[begin, end)의 앞뒤 공백을 뺀 부분
+static std::string trimmedRange(const std::string &s, size_t begin, size_t end)
+{
+    while (begin < end && (s[begin] == ' ' || s[begin] == '\t'))
+        ++begin;
+    while (end > begin && (s[end - 1] == ' ' || s[end - 1] == '\t'))
+        --end;
+    return s.substr(begin, end - begin);
+}
 
-    if (extension != "py" && extension != "php" && extension != "sh" && extension != "pl")
+// posix_spawn은 glibc에서 vfork처럼 부모의 메모리를 공유한 채 바로 exec하므로 캐시로 커진 서버의 페이지 테이블을 복사하지 않습니다.
+// 파이프 연결, 작업 디렉터리, 시그널 설정은 자식에서 코드를 돌리지 않고 file actions/attr로 넘깁니다.
+static int spawnScript(pid_t &pid, const char *interpreter, char *const argv[], char *const envp[], const std::string &dir,
+                       int in_fd, int out_fd)
+{
+    posix_spawn_file_actions_t actions;
+    posix_spawnattr_t attr;
+    int err = posix_spawn_file_actions_init(&actions);
+    if (err)
+        return err;
+    err = posix_spawnattr_init(&attr);
+    if (err)
     {
-        LogConfig::reportInternalError("Unsupported CGI Script Extension: " + extension);
-        return false;
+        posix_spawn_file_actions_destroy(&actions);
+        return err;
     }
+    // 풀 스레드가 막아 둔 시그널과 서버가 무시하는 SIGPIPE를 스크립트에서는 기본값으로 돌립니다.
+    sigset_t none, pipe_only;
+    sigemptyset(&none);
+    sigemptyset(&pipe_only);
+    sigaddset(&pipe_only, SIGPIPE);
+    if (!err)
+        err = posix_spawnattr_setsigmask(&attr, &none);
+    if (!err)
+        err = posix_spawnattr_setsigdefault(&attr, &pipe_only);
+    if (!err)
+        err = posix_spawnattr_setflags(&attr, POSIX_SPAWN_SETSIGMASK | POSIX_SPAWN_SETSIGDEF);
+    if (!err)
+        err = posix_spawn_file_actions_adddup2(&actions, in_fd, STDIN_FILENO);
+    if (!err)
+        err = posix_spawn_file_actions_adddup2(&actions, out_fd, STDOUT_FILENO);
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 29))
+    // 스크립트가 상대 경로로 자기 옆의 파일을 열 수 있도록 스크립트 디렉터리에서 실행합니다.
+    if (!err)
+        err = posix_spawn_file_actions_addchdir_np(&actions, dir.c_str());
+#else
+    (void)dir;
+#endif
+    if (!err)
+        err = posix_spawn(&pid, interpreter, &actions, &attr, argv, envp);
+    posix_spawnattr_destroy(&attr);
+    posix_spawn_file_actions_destroy(&actions);
+    return err;
+}
 
-    int pipefd[2];
-    if (pipe(pipefd) == -1)
+CgiStream *CGIHandler::execute(const Request &request, const std::string &script_path, const std::string &interpreter,
+                               const ServerConfig &server_config, CgiHeaders &headers)
+{
+    // 작업 디렉터리를 바꿔 실행하므로 스크립트는 절대 경로로 넘깁니다.
+    std::string script = script_path;
+    if (script.empty() || script[0] != '/')
+    {
+        char cwd[PATH_MAX];
+        if (!getcwd(cwd, sizeof(cwd)))
+        {
+            LogConfig::reportInternalError("getcwd failed: " + std::string(strerror(errno)));
+            return NULL;
+        }
+        script = std::string(cwd) + "/" + (script.compare(0, 2, "./") == 0 ? script.substr(2) : script);
+    }
+    std::string dir = script.substr(0, script.find_last_of('/'));
+    if (dir.empty())
+        dir = "/";
+    std::string name = interpreter.substr(interpreter.find_last_of('/') + 1);
+
+    // 인자와 환경 배열은 spawn 전에 모두 만듭니다.
+    std::vector<std::string> env;
+    buildEnvironment(request, script, server_config, env);
+    std::vector<char *> envp(env.size() + 1, static_cast<char *>(NULL));
+    for (size_t i = 0; i < env.size(); ++i)
+        envp[i] = const_cast<char *>(env[i].c_str());
+    char *argv[] = {const_cast<char *>(name.c_str()), const_cast<char *>(script.c_str()), NULL};
+
+    int out_pipe[2], in_pipe[2];
+    if (!openPipe(out_pipe))
     {
-        perror("pipe");
         LogConfig::reportInternalError("Pipe creation failed: " + std::string(strerror(errno)));
-        return false;
+        return NULL;
     }
-    pid_t pid = fork();
-    if (pid == -1)
+    if (!openPipe(in_pipe))
     {
-        perror("fork");
-        LogConfig::reportInternalError("Fork failed: " + std::string(strerror(errno)));
-        close(pipefd[0]);
-        close(pipefd[1]);
-        return false;
+        LogConfig::reportInternalError("Pipe creation failed: " + std::string(strerror(errno)));
+        close(out_pipe[0]);
+        close(out_pipe[1]);
+        return NULL;
+    }
+    // 요청 본문은 스크립트가 읽는 만큼만 씁니다. (파이프가 차면 기다림)
+    fcntl(in_pipe[1], F_SETFL, fcntl(in_pipe[1], F_GETFL) | O_NONBLOCK);
+    uint64_t start_us = monotonicMicros();
+    pid_t pid = -1;
+    int err = spawnScript(pid, interpreter.c_str(), argv, &envp[0], dir, in_pipe[0], out_pipe[1]);
+    if (err)
+    {
+        LogConfig::reportInternalError("CGI spawn failed (" + interpreter + "): " + std::string(strerror(err)));
+        close(out_pipe[0]);
+        close(out_pipe[1]);
+        close(in_pipe[0]);
+        close(in_pipe[1]);
+        return NULL;
+    }
+    close(out_pipe[1]);
+    close(in_pipe[0]);
+    CgiStream *stream = new CgiStream();
+    stream->fd = out_pipe[0];
+    stream->in_fd = in_pipe[1];
+    stream->in_offset = 0;
+    stream->pid = pid;
+    stream->chunked = false;
+    stream->discard = false;
+    stream->eof = false;
+    stream->start_us = start_us;
+    stream->refs = 1;
+    if (!readHeaders(*stream, request.getBody(), headers))
+    {
+        release(stream);
+        return NULL;
     }
-    if (pid == 0)
+    return stream;
+}
+
+bool CGIHandler::writeBody(CgiStream &stream, const std::string &body)
+{
+    while (stream.in_offset < body.size())
     {
-        close(pipefd[0]);
-        if (dup2(pipefd[1], STDOUT_FILENO) == -1)
+        ssize_t written = write(stream.in_fd, body.data() + stream.in_offset, body.size() - stream.in_offset);
+        if (written > 0)
         {
-            perror("dup2");
-            exit(EXIT_FAILURE);
+            stream.in_offset += written;
+            continue;
         }
-        close(pipefd[1]);
-        setEnvironmentVariables(request, script_path);
+        if (written == -1 && errno == EINTR)
+            continue;
+        if (written == -1 && (errno == EAGAIN || errno == EWOULDBLOCK))
+            return false;
+        // EPIPE: 스크립트가 본문을 다 읽지 않고 stdin을 닫았습니다.
+        break;
+    }
+    return true;
+}
 
-        if (extension == "py")
+// 도착하는 대로 한 줄씩 해석하고, 빈 줄을 만나면 그 뒤에 함께 읽힌 바이트를 본문 앞부분으로 남깁니다.
+// 완성된 줄만 보므로 이미 읽은 부분을 다시 훑지 않습니다. 본문을 다 읽은 뒤에야 출력하는 스크립트를 위해
+// 헤더를 기다리는 동안 stdin에도 씁니다.
+bool CGIHandler::readHeaders(CgiStream &stream, const std::string &body, CgiHeaders &headers)
+{
+    std::string &buf = stream.head;
+    size_t line_start = 0;
+    char data[BUFFER_SIZE];
+    for (;;)
+    {
+        size_t eol;
+        while ((eol = buf.find('\n', line_start)) != std::string::npos)
         {
-            char *args[] = {const_cast<char *>("python"), const_cast<char *>(script_path.c_str()), NULL};
-            if (execve(PYTHON_PATH, args, environ) == -1)
+            size_t end = (eol > line_start && buf[eol - 1] == '\r') ? eol - 1 : eol;
+            if (end == line_start)
             {
-                perror("execve");
-                LogConfig::reportInternalError("Execve failed for Python: " + std::string(strerror(errno)));
-                exit(EXIT_FAILURE);
+                buf.erase(0, eol + 1);
+                return true;
             }
-        }
-
-        else if (extension == "sh")
-        {
-
-            char *args[] = {const_cast<char *>("bash"), const_cast<char *>(script_path.c_str()), NULL};
-            if (execve("/bin/bash", args, environ) == -1)
+            size_t colon = buf.find(':', line_start);
+            if (colon >= end)
             {
-                perror("execve");
-                LogConfig::reportInternalError("Execve failed for Bash: " + std::string(strerror(errno)));
-                exit(EXIT_FAILURE);
+                // 헤더 없이 본문부터 쓰는 스크립트: 출력 전체가 본문입니다.
+                headers.clear();
+                return true;
             }
+            headers.push_back(std::make_pair(trimmedRange(buf, line_start, colon), trimmedRange(buf, colon + 1, end)));
+            line_start = eol + 1;
         }
-
-        else if (extension == "pl")
+        if (buf.size() > CGI_HEADER_MAX)
         {
-            char *args[] = {const_cast<char *>("perl"), const_cast<char *>(script_path.c_str()), NULL};
-            if (execve("/usr/bin/perl", args, environ) == -1)
+            LogConfig::reportInternalError("CGI response header too large: " + sizeToString(buf.size()) + " bytes");
+            return false;
+        }
+        struct pollfd fds[2];
+        fds[0].fd = stream.fd;
+        fds[0].events = POLLIN;
+        fds[0].revents = 0;
+        fds[1].fd = stream.in_fd;
+        fds[1].events = POLLOUT;
+        fds[1].revents = 0;
+        int ready = poll(fds, stream.in_fd != -1 ? 2 : 1, CGI_ABORT_CHECK_MS);
+        if (ready == -1 && errno != EINTR)
+        {
+            LogConfig::reportInternalError("poll() failed for CGI pipes: " + std::string(strerror(errno)));
+            return false;
+        }
+        if (ready <= 0)
+        {
+            if (__atomic_load_n(&g_abort_pending, __ATOMIC_ACQUIRE))
             {
-                perror("execve");
-                LogConfig::reportInternalError("Execve failed for Perl: " + std::string(strerror(errno)));
-                exit(EXIT_FAILURE);
+                LogConfig::reportInternalError("CGI aborted before sending headers: shutdown_timeout expired");
+                return false;
             }
+            continue;
         }
-    }
-    else
-    {
-        close(pipefd[1]);
-        char buffer[BUFFER_SIZE];
-        ssize_t bytes_read;
-        while ((bytes_read = read(pipefd[0], buffer, sizeof(buffer))) > 0)
+        if (stream.in_fd != -1 && fds[1].revents && writeBody(stream, body))
         {
-            cgi_output.append(buffer, bytes_read);
+            close(stream.in_fd);
+            stream.in_fd = -1;
         }
+        if (!fds[0].revents)
+            continue;
+        ssize_t bytes_read = read(stream.fd, data, sizeof(data));
+        if (bytes_read == -1 && errno == EINTR)
+            continue;
         if (bytes_read == -1)
         {
-            perror("read");
             LogConfig::reportInternalError("Read failed: " + std::string(strerror(errno)));
-            close(pipefd[0]);
             return false;
         }
-        close(pipefd[0]);
-        int status;
-        waitpid(pid, &status, 0);
-        size_t pos = cgi_output.find("\r\n\r\n");
-        if (pos != std::string::npos)
+        if (bytes_read == 0)
         {
-            std::string headers_part = cgi_output.substr(0, pos);
-            std::string body_part = cgi_output.substr(pos + 4);
-            std::istringstream header_stream(headers_part);
-            std::string header_line;
-            while (std::getline(header_stream, header_line))
-            {
-                if (!header_line.empty() && header_line[header_line.size() - 1] == '\r')
-                    header_line.resize(header_line.size() - 1);
-                size_t colon = header_line.find(':');
-                if (colon != std::string::npos && colon + 2 < header_line.size())
-                {
-                    content_type = header_line.substr(colon + 2);
-                }
-            }
+            // 빈 줄 없이 끝난 출력도 모두 본문입니다.
+            headers.clear();
+            stream.eof = true;
+            return true;
+        }
+        buf.append(data, bytes_read);
+    }
+}
+
+void CGIHandler::abortPending()
+{
+    __atomic_store_n(&g_abort_pending, true, __ATOMIC_RELEASE);
+}
+
+void CGIHandler::retain(CgiStream *stream)
+{
+    __atomic_add_fetch(&stream->refs, 1, __ATOMIC_RELAXED);
+}
+
+void CGIHandler::release(CgiStream *stream)
+{
+    if (__atomic_sub_fetch(&stream->refs, 1, __ATOMIC_ACQ_REL) != 0)
+        return;
+    close(stream->fd);
+    if (stream->in_fd != -1)
+        close(stream->in_fd);
+    if (waitpid(stream->pid, NULL, WNOHANG) == 0)
+    {
+        if (stream->eof)
+        {
+            // stdout을 닫은 뒤 정리 중인 스크립트는 멈추지 않고 끝나면 거둡니다.
+            pthread_mutex_lock(&g_unreaped_lock);
+            g_unreaped.push_back(stream->pid);
+            pthread_mutex_unlock(&g_unreaped_lock);
         }
         else
         {
-            content_type = "text/html";
+            // 출력을 다 보내기 전에 연결이 끊겼으면 스크립트를 멈춥니다.
+            kill(stream->pid, SIGKILL);
+            while (waitpid(stream->pid, NULL, 0) == -1 && errno == EINTR)
+                ;
         }
-        return true;
     }
-    return true;
+    delete stream;
+}
+
+void CGIHandler::reapExited()
+{
+    pthread_mutex_lock(&g_unreaped_lock);
+    for (size_t i = 0; i < g_unreaped.size();)
+    {
+        if (waitpid(g_unreaped[i], NULL, WNOHANG) == 0)
+        {
+            ++i;
+            continue;
+        }
+        g_unreaped[i] = g_unreaped.back();
+        g_unreaped.pop_back();
+    }
+    pthread_mutex_unlock(&g_unreaped_lock);
 }
@@ -0,0 +1,406 @@
+#include "DirectoryListing.hpp"
+#include "Log.hpp"
+#include "Utils.hpp"
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <dirent.h>
+#include <map>
+#include <pthread.h>
+#include <sys/stat.h>
+
+enum EntryType
+{
+    ENTRY_DIR,
+    ENTRY_FILE,
+    ENTRY_OTHER // 소켓, FIFO, 깨진 링크 등
+};
+
+struct ListingEntry
+{
+    std::string name;
+    EntryType type;
+};
+
+// 한 번 읽어 정렬한 디렉터리. 디렉터리의 mtime이 그대로인 동안 다시 읽지 않습니다.
+struct Snapshot
+{
+    dev_t dev;
+    ino_t ino;
+    time_t mtime;
+    long mtime_nsec;
+    std::vector<ListingEntry> entries; // 디렉터리 먼저, 그 안에서 이름순
+    std::vector<size_t> visible;       // autoindex에 보이는 항목 (숨김 파일 제외)
+    size_t visible_dirs;               // visible 앞쪽의 디렉터리 수
+    std::map<std::string, std::string> pages; // 만든 페이지 (쿼리별)
+    uint64_t last_used;
+};
+
+// 같은 디렉터리를 다른 경로(상대 경로, realpath)로 불러도 한 목록을 쓰도록 (dev, inode)로 찾습니다.
+typedef std::map<std::pair<dev_t, ino_t>, Snapshot *> SnapshotTable;
+
+static pthread_mutex_t g_lock = PTHREAD_MUTEX_INITIALIZER;
+static SnapshotTable g_snapshots;
+static uint64_t g_clock = 0;
+
+static long mtimeNsec(const struct stat &st)
+{
+#ifdef __APPLE__
+    return st.st_mtimespec.tv_nsec;
+#else
+    return st.st_mtim.tv_nsec;
+#endif
+}
+
+static bool entryLess(const ListingEntry &a, const ListingEntry &b)
+{
+    if ((a.type == ENTRY_DIR) != (b.type == ENTRY_DIR))
+        return a.type == ENTRY_DIR;
+    return a.name < b.name;
+}
+
+// d_type을 주지 않는 파일 시스템과 심볼릭 링크만 stat으로 확인합니다. (링크는 가리키는 대상의 종류)
+static EntryType entryType(const std::string &dir, const struct dirent *ent)
+{
+    if (ent->d_type == DT_DIR)
+        return ENTRY_DIR;
+    if (ent->d_type == DT_REG)
+        return ENTRY_FILE;
+    if (ent->d_type != DT_LNK && ent->d_type != DT_UNKNOWN)
+        return ENTRY_OTHER;
+    struct stat st;
+    if (stat((dir + "/" + ent->d_name).c_str(), &st) == -1)
+        return ENTRY_OTHER;
+    if (S_ISDIR(st.st_mode))
+        return ENTRY_DIR;
+    return S_ISREG(st.st_mode) ? ENTRY_FILE : ENTRY_OTHER;
+}
+
+static bool scan(const std::string &dir, const struct stat &st, Snapshot &snap)
+{
+    DIR *handle = opendir(dir.c_str());
+    if (!handle)
+    {
+        LogConfig::reportInternalError("Failed to open directory: " + dir + ": " + strerror(errno));
+        return false;
+    }
+    struct dirent *ent;
+    while ((ent = readdir(handle)) != NULL)
+    {
+        if (strcmp(ent->d_name, ".") == 0 || strcmp(ent->d_name, "..") == 0)
+            continue;
+        ListingEntry entry;
+        entry.name = ent->d_name;
+        entry.type = entryType(dir, ent);
+        snap.entries.push_back(entry);
+    }
+    closedir(handle);
+    std::sort(snap.entries.begin(), snap.entries.end(), entryLess);
+    snap.visible_dirs = 0;
+    for (size_t i = 0; i < snap.entries.size(); ++i)
+    {
+        if (snap.entries[i].name[0] == '.')
+            continue;
+        snap.visible.push_back(i);
+        if (snap.entries[i].type == ENTRY_DIR)
+            ++snap.visible_dirs;
+    }
+    snap.dev = st.st_dev;
+    snap.ino = st.st_ino;
+    snap.mtime = st.st_mtime;
+    snap.mtime_nsec = mtimeNsec(st);
+    snap.last_used = 0;
+    return true;
+}
+
+// (잠금 안에서 호출) 디렉터리가 바뀌지 않았으면 캐시된 목록
+static Snapshot *findFresh(const struct stat &st)
+{
+    SnapshotTable::iterator it = g_snapshots.find(std::make_pair(st.st_dev, st.st_ino));
+    if (it == g_snapshots.end())
+        return NULL;
+    Snapshot *snap = it->second;
+    if (snap->mtime != st.st_mtime || snap->mtime_nsec != mtimeNsec(st))
+        return NULL;
+    snap->last_used = ++g_clock;
+    return snap;
+}
+
+// (잠금 안에서 호출) 새로 읽은 목록을 캐시에 넣습니다. 넣지 않았으면 false (호출한 쪽이 해제)
+static bool store(Snapshot *snap)
+{
+    // mtime은 거친 시계로 찍히므로, 방금 바뀐 디렉터리는 같은 mtime으로 또 바뀔 수 있어 캐시하지 않습니다.
+    if (snap->mtime >= time(NULL) - 1)
+        return false;
+    std::pair<dev_t, ino_t> key(snap->dev, snap->ino);
+    SnapshotTable::iterator it = g_snapshots.find(key);
+    if (it != g_snapshots.end())
+    {
+        delete it->second;
+        g_snapshots.erase(it);
+    }
+    if (g_snapshots.size() >= AUTOINDEX_CACHE_DIRS)
+    {
+        SnapshotTable::iterator oldest = g_snapshots.begin();
+        for (it = g_snapshots.begin(); it != g_snapshots.end(); ++it)
+        {
+            if (it->second->last_used < oldest->second->last_used)
+                oldest = it;
+        }
+        delete oldest->second;
+        g_snapshots.erase(oldest);
+    }
+    snap->last_used = ++g_clock;
+    g_snapshots[key] = snap;
+    return true;
+}
+
+static void storePage(Snapshot &snap, const std::string &key, const std::string &body)
+{
+    if (snap.pages.size() >= AUTOINDEX_CACHE_PAGES)
+        snap.pages.clear();
+    snap.pages[key] = body;
+}
+
+static void appendHtmlEscaped(std::string &out, const std::string &text)
+{
+    for (size_t i = 0; i < text.size(); ++i)
+    {
+        switch (text[i])
+        {
+            case '&': out += "&amp;"; break;
+            case '<': out += "&lt;"; break;
+            case '>': out += "&gt;"; break;
+            case '"': out += "&quot;"; break;
+            case '\'': out += "&#39;"; break;
+            default: out += text[i];
+        }
+    }
+}
+
+static void appendUrlEncoded(std::string &out, const std::string &text)
+{
+    static const char hex[] = "0123456789ABCDEF";
+    for (size_t i = 0; i < text.size(); ++i)
+    {
+        unsigned char c = static_cast<unsigned char>(text[i]);
+        if (isalnum(c) || c == '-' || c == '.' || c == '_' || c == '~')
+            out += static_cast<char>(c);
+        else
+        {
+            out += '%';
+            out += hex[c >> 4];
+            out += hex[c & 15];
+        }
+    }
+}
+
+static void appendJsonString(std::string &out, const std::string &text)
+{
+    static const char hex[] = "0123456789abcdef";
+    out += '"';
+    for (size_t i = 0; i < text.size(); ++i)
+    {
+        unsigned char c = static_cast<unsigned char>(text[i]);
+        if (c == '"' || c == '\\')
+        {
+            out += '\\';
+            out += static_cast<char>(c);
+        }
+        else if (c < 0x20)
+        {
+            out += "\\u00";
+            out += hex[c >> 4];
+            out += hex[c & 15];
+        }
+        else
+            out += static_cast<char>(c);
+    }
+    out += '"';
+}
+
+// 표시 순서의 i번째 항목. 역순이어도 디렉터리는 파일보다 앞에 둡니다.
+static const ListingEntry &visibleAt(const Snapshot &snap, size_t i, bool descending)
+{
+    if (descending)
+    {
+        if (i < snap.visible_dirs)
+            i = snap.visible_dirs - 1 - i;
+        else
+            i = snap.visible_dirs + (snap.visible.size() - 1 - i);
+    }
+    return snap.entries[snap.visible[i]];
+}
+
+static std::string pageLink(const ListingQuery &query, size_t page)
+{
+    std::string link = "?page=" + sizeToString(page);
+    if (query.descending)
+        link += "&amp;order=desc";
+    if (query.limit != AUTOINDEX_PAGE_SIZE)
+        link += "&amp;limit=" + sizeToString(query.limit);
+    return link;
+}
+
+static void renderPage(const Snapshot &snap, const std::string &uri, const ListingQuery &query, std::string &body)
+{
+    size_t total = snap.visible.size();
+    size_t pages = total == 0 ? 1 : (total + query.limit - 1) / query.limit;
+    size_t begin = query.page > pages ? total : (query.page - 1) * query.limit;
+    size_t end = std::min(total, begin + query.limit);
+    body.reserve((end - begin) * (query.format == LISTING_JSON ? 48 : 96) + 512);
+    if (query.format == LISTING_JSON)
+    {
+        body += "{\"path\":";
+        appendJsonString(body, uri);
+        body += ",\"total\":" + sizeToString(total) + ",\"page\":" + sizeToString(query.page) +
+                ",\"pages\":" + sizeToString(pages) + ",\"limit\":" + sizeToString(query.limit) + ",\"entries\":[";
+        for (size_t i = begin; i < end; ++i)
+        {
+            const ListingEntry &entry = visibleAt(snap, i, query.descending);
+            if (i != begin)
+                body += ',';
+            body += "{\"name\":";
+            appendJsonString(body, entry.name);
+            body += entry.type == ENTRY_DIR ? ",\"type\":\"directory\"}"
+                    : entry.type == ENTRY_FILE ? ",\"type\":\"file\"}" : ",\"type\":\"other\"}";
+        }
+        body += "]}";
+        return;
+    }
+    body += "<!DOCTYPE html>\n<html>\n<head><meta charset=\"utf-8\"><title>Index of ";
+    appendHtmlEscaped(body, uri);
+    body += "</title></head>\n<body>\n<h1>Index of ";
+    appendHtmlEscaped(body, uri);
+    body += "</h1><hr><pre>\n";
+    if (uri != "/")
+        body += "<a href=\"../\">../</a>\n";
+    for (size_t i = begin; i < end; ++i)
+    {
+        const ListingEntry &entry = visibleAt(snap, i, query.descending);
+        const char *suffix = entry.type == ENTRY_DIR ? "/" : "";
+        body += "<a href=\"";
+        appendUrlEncoded(body, entry.name);
+        body += suffix;
+        body += "\">";
+        appendHtmlEscaped(body, entry.name);
+        body += suffix;
+        body += "</a>\n";
+    }
+    body += "</pre><hr>\n<p>" + sizeToString(total) + " entries, page " + sizeToString(query.page) + " of " +
+            sizeToString(pages);
+    if (query.page > 1)
+        body += " <a href=\"" + pageLink(query, std::min(query.page - 1, pages)) + "\">previous</a>";
+    if (query.page < pages)
+        body += " <a href=\"" + pageLink(query, query.page + 1) + "\">next</a>";
+    body += "</p>\n</body>\n</html>\n";
+}
+
+static void renderFiles(const Snapshot &snap, std::string &body)
+{
+    body.reserve(snap.entries.size() * 24 + 32);
+    body += "{ \"files\": [";
+    bool first = true;
+    for (size_t i = 0; i < snap.entries.size(); ++i)
+    {
+        if (snap.entries[i].type != ENTRY_FILE)
+            continue;
+        if (!first)
+            body += ", ";
+        appendJsonString(body, snap.entries[i].name);
+        first = false;
+    }
+    body += "] }";
+}
+
+// key에 해당하는 페이지를 캐시에서 찾거나, 목록을 (필요하면 다시 읽어) 만들어 body에 담습니다.
+// uri가 비어 있으면 업로드 목록, 아니면 autoindex 페이지
+static bool renderCached(const std::string &dir, const std::string &key, const std::string &uri,
+                         const ListingQuery &query, std::string &body)
+{
+    struct stat st;
+    if (stat(dir.c_str(), &st) == -1 || !S_ISDIR(st.st_mode))
+        return false;
+    pthread_mutex_lock(&g_lock);
+    Snapshot *snap = findFresh(st);
+    if (snap)
+    {
+        std::map<std::string, std::string>::const_iterator page = snap->pages.find(key);
+        if (page != snap->pages.end())
+            body = page->second;
+        else
+        {
+            if (uri.empty())
+                renderFiles(*snap, body);
+            else
+                renderPage(*snap, uri, query, body);
+            storePage(*snap, key, body);
+        }
+        pthread_mutex_unlock(&g_lock);
+        return true;
+    }
+    pthread_mutex_unlock(&g_lock);
+
+    // 디렉터리는 잠금 밖에서 읽습니다. (큰 디렉터리를 읽는 동안 다른 목록 요청을 막지 않음)
+    Snapshot *scanned = new Snapshot();
+    if (!scan(dir, st, *scanned))
+    {
+        delete scanned;
+        return false;
+    }
+    if (uri.empty())
+        renderFiles(*scanned, body);
+    else
+        renderPage(*scanned, uri, query, body);
+    pthread_mutex_lock(&g_lock);
+    bool stored = store(scanned);
+    if (stored)
+        storePage(*scanned, key, body);
+    pthread_mutex_unlock(&g_lock);
+    if (!stored)
+        delete scanned;
+    return true;
+}
+
+ListingQuery DirectoryListing::parseQuery(const HeaderMap &params)
+{
+    ListingQuery query;
+    HeaderMap::const_iterator it = params.find("format");
+    if (it != params.end() && iequals(it->second, "json"))
+        query.format = LISTING_JSON;
+    it = params.find("order");
+    if (it != params.end() && iequals(it->second, "desc"))
+        query.descending = true;
+    it = params.find("page");
+    if (it != params.end() && std::atol(it->second.c_str()) > 0)
+        query.page = static_cast<size_t>(std::atol(it->second.c_str()));
+    it = params.find("limit");
+    if (it != params.end() && std::atol(it->second.c_str()) > 0)
+        query.limit = std::min(static_cast<size_t>(std::atol(it->second.c_str())), static_cast<size_t>(AUTOINDEX_PAGE_MAX));
+    return query;
+}
+
+bool DirectoryListing::render(const std::string &dir, const std::string &uri, const ListingQuery &query,
+                              std::string &body)
+{
+    std::string key = (query.format == LISTING_JSON ? "json " : "html ") + std::string(query.descending ? "desc " : "asc ") +
+                      sizeToString(query.page) + " " + sizeToString(query.limit) + " " + uri;
+    return renderCached(dir, key, uri, query, body);
+}
+
+bool DirectoryListing::renderFileList(const std::string &dir, std::string &body)
+{
+    return renderCached(dir, "files", "", ListingQuery(), body);
+}
+
+void DirectoryListing::clear()
+{
+    pthread_mutex_lock(&g_lock);
+    for (SnapshotTable::iterator it = g_snapshots.begin(); it != g_snapshots.end(); ++it)
+        delete it->second;
+    g_snapshots.clear();
+    pthread_mutex_unlock(&g_lock);
+}
@@ -0,0 +1,107 @@
+#include "HttpStatus.hpp"
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+
+struct StatusDef
+{
+    int code;
+    const char *reason;
+};
+
+static const StatusDef STATUS_DEFS[] = {{100, "Continue"},
+                                        {101, "Switching Protocols"},
+                                        {200, "OK"},
+                                        {201, "Created"},
+                                        {202, "Accepted"},
+                                        {204, "No Content"},
+                                        {206, "Partial Content"},
+                                        {301, "Moved Permanently"},
+                                        {302, "Found"},
+                                        {303, "See Other"},
+                                        {304, "Not Modified"},
+                                        {307, "Temporary Redirect"},
+                                        {308, "Permanent Redirect"},
+                                        {400, "Bad Request"},
+                                        {401, "Unauthorized"},
+                                        {403, "Forbidden"},
+                                        {404, "Not Found"},
+                                        {405, "Method Not Allowed"},
+                                        {408, "Request Timeout"},
+                                        {409, "Conflict"},
+                                        {411, "Length Required"},
+                                        {412, "Precondition Failed"},
+                                        {413, "Payload Too Large"},
+                                        {414, "URI Too Long"},
+                                        {415, "Unsupported Media Type"},
+                                        {416, "Range Not Satisfiable"},
+                                        {429, "Too Many Requests"},
+                                        {431, "Request Header Fields Too Large"},
+                                        {500, "Internal Server Error"},
+                                        {501, "Not Implemented"},
+                                        {502, "Bad Gateway"},
+                                        {503, "Service Unavailable"},
+                                        {504, "Gateway Timeout"},
+                                        {505, "HTTP Version Not Supported"}};
+
+static const size_t STATUS_LINE_MAX = 64;
+
+// 시작 시 한 번 모든 상태 라인을 만들어 코드로 인덱싱합니다.
+struct StatusTable
+{
+    char lines[HttpStatus::MAX_CODE][STATUS_LINE_MAX];
+    unsigned char lengths[HttpStatus::MAX_CODE];
+    const char *reasons[HttpStatus::MAX_CODE];
+
+    StatusTable()
+    {
+        for (int code = 0; code < HttpStatus::MAX_CODE; ++code)
+        {
+            reasons[code] = "Unknown";
+            lengths[code] = 0;
+        }
+        for (size_t i = 0; i < sizeof(STATUS_DEFS) / sizeof(STATUS_DEFS[0]); ++i)
+            reasons[STATUS_DEFS[i].code] = STATUS_DEFS[i].reason;
+        for (int code = 100; code < HttpStatus::MAX_CODE; ++code)
+        {
+            int n = snprintf(lines[code], STATUS_LINE_MAX, "HTTP/1.1 %d %s\r\n", code, reasons[code]);
+            lengths[code] = static_cast<unsigned char>(n);
+        }
+    }
+};
+
+static const StatusTable g_status_table;
+
+const char *HttpStatus::reason(int code)
+{
+    if (code < 0 || code >= MAX_CODE)
+        return "Unknown";
+    return g_status_table.reasons[code];
+}
+
+const char *HttpStatus::statusLine(int code, size_t &len)
+{
+    if (code < 100 || code >= MAX_CODE)
+        code = 500;
+    len = g_status_table.lengths[code];
+    return g_status_table.lines[code];
+}
+
+const char *HttpStatus::dateHeader(size_t &len)
+{
+    // worker_threads의 각 루프가 따로 갱신하도록 스레드별로 둡니다.
+    static __thread char cached[64];
+    static __thread size_t cached_len = 0;
+    static __thread time_t cached_sec = 0;
+
+    time_t now = time(NULL);
+    if (now != cached_sec || cached_len == 0)
+    {
+        struct tm gmt;
+        gmtime_r(&now, &gmt);
+        cached_len = strftime(cached, sizeof(cached), "Date: %a, %d %b %Y %H:%M:%S GMT\r\n", &gmt);
+        cached_sec = now;
+    }
+    len = cached_len;
+    return cached;
+}
@@ -1,64 +1,198 @@
 #include "Response.hpp"
 #include "Define.hpp"
+#include "HttpStatus.hpp"
+#include "RequestTiming.hpp"
 #include "ResponseHandlers.hpp"
 #include "ResponseUtils.hpp"
+#include "ResumableUpload.hpp"
+#include <cstring>
 #include <iostream>
 #include <limits.h>
 #include <sstream>
 #include <string>
 #include <unistd.h>
 
-Response::Response() : _status("200 OK"), _headers(), _body("")
+Response::Response() : _status(200), _headers(), _body(""), _file(NULL), _stream(NULL)
 {
 }
 
+Response::Response(const Response &other)
+    : _status(other._status), _headers(other._headers), _body(other._body), _file(other._file), _stream(other._stream)
+{
+    if (_file)
+        FileCache::retain(_file);
+    if (_stream)
+        CGIHandler::retain(_stream);
+}
+
+Response &Response::operator=(const Response &other)
+{
+    if (this == &other)
+        return *this;
+    if (other._file)
+        FileCache::retain(other._file);
+    if (_file)
+        FileCache::release(_file);
+    if (other._stream)
+        CGIHandler::retain(other._stream);
+    if (_stream)
+        CGIHandler::release(_stream);
+    _status = other._status;
+    _headers = other._headers;
+    _body = other._body;
+    _file = other._file;
+    _stream = other._stream;
+    return *this;
+}
+
 Response::~Response()
 {
+    if (_file)
+        FileCache::release(_file);
+    if (_stream)
+        CGIHandler::release(_stream);
 }
 
-void Response::setStatus(const std::string &status_code)
+void Response::setStatus(int status_code)
 {
     _status = status_code;
 }
 
 void Response::setHeader(const std::string &key, const std::string &value)
 {
-    _headers[key] = value;
+    // 같은 이름이 있으면 그 자리에서 교체하고, 없으면 삽입 순서대로 추가합니다.
+    for (HeaderList::iterator it = _headers.begin(); it != _headers.end(); ++it)
+    {
+        if (iequals(it->first, key))
+        {
+            it->second = value;
+            return;
+        }
+    }
+    _headers.push_back(std::make_pair(key, value));
+}
+
+void Response::addHeader(const std::string &key, const std::string &value)
+{
+    _headers.push_back(std::make_pair(key, value));
 }
 
 void Response::setBody(const std::string &content)
 {
     _body = content;
+    if (_file)
+        FileCache::release(_file);
+    _file = NULL;
+}
+
+void Response::setFileBody(MappedFile *file)
+{
+    _body.clear();
+    if (_file)
+        FileCache::release(_file);
+    _file = file;
 }
 
-std::string Response::getStatus() const
+int Response::getStatusCode() const
 {
     return _status;
 }
 
-std::string Response::toString() const
+size_t Response::getBodySize() const
+{
+    return _file ? _file->size : _body.size();
+}
+
+MappedFile *Response::getFile() const
+{
+    return _file;
+}
+
+void Response::setStreamBody(CgiStream *stream)
+{
+    _body.clear();
+    if (_stream)
+        CGIHandler::release(_stream);
+    _stream = stream;
+}
+
+CgiStream *Response::getStream() const
+{
+    return _stream;
+}
+
+static char *appendBytes(char *p, const char *src, size_t len)
+{
+    memcpy(p, src, len);
+    return p + len;
+}
+
+// 상태 라인 + Date + 헤더(삽입 순서) + 본문을 미리 크기를 맞춘 버퍼에 직접 기록합니다.
+// Content-Length가 설정되지 않았으면 본문 길이로 채웁니다. (CGI 출력은 핸들러가 정한 헤더 그대로)
+// 1xx/204/304는 본문이 없는 응답이라 Content-Length도 본문도 쓰지 않습니다. (RFC 9110 8.6)
+void Response::serialize(std::string &out) const
 {
-    std::stringstream response_stream;
-    response_stream << "HTTP/1.1 " << _status << "\r\n";
-    for (std::map<std::string, std::string>::const_iterator it = _headers.begin(); it != _headers.end(); ++it)
+    bool bodyless = _status < 200 || _status == 204 || _status == 304;
+    size_t status_len = 0, date_len = 0;
+    const char *status_line = HttpStatus::statusLine(_status, status_len);
+    const char *date = HttpStatus::dateHeader(date_len);
+
+    bool has_length = false;
+    size_t body_size = getBodySize();
+    size_t total = status_len + date_len + 2 + (bodyless ? 0 : _body.size());
+    for (HeaderList::const_iterator it = _headers.begin(); it != _headers.end(); ++it)
+    {
+        total += it->first.size() + 2 + it->second.size() + 2;
+        if (!has_length && iequals(it->first, "Content-Length"))
+            has_length = true;
+    }
+    char length_digits[24];
+    size_t length_len = 0;
+    if (!has_length && !_stream && !bodyless)
     {
-        response_stream << it->first << ": " << it->second << "\r\n";
+        length_len = formatDecimal(length_digits, body_size);
+        total += 16 + length_len + 2;
     }
-    response_stream << "\r\n" << _body;
-    return response_stream.str();
+
+    size_t offset = out.size();
+    out.resize(offset + total);
+    char *p = &out[offset];
+    p = appendBytes(p, status_line, status_len);
+    p = appendBytes(p, date, date_len);
+    for (HeaderList::const_iterator it = _headers.begin(); it != _headers.end(); ++it)
+    {
+        p = appendBytes(p, it->first.data(), it->first.size());
+        p = appendBytes(p, ": ", 2);
+        p = appendBytes(p, it->second.data(), it->second.size());
+        p = appendBytes(p, "\r\n", 2);
+    }
+    if (length_len)
+    {
+        p = appendBytes(p, "Content-Length: ", 16);
+        p = appendBytes(p, length_digits, length_len);
+        p = appendBytes(p, "\r\n", 2);
+    }
+    p = appendBytes(p, "\r\n", 2);
+    if (!bodyless && !_body.empty())
+        appendBytes(p, _body.data(), _body.size());
+}
+
+std::string Response::toString() const
+{
+    std::string out;
+    serialize(out);
+    if (_file)
+        out.append(_file->data, _file->size);
+    return out;
 }
 
 void Response::setCookie(const std::string &key, const std::string &value, const std::string &path, int max_age)
 {
-    std::stringstream ss;
-    ss << key << "=" << value;
-    ss << "; Path=" << path;
+    std::string cookie = key + "=" + value + "; Path=" + path;
     if (max_age > 0)
-        ss << "; Max-Age=" << max_age;
-    ss << "; HttpOnly";
-    ss << "; Secure";
-    ss << "; SameSite=Strict";
-    setHeader("Set-Cookie", ss.str());
+        cookie += "; Max-Age=" + intToString(max_age);
+    cookie += "; HttpOnly; Secure; SameSite=Strict";
+    addHeader("Set-Cookie", cookie);
 }
 
 Response Response::buildResponse(const Request &request, const ServerConfig &server_config,
@@ -87,13 +221,33 @@ Response Response::createResponse(const Request &request, const LocationConfig &
         return ResponseHandler::handleMethodNotAllowed(location_config, server_config);
     if (!location_config.redirect.empty())
         return ResponseHandler::handleRedirection(location_config);
+    if (location_config.status_page != STATUS_PAGE_NONE)
+        return ResponseHandler::handleStatusPage(location_config);
     if (path == "/setmode" && iequals(method, "GET"))
         return ResponseHandler::handleCookieAndSession(request);
+    if (location_config.upload_store && (iequals(method, "HEAD") || iequals(method, "GET")) &&
+        request.getQueryParams().count("digest"))
+        return ResponseHandler::handleUploadProbe(request, location_config, server_config);
+    if (ResumableUpload::isRequest(request, location_config))
+        return ResumableUpload::handle(request, location_config, server_config);
     std::string real_path;
     if (!getRealPath(path, location_config, server_config, real_path))
-        return createErrorResponse(404, server_config);
+    {
+        // index 파일이 없는 디렉터리는 autoindex가 켜져 있으면 목록을 보여줍니다.
+        if (!location_config.directory_listing)
+            return createErrorResponse(404, server_config);
+        LocationConfig listing_location = location_config;
+        listing_location.index.clear();
+        if (!getRealPath(path, listing_location, server_config, real_path))
+            return createErrorResponse(404, server_config);
+    }
+    RequestTiming::markCurrent(PHASE_RESOLVED);
+    struct stat st;
+    if (location_config.directory_listing && iequals(method, "GET") && stat(real_path.c_str(), &st) == 0 &&
+        S_ISDIR(st.st_mode))
+        return ResponseHandler::handleAutoindex(request, real_path, server_config);
     if (ResponseHandler::isCGIRequest(real_path, location_config))
-        return ResponseHandler::handleCGI(request, real_path, server_config);
+        return ResponseHandler::handleCGI(request, real_path, location_config, server_config);
     if (path == "/redirection" && iequals(method, "GET"))
         return ResponseHandler::handleRedirection(location_config);
     if (path == "/query")
@@ -109,6 +263,36 @@ Response Response::createResponse(const Request &request, const LocationConfig &
     return ResponseHandler::handleStaticFile(real_path, server_config);
 }
 
+// createResponse()와 같은 순서로 판단합니다. 405/404 에러 페이지도 파일에서 읽으므로 디스크 작업입니다.
+IoQueue Response::ioQueue(const Request &request, const LocationConfig *location_config)
+{
+    if (!location_config)
+        return IO_QUEUE_FILE;
+    const std::string &method = request.getMethod();
+    const std::string &path = request.getPath();
+    bool allowed = false;
+    for (size_t i = 0; i < location_config->methods.size() && !allowed; ++i)
+        allowed = iequals(method, location_config->methods[i]);
+    if (!allowed)
+        return IO_QUEUE_FILE;
+    if (!location_config->redirect.empty() || location_config->status_page != STATUS_PAGE_NONE)
+        return IO_QUEUE_NONE;
+    if (path == "/setmode" && iequals(method, "GET"))
+        return IO_QUEUE_NONE;
+    // 확장자만 보므로 realpath 전의 요청 경로로도 같은 판단이 됩니다.
+    if (ResponseHandler::isCGIRequest(path, *location_config))
+        return IO_QUEUE_CGI;
+    if (path == "/filelist" || path == "/filelist/all")
+        return IO_QUEUE_DIRECTORY;
+    // autoindex의 디렉터리 주소 (파일 요청과 섞이지 않도록 목록은 directory 대기열에서)
+    if (location_config->directory_listing &&
+        (path == location_config->path || (!path.empty() && path[path.size() - 1] == '/')))
+        return IO_QUEUE_DIRECTORY;
+    if (iequals(method, "POST") || ResumableUpload::isRequest(request, *location_config))
+        return IO_QUEUE_UPLOAD;
+    return IO_QUEUE_FILE;
+}
+
 bool Response::validateMethod(const Request &request, const LocationConfig &location_config)
 {
     //using namespace ResponseUtils;
@@ -171,26 +355,7 @@ std::string Response::readErrorPageFromFile(const std::string &file_path, int st
 Response Response::createErrorResponse(const int status, const ServerConfig &server_config)
 {
     Response res;
-    std::string status_text;
-    if (status == 400)
-        status_text = NOT_FOUND_400;
-    else if (status == 413)
-        status_text = PAYLOAD_TOO_LARGE_413;
-    else if (status == 301)
-        status_text = REDIRECTION_301;
-    else if (status == 404)
-        status_text = BAD_REQUEST_404;
-    else if (status == 405)
-        status_text = METHOD_NOT_ALLOWED_405;
-    else if (status == 500)
-        status_text = INTERNAL_SERVER_ERROR_500;
-    else
-    {
-        std::stringstream ss;
-        ss << status;
-        status_text = ss.str() + " Error";
-    }
-    res.setStatus(status_text);
+    res.setStatus(status);
     res.setHeader("Content-Type", "text/html");
 
     std::map<int, std::string>::const_iterator serv_it = server_config.error_pages.find(status);
@@ -202,10 +367,6 @@ Response Response::createErrorResponse(const int status, const ServerConfig &ser
                                        ": " + strerror(errno));
         std::string default_error = ss.str();
         res.setBody(default_error);
-
-        std::stringstream ss_len;
-        ss_len << default_error.size();
-        res.setHeader("Content-Length", ss_len.str());
         return res;
     }
 
@@ -213,11 +374,6 @@ Response Response::createErrorResponse(const int status, const ServerConfig &ser
     std::string file_content = readErrorPageFromFile(error_file_path, status);
 
     res.setBody(file_content);
-    {
-        std::stringstream ss_len;
-        ss_len << file_content.size();
-        res.setHeader("Content-Length", ss_len.str());
-    }
-    LogConfig::reportError(status, status_text);
+    LogConfig::reportError(status, HttpStatus::reason(status));
     return res;
 }
@@ -1,9 +1,15 @@
 #include "ResponseHandlers.hpp"
 #include "CGIHandler.hpp"
+#include "DirectoryListing.hpp"
 #include "Log.hpp"
+#include "Metrics.hpp"
+#include "MimeTypes.hpp"
+#include "RequestTiming.hpp"
 #include "Response.hpp"
 #include "ResponseUtils.hpp" // ResponseUtil 클래스 포함
+#include "Sha256.hpp"
 #include "Utils.hpp"
+#include <cstdlib>
 #include <cstring>
 #include <errno.h>
 #include <iostream>
@@ -16,21 +22,29 @@ Response ResponseHandler::handleRedirection(const LocationConfig &location_confi
     LogConfig::reportSuccess(302, "Moved Permanently");
 
     Response res;
-    res.setStatus("301 Moved Permanently");
+    res.setStatus(301);
     res.setHeader("Location", location_config.redirect);
     res.setHeader("Cache-Control", "max-age=20, public");
     std::string body = "<h1>301 Moved Permanently</h1>";
     res.setBody(body);
-    std::stringstream ss;
-    ss << body.size();
-    res.setHeader("Content-Length", ss.str());
     res.setHeader("Content-Type", "text/html");
     return res;
 }
 
 
+// 설정을 읽을 때 만든 확장자별 인터프리터 표에서 찾습니다. (없으면 end)
+static std::map<std::string, std::string>::const_iterator findInterpreter(const std::string &real_path,
+                                                                          const LocationConfig &location_config)
+{
+    const std::map<std::string, std::string> &interpreters = location_config.cgi_interpreters;
+    size_t dot = real_path.find_last_of('.');
+    if (interpreters.empty() || dot == std::string::npos)
+        return interpreters.end();
+    return interpreters.find(toLower(real_path.substr(dot + 1)));
+}
+
 Response ResponseHandler::handleCGI(const Request &request, const std::string &real_path,
-                                    const ServerConfig &server_config)
+                                    const LocationConfig &location_config, const ServerConfig &server_config)
 {
     // Create a copy of real_path
     std::string real_path_copy = real_path;
@@ -54,60 +68,72 @@ Response ResponseHandler::handleCGI(const Request &request, const std::string &r
         return Response::createErrorResponse(404, server_config);
     }
 
-    Response res;
-    CGIHandler cgi_handler;
-    std::string cgi_output, cgi_content_type;
+    std::map<std::string, std::string>::const_iterator interpreter = findInterpreter(real_path_copy, location_config);
+    if (interpreter == location_config.cgi_interpreters.end() || interpreter->second.empty())
+    {
+        LogConfig::reportInternalError("No CGI interpreter for " + real_path_copy);
+        return Response::createErrorResponse(500, server_config);
+    }
 
-    if (!cgi_handler.execute(request, real_path_copy, cgi_output, cgi_content_type))
+    CGIHandler cgi_handler;
+    CgiHeaders headers;
+
+    RequestTiming::markCurrent(PHASE_UPSTREAM_START);
+    uint64_t cgi_start = monotonicMicros();
+    CgiStream *stream = cgi_handler.execute(request, real_path_copy, interpreter->second, server_config, headers);
+    // 헤더까지 읽은 시각 (본문을 다 보내면 이벤트 루프가 다시 기록)
+    RequestTiming::markCurrent(PHASE_UPSTREAM_END);
+    if (!stream)
+    {
+        Metrics::observeCgi(monotonicMicros() - cgi_start, false);
         return Response::createErrorResponse(500, server_config);
+    }
 
-    // Parse CGI output
-    size_t pos = cgi_output.find("\r\n\r\n");
-    
-    if (pos != std::string::npos)
+    // 스크립트가 보낸 헤더를 그대로 옮기되, Status는 상태 코드로 쓰고 본문 구분은 서버가 정합니다.
+    Response res;
+    res.setStatus(200);
+    bool has_status = false, has_location = false, has_type = false, has_length = false;
+    for (CgiHeaders::const_iterator it = headers.begin(); it != headers.end(); ++it)
     {
-        std::string headers_part = cgi_output.substr(0, pos);
-        std::string body_part = cgi_output.substr(pos + 4);
-        std::istringstream iss(headers_part);
-        std::string line;
-        while (std::getline(iss, line))
+        const std::string &key = it->first;
+        if (iequals(key, "Status"))
         {
-            if (!line.empty() && line[line.size() - 1] == '\r')
-                line.resize(line.size() - 1);
-            size_t colon = line.find(':');
-
-            if (colon != std::string::npos)
+            int status = std::atoi(it->second.c_str());
+            if (status >= 100 && status <= 599)
             {
-                std::string key = trim(line.substr(0, colon));
-                std::string value = trim(line.substr(colon + 1));
-                res.setHeader(key, value);
+                res.setStatus(status);
+                has_status = true;
             }
+            continue;
         }
-
-        res.setStatus("200 SUCCESS");
-        res.setBody(body_part);
-
-        std::stringstream ss;
-        ss << body_part.size();
-        res.setHeader("Content-Length", ss.str());
-
-        if (!cgi_content_type.empty())
-            res.setHeader("Content-Type", cgi_content_type);
-
+        if (iequals(key, "Transfer-Encoding") || iequals(key, "Connection"))
+            continue;
+        if (iequals(key, "Location"))
+            has_location = true;
+        else if (iequals(key, "Content-Type"))
+            has_type = true;
+        else if (iequals(key, "Content-Length"))
+            has_length = true;
+        res.addHeader(key, it->second);
     }
-    else
-    {
-        res.setStatus("200 OK");
-        res.setBody(cgi_output);
-
-        std::stringstream ss;
-        ss << cgi_output.size();
-
-        res.setHeader("Content-Length", ss.str());
+    if (has_location && !has_status)
+        res.setStatus(302);
+    // 1xx/204/304는 본문이 없으므로 Content-Type을 채우거나 chunked로 감싸지 않습니다.
+    int status = res.getStatusCode();
+    bool bodyless = status < 200 || status == 204 || status == 304;
+    if (!has_type && !bodyless)
         res.setHeader("Content-Type", "text/html");
+    // 길이를 모르면 HTTP/1.1은 chunked로 보냅니다. 그 밖에는 다 보낸 뒤 연결을 닫습니다. (스크립트가 적은 길이를 믿지 않음)
+    if (!has_length && !bodyless && request.getHTTPVersion() == "HTTP/1.1")
+    {
+        stream->chunked = true;
+        res.setHeader("Transfer-Encoding", "chunked");
     }
+    // 본문이 없는 상태여도 요청 본문을 stdin에 다 쓰고 스크립트가 끝날 때까지 출력을 읽어 버립니다.
+    stream->discard = bodyless;
+    res.setStreamBody(stream);
 
-    LogConfig::reportSuccess(200, "SUCCESS");
+    LogConfig::reportSuccess(res.getStatusCode(), "SUCCESS");
 
     return res;
 
@@ -116,6 +142,21 @@ Response ResponseHandler::handleCGI(const Request &request, const std::string &r
 Response ResponseHandler::handleStaticFile(const std::string &real_path, const ServerConfig &server_config)
 {
     Response res;
+    // 캐시 대상 크기의 파일은 매핑을 공유해 송신 버퍼로 복사하지 않고 보냅니다.
+    struct stat st;
+    if (stat(real_path.c_str(), &st) == 0)
+    {
+        if (MappedFile *file = FileCache::acquire(real_path, st))
+        {
+            res.setStatus(200);
+            res.setFileBody(file);
+            // 매핑할 때 찾아 둔 타입을 씁니다. (그 뒤 types 표가 바뀌었으면 다시 찾음)
+            res.setHeader("Content-Type", file->mime_generation == MimeTypes::generation() ? *file->mime
+                                                                                         : MimeTypes::lookup(real_path));
+            LogConfig::reportSuccess(200, "SUCCESS");
+            return res;
+        }
+    }
     int fd = open(real_path.c_str(), O_RDONLY);
     if (fd == -1)
     {
@@ -134,11 +175,8 @@ Response ResponseHandler::handleStaticFile(const std::string &real_path, const S
         return Response::createErrorResponse(500, server_config);
     }
     std::string content_type = getMimeType(real_path);
-    res.setStatus("200 OK");
+    res.setStatus(200);
     res.setBody(file_content);
-    std::stringstream ss;
-    ss << file_content.size();
-    res.setHeader("Content-Length", ss.str());
     res.setHeader("Content-Type", content_type);
     LogConfig::reportSuccess(200, "SUCCESS");
     return res;
@@ -173,6 +211,7 @@ Response ResponseHandler::handleUpload(const std::string &real_path, const Reque
     // Allowed file extensions
     const std::vector<std::string> &allowed_extensions = location_config.allowed_extensions;
     std::vector<std::string> uploaded_filenames;
+    std::string digests;
 
     // Determine the effective client body size limit.
     // If location_config.client_max_body_size is set (non-zero), use it;
@@ -201,18 +240,58 @@ Response ResponseHandler::handleUpload(const std::string &real_path, const Reque
         }
 
         // Save the file if the extension is valid
-        if (!ResponseUtil::saveUploadedFile(upload_dir, *it, sanitized_filename))
+        std::string digest;
+        bool saved = location_config.upload_store
+                         ? ResponseUtil::storeUploadedFile(upload_dir, *it, sanitized_filename, digest,
+                                                           location_config.upload_fsync)
+                         : ResponseUtil::saveUploadedFile(upload_dir, *it, sanitized_filename,
+                                                          location_config.upload_fsync);
+        if (!saved)
         {
             LogConfig::reportInternalError("Failed to save file: " + sanitized_filename);
             return Response::createErrorResponse(500, server_config);
         }
+        if (!digest.empty())
+            digests += (digests.empty() ? "sha256=" : ", sha256=") + digest;
 
         // Add to the list of successfully uploaded filenames
         uploaded_filenames.push_back(sanitized_filename);
     }
 
     // Handle static file response (or other post-upload logic)
-    return handleStaticFile(real_path, server_config);
+    Response res = handleStaticFile(real_path, server_config);
+    // 클라이언트는 이 값으로 다음에 같은 내용을 올리기 전에 ?digest= 로 확인할 수 있습니다.
+    if (!digests.empty())
+        res.setHeader("X-Upload-Digest", digests);
+    return res;
+}
+
+// upload_store: HEAD/GET ?digest=<sha256> 에 그 내용이 이미 저장되어 있으면 200, 없으면 404로 답합니다.
+Response ResponseHandler::handleUploadProbe(const Request &request, const LocationConfig &location_config,
+                                            const ServerConfig &server_config)
+{
+    const HeaderMap &params = request.getQueryParams();
+    HeaderMap::const_iterator it = params.find("digest");
+    std::string digest = it->second;
+    if (digest.compare(0, 7, "sha256=") == 0)
+        digest.erase(0, 7);
+    if (!Sha256::isHexDigest(digest))
+        return Response::createErrorResponse(400, server_config);
+    std::string upload_dir;
+    if (!ResponseUtil::getUploadDirectory(location_config, server_config, upload_dir))
+        return Response::createErrorResponse(500, server_config);
+    bool exists = ResponseUtil::blobExists(upload_dir, digest);
+    std::string body = std::string("{ \"digest\": \"sha256=") + digest + "\", \"exists\": " +
+                       (exists ? "true" : "false") + " }";
+    Response res;
+    res.setStatus(exists ? 200 : 404);
+    res.setHeader("Content-Type", "application/json; charset=UTF-8");
+    res.setHeader("X-Upload-Digest", "sha256=" + digest);
+    // HEAD는 GET과 같은 헤더에 본문만 뺍니다.
+    res.setHeader("Content-Length", sizeToString(body.size()));
+    if (!iequals(request.getMethod(), "HEAD"))
+        res.setBody(body);
+    return res;
 }
 
 
@@ -234,13 +313,14 @@ Response ResponseHandler::handleFileList(const Request &request, const LocationC
 Response ResponseHandler::handleDeleteFile(const Request &request, const LocationConfig &location_config,
                                            const ServerConfig &server_config)
 {
-    std::map<std::string, std::string> queryParams = request.getQueryParams();
-    if (queryParams.find("filename") == queryParams.end())
+    const HeaderMap &queryParams = request.getQueryParams();
+    HeaderMap::const_iterator filename_it = queryParams.find("filename");
+    if (filename_it == queryParams.end())
     {
         LogConfig::reportInternalError("filename parameter in DELETE is required.");
         return Response::createErrorResponse(400, server_config);
     }
-    std::string filename = queryParams["filename"];
+    const std::string &filename = filename_it->second;
     std::string sanitized_filename = sanitizeFilename(filename);
     if (!isValidFilename(sanitized_filename))
     {
@@ -251,9 +331,8 @@ Response ResponseHandler::handleDeleteFile(const Request &request, const Locatio
         return Response::createErrorResponse(500, server_config);
     std::string responseBody = "{ \"message\": \"File successfully deleted.\" }";
     Response res;
-    res.setStatus("200 OK");
+    res.setStatus(200);
     res.setHeader("Content-Type", "application/json; charset=UTF-8");
-    res.setHeader("Content-Length", intToString(responseBody.size()));
     res.setBody(responseBody);
     return res;
 }
@@ -264,27 +343,54 @@ Response ResponseHandler::handleDeleteAllFiles(const LocationConfig &location_co
         return Response::createErrorResponse(500, server_config);
     std::string responseBody = "{ \"message\": \"All files successfully deleted.\" }";
     Response res;
-    res.setStatus("200 OK");
+    res.setStatus(200);
     res.setHeader("Content-Type", "application/json; charset=UTF-8");
-    res.setHeader("Content-Length", intToString(responseBody.size()));
     res.setBody(responseBody);
     return res;
 }
 
 Response ResponseHandler::handleGetFileList(const LocationConfig &location_config, const ServerConfig &server_config)
 {
-    std::vector<std::string> files;
-    if (!ResponseUtil::listUploadedFiles(location_config.upload_directory, files))
+    std::string jsonContent;
+    if (!DirectoryListing::renderFileList(location_config.upload_directory, jsonContent))
         return Response::createErrorResponse(404, server_config);
-    std::string jsonContent = ResponseUtil::generateFileListJSON(files);
     Response res;
-    res.setStatus("200 OK");
+    res.setStatus(200);
     res.setHeader("Content-Type", "application/json; charset=UTF-8");
-    res.setHeader("Content-Length", intToString(jsonContent.size()));
     res.setBody(jsonContent);
     return res;
 }
 
+// autoindex: 디렉터리 목록을 HTML 또는 JSON(?format=json)으로 한 페이지씩 보냅니다.
+Response ResponseHandler::handleAutoindex(const Request &request, const std::string &real_path,
+                                          const ServerConfig &server_config)
+{
+    const std::string &path = request.getPath();
+    Response res;
+    // 목록의 상대 링크가 이 디렉터리를 기준으로 하도록 '/'로 끝나는 주소로 보냅니다.
+    if (path.empty() || path[path.size() - 1] != '/')
+    {
+        std::string location = path + "/";
+        if (!request.getQueryString().empty())
+            location += "?" + request.getQueryString();
+        res.setStatus(301);
+        res.setHeader("Location", location);
+        res.setBody("<h1>301 Moved Permanently</h1>");
+        res.setHeader("Content-Type", "text/html");
+        return res;
+    }
+    ListingQuery query = DirectoryListing::parseQuery(request.getQueryParams());
+    std::string body;
+    if (!DirectoryListing::render(real_path, path, query, body))
+        return Response::createErrorResponse(403, server_config);
+    res.setStatus(200);
+    res.setHeader("Content-Type",
+                  query.format == LISTING_JSON ? "application/json; charset=UTF-8" : "text/html; charset=UTF-8");
+    res.setBody(body);
+    LogConfig::reportSuccess(200, "SUCCESS");
+    return res;
+}
+
 Response ResponseHandler::handleMethodNotAllowed(const LocationConfig &location_config,
                                                  const ServerConfig &server_config)
 {
@@ -317,22 +423,7 @@ bool ResponseHandler::validateMethod(const Request &request, const LocationConfi
 // 추가: isCGIRequest
 bool ResponseHandler::isCGIRequest(const std::string &real_path, const LocationConfig &location_config)
 {
-
-    if (!location_config.cgi_extension.empty())
-    {
-        std::string ext = real_path.substr(real_path.find_last_of('.') + 1);
-
-        for (std::vector<std::string>::const_iterator it = location_config.cgi_extension.begin(); it != location_config.cgi_extension.end(); ++it)
-        {
-            std::string cgi_ext = *it;
-            if (cgi_ext[0] == '.') // Remove the dot if present
-                cgi_ext = cgi_ext.substr(1);
-            if (iequals(ext, cgi_ext))
-                return true;
-        }
-
-    }
-    return false;
+    return findInterpreter(real_path, location_config) != location_config.cgi_interpreters.end();
 }
 
 Response ResponseHandler::handleQuery(const std::string &real_path, const Request &request,
@@ -360,7 +451,7 @@ Response ResponseHandler::handleQuery(const std::string &real_path, const Reques
 
     // 쿼리 파라미터를 가져옵니다.
     // 여기서는 첫 번째 쿼리 파라미터만 사용한다고 가정합니다.
-    std::map<std::string, std::string> params = request.getQueryParams();
+    const HeaderMap &params = request.getQueryParams();
     std::string key = "";
     std::string value = "";
     if (!params.empty())
@@ -385,12 +476,9 @@ Response ResponseHandler::handleQuery(const std::string &real_path, const Reques
 
     // MIME 타입 설정 (HTML)
     std::string content_type = "text/html; charset=UTF-8";
-    res.setStatus("200 OK");
+    res.setStatus(200);
     res.setBody(file_content);
 
-    std::stringstream ss;
-    ss << file_content.size();
-    res.setHeader("Content-Length", ss.str());
     res.setHeader("Content-Type", content_type);
 
     LogConfig::reportSuccess(200, "SUCCESS");
@@ -402,10 +490,11 @@ Response ResponseHandler::handleCookieAndSession(const Request &request)
     Response res;
     
     // 쿼리 파라미터에서 "mode" 값을 가져옵니다. (없으면 기본값 "day")
-    std::map<std::string, std::string> queryParams = request.getQueryParams();
+    const HeaderMap &queryParams = request.getQueryParams();
     std::string mode = "day";
-    if (queryParams.find("mode") != queryParams.end()) {
-        mode = queryParams["mode"];
+    HeaderMap::const_iterator mode_it = queryParams.find("mode");
+    if (mode_it != queryParams.end()) {
+        mode = mode_it->second;
     }
     
     // mode 쿠키를 설정 (7일 유효, Path=/)
@@ -413,11 +502,8 @@ Response ResponseHandler::handleCookieAndSession(const Request &request)
     res.setHeader("Set-Cookie", cookie);
     
     std::string body = "Cookie set to " + mode;
-    res.setStatus("200 OK");
+    res.setStatus(200);
     res.setBody(body);
-    std::stringstream ss;
-    ss << body.size();
-    res.setHeader("Content-Length", ss.str());
     res.setHeader("Content-Type", "text/plain");
 
     LogConfig::reportSuccess(200, "Cookie delivered: " + mode);
@@ -478,12 +564,28 @@ Response ResponseHandler::handlePost(const Request &request,
     // 응답 생성
     Response res;
     std::string content_type = getMimeType(real_path);
-    res.setStatus("200 OK");
+    res.setStatus(200);
     res.setBody(file_content);
-    std::stringstream ss;
-    ss << file_content.size();
-    res.setHeader("Content-Length", ss.str());
     res.setHeader("Content-Type", content_type);
     LogConfig::reportSuccess(200, "SUCCESS");
     return res;
 }
+
+Response ResponseHandler::handleStatusPage(const LocationConfig &location_config)
+{
+    Response res;
+    std::string body;
+    if (location_config.status_page == STATUS_PAGE_PROMETHEUS)
+    {
+        Metrics::renderPrometheus(body);
+        res.setHeader("Content-Type", "text/plain; version=0.0.4");
+    }
+    else
+    {
+        Metrics::renderStubStatus(body);
+        res.setHeader("Content-Type", "text/plain");
+    }
+    res.setHeader("Cache-Control", "no-store");
+    res.setBody(body);
+    return res;
+}
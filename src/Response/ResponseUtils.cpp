@@ -1,8 +1,11 @@
 #include "ResponseUtils.hpp"
 #include "Log.hpp"
+#include "Sha256.hpp"
+#include "UploadSync.hpp"
 #include "Utils.hpp"
 #include <dirent.h>
 #include <errno.h>
+#include <fcntl.h>
 #include <iostream>
 #include <sstream>
 #include <string.h>
@@ -86,20 +89,6 @@ std::string ResponseUtil::buildRequestedPath(const std::string &original_path, c
     return requested_path;
 }
 
-std::string ResponseUtil::generateFileListJSON(const std::vector<std::string> &files)
-{
-    std::ostringstream json;
-    json << "{ \"files\": [";
-    for (size_t i = 0; i < files.size(); ++i)
-    {
-        json << "\"" << files[i] << "\"";
-        if (i != files.size() - 1)
-            json << ", ";
-    }
-    json << "] }";
-    return json.str();
-}
-
 bool ResponseUtil::createSingleDir(const std::string &path)
 {
     struct stat sb;
@@ -188,64 +177,213 @@ bool ResponseUtil::isFileExtensionAllowed(const std::string &filename,
     return isAllowedExtension(filename, allowed_extensions);
 }
 
-bool ResponseUtil::saveUploadedFile(const std::string &upload_dir, const UploadedFile &file,
-                                    std::string &sanitized_filename)
+static bool writeAll(int fd, const char *data, size_t len)
+{
+    while (len > 0)
+    {
+        ssize_t n = write(fd, data, len);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return false;
+        data += n;
+        len -= n;
+    }
+    return true;
+}
+
+static bool syncDirectory(const std::string &dir)
+{
+    int fd = open(dir.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd < 0)
+        return false;
+    bool ok = fsync(fd) == 0;
+    close(fd);
+    return ok;
+}
+
+// upload_fsync 정책대로 이름을 붙이기 전의 내용을 디스크에 내려 씁니다.
+static bool syncUpload(int fd, const std::string &target, UploadFsync policy)
+{
+    if (policy == UPLOAD_FSYNC_FILE && fsync(fd) != 0)
+    {
+        LogConfig::reportInternalError("fsync failed for " + target + ": " + strerror(errno));
+        return false;
+    }
+    if (policy == UPLOAD_FSYNC_BATCHED && !UploadSync::commit(fd))
+    {
+        LogConfig::reportInternalError("Batched fsync failed for " + target);
+        return false;
+    }
+    return true;
+}
+
+// 다른 프로세스(바이너리 교체 중)와도 겹치지 않는 임시 이름
+static std::string tempName(const std::string &dir)
 {
-    std::string file_path = upload_dir + "/" + sanitized_filename;
-    std::ofstream ofs(file_path.c_str(), std::ios::binary);
+    static unsigned long counter = 0;
+    unsigned long n = __atomic_add_fetch(&counter, 1, __ATOMIC_RELAXED);
+    return dir + "/.upload-" + sizeToString(getpid()) + "-" + sizeToString(n);
+}
 
+// 내용을 이름 없는 파일(O_TMPFILE, 안 되면 임시 이름)에 다 쓰고, fsync 정책을 따른 뒤 rename으로 target과 바꿉니다.
+// 읽는 쪽은 이전 파일이나 완성된 새 파일만 보게 되고, 하드 링크된 blob이나 매핑 캐시가 잡은 파일도 덮어쓰지 않습니다.
+static bool writeFileAtomic(const std::string &dir, const std::string &target, const std::vector<char> &data,
+                            UploadFsync policy)
+{
+    std::string tmp = tempName(dir);
+    bool anonymous = true;
+    int fd = open(dir.c_str(), O_WRONLY | O_TMPFILE | O_CLOEXEC, 0644);
+    if (fd < 0)
+    {
+        anonymous = false;
+        fd = open(tmp.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0644);
+    }
+    if (fd < 0)
+    {
+        LogConfig::reportInternalError("Failed to open file for writing: " + target + ": " + strerror(errno));
+        return false;
+    }
+    // 크기를 알고 있으므로 한 번에 자리를 잡아 조각나지 않게 합니다. (지원하지 않는 파일 시스템은 그냥 씁니다)
+    if (!data.empty() && fallocate(fd, 0, 0, data.size()) != 0 && errno != EOPNOTSUPP && errno != ENOSYS)
+    {
+        LogConfig::reportInternalError("Failed to preallocate " + target + ": " + strerror(errno));
+        close(fd);
+        if (!anonymous)
+            unlink(tmp.c_str());
+        return false;
+    }
+    bool ok = writeAll(fd, data.empty() ? NULL : &data[0], data.size());
+    if (!ok)
+        LogConfig::reportInternalError("Failed to write to file: " + target + ": " + strerror(errno));
+    else
+        ok = syncUpload(fd, target, policy);
+    if (ok && anonymous)
+    {
+        std::string proc = "/proc/self/fd/" + intToString(fd);
+        if (linkat(AT_FDCWD, proc.c_str(), AT_FDCWD, tmp.c_str(), AT_SYMLINK_FOLLOW) != 0)
+        {
+            LogConfig::reportInternalError("Failed to link " + target + ": " + strerror(errno));
+            ok = false;
+        }
+    }
+    if (close(fd) != 0)
+        ok = false;
+    if (ok && rename(tmp.c_str(), target.c_str()) != 0)
+    {
+        LogConfig::reportInternalError("Failed to rename " + tmp + " to " + target + ": " + strerror(errno));
+        ok = false;
+    }
+    if (!ok)
+    {
+        unlink(tmp.c_str());
+        return false;
+    }
+    if (policy == UPLOAD_FSYNC_FILE && !syncDirectory(dir))
+    {
+        LogConfig::reportInternalError("fsync failed for directory " + dir + ": " + strerror(errno));
+        return false;
+    }
+    return true;
+}
+
+bool ResponseUtil::saveUploadedFile(const std::string &upload_dir, const UploadedFile &file,
+                                    std::string &sanitized_filename, UploadFsync fsync_policy)
+{
     // Check if the directory is writable
     if (access(upload_dir.c_str(), W_OK) != 0)
     {
         LogConfig::reportInternalError("Upload directory is not writable: " + upload_dir);
         return false;
     }
+    return writeFileAtomic(upload_dir, upload_dir + "/" + sanitized_filename, file.data, fsync_policy);
+}
 
-    if (!ofs.is_open())
+bool ResponseUtil::commitUploadedFile(int fd, const std::string &path, const std::string &upload_dir,
+                                      const std::string &sanitized_filename, UploadFsync fsync_policy)
+{
+    std::string target = upload_dir + "/" + sanitized_filename;
+    if (!syncUpload(fd, target, fsync_policy))
+        return false;
+    // rename과 달리 link는 이미 있는 이름(upload_store의 하드 링크일 수도 있음)을 덮어쓰지 않습니다.
+    if (link(path.c_str(), target.c_str()) != 0)
     {
-        LogConfig::reportInternalError("Failed to open file for writing: " + file_path + ": " + strerror(errno));
+        if (errno != EEXIST)
+            LogConfig::reportInternalError("Failed to link " + path + " to " + target + ": " + strerror(errno));
         return false;
     }
-    if (!file.data.empty())
+    unlink(path.c_str());
+    if (fsync_policy == UPLOAD_FSYNC_FILE && !syncDirectory(upload_dir))
     {
-        ofs.write(&file.data[0], file.data.size());
-        if (ofs.fail())
-        {
-            LogConfig::reportInternalError("Failed to write to file: " + file_path);
-            ofs.close();
-            return false;
-        }
+        LogConfig::reportInternalError("fsync failed for directory " + upload_dir + ": " + strerror(errno));
+        return false;
     }
-    ofs.close();
     return true;
 }
 
-bool ResponseUtil::listUploadedFiles(const std::string &upload_dir, std::vector<std::string> &files)
+static std::string blobPath(const std::string &upload_dir, const std::string &digest)
 {
-    DIR *dir;
-    struct dirent *ent;
-    if ((dir = opendir(upload_dir.c_str())) != NULL)
+    return upload_dir + "/" UPLOAD_BLOB_DIR "/" + digest.substr(0, 2) + "/" + digest.substr(2);
+}
+
+bool ResponseUtil::storeUploadedFile(const std::string &upload_dir, const UploadedFile &file,
+                                     const std::string &sanitized_filename, std::string &digest,
+                                     UploadFsync fsync_policy)
+{
+    digest = Sha256::hex(file.data.empty() ? NULL : &file.data[0], file.data.size());
+    std::string blob_dir = upload_dir + "/" UPLOAD_BLOB_DIR "/" + digest.substr(0, 2);
+    std::string blob = blobPath(upload_dir, digest);
+    if (!ensureDirectoryExists(blob_dir))
     {
-        while ((ent = readdir(dir)) != NULL)
+        LogConfig::reportInternalError("Failed to ensure blob directory exists: " + blob_dir + ": " + strerror(errno));
+        return false;
+    }
+    struct stat st;
+    if (stat(blob.c_str(), &st) != 0 || !S_ISREG(st.st_mode) ||
+        static_cast<size_t>(st.st_size) != file.data.size())
+    {
+        if (!writeFileAtomic(blob_dir, blob, file.data, fsync_policy))
+            return false;
+    }
+
+    // 이미 같은 blob을 가리키면 할 일이 없습니다. (같은 파일끼리의 rename은 임시 링크를 남깁니다)
+    std::string target = upload_dir + "/" + sanitized_filename;
+    struct stat cur;
+    if (stat(blob.c_str(), &st) == 0 && lstat(target.c_str(), &cur) == 0 && cur.st_dev == st.st_dev &&
+        cur.st_ino == st.st_ino)
+        return true;
+    // 임시 이름으로 링크한 뒤 rename으로 바꿔 끼우므로 기존 이름이 잠깐이라도 사라지지 않습니다.
+    std::string tmp = tempName(blob_dir);
+    if (link(blob.c_str(), tmp.c_str()) != 0)
+    {
+        // 링크 수 한도나 하드 링크를 지원하지 않는 파일 시스템: 복사본으로 저장합니다.
+        if (errno == EMLINK || errno == EPERM || errno == EXDEV)
         {
-            if (strcmp(ent->d_name, ".") == 0 || strcmp(ent->d_name, "..") == 0)
-                continue;
-            std::string filePath = upload_dir + "/" + ent->d_name;
-            struct stat st;
-            if (stat(filePath.c_str(), &st) == 0)
-            {
-                if (S_ISREG(st.st_mode))
-                    files.push_back(ent->d_name);
-            }
+            std::string copy_name = sanitized_filename;
+            return saveUploadedFile(upload_dir, file, copy_name, fsync_policy);
         }
-        closedir(dir);
-        return true;
+        LogConfig::reportInternalError("Failed to link blob: " + target + ": " + strerror(errno));
+        return false;
     }
-    else
+    if (rename(tmp.c_str(), target.c_str()) != 0)
     {
-        LogConfig::reportInternalError("Failed to open directory: " + upload_dir + ": " + strerror(errno));
+        LogConfig::reportInternalError("Failed to rename link: " + target + ": " + strerror(errno));
+        unlink(tmp.c_str());
         return false;
     }
+    if (fsync_policy == UPLOAD_FSYNC_FILE && !syncDirectory(upload_dir))
+    {
+        LogConfig::reportInternalError("fsync failed for directory " + upload_dir + ": " + strerror(errno));
+        return false;
+    }
+    return true;
+}
+
+bool ResponseUtil::blobExists(const std::string &upload_dir, const std::string &digest)
+{
+    struct stat st;
+    return Sha256::isHexDigest(digest) && stat(blobPath(upload_dir, digest).c_str(), &st) == 0 &&
+           S_ISREG(st.st_mode);
 }
 
 std::string ResponseUtil::generateSuccessResponse(const std::string &jsonContent)
@@ -269,6 +407,44 @@ bool ResponseUtil::deleteUploadedFile(const std::string &upload_dir, const std::
     return true;
 }
 
+// 어떤 이름도 링크하지 않는 (링크 수 1) blob을 지웁니다. 쓰는 중인 임시 파일(.tmp-, .link-)은 건드리지 않습니다.
+static bool sweepBlobs(const std::string &upload_dir)
+{
+    std::string root = upload_dir + "/" UPLOAD_BLOB_DIR;
+    DIR *top = opendir(root.c_str());
+    if (!top)
+        return errno == ENOENT;
+    bool ok = true;
+    struct dirent *shard;
+    while ((shard = readdir(top)) != NULL)
+    {
+        if (shard->d_name[0] == '.')
+            continue;
+        std::string shard_dir = root + "/" + shard->d_name;
+        DIR *dir = opendir(shard_dir.c_str());
+        if (!dir)
+            continue;
+        struct dirent *ent;
+        while ((ent = readdir(dir)) != NULL)
+        {
+            if (ent->d_name[0] == '.')
+                continue;
+            std::string blob = shard_dir + "/" + ent->d_name;
+            struct stat st;
+            if (lstat(blob.c_str(), &st) == 0 && S_ISREG(st.st_mode) && st.st_nlink == 1 &&
+                unlink(blob.c_str()) != 0)
+            {
+                LogConfig::reportInternalError("Failed to delete blob: " + blob + ": " + strerror(errno));
+                ok = false;
+            }
+        }
+        closedir(dir);
+        rmdir(shard_dir.c_str()); // 비었을 때만 지워집니다.
+    }
+    closedir(top);
+    return ok;
+}
+
 bool ResponseUtil::deleteAllUploadedFiles(const std::string &upload_dir)
 {
     DIR *dir;
@@ -292,6 +468,8 @@ bool ResponseUtil::deleteAllUploadedFiles(const std::string &upload_dir)
             }
         }
         closedir(dir);
+        if (!sweepBlobs(upload_dir))
+            allDeleted = false;
         return allDeleted;
     }
     else
@@ -0,0 +1,495 @@
+#include "ResumableUpload.hpp"
+#include "Log.hpp"
+#include "ResponseUtils.hpp"
+#include "Utils.hpp"
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <dirent.h>
+#include <fcntl.h>
+#include <fstream>
+#include <map>
+#include <pthread.h>
+#include <set>
+#include <sstream>
+#include <strings.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define TUS_VERSION "1.0.0"
+#define SESSION_ID_BYTES 16
+
+struct SessionInfo
+{
+    unsigned long length;
+    unsigned long offset;
+    std::string filename;
+};
+
+static const std::string *findHeader(const Request &request, const char *name)
+{
+    const HeaderMap &headers = request.getHeaders();
+    for (HeaderMap::const_iterator it = headers.begin(); it != headers.end(); ++it)
+    {
+        if (strcasecmp(it->first.c_str(), name) == 0)
+            return &it->second;
+    }
+    return NULL;
+}
+
+// 부호나 공백 없는 10진수만 받습니다.
+static bool parseOffset(const std::string &value, unsigned long &out)
+{
+    if (value.empty() || value.size() > 19)
+        return false;
+    out = 0;
+    for (size_t i = 0; i < value.size(); ++i)
+    {
+        if (value[i] < '0' || value[i] > '9')
+            return false;
+        out = out * 10 + (value[i] - '0');
+    }
+    return true;
+}
+
+static bool base64Decode(const std::string &in, std::string &out)
+{
+    out.clear();
+    unsigned int acc = 0;
+    int bits = 0;
+    for (size_t i = 0; i < in.size(); ++i)
+    {
+        char c = in[i];
+        int v;
+        if (c >= 'A' && c <= 'Z')
+            v = c - 'A';
+        else if (c >= 'a' && c <= 'z')
+            v = c - 'a' + 26;
+        else if (c >= '0' && c <= '9')
+            v = c - '0' + 52;
+        else if (c == '+')
+            v = 62;
+        else if (c == '/')
+            v = 63;
+        else if (c == '=')
+            break;
+        else
+            return false;
+        acc = (acc << 6) | v;
+        bits += 6;
+        if (bits >= 8)
+        {
+            bits -= 8;
+            out += static_cast<char>((acc >> bits) & 0xff);
+        }
+    }
+    return true;
+}
+
+// Upload-Metadata: key base64,key base64,...
+static std::string metadataValue(const std::string &metadata, const std::string &key)
+{
+    std::istringstream pairs(metadata);
+    std::string pair;
+    while (std::getline(pairs, pair, ','))
+    {
+        std::istringstream fields(pair);
+        std::string name, encoded, decoded;
+        fields >> name >> encoded;
+        if (name == key && base64Decode(encoded, decoded))
+            return decoded;
+    }
+    return "";
+}
+
+static bool isSessionId(const std::string &id)
+{
+    if (id.size() != SESSION_ID_BYTES * 2)
+        return false;
+    for (size_t i = 0; i < id.size(); ++i)
+    {
+        if (!((id[i] >= '0' && id[i] <= '9') || (id[i] >= 'a' && id[i] <= 'f')))
+            return false;
+    }
+    return true;
+}
+
+static bool newSessionId(std::string &id)
+{
+    unsigned char raw[SESSION_ID_BYTES];
+    int fd = open("/dev/urandom", O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return false;
+    ssize_t n = read(fd, raw, sizeof(raw));
+    close(fd);
+    if (n != static_cast<ssize_t>(sizeof(raw)))
+        return false;
+    static const char digits[] = "0123456789abcdef";
+    id.clear();
+    for (size_t i = 0; i < sizeof(raw); ++i)
+    {
+        id += digits[raw[i] >> 4];
+        id += digits[raw[i] & 15];
+    }
+    return true;
+}
+
+static bool readInfo(const std::string &path, SessionInfo &info)
+{
+    std::ifstream ifs(path.c_str());
+    return ifs && (ifs >> info.length >> info.offset >> info.filename) && info.offset <= info.length;
+}
+
+// 임시 파일에 쓰고 rename하므로 중간에 멈춰도 이전 내용이나 새 내용 중 하나가 남습니다.
+static bool writeInfo(const std::string &path, const SessionInfo &info)
+{
+    std::string tmp = path + ".tmp";
+    {
+        std::ofstream ofs(tmp.c_str(), std::ios::trunc);
+        ofs << info.length << ' ' << info.offset << ' ' << info.filename << '\n';
+        ofs.close();
+        if (ofs.fail())
+        {
+            LogConfig::reportInternalError("Failed to write upload session: " + tmp);
+            unlink(tmp.c_str());
+            return false;
+        }
+    }
+    if (rename(tmp.c_str(), path.c_str()) != 0)
+    {
+        LogConfig::reportInternalError("Failed to save upload session: " + path + ": " + strerror(errno));
+        unlink(tmp.c_str());
+        return false;
+    }
+    return true;
+}
+
+static bool pwriteAll(int fd, const char *data, size_t len, off_t offset)
+{
+    while (len > 0)
+    {
+        ssize_t n = pwrite(fd, data, len, offset);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return false;
+        data += n;
+        len -= n;
+        offset += n;
+    }
+    return true;
+}
+
+static bool isStale(const std::string &path, time_t now)
+{
+    struct stat st;
+    return stat(path.c_str(), &st) != 0 || now - st.st_mtime >= UPLOAD_SESSION_TTL;
+}
+
+// UPLOAD_SESSION_TTL 동안 조각이 오지 않은 세션을 지웁니다. 디렉터리마다 UPLOAD_SESSION_SWEEP에 한 번만 훑고,
+// 지우기 전에 .part 잠금을 잡으므로 PATCH를 처리 중인 세션은 건드리지 않습니다.
+static void expireSessions(const std::string &session_dir)
+{
+    static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+    static std::map<std::string, time_t> last_sweep;
+    time_t now = time(NULL);
+    pthread_mutex_lock(&lock);
+    time_t &last = last_sweep[session_dir];
+    bool due = now - last >= UPLOAD_SESSION_SWEEP;
+    if (due)
+        last = now;
+    pthread_mutex_unlock(&lock);
+    if (!due)
+        return;
+
+    DIR *dir = opendir(session_dir.c_str());
+    if (!dir)
+        return;
+    std::set<std::string> ids;
+    while (struct dirent *entry = readdir(dir))
+    {
+        std::string id = std::string(entry->d_name).substr(0, SESSION_ID_BYTES * 2);
+        if (isSessionId(id))
+            ids.insert(id);
+    }
+    closedir(dir);
+    for (std::set<std::string>::const_iterator it = ids.begin(); it != ids.end(); ++it)
+    {
+        std::string base = session_dir + "/" + *it;
+        if (!isStale(base + ".info", now) || !isStale(base + ".part", now))
+            continue;
+        int fd = open((base + ".part").c_str(), O_WRONLY | O_CLOEXEC);
+        if (fd >= 0 && flock(fd, LOCK_EX | LOCK_NB) != 0)
+        {
+            close(fd);
+            continue;
+        }
+        if (isStale(base + ".info", now) && isStale(base + ".part", now))
+        {
+            unlink((base + ".info").c_str());
+            unlink((base + ".info.tmp").c_str());
+            unlink((base + ".part").c_str());
+        }
+        if (fd >= 0)
+            close(fd);
+    }
+}
+
+static std::string expiresAt(time_t now)
+{
+    time_t expires = now + UPLOAD_SESSION_TTL;
+    struct tm gmt;
+    char buf[64];
+    gmtime_r(&expires, &gmt);
+    return std::string(buf, strftime(buf, sizeof(buf), "%a, %d %b %Y %H:%M:%S GMT", &gmt));
+}
+
+static Response tusResponse(int status)
+{
+    Response res;
+    res.setStatus(status);
+    res.setHeader("Tus-Resumable", TUS_VERSION);
+    res.setHeader("Cache-Control", "no-store");
+    return res;
+}
+
+bool ResumableUpload::isRequest(const Request &request, const LocationConfig &location_config)
+{
+    if (!location_config.upload_resumable)
+        return false;
+    const std::string &method = request.getMethod();
+    return iequals(method, "POST") || iequals(method, "HEAD") || iequals(method, "PATCH") ||
+           iequals(method, "DELETE") || iequals(method, "OPTIONS");
+}
+
+Response ResumableUpload::handle(const Request &request, const LocationConfig &location_config,
+                                 const ServerConfig &server_config)
+{
+    const std::string &method = request.getMethod();
+    if (iequals(method, "OPTIONS"))
+    {
+        Response res = tusResponse(204);
+        res.setHeader("Tus-Version", TUS_VERSION);
+        res.setHeader("Tus-Extension", "creation,expiration,termination");
+        return res;
+    }
+    // Upload-Offset 등은 tus 1.0 의미로만 해석합니다.
+    const std::string *version = findHeader(request, "Tus-Resumable");
+    if (version && *version != TUS_VERSION)
+    {
+        Response res = tusResponse(412);
+        res.setHeader("Tus-Version", TUS_VERSION);
+        return res;
+    }
+
+    std::string upload_dir;
+    if (!ResponseUtil::getUploadDirectory(location_config, server_config, upload_dir))
+        return Response::createErrorResponse(500, server_config);
+    std::string session_dir = upload_dir + "/" UPLOAD_SESSION_DIR;
+    if (!ResponseUtil::ensureDirectoryExists(session_dir))
+    {
+        LogConfig::reportInternalError("Failed to ensure upload session directory exists: " + session_dir + ": " +
+                                       strerror(errno));
+        return Response::createErrorResponse(500, server_config);
+    }
+    expireSessions(session_dir);
+
+    std::string base = trimTrailingSlash(location_config.path);
+    const std::string &path = request.getPath();
+    if (path == base || path == base + "/")
+    {
+        if (iequals(method, "POST"))
+            return create(request, location_config, server_config, upload_dir, session_dir);
+        return Response::createErrorResponse(405, server_config);
+    }
+    std::string id = path.compare(0, base.size() + 1, base + "/") == 0 ? path.substr(base.size() + 1) : "";
+    if (!isSessionId(id))
+        return Response::createErrorResponse(404, server_config);
+    if (iequals(method, "HEAD"))
+        return status(session_dir, id, server_config);
+    if (iequals(method, "PATCH"))
+        return append(request, location_config, server_config, upload_dir, session_dir, id);
+    if (iequals(method, "DELETE"))
+        return terminate(session_dir, id, server_config);
+    return Response::createErrorResponse(405, server_config);
+}
+
+Response ResumableUpload::create(const Request &request, const LocationConfig &location_config,
+                                 const ServerConfig &server_config, const std::string &upload_dir,
+                                 const std::string &session_dir)
+{
+    const std::string *length = findHeader(request, "Upload-Length");
+    const std::string *metadata = findHeader(request, "Upload-Metadata");
+    SessionInfo info;
+    info.offset = 0;
+    if (!length || !parseOffset(*length, info.length))
+        return Response::createErrorResponse(400, server_config);
+    info.filename = sanitizeFilename(metadata ? metadataValue(*metadata, "filename") : "");
+    if (info.filename.empty() || !isValidFilename(info.filename) ||
+        !ResponseUtil::isFileExtensionAllowed(info.filename, location_config.allowed_extensions))
+    {
+        LogConfig::reportInternalError("Invalid resumable upload filename: " + info.filename);
+        return Response::createErrorResponse(400, server_config);
+    }
+    // 이미 있는 업로드를 덮어쓰지 않습니다. 받는 동안 생긴 이름은 마지막 조각에서 다시 걸러집니다.
+    struct stat st;
+    if (lstat((upload_dir + "/" + info.filename).c_str(), &st) == 0)
+    {
+        LogConfig::reportInternalError("Resumable upload target already exists: " + info.filename);
+        return Response::createErrorResponse(409, server_config);
+    }
+
+    std::string id;
+    if (!newSessionId(id))
+    {
+        LogConfig::reportInternalError("Failed to create upload session id: " + std::string(strerror(errno)));
+        return Response::createErrorResponse(500, server_config);
+    }
+    std::string part = session_dir + "/" + id + ".part";
+    int fd = open(part.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0644);
+    if (fd < 0)
+    {
+        LogConfig::reportInternalError("Failed to create upload session: " + part + ": " + strerror(errno));
+        return Response::createErrorResponse(500, server_config);
+    }
+    // 빈 파일은 받을 조각이 없으므로 세션을 남기지 않고 바로 마무리합니다.
+    if (info.length == 0)
+    {
+        bool committed =
+            ResponseUtil::commitUploadedFile(fd, part, upload_dir, info.filename, location_config.upload_fsync);
+        int err = errno;
+        close(fd);
+        if (!committed)
+        {
+            unlink(part.c_str());
+            return Response::createErrorResponse(err == EEXIST ? 409 : 500, server_config);
+        }
+    }
+    else
+    {
+        close(fd);
+        if (!writeInfo(session_dir + "/" + id + ".info", info))
+        {
+            unlink(part.c_str());
+            return Response::createErrorResponse(500, server_config);
+        }
+    }
+    Response res = tusResponse(201);
+    res.setHeader("Location", trimTrailingSlash(location_config.path) + "/" + id);
+    res.setHeader("Upload-Offset", "0");
+    if (info.length > 0)
+        res.setHeader("Upload-Expires", expiresAt(time(NULL)));
+    return res;
+}
+
+Response ResumableUpload::status(const std::string &session_dir, const std::string &id,
+                                 const ServerConfig &server_config)
+{
+    SessionInfo info;
+    if (!readInfo(session_dir + "/" + id + ".info", info))
+        return Response::createErrorResponse(404, server_config);
+    Response res = tusResponse(200);
+    res.setHeader("Upload-Offset", sizeToString(info.offset));
+    res.setHeader("Upload-Length", sizeToString(info.length));
+    return res;
+}
+
+// 받은 조각을 그 위치에 pwrite하고 fsync한 뒤에야 세션의 offset을 올리므로,
+// 어느 순간 연결이 끊기거나 서버가 죽어도 HEAD가 알려 주는 위치까지는 디스크에 있습니다.
+Response ResumableUpload::append(const Request &request, const LocationConfig &location_config,
+                                 const ServerConfig &server_config, const std::string &upload_dir,
+                                 const std::string &session_dir, const std::string &id)
+{
+    const std::string *type = findHeader(request, "Content-Type");
+    if (!type || !iequals(*type, "application/offset+octet-stream"))
+        return Response::createErrorResponse(415, server_config);
+    const std::string *offset_header = findHeader(request, "Upload-Offset");
+    unsigned long offset;
+    if (!offset_header || !parseOffset(*offset_header, offset))
+        return Response::createErrorResponse(400, server_config);
+    const std::string &body = request.getBody();
+    size_t effective_limit = (location_config.client_max_body_size > 0 ? location_config.client_max_body_size :
+                                                                        server_config.client_max_body_size);
+    if (body.size() > effective_limit)
+        return Response::createErrorResponse(413, server_config);
+
+    std::string part = session_dir + "/" + id + ".part";
+    std::string info_path = session_dir + "/" + id + ".info";
+    int fd = open(part.c_str(), O_WRONLY | O_CLOEXEC);
+    if (fd < 0)
+        return Response::createErrorResponse(404, server_config);
+    // 같은 세션의 PATCH가 여러 스레드/프로세스에서 동시에 오면 하나씩 처리합니다. (close()가 잠금을 풉니다)
+    if (flock(fd, LOCK_EX) != 0)
+    {
+        LogConfig::reportInternalError("Failed to lock upload session: " + part + ": " + strerror(errno));
+        close(fd);
+        return Response::createErrorResponse(500, server_config);
+    }
+    SessionInfo info;
+    if (!readInfo(info_path, info) || info.offset == info.length)
+    {
+        // 잠금을 기다리는 동안 다른 요청이 마무리했을 수 있습니다.
+        close(fd);
+        return Response::createErrorResponse(404, server_config);
+    }
+    if (offset != info.offset)
+    {
+        close(fd);
+        Response res = tusResponse(409);
+        res.setHeader("Upload-Offset", sizeToString(info.offset));
+        return res;
+    }
+    if (body.size() > info.length - info.offset)
+    {
+        close(fd);
+        return Response::createErrorResponse(400, server_config);
+    }
+    if (!pwriteAll(fd, body.data(), body.size(), static_cast<off_t>(offset)) || fsync(fd) != 0)
+    {
+        LogConfig::reportInternalError("Failed to write upload chunk: " + part + ": " + strerror(errno));
+        close(fd);
+        return Response::createErrorResponse(500, server_config);
+    }
+    info.offset += body.size();
+    if (info.offset == info.length)
+    {
+        // 이름을 붙인 뒤에야 세션을 지우므로, 실패하면 offset은 그대로이고 마지막 조각을 다시 보낼 수 있습니다.
+        bool committed =
+            ResponseUtil::commitUploadedFile(fd, part, upload_dir, info.filename, location_config.upload_fsync);
+        int err = errno;
+        if (committed)
+            unlink(info_path.c_str());
+        close(fd);
+        if (!committed && err == EEXIST)
+        {
+            LogConfig::reportInternalError("Resumable upload target already exists: " + info.filename);
+            return Response::createErrorResponse(409, server_config);
+        }
+        if (!committed)
+            return Response::createErrorResponse(500, server_config);
+        Response res = tusResponse(204);
+        res.setHeader("Upload-Offset", sizeToString(info.offset));
+        return res;
+    }
+    bool saved = writeInfo(info_path, info);
+    close(fd);
+    if (!saved)
+        return Response::createErrorResponse(500, server_config);
+    Response res = tusResponse(204);
+    res.setHeader("Upload-Offset", sizeToString(info.offset));
+    res.setHeader("Upload-Expires", expiresAt(time(NULL)));
+    return res;
+}
+
+Response ResumableUpload::terminate(const std::string &session_dir, const std::string &id,
+                                    const ServerConfig &server_config)
+{
+    std::string info_path = session_dir + "/" + id + ".info";
+    if (access(info_path.c_str(), F_OK) != 0)
+        return Response::createErrorResponse(404, server_config);
+    unlink((session_dir + "/" + id + ".part").c_str());
+    unlink(info_path.c_str());
+    return tusResponse(204);
+}
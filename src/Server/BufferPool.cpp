@@ -0,0 +1,254 @@
+#include "BufferPool.hpp"
+#include <cstdlib>
+#include <cstring>
+#include <strings.h>
+#include <sys/uio.h>
+
+__thread RecvBuffer *BufferPool::_free_list = NULL;
+__thread size_t BufferPool::_free_count = 0;
+BufferPoolStats BufferPool::_stats;
+
+void BufferPool::adjust(size_t &slot, long delta)
+{
+    __atomic_add_fetch(&slot, static_cast<size_t>(delta), __ATOMIC_RELAXED);
+}
+
+RecvBuffer *BufferPool::acquire()
+{
+    RecvBuffer *buffer = _free_list;
+    if (buffer)
+    {
+        _free_list = buffer->next;
+        --_free_count;
+        adjust(_stats.free, -1);
+        adjust(_stats.hits, 1);
+    }
+    else
+    {
+        buffer = new RecvBuffer;
+        adjust(_stats.allocated, 1);
+        adjust(_stats.misses, 1);
+    }
+    buffer->next = NULL;
+    buffer->end = 0;
+    return buffer;
+}
+
+void BufferPool::release(RecvBuffer *buffer)
+{
+    if (_free_count >= RECV_POOL_MAX_FREE)
+    {
+        delete buffer;
+        adjust(_stats.allocated, -1);
+        return;
+    }
+    buffer->next = _free_list;
+    _free_list = buffer;
+    ++_free_count;
+    adjust(_stats.free, 1);
+}
+
+void BufferPool::releaseThreadCache()
+{
+    while (_free_list)
+    {
+        RecvBuffer *next = _free_list->next;
+        delete _free_list;
+        adjust(_stats.free, -1);
+        adjust(_stats.allocated, -1);
+        _free_list = next;
+    }
+    _free_count = 0;
+}
+
+BufferPoolStats BufferPool::stats()
+{
+    BufferPoolStats snapshot;
+    snapshot.allocated = __atomic_load_n(&_stats.allocated, __ATOMIC_RELAXED);
+    snapshot.in_use = __atomic_load_n(&_stats.in_use, __ATOMIC_RELAXED);
+    snapshot.free = __atomic_load_n(&_stats.free, __ATOMIC_RELAXED);
+    snapshot.hits = __atomic_load_n(&_stats.hits, __ATOMIC_RELAXED);
+    snapshot.misses = __atomic_load_n(&_stats.misses, __ATOMIC_RELAXED);
+    return snapshot;
+}
+
+RecvChain::RecvChain()
+    : _head(NULL), _tail(NULL), _size(0), _scanned(0), _match(0), _prev(0), _header_end(0), _content_length(0)
+{
+}
+
+RecvChain::~RecvChain()
+{
+    clear();
+}
+
+void RecvChain::linkBuffer(RecvBuffer *buffer)
+{
+    if (_tail)
+        _tail->next = buffer;
+    else
+        _head = buffer;
+    _tail = buffer;
+    BufferPool::adjust(BufferPool::_stats.in_use, 1);
+}
+
+ssize_t RecvChain::readFrom(int fd)
+{
+    // 마지막 버퍼의 남은 공간과 새 풀 버퍼에 한 번의 readv로 읽습니다.
+    RecvBuffer *fresh = BufferPool::acquire();
+    struct iovec iov[2];
+    int iovcnt = 0;
+    size_t spare = 0;
+    if (_tail && _tail->end < RECV_BUFFER_SIZE)
+    {
+        spare = RECV_BUFFER_SIZE - _tail->end;
+        iov[iovcnt].iov_base = _tail->data + _tail->end;
+        iov[iovcnt].iov_len = spare;
+        ++iovcnt;
+    }
+    iov[iovcnt].iov_base = fresh->data;
+    iov[iovcnt].iov_len = RECV_BUFFER_SIZE;
+    ++iovcnt;
+
+    ssize_t n = readv(fd, iov, iovcnt);
+    if (n <= 0)
+    {
+        BufferPool::release(fresh);
+        return n;
+    }
+    size_t remaining = static_cast<size_t>(n);
+    if (spare > 0)
+    {
+        size_t in_tail = remaining < spare ? remaining : spare;
+        _tail->end += in_tail;
+        remaining -= in_tail;
+    }
+    if (remaining > 0)
+    {
+        fresh->end = remaining;
+        linkBuffer(fresh);
+    }
+    else
+        BufferPool::release(fresh);
+    _size += static_cast<size_t>(n);
+    return n;
+}
+
+void RecvChain::parseContentLength()
+{
+    // 헤더 블록만 이어 붙여 Content-Length를 찾습니다. (헤더는 보통 수백 바이트)
+    std::string headers;
+    headers.reserve(_header_end);
+    for (RecvBuffer *b = _head; b && headers.size() < _header_end; b = b->next)
+    {
+        size_t take = _header_end - headers.size();
+        headers.append(b->data, take < b->end ? take : b->end);
+    }
+    _content_length = 0;
+    static const char name[] = "\r\ncontent-length:";
+    size_t pos = 0;
+    while ((pos = headers.find('\r', pos)) != std::string::npos)
+    {
+        if (headers.size() - pos >= sizeof(name) - 1 &&
+            strncasecmp(headers.c_str() + pos, name, sizeof(name) - 1) == 0)
+        {
+            long value = std::atol(headers.c_str() + pos + sizeof(name) - 1);
+            _content_length = value > 0 ? static_cast<size_t>(value) : 0;
+            return;
+        }
+        ++pos;
+    }
+}
+
+RecvChain::FrameStatus RecvChain::frameStatus()
+{
+    static const char terminator[] = "\r\n\r\n";
+    if (_header_end == 0)
+    {
+        size_t offset = 0;
+        for (RecvBuffer *b = _head; b && _header_end == 0; b = b->next)
+        {
+            size_t i = (_scanned > offset) ? _scanned - offset : 0;
+            for (; i < b->end; ++i)
+            {
+                char c = b->data[i];
+                // 단독 LF는 파서가 400으로 거절하도록 바로 넘깁니다.
+                if (c == '\n' && _prev != '\r')
+                {
+                    _header_end = offset + i + 1;
+                    break;
+                }
+                _prev = c;
+                if (c == terminator[_match])
+                    ++_match;
+                else
+                    _match = (c == '\r') ? 1 : 0;
+                if (_match == 4)
+                {
+                    _header_end = offset + i + 1;
+                    break;
+                }
+            }
+            offset += b->end;
+        }
+        if (_header_end == 0)
+        {
+            _scanned = _size;
+            return (_size > RECV_MAX_HEADER_SIZE) ? FRAME_HEADER_TOO_LARGE : FRAME_INCOMPLETE;
+        }
+        parseContentLength();
+    }
+    return (_size >= _header_end + _content_length) ? FRAME_COMPLETE : FRAME_INCOMPLETE;
+}
+
+size_t RecvChain::size() const
+{
+    return _size;
+}
+
+bool RecvChain::empty() const
+{
+    return _size == 0;
+}
+
+void RecvChain::drainTo(std::string &out)
+{
+    out.reserve(out.size() + _size);
+    for (RecvBuffer *b = _head; b; b = b->next)
+        out.append(b->data, b->end);
+    clear();
+}
+
+void RecvChain::append(const char *data, size_t len)
+{
+    while (len > 0)
+    {
+        if (!_tail || _tail->end == RECV_BUFFER_SIZE)
+            linkBuffer(BufferPool::acquire());
+        size_t room = RECV_BUFFER_SIZE - _tail->end;
+        size_t take = len < room ? len : room;
+        memcpy(_tail->data + _tail->end, data, take);
+        _tail->end += take;
+        _size += take;
+        data += take;
+        len -= take;
+    }
+}
+
+void RecvChain::clear()
+{
+    while (_head)
+    {
+        RecvBuffer *next = _head->next;
+        BufferPool::release(_head);
+        BufferPool::adjust(BufferPool::_stats.in_use, -1);
+        _head = next;
+    }
+    _tail = NULL;
+    _size = 0;
+    _scanned = 0;
+    _match = 0;
+    _prev = 0;
+    _header_end = 0;
+    _content_length = 0;
+}
@@ -1,11 +1,20 @@
+#include "DirectoryListing.hpp"
 #include "EpollPoller.hpp"
+#include "IoUringPoller.hpp"
+#include "MimeTypes.hpp"
 #include "KqueuePoller.hpp"
 #include "Server.hpp"
+#include "UploadSync.hpp"
 #include <cstring>
 #include <errno.h>
+#include <fcntl.h>
+#include <sstream>
 #include <stdlib.h>
+#include <sys/resource.h>
 
 extern volatile sig_atomic_t shutdown_flag;
+extern volatile sig_atomic_t reload_flag;
+extern volatile sig_atomic_t upgrade_flag;
 
 static void show_ascii()
 {
@@ -25,8 +34,16 @@ static void show_ascii()
     std::cout << "\033[0m";
 }
 
-Server::Server(const std::string &configFile) : _poller(NULL)
+Server::Server(const std::string &configFile, const std::string &executable)
+    : _config_file(configFile), _executable(executable), _config(NULL), _poller(NULL), _is_running(false),
+      _completion_io(false), _worker_connections(WORKER_CONNECTIONS), _reject_overflow(false), _accept_paused(false),
+      _accept_resume_us(0), _reserve_fd(-1), _shutdown_timeout_us(SHUTDOWN_TIMEOUT_MS * 1000ULL), _draining(false),
+      _drain_deadline_us(0), _upgrade_pid(-1), _upgrade_fd(-1), _group(this), _next_loop(0), _connection_count(0),
+      _config_generation(0), _drain_requested(false), _stop_requested(false)
 {
+    pthread_mutex_init(&_config_lock, NULL);
+    pthread_mutex_init(&_wake_lock, NULL);
+    _wake_fds[0] = _wake_fds[1] = -1;
     Configuration config;
     if (!config.parseConfigFile(configFile))
     {
@@ -34,44 +51,211 @@ Server::Server(const std::string &configFile) : _poller(NULL)
         throw std::runtime_error("Failed to parse configuration file.");
     }
     show_ascii();
-    _server_configs = config.servers;
+    _config = new ConfigSnapshot();
+    _config->servers = config.servers;
+    retainConfig(_config);
+    applyGlobalConfig(config);
+    _reserve_fd = open("/dev/null", O_RDONLY);
+    createPoller();
+    if (!openWakeFd())
+        throw std::runtime_error("event loop wake fd: " + std::string(strerror(errno)));
+    initSockets();
+    prepareServers(_config->servers);
+    if (!AsyncLog::start())
+        LogConfig::reportInternalError("Failed to start log writer thread, logging synchronously");
+    if (config.io_threads > 0 && !IoPool::start(config.io_threads))
+        LogConfig::reportInternalError("Failed to start I/O threads, handling file I/O on the event loop");
+    startLoops(config.worker_threads);
+    // SIGUSR2로 실행된 새 바이너리이면 이전 프로세스에 준비되었다고 알립니다.
+    notifyUpgradeParent();
+}
+
+void Server::createPoller()
+{
 // _poller를 임시 auto_ptr로 생성하여 RAII를 적용합니다.
-#ifdef __linux__
+#if defined(__linux__) && defined(WEBSERV_IO_URING)
+    // io_uring을 쓸 수 없는 커널(또는 seccomp 환경)에서는 epoll로 대체합니다.
+    try
+    {
+        _poller = std::auto_ptr<Poller>(new IoUringPoller());
+    }
+    catch (const std::exception &e)
+    {
+        LogConfig::reportInternalError(std::string(e.what()) + ", falling back to epoll");
+        _poller = std::auto_ptr<Poller>(new EpollPoller());
+    }
+#elif defined(__linux__)
     _poller = std::auto_ptr<Poller>(new EpollPoller());
 #elif defined(__APPLE__)
     _poller = std::auto_ptr<Poller>(new KqueuePoller());
 #else
 #error "Unsupported OS"
 #endif
-    initSockets();
+    _completion_io = _poller->completionIo();
+}
+
+// 서버 블록별 로거, 메트릭 번호, limit zone을 준비합니다. location에 없는 limit_req/limit_conn은 서버 설정을 물려받습니다.
+void Server::prepareServers(std::vector<ServerConfig> &servers)
+{
+    for (size_t i = 0; i < servers.size(); ++i)
+    {
+        ServerConfig &server = servers[i];
+        server.access_log_id = AccessLog::configure(server);
+        server.slow_request_log_id = AccessLog::configureSlowLog(server);
+        std::string label = server.server_name + ":" + intToString(server.port);
+        for (size_t j = 0; j < server.locations.size(); ++j)
+        {
+            LocationConfig &location = server.locations[j];
+            location.metrics_id = Metrics::registerLocation(label, location.path);
+            if (location.limit_req.zone.empty())
+                location.limit_req = server.limit_req;
+            if (location.limit_conn.zone.empty())
+                location.limit_conn = server.limit_conn;
+            if (!location.limit_req.zone.empty())
+                location.limit_req.zone_id = RateLimit::registerZone(location.limit_req.zone,
+                                                                     location.limit_req.zone_size);
+            if (!location.limit_conn.zone.empty())
+                location.limit_conn.zone_id = RateLimit::registerZone(location.limit_conn.zone,
+                                                                      location.limit_conn.zone_size);
+        }
+    }
+}
+
+// server 블록 밖의 설정 (SIGHUP 때도 다시 적용)
+void Server::applyGlobalConfig(const Configuration &config)
+{
+    _worker_connections = config.worker_connections;
+    _reject_overflow = config.reject_overflow;
+    _shutdown_timeout_us = config.shutdown_timeout_us;
+    FileCache::configure(config.mmap_cache_size, config.mmap_min_file, config.mmap_max_file);
+    MimeTypes::install(config.mime_types);
+    fitConnectionLimit();
 }
 
 Server::~Server()
 {
-    for (size_t i = 0; i < _server_configs.size(); ++i)
+    // 워커 루프가 먼저 남은 연결을 정리하고 끝나야 로그 writer를 멈출 수 있습니다.
+    stopLoops();
+    // shutdown_timeout이 지나도 남아 있던 연결은 여기서 닫습니다. (보내던 응답도 접근 로그에 남깁니다)
+    closeAllConnections();
+    for (size_t i = 0; i < _handoff.size(); ++i)
+    {
+        close(_handoff[i].fd);
+        countConnection(-1);
+    }
+    if (_group == this)
     {
-        for (size_t j = 0; j < _server_configs[i].server_sockets.size(); ++j)
+        for (size_t i = 0; i < _config->servers.size(); ++i)
         {
-            close(_server_configs[i].server_sockets[j]);
+            for (size_t j = 0; j < _config->servers[i].server_sockets.size(); ++j)
+                close(_config->servers[i].server_sockets[j]);
         }
     }
-    std::map<int, std::string>().swap(_partialRequests);
+    releaseConfig(_config);
+    if (_reserve_fd != -1)
+        close(_reserve_fd);
+    if (_upgrade_fd != -1)
+        close(_upgrade_fd);
+    closeWakeFd();
+    for (std::map<int, RecvChain *>::iterator it = _recvChains.begin(); it != _recvChains.end(); ++it)
+        delete it->second;
     std::map<int, std::string>().swap(_outgoingData);
+    for (std::map<int, OutgoingFile>::iterator it = _outgoingFiles.begin(); it != _outgoingFiles.end(); ++it)
+        FileCache::release(it->second.file);
     std::map<int, Request>().swap(_requestMap);
+    for (std::map<int, Arena *>::iterator it = _arenas.begin(); it != _arenas.end(); ++it)
+        delete it->second;
+    pthread_mutex_destroy(&_config_lock);
+    pthread_mutex_destroy(&_wake_lock);
+    if (_group != this)
+        return;
+    // 모든 루프가 맡긴 작업을 돌려받았으므로 대기열은 비어 있습니다.
+    IoPool::stop();
+    UploadSync::stop();
+    FileCache::clear();
+    MimeTypes::clear();
+    DirectoryListing::clear();
+    ArenaStats stats = Arena::stats();
+    // 아레나 크기(ARENA_BLOCK_SIZE) 조정을 위한 통계
+    std::cerr << "Arena stats: high-water " << stats.high_water << " bytes, " << stats.block_allocs
+              << " block allocations, " << stats.oversize_allocs << " oversize, " << stats.resets << " resets"
+              << std::endl;
+    BufferPoolStats pool = BufferPool::stats();
+    std::cerr << "Recv buffer pool: " << pool.allocated << " allocated, " << pool.free << " free, " << pool.in_use
+              << " in use" << std::endl;
+    // 링에 남은 로그를 모두 기록한 뒤 writer 스레드를 종료합니다.
+    AsyncLog::stop();
+    AsyncLogStats log_stats = AsyncLog::stats();
+    std::cerr << "Async log: " << log_stats.bytes_written << " bytes in " << log_stats.writes << " writes, "
+              << log_stats.dropped << " dropped, " << log_stats.reopens << " reopens" << std::endl;
+}
+
+// SIGUSR2로 실행되었으면 이전 프로세스가 넘겨준 리스너를 "port:fd;port:fd" 형식의 환경 변수에서 읽습니다.
+static std::map<int, int> inheritedListeners()
+{
+    std::map<int, int> listeners;
+    const char *value = getenv(LISTEN_FDS_ENV);
+    if (!value)
+        return listeners;
+    std::istringstream iss(value);
+    std::string item;
+    while (std::getline(iss, item, ';'))
+    {
+        size_t colon = item.find(':');
+        if (colon != std::string::npos)
+            listeners[std::atoi(item.c_str())] = std::atoi(item.c_str() + colon + 1);
+    }
+    // CGI 자식 프로세스에는 넘기지 않습니다.
+    unsetenv(LISTEN_FDS_ENV);
+    return listeners;
 }
 
 void Server::initSockets()
 {
-    for (size_t i = 0; i < _server_configs.size(); ++i)
+    std::map<int, int> inherited = inheritedListeners();
+    for (size_t i = 0; i < _config->servers.size(); ++i)
     {
-        ServerConfig &server = _server_configs[i];
-        int sockfd = SocketManager::createSocket(server.port);
-        SocketManager::setSocketNonBlocking(sockfd, server.port);
-        SocketManager::bindSocket(sockfd, server.port);
-        SocketManager::startListening(sockfd, server.port);
+        ServerConfig &server = _config->servers[i];
+        int sockfd;
+        std::map<int, int>::iterator it = inherited.find(server.port);
+        if (it != inherited.end())
+        {
+            // 이전 프로세스의 소켓을 그대로 씁니다. 대기열에 있던 연결도 이어받습니다.
+            sockfd = it->second;
+            inherited.erase(it);
+            SocketManager::startListening(sockfd, server.port, server.listen_backlog);
+        }
+        else
+            sockfd = SocketManager::openListener(server.port, server.listen_backlog);
         server.server_sockets.push_back(sockfd);
-        _poller->add(sockfd, POLLER_READ);
+        addListener(sockfd);
+    }
+    // 새 설정에서 쓰지 않는 포트의 소켓은 닫습니다.
+    for (std::map<int, int>::iterator it = inherited.begin(); it != inherited.end(); ++it)
+        close(it->second);
+}
+
+// worker_connections만큼 fd를 쓸 수 있도록 RLIMIT_NOFILE 소프트 한도를 올리고,
+// 하드 한도가 부족하면 연결 상한을 줄입니다. (나머지 fd는 리스너, 로그, CGI, 파일용)
+void Server::fitConnectionLimit()
+{
+    struct rlimit limit;
+    if (getrlimit(RLIMIT_NOFILE, &limit) != 0)
+        return;
+    rlim_t needed = static_cast<rlim_t>(_worker_connections) + FD_RESERVE_MARGIN;
+    if (limit.rlim_cur != RLIM_INFINITY && limit.rlim_cur < needed)
+    {
+        limit.rlim_cur = (limit.rlim_max == RLIM_INFINITY || limit.rlim_max >= needed) ? needed : limit.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &limit);
+        getrlimit(RLIMIT_NOFILE, &limit);
     }
+    if (limit.rlim_cur == RLIM_INFINITY || limit.rlim_cur >= needed)
+        return;
+    size_t fitted = limit.rlim_cur > FD_RESERVE_MARGIN * 2 ? limit.rlim_cur - FD_RESERVE_MARGIN : limit.rlim_cur / 2;
+    LogConfig::reportInternalError("worker_connections " + sizeToString(_worker_connections) +
+                                   " exceeds the open file limit " + sizeToString(limit.rlim_cur) + ", using " +
+                                   sizeToString(fitted));
+    _worker_connections = fitted;
 }
 
 void Server::start()
@@ -79,11 +263,37 @@ void Server::start()
     _is_running = true;
     while (_is_running)
     {
-        if (shutdown_flag)
+        if (_group != this && !followGroup())
         {
             _is_running = false;
             break;
         }
+        if (_group == this && shutdown_flag)
+        {
+            // 첫 신호는 남은 응답을 마무리하며 종료하고, 종료 중에 다시 받으면 바로 끝냅니다.
+            shutdown_flag = 0;
+            if (_draining)
+            {
+                _is_running = false;
+                break;
+            }
+            beginDrain();
+        }
+        if (_draining && drainFinished())
+        {
+            _is_running = false;
+            break;
+        }
+        if (_group == this && reload_flag)
+        {
+            reload_flag = 0;
+            reloadConfig();
+        }
+        if (_group == this && upgrade_flag)
+        {
+            upgrade_flag = 0;
+            startBinaryUpgrade();
+        }
 
         std::vector<Event> events;
         if (!processPollerEvents(events))
@@ -92,6 +302,14 @@ void Server::start()
             continue;
         }
         processEvents(events);
+        runDelayedRequests();
+        resumeAcceptIfReady();
+        if (_group == this)
+            CGIHandler::reapExited();
+        // 연결 상태 게이지는 반복마다 한 번 기록합니다. (요청 처리 경로에는 비용 없음)
+        Metrics::set(METRIC_CONNECTIONS_ACTIVE, _peerAddrs.size());
+        Metrics::set(METRIC_CONNECTIONS_READING, _recvChains.size());
+        Metrics::set(METRIC_CONNECTIONS_WRITING, _outgoingData.size());
     }
 }
 
@@ -102,7 +320,21 @@ void Server::stop()
 
 bool Server::processPollerEvents(std::vector<Event> &events)
 {
-    int n = _poller->poll(events, 1000);
+    // EMFILE로 멈춘 리스너는 정해진 시각에 다시 켜야 하므로 그때까지만 기다립니다.
+    int timeout = (_accept_paused && _accept_resume_us) ? ACCEPT_RETRY_MS : 1000;
+    // limit_req로 지연된 요청은 재개 시각에 맞춰 깨어납니다.
+    timeout = delayedTimeout(timeout);
+    // 다른 루프의 연결이 줄어드는 것은 이 루프를 깨우지 않으므로, 그것을 기다리는 동안은 자주 확인합니다.
+    if (!_loops.empty() && (_draining || (_accept_paused && !_accept_resume_us)) && timeout > LOOP_CHECK_MS)
+        timeout = LOOP_CHECK_MS;
+    if (_draining)
+    {
+        uint64_t now = monotonicMicros();
+        uint64_t left_ms = _drain_deadline_us > now ? (_drain_deadline_us - now + 999) / 1000 : 0;
+        if (left_ms < static_cast<uint64_t>(timeout))
+            timeout = static_cast<int>(left_ms);
+    }
+    int n = _poller->poll(events, timeout);
     if (n == -1)
     {
         LogConfig::reportInternalError("poller->poll() failed: " + std::string(strerror(errno)));
@@ -1,37 +1,72 @@
 #include "Server.hpp"
+#include "ServerWriteHelper.hpp"
 #include <cstring>
+#include <fcntl.h>
 #include <errno.h>
 #include <iostream>
 
 void Server::processEvents(const std::vector<Event> &events)
 {
-    std::set<int>& closed_fds = getClosedFds();
     for (size_t i = 0; i < events.size(); ++i)
     {
         int fd = events[i].fd;
-        // FD가 이미 닫힌 경우는 건너뜁니다.
-        if (closed_fds.find(fd) != closed_fds.end())
-            continue;
         if (fd < 0)
         {
             LogConfig::reportInternalError("Invalid file descriptor in events[" + intToString(i) + "]");
             continue;
         }
-        if (events[i].events & POLLER_READ)
+        if (fd == _upgrade_fd)
+        {
+            handleUpgradeReady();
+            continue;
+        }
+        if (fd == _wake_fds[0])
+        {
+            handleWake();
+            continue;
+        }
+        if (_streamPipes.find(fd) != _streamPipes.end())
+        {
+            handleStreamEvent(fd);
+            continue;
+        }
+        if (events[i].events & POLLER_ACCEPTED)
+        {
+            handleAccepted(fd, events[i].result);
+            continue;
+        }
+        if (events[i].events & POLLER_SENT)
+        {
+            handleSent(fd, events[i].result);
+            continue;
+        }
+        if (events[i].events & (POLLER_READ | POLLER_RECEIVED))
         {
             ServerConfig *matched_server = 0;
-            if (isServerSocket(fd, &matched_server))
+            if (_group == this && isServerSocket(fd, &matched_server))
+            {
                 handleNewConnection(fd);
-            else
-                handleClientRead(fd, findMatchingServerConfig(fd));
+                continue;
+            }
+            // 같은 배치에서 이미 닫힌 연결은 건너뜁니다.
+            if (_peerAddrs.find(fd) == _peerAddrs.end())
+                continue;
+            handleClientRead(fd, findMatchingServerConfig(fd), events[i]);
         }
-        if (events[i].events & POLLER_WRITE)
+        if ((events[i].events & POLLER_WRITE) && _peerAddrs.find(fd) != _peerAddrs.end())
             handleClientWrite(fd);
     }
 }
 
 void Server::handleNewConnection(int server_fd)
 {
+    bool at_capacity = connectionCount() >= _worker_connections;
+    if (at_capacity && !_reject_overflow)
+    {
+        // 새 연결은 커널 backlog에 남겨 두고 연결 수가 줄어들 때까지 accept를 멈춥니다.
+        pauseAccept(0);
+        return;
+    }
     struct sockaddr_in client_addr;
     socklen_t client_len = sizeof(client_addr);
     int client_fd = accept(server_fd, (struct sockaddr *)&client_addr, &client_len);
@@ -39,48 +74,217 @@ void Server::handleNewConnection(int server_fd)
     {
         if (errno == EAGAIN || errno == EWOULDBLOCK)
             return;
+        if (errno == EMFILE || errno == ENFILE)
+        {
+            // 리스너가 계속 읽기 가능으로 깨어나며 실패를 반복하지 않도록 하나를 거절하고 잠시 멈춥니다.
+            rejectWithReserveFd(server_fd);
+            pauseAccept(ACCEPT_RETRY_MS);
+            return;
+        }
         LogConfig::reportInternalError("accept() failed: " + std::string(strerror(errno)));
         return;
     }
+    Metrics::add(METRIC_ACCEPTS);
+    if (at_capacity)
+    {
+        rejectConnection(client_fd);
+        return;
+    }
     if (!setNonBlocking(client_fd))
     {
         LogConfig::reportInternalError("Failed to set non-blocking mode for client_fd " + intToString(client_fd));
         close(client_fd);
         return;
     }
-    if (!_poller->add(client_fd, POLLER_READ))
+    countConnection(1);
+    handOff(client_fd, client_addr.sin_addr.s_addr);
+}
+
+// io_uring: 리스너의 multishot accept가 이미 받은 연결 (result는 새 fd, 실패면 -errno)
+void Server::handleAccepted(int server_fd, int result)
+{
+    if (result < 0)
+    {
+        if (result == -EMFILE || result == -ENFILE)
+        {
+            rejectWithReserveFd(server_fd);
+            pauseAccept(ACCEPT_RETRY_MS);
+            return;
+        }
+        LogConfig::reportInternalError("accept() failed: " + std::string(strerror(-result)));
+        return;
+    }
+    int client_fd = result;
+    // 리스너를 닫은 뒤에 도착한 연결 (리스너를 닫았을 때 backlog에 남아 있던 연결처럼 끊습니다)
+    if (_draining)
     {
-        LogConfig::reportInternalError("Failed to add client_fd " + intToString(client_fd) + " to poller");
         close(client_fd);
+        return;
+    }
+    Metrics::add(METRIC_ACCEPTS);
+    // 리스너를 멈추기 전에 커널이 받아 둔 연결은 backlog로 되돌릴 수 없으므로 503으로 거절합니다.
+    if (connectionCount() >= _worker_connections)
+    {
+        if (!_reject_overflow)
+            pauseAccept(0);
+        rejectConnection(client_fd);
+        return;
+    }
+    struct sockaddr_in client_addr;
+    socklen_t client_len = sizeof(client_addr);
+    if (getpeername(client_fd, (struct sockaddr *)&client_addr, &client_len) != 0)
+        client_addr.sin_addr.s_addr = 0;
+    countConnection(1);
+    handOff(client_fd, client_addr.sin_addr.s_addr);
+}
+
+// 리스너를 poller에 넣습니다. 완료 기반이면 multishot accept를 겁니다.
+bool Server::addListener(int server_fd)
+{
+    return _completion_io ? _poller->addAcceptor(server_fd) : _poller->add(server_fd, POLLER_READ);
+}
+
+// 과부하일 때 요청을 읽지 않고 고정된 503 응답을 보낸 뒤 바로 닫습니다.
+void Server::rejectConnection(int client_fd)
+{
+    static const char RESPONSE[] = "HTTP/1.1 503 Service Unavailable\r\n"
+                                   "Content-Type: text/plain\r\n"
+                                   "Content-Length: 20\r\n"
+                                   "Retry-After: 1\r\n"
+                                   "Connection: close\r\n"
+                                   "\r\n"
+                                   "Service Unavailable\n";
+    send(client_fd, RESPONSE, sizeof(RESPONSE) - 1, MSG_DONTWAIT | MSG_NOSIGNAL);
+    close(client_fd);
+    Metrics::add(METRIC_REJECTED);
+    Metrics::countResponse(503);
+}
+
+// fd가 바닥났을 때 예비 fd를 잠시 돌려주고 대기 중인 연결 하나를 받아 거절합니다.
+void Server::rejectWithReserveFd(int server_fd)
+{
+    if (_reserve_fd == -1)
+        return;
+    close(_reserve_fd);
+    int client_fd = accept(server_fd, NULL, NULL);
+    if (client_fd != -1)
+    {
+        Metrics::add(METRIC_ACCEPTS);
+        rejectConnection(client_fd);
     }
+    _reserve_fd = open("/dev/null", O_RDONLY);
 }
 
-void Server::handleClientRead(int client_fd, const ServerConfig &server_config)
+// 리스너를 poller에서 뺍니다. delay_ms가 0이면 연결 수가 줄어들 때, 아니면 그 시간이 지난 뒤 재개합니다.
+void Server::pauseAccept(uint64_t delay_ms)
 {
-    std::string &buffer = _partialRequests[client_fd];
-    if (!readClientData(client_fd, buffer))
+    _accept_resume_us = delay_ms ? monotonicMicros() + delay_ms * 1000 : 0;
+    if (_accept_paused)
+        return;
+    _accept_paused = true;
+    Metrics::add(METRIC_ACCEPT_PAUSES);
+    for (size_t s = 0; s < _config->servers.size(); ++s)
     {
-        safelyCloseClient(client_fd);
-        _partialRequests.erase(client_fd);
+        for (size_t i = 0; i < _config->servers[s].server_sockets.size(); ++i)
+            _poller->remove(_config->servers[s].server_sockets[i]);
+    }
+    LogConfig::reportInfo("Pausing accept: " + sizeToString(connectionCount()) + " connections open (limit " +
+                          sizeToString(_worker_connections) + ")" + (delay_ms ? ", out of file descriptors" : ""));
+}
+
+void Server::resumeAcceptIfReady()
+{
+    if (!_accept_paused)
         return;
+    if (_accept_resume_us ? monotonicMicros() < _accept_resume_us
+                          : connectionCount() * 100 >= _worker_connections * ACCEPT_RESUME_PERCENT)
+        return;
+    if (connectionCount() >= _worker_connections)
+        return;
+    _accept_paused = false;
+    for (size_t s = 0; s < _config->servers.size(); ++s)
+    {
+        for (size_t i = 0; i < _config->servers[s].server_sockets.size(); ++i)
+            addListener(_config->servers[s].server_sockets[i]);
     }
-    if (!handleReceivedData(client_fd, server_config, buffer))
+}
+
+void Server::handleClientRead(int client_fd, const ServerConfig &server_config, const Event &event)
+{
+    RecvChain *chain = getRecvChain(client_fd);
+    if (!readClientData(client_fd, *chain, event))
     {
+        closeConnection(client_fd);
         return;
     }
+    // 지연된 요청은 타이머가, IoPool에 맡긴 요청은 작업 완료가, 응답(CGI 출력 포함)을 보내는 중이면 그 끝이 처리합니다.
+    // 그동안 온 데이터는 버퍼에 쌓아 둡니다. (io_uring은 받기를 멈추기 전에 받아 둔 데이터를 이어서 넘겨줍니다)
+    if (_delayed.find(client_fd) != _delayed.end() || _inflight.find(client_fd) != _inflight.end() ||
+        outputPending(client_fd))
+        return;
+    RecvChain::FrameStatus status = chain->frameStatus();
+    if (status == RecvChain::FRAME_INCOMPLETE)
+        return;
+    if (status == RecvChain::FRAME_HEADER_TOO_LARGE)
+    {
+        {
+            Response res = Response::createErrorResponse(431, server_config);
+            res.setHeader("Connection", "close");
+            queueRecord(client_fd, server_config, NULL, res);
+            queueDirectResponse(client_fd, res);
+        }
+        writePendingData(client_fd);
+        closeConnection(client_fd);
+        return;
+    }
+    _timings[client_fd].mark(PHASE_RECV_END);
+    processBufferedRequest(client_fd, server_config);
 }
 
-bool Server::readClientData(int client_fd, std::string &buffer)
+// 수신 버퍼에 모인 요청을 처리하고, 남은 바이트(지연된 요청 포함)는 버퍼에 되돌려 둡니다.
+void Server::processBufferedRequest(int client_fd, const ServerConfig &server_config)
 {
-    char tmp[BUFFER_SIZE];
-    ssize_t bytes_read = recv(client_fd, tmp, sizeof(tmp), 0);
+    RecvChain *chain = getRecvChain(client_fd);
+    // 요청 하나가 모두 도착했을 때만 한 번 이어 붙여 파서에 넘깁니다.
+    std::string buffer;
+    chain->drainTo(buffer);
+    handleReceivedData(client_fd, server_config, buffer);
+    std::map<int, RecvChain *>::iterator it = _recvChains.find(client_fd);
+    if (it == _recvChains.end())
+        return;
+    if (!buffer.empty())
+        it->second->append(buffer.data(), buffer.size());
+    else
+        releaseRecvChain(client_fd);
+}
+
+// 준비 이벤트면 소켓에서 직접 읽고, io_uring이 이미 받은 데이터(POLLER_RECEIVED)면 그 버퍼에서 복사합니다.
+bool Server::readClientData(int client_fd, RecvChain &chain, const Event &event)
+{
+    ssize_t bytes_read;
+    if (event.events & POLLER_RECEIVED)
+    {
+        bytes_read = event.result;
+        if (bytes_read > 0)
+            chain.append(event.data, bytes_read);
+        else if (bytes_read < 0)
+        {
+            errno = -event.result;
+            bytes_read = -1;
+        }
+    }
+    else
+        bytes_read = chain.readFrom(client_fd);
     if (bytes_read > 0)
     {
-        buffer.append(tmp, bytes_read);
+        Metrics::add(METRIC_BYTES_IN, bytes_read);
+        _timings[client_fd].markOnce(PHASE_RECV_START);
         return true;
     }
     else if (bytes_read == 0)
         return false;
+    else if (errno == EAGAIN || errno == EWOULDBLOCK)
+        return true; // 이미 처리된 이벤트(예: 재사용된 fd)에 대한 빈 읽기
     else
     {
         std::cerr << "recv() failed on fd " << client_fd << ": " << strerror(errno) << std::endl;
@@ -90,15 +294,7 @@ bool Server::readClientData(int client_fd, std::string &buffer)
 
 bool Server::handleReceivedData(int client_fd, const ServerConfig &server_config, std::string &buffer)
 {
-    static std::map<int, time_t> closed_fds;
-    time_t now = time(NULL);
-    for (std::map<int, time_t>::iterator it = closed_fds.begin(); it != closed_fds.end(); ) {
-        if (now - it->second > 600)
-            closed_fds.erase(it++); // C++98 방식: erase 후 it 증가
-        else
-            ++it;
-    }
-    if (closed_fds.find(client_fd) != closed_fds.end())
+    if (_peerAddrs.find(client_fd) == _peerAddrs.end())
         return true;
     while (true)
     {
@@ -107,13 +303,7 @@ bool Server::handleReceivedData(int client_fd, const ServerConfig &server_config
         if (!ok)
         {
             // 치명적 에러가 발생하면 해당 연결을 종료합니다.
-            safelyCloseClient(client_fd);
-            _partialRequests.erase(client_fd);
-            if (_requestMap.find(client_fd) != _requestMap.end())
-                _requestMap.erase(client_fd);
-            if (_outgoingData.find(client_fd) != _outgoingData.end())
-                _outgoingData.erase(client_fd);
-            closed_fds[client_fd] = now;
+            closeConnection(client_fd);
             break;
         }
         else if (consumed == 0)
@@ -132,36 +322,13 @@ bool Server::handleReceivedData(int client_fd, const ServerConfig &server_config
     }
     if (_requestMap.find(client_fd) != _requestMap.end())
     {
-        Request req = _requestMap[client_fd];
-        std::map<std::string, std::string> headers = req.getHeaders();
-        std::string connHeader = "";
-        if (headers.find("Connection") != headers.end())
-            connHeader = headers["Connection"];
-        connHeader = toLower(connHeader);
-
-        bool keepAlive = false;
-        std::string httpVersion = req.getHTTPVersion();
-
-        if (httpVersion == "HTTP/1.1")
-            keepAlive = (connHeader != "close");
-        else if (httpVersion == "HTTP/1.0")
-            keepAlive = (connHeader == "keep-alive");
-        else
-            keepAlive = false;
-        if (!keepAlive)
-        {
-            safelyCloseClient(client_fd);
-            _partialRequests.erase(client_fd);
-            _requestMap.erase(client_fd);
-            _outgoingData.erase(client_fd);
-            closed_fds[client_fd] = now;
-        }
-        else
-        {
-            _partialRequests[client_fd].clear();
-            _requestMap.erase(client_fd);
-            _outgoingData.erase(client_fd);
-        }
+        // IoPool에서 응답을 만드는 중이면 작업이 돌아올 때 보냅니다.
+        if (_inflight.find(client_fd) != _inflight.end())
+            return true;
+        // 응답을 다 보내지 못했으면 쓰기 이벤트에서 마무리합니다. (그동안 읽기는 멈춥니다)
+        if (outputPending(client_fd))
+            return true;
+        finishResponse(client_fd);
     }
     else
     {
@@ -0,0 +1,98 @@
+#include "Server.hpp"
+
+// limit_req, limit_conn 순서로 확인합니다. 지연되었던 요청이 다시 처리될 때는 limit_req를 이미 통과한 것으로 봅니다.
+LimitResult Server::checkLimits(int client_fd, const LocationConfig &location)
+{
+    if (location.limit_req.zone_id < 0 && location.limit_conn.zone_id < 0)
+        return LIMIT_PASS;
+    in_addr_t addr = _peerAddrs[client_fd];
+    uint64_t now = monotonicMicros();
+    std::map<int, uint64_t>::iterator delayed = _delayed.find(client_fd);
+    bool resumed = (delayed != _delayed.end() && delayed->second == 0);
+    if (!resumed && location.limit_req.zone_id >= 0)
+    {
+        const LimitReqConfig &req = location.limit_req;
+        uint64_t delay_us = 0;
+        LimitResult result = RateLimit::acquireRequest(req.zone_id, addr, req.rate, req.burst, req.nodelay, now,
+                                                       delay_us);
+        if (result == LIMIT_REJECT)
+        {
+            Metrics::add(METRIC_LIMIT_REQ_REJECTED);
+            return LIMIT_REJECT;
+        }
+        if (result == LIMIT_DELAY)
+        {
+            Metrics::add(METRIC_LIMIT_REQ_DELAYED);
+            _delayed[client_fd] = now + delay_us;
+            return LIMIT_DELAY;
+        }
+    }
+    if (location.limit_conn.zone_id >= 0 && _connLimitZones.find(client_fd) == _connLimitZones.end())
+    {
+        if (RateLimit::acquireConn(location.limit_conn.zone_id, addr, location.limit_conn.limit, now) ==
+            LIMIT_REJECT)
+        {
+            Metrics::add(METRIC_LIMIT_CONN_REJECTED);
+            return LIMIT_REJECT;
+        }
+        _connLimitZones[client_fd] = location.limit_conn.zone_id;
+    }
+    return LIMIT_PASS;
+}
+
+// 응답을 다 보냈거나 연결이 닫힐 때 limit_conn 카운트를 돌려줍니다.
+void Server::releaseConnLimit(int client_fd)
+{
+    std::map<int, int>::iterator it = _connLimitZones.find(client_fd);
+    if (it == _connLimitZones.end())
+        return;
+    std::map<int, in_addr_t>::const_iterator peer = _peerAddrs.find(client_fd);
+    if (peer != _peerAddrs.end())
+        RateLimit::releaseConn(it->second, peer->second);
+    _connLimitZones.erase(it);
+}
+
+// 재개 시각이 된 지연 요청을 처리합니다.
+void Server::runDelayedRequests()
+{
+    if (_delayed.empty())
+        return;
+    uint64_t now = monotonicMicros();
+    std::vector<int> due;
+    for (std::map<int, uint64_t>::const_iterator it = _delayed.begin(); it != _delayed.end(); ++it)
+    {
+        if (it->second && it->second <= now)
+            due.push_back(it->first);
+    }
+    for (size_t i = 0; i < due.size(); ++i)
+    {
+        int client_fd = due[i];
+        std::map<int, uint64_t>::iterator it = _delayed.find(client_fd);
+        if (it == _delayed.end())
+            continue;
+        it->second = 0;
+        // 기다린 시간은 수신/파싱 구간이 아닌 전체 시간에만 들어가도록 합니다.
+        _timings[client_fd].mark(PHASE_RECV_END);
+        processBufferedRequest(client_fd, findMatchingServerConfig(client_fd));
+        it = _delayed.find(client_fd);
+        if (it != _delayed.end() && it->second == 0)
+            _delayed.erase(it);
+    }
+}
+
+// 가장 이른 재개 시각까지 남은 시간으로 poll 대기 시간을 줄입니다. (밀리초, 올림)
+int Server::delayedTimeout(int timeout) const
+{
+    if (_delayed.empty())
+        return timeout;
+    uint64_t now = monotonicMicros();
+    for (std::map<int, uint64_t>::const_iterator it = _delayed.begin(); it != _delayed.end(); ++it)
+    {
+        if (!it->second)
+            continue;
+        uint64_t wait_ms = it->second > now ? (it->second - now + 999) / 1000 : 0;
+        if (wait_ms < static_cast<uint64_t>(timeout))
+            timeout = static_cast<int>(wait_ms);
+    }
+    return timeout;
+}
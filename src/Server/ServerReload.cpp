@@ -0,0 +1,305 @@
+#include "Server.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+
+extern char **environ;
+
+// SIGHUP: 설정 파일을 다시 읽어 새 요청부터 적용합니다. 읽기에 실패하면 지금 설정을 유지합니다.
+void Server::reloadConfig()
+{
+    if (_draining)
+        return;
+    Configuration config;
+    if (!config.parseConfigFile(_config_file))
+    {
+        LogConfig::reportInternalError("Reload: failed to parse " + _config_file + ", keeping current configuration");
+        return;
+    }
+    ConfigSnapshot *next = new ConfigSnapshot();
+    next->servers = config.servers;
+    if (!rebindListeners(next->servers))
+    {
+        delete next;
+        return;
+    }
+    prepareServers(next->servers);
+    applyGlobalConfig(config);
+    if (config.worker_threads != _loops.size() + 1)
+        LogConfig::reportInfo("Reload: worker_threads is applied only at startup (binary upgrade)");
+    if (config.io_threads != IoPool::stats(IO_QUEUE_FILE).threads)
+        LogConfig::reportInfo("Reload: io_threads is applied only at startup (binary upgrade)");
+    publishConfig(next);
+    LogConfig::reportInfo("Reload: configuration reloaded from " + _config_file);
+}
+
+// 새 설정을 주 루프에 걸고 워커 루프가 다음 반복에서 따라오게 합니다.
+// 이전 설정은 그것을 쓰는 루프와 보내는 중인 응답이 모두 놓을 때까지 남습니다.
+void Server::publishConfig(ConfigSnapshot *next)
+{
+    retainConfig(next);
+    pthread_mutex_lock(&_config_lock);
+    ConfigSnapshot *previous = _config;
+    _config = next;
+    __atomic_add_fetch(&_config_generation, 1, __ATOMIC_RELEASE);
+    pthread_mutex_unlock(&_config_lock);
+    releaseConfig(previous);
+}
+
+// 새 설정의 포트마다 리스너를 정합니다. 이미 열려 있는 포트는 소켓을 그대로 넘겨받아 대기열의 연결을 잃지 않습니다.
+// 새 포트를 열지 못하면 아무것도 바꾸지 않고 false
+bool Server::rebindListeners(std::vector<ServerConfig> &servers)
+{
+    std::map<int, int> current;
+    for (size_t i = 0; i < _config->servers.size(); ++i)
+    {
+        for (size_t j = 0; j < _config->servers[i].server_sockets.size(); ++j)
+            current[_config->servers[i].port] = _config->servers[i].server_sockets[j];
+    }
+    std::vector<int> opened;
+    try
+    {
+        for (size_t i = 0; i < servers.size(); ++i)
+        {
+            std::map<int, int>::const_iterator it = current.find(servers[i].port);
+            if (it != current.end())
+                servers[i].server_sockets.push_back(it->second);
+            else
+            {
+                opened.push_back(SocketManager::openListener(servers[i].port, servers[i].listen_backlog));
+                servers[i].server_sockets.push_back(opened.back());
+            }
+        }
+    }
+    catch (const std::exception &e)
+    {
+        for (size_t i = 0; i < opened.size(); ++i)
+            close(opened[i]);
+        LogConfig::reportInternalError("Reload: " + std::string(e.what()) + ", keeping current configuration");
+        return false;
+    }
+    std::set<int> kept;
+    for (size_t i = 0; i < servers.size(); ++i)
+    {
+        int sockfd = servers[i].server_sockets[0];
+        kept.insert(sockfd);
+        // 이어받은 소켓도 backlog가 바뀌었을 수 있으므로 다시 listen합니다.
+        listen(sockfd, servers[i].listen_backlog);
+        if (std::find(opened.begin(), opened.end(), sockfd) != opened.end() && !_accept_paused)
+            addListener(sockfd);
+    }
+    for (std::map<int, int>::iterator it = current.begin(); it != current.end(); ++it)
+    {
+        if (kept.count(it->second))
+            continue;
+        if (!_accept_paused)
+            _poller->remove(it->second);
+        close(it->second);
+    }
+    return true;
+}
+
+void Server::retainConfig(ConfigSnapshot *config)
+{
+    __atomic_add_fetch(&config->refs, 1, __ATOMIC_RELAXED);
+}
+
+// 이벤트 루프나 ResponseRecord가 잡고 있던 스냅샷을 놓습니다. 마지막 참조가 사라지면 해제합니다.
+void Server::releaseConfig(ConfigSnapshot *config)
+{
+    if (config && __atomic_sub_fetch(&config->refs, 1, __ATOMIC_ACQ_REL) == 0)
+        delete config;
+}
+
+// SIGUSR2: 같은 경로의 (새로 설치된) 바이너리를 실행하고 리스너를 넘깁니다.
+// 새 프로세스가 준비되었다고 알리면 이 프로세스는 accept를 멈추고 남은 연결을 마무리한 뒤 종료합니다.
+// 새 프로세스가 준비 전에 죽으면 이 프로세스가 계속 서비스합니다.
+void Server::startBinaryUpgrade()
+{
+    if (_draining || _upgrade_pid != -1)
+    {
+        LogConfig::reportInternalError("Upgrade: already in progress, ignoring SIGUSR2");
+        return;
+    }
+    int ready[2];
+    if (pipe(ready) == -1)
+    {
+        LogConfig::reportInternalError("Upgrade: pipe() failed: " + std::string(strerror(errno)));
+        return;
+    }
+    fcntl(ready[0], F_SETFD, FD_CLOEXEC);
+
+    // fork 뒤에는 메모리를 할당하지 않도록 인자, 환경 변수, 남길 fd를 미리 만들어 둡니다.
+    std::string listen_env = std::string(LISTEN_FDS_ENV) + "=";
+    std::vector<int> keep;
+    for (size_t i = 0; i < _config->servers.size(); ++i)
+    {
+        for (size_t j = 0; j < _config->servers[i].server_sockets.size(); ++j)
+        {
+            int sockfd = _config->servers[i].server_sockets[j];
+            listen_env += intToString(_config->servers[i].port) + ":" + intToString(sockfd) + ";";
+            keep.push_back(sockfd);
+        }
+    }
+    keep.push_back(ready[1]);
+    std::sort(keep.begin(), keep.end());
+    std::string ready_env = std::string(READY_FD_ENV) + "=" + intToString(ready[1]);
+    std::vector<char *> envp;
+    for (char **env = environ; *env; ++env)
+    {
+        if (strncmp(*env, LISTEN_FDS_ENV "=", sizeof(LISTEN_FDS_ENV)) != 0 &&
+            strncmp(*env, READY_FD_ENV "=", sizeof(READY_FD_ENV)) != 0)
+            envp.push_back(*env);
+    }
+    envp.push_back(const_cast<char *>(listen_env.c_str()));
+    envp.push_back(const_cast<char *>(ready_env.c_str()));
+    envp.push_back(NULL);
+    char *argv[] = {const_cast<char *>(_executable.c_str()), const_cast<char *>(_config_file.c_str()), NULL};
+    struct rlimit limit;
+    int max_fd = (getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur != RLIM_INFINITY)
+                     ? static_cast<int>(limit.rlim_cur)
+                     : 65536;
+
+    pid_t pid = fork();
+    if (pid == 0)
+    {
+        // 리스너와 준비 파이프만 남기고 연결, poller, 로그 fd는 닫습니다.
+        for (int fd = 3; fd < max_fd; ++fd)
+        {
+            if (!std::binary_search(keep.begin(), keep.end(), fd))
+                close(fd);
+        }
+        environ = &envp[0];
+        execvp(argv[0], argv);
+        _exit(127);
+    }
+    close(ready[1]);
+    if (pid == -1)
+    {
+        LogConfig::reportInternalError("Upgrade: fork() failed: " + std::string(strerror(errno)));
+        close(ready[0]);
+        return;
+    }
+    _upgrade_pid = pid;
+    _upgrade_fd = ready[0];
+    _poller->add(_upgrade_fd, POLLER_READ);
+    LogConfig::reportInfo("Upgrade: started " + _executable + " as pid " + intToString(pid));
+}
+
+// 준비 파이프가 읽기 가능해졌을 때: 한 바이트가 오면 교체 완료, EOF이면 새 프로세스가 실패한 것입니다.
+void Server::handleUpgradeReady()
+{
+    char byte = 0;
+    ssize_t n = read(_upgrade_fd, &byte, 1);
+    _poller->remove(_upgrade_fd);
+    close(_upgrade_fd);
+    _upgrade_fd = -1;
+    if (n == 1)
+    {
+        LogConfig::reportInfo("Upgrade: pid " + intToString(_upgrade_pid) +
+                              " is serving, draining this process");
+        beginDrain();
+        return;
+    }
+    // 준비 파이프는 알린 뒤에만 닫으므로 EOF는 새 프로세스가 종료했다는 뜻입니다. 곧바로 거둡니다.
+    int status = 0;
+    if (waitpid(_upgrade_pid, &status, 0) == _upgrade_pid && WIFEXITED(status))
+        LogConfig::reportInternalError("Upgrade: pid " + intToString(_upgrade_pid) + " exited with status " +
+                                       intToString(WEXITSTATUS(status)) + ", keeping this process");
+    else
+        LogConfig::reportInternalError("Upgrade: pid " + intToString(_upgrade_pid) +
+                                       " failed before becoming ready, keeping this process");
+    _upgrade_pid = -1;
+}
+
+// SIGUSR2로 실행된 새 바이너리: 설정과 리스너 준비가 끝났음을 이전 프로세스에 알립니다.
+void Server::notifyUpgradeParent()
+{
+    const char *value = getenv(READY_FD_ENV);
+    if (!value)
+        return;
+    int fd = std::atoi(value);
+    unsetenv(READY_FD_ENV);
+    char byte = 1;
+    if (write(fd, &byte, 1) != 1)
+        LogConfig::reportInternalError("Upgrade: failed to notify previous process: " +
+                                       std::string(strerror(errno)));
+    close(fd);
+}
+
+// 종료(SIGINT/SIGTERM) 또는 바이너리 교체 후: 리스너를 닫고(다른 프로세스가 같은 소켓을 계속 쓸 수 있음)
+// 유휴 keep-alive 연결은 바로 닫습니다. 진행 중인 요청은 응답을 끝까지 보낸 뒤 닫고,
+// 모든 연결이 끝나거나 shutdown_timeout이 지나면 종료합니다.
+// worker_threads의 워커 루프는 주 루프가 정한 마감 시각으로 자기 연결만 정리합니다.
+void Server::beginDrain()
+{
+    if (_draining)
+        return;
+    _draining = true;
+    if (_group == this)
+    {
+        _drain_deadline_us = monotonicMicros() + _shutdown_timeout_us;
+        for (size_t i = 0; i < _config->servers.size(); ++i)
+        {
+            std::vector<int> &sockets = _config->servers[i].server_sockets;
+            for (size_t j = 0; j < sockets.size(); ++j)
+            {
+                if (!_accept_paused)
+                    _poller->remove(sockets[j]);
+                close(sockets[j]);
+            }
+            sockets.clear();
+        }
+        for (size_t i = 0; i < _loops.size(); ++i)
+        {
+            _loops[i]->_drain_deadline_us = _drain_deadline_us;
+            __atomic_store_n(&_loops[i]->_drain_requested, true, __ATOMIC_RELEASE);
+            _loops[i]->wake();
+        }
+    }
+    std::vector<int> idle;
+    for (std::map<int, in_addr_t>::const_iterator it = _peerAddrs.begin(); it != _peerAddrs.end(); ++it)
+    {
+        int client_fd = it->first;
+        std::map<int, RecvChain *>::const_iterator chain = _recvChains.find(client_fd);
+        if ((chain == _recvChains.end() || chain->second->empty()) &&
+            _outgoingData.find(client_fd) == _outgoingData.end() && _delayed.find(client_fd) == _delayed.end() &&
+            _inflight.find(client_fd) == _inflight.end())
+            idle.push_back(client_fd);
+    }
+    for (size_t i = 0; i < idle.size(); ++i)
+        closeConnection(idle[i]);
+    LogConfig::reportInfo("Draining: closed " + sizeToString(idle.size()) + " idle connections, waiting for " +
+                          sizeToString(_peerAddrs.size()) + " in progress (up to " +
+                          sizeToString(_shutdown_timeout_us / 1000) + " ms)");
+}
+
+// 남은 연결을 모두 닫습니다. 보내던 응답은 중단된 상태로 기록됩니다.
+void Server::closeAllConnections()
+{
+    // IoPool 작업이 쓰는 요청과 아레나를 해제하기 전에 작업이 모두 돌아와야 합니다.
+    // 헤더를 기다리는 CGI 작업은 끝나지 않을 수 있으므로 shutdown_timeout이 지났으면 먼저 중단시킵니다.
+    if (!_inflight.empty() && (!_draining || monotonicMicros() >= _drain_deadline_us))
+        CGIHandler::abortPending();
+    waitForTasks();
+    if (_peerAddrs.empty())
+        return;
+    LogConfig::reportInfo("Closing " + sizeToString(_peerAddrs.size()) + " connections still open");
+    std::vector<int> open;
+    for (std::map<int, in_addr_t>::const_iterator it = _peerAddrs.begin(); it != _peerAddrs.end(); ++it)
+        open.push_back(it->first);
+    for (size_t i = 0; i < open.size(); ++i)
+        closeConnection(open[i]);
+    waitForSends();
+}
+
+// 주 루프는 모든 루프의 연결이 끝날 때까지 기다립니다.
+bool Server::drainFinished() const
+{
+    size_t open = _group == this ? connectionCount() : _peerAddrs.size();
+    return open == 0 || monotonicMicros() >= _drain_deadline_us;
+}
@@ -0,0 +1,181 @@
+#include "Server.hpp"
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+
+// 길이가 len인 chunk 하나를 덧붙입니다.
+static void appendChunk(std::string &out, const char *data, size_t len)
+{
+    char size_line[24];
+    int n = snprintf(size_line, sizeof(size_line), "%lx\r\n", static_cast<unsigned long>(len));
+    out.append(size_line, n);
+    out.append(data, len);
+    out.append("\r\n", 2);
+}
+
+// 응답 본문이 CGI 출력이면 헤더 뒤에 함께 읽힌 부분을 넣고, 나머지는 파이프가 읽기 가능할 때마다 보냅니다.
+// 스크립트가 요청 본문을 다 읽지 않았으면 stdin 파이프가 쓰기 가능할 때마다 이어 씁니다.
+void Server::attachStream(int client_fd, const Response &response)
+{
+    CgiStream *stream = response.getStream();
+    if (!stream)
+        return;
+    releaseStream(client_fd);
+    CGIHandler::retain(stream);
+    OutgoingStream &out = _outgoingStreams[client_fd];
+    out.stream = stream;
+    out.paused = false;
+    out.close_after = !stream->chunked;
+    _streamPipes[stream->fd] = client_fd;
+    if (!stream->head.empty() && !stream->discard)
+    {
+        std::string &buf = _outgoingData[client_fd];
+        if (stream->chunked)
+            appendChunk(buf, stream->head.data(), stream->head.size());
+        else
+            buf.append(stream->head);
+        _pendingRecords[client_fd].body_size += stream->head.size();
+    }
+    if (!setNonBlocking(stream->fd) || !_poller->add(stream->fd, POLLER_READ))
+    {
+        LogConfig::reportInternalError("Failed to watch CGI output for client_fd " + intToString(client_fd));
+        out.paused = true; // poller에 없으므로 endStream()이 빼지 않게 합니다.
+        endStream(client_fd, false);
+        return;
+    }
+    if (stream->in_fd == -1)
+        return;
+    if (_poller->add(stream->in_fd, POLLER_WRITE))
+        _streamPipes[stream->in_fd] = client_fd;
+    else
+        closeStreamInput(client_fd);
+}
+
+void Server::handleStreamEvent(int pipe_fd)
+{
+    std::map<int, int>::iterator pipe = _streamPipes.find(pipe_fd);
+    if (pipe == _streamPipes.end())
+        return;
+    std::map<int, OutgoingStream>::iterator out = _outgoingStreams.find(pipe->second);
+    if (out != _outgoingStreams.end() && out->second.stream && out->second.stream->in_fd == pipe_fd)
+        handleStreamWrite(pipe_fd);
+    else
+        handleStreamRead(pipe_fd);
+}
+
+// 요청 본문의 남은 부분을 CGI stdin에 씁니다. 본문은 응답을 다 보낼 때까지 _requestMap에 남아 있어 그대로 씁니다.
+void Server::handleStreamWrite(int pipe_fd)
+{
+    int client_fd = _streamPipes[pipe_fd];
+    CgiStream &stream = *_outgoingStreams[client_fd].stream;
+    std::map<int, Request>::const_iterator request = _requestMap.find(client_fd);
+    if (request == _requestMap.end() || CGIHandler::writeBody(stream, request->second.getBody()))
+        closeStreamInput(client_fd);
+}
+
+// 요청 본문을 다 썼거나 스크립트가 stdin을 닫았으면 파이프를 닫아 EOF를 알립니다.
+void Server::closeStreamInput(int client_fd)
+{
+    std::map<int, OutgoingStream>::iterator it = _outgoingStreams.find(client_fd);
+    if (it == _outgoingStreams.end() || !it->second.stream || it->second.stream->in_fd == -1)
+        return;
+    CgiStream *stream = it->second.stream;
+    if (_streamPipes.erase(stream->in_fd))
+        _poller->remove(stream->in_fd);
+    close(stream->in_fd);
+    stream->in_fd = -1;
+}
+
+// CGI 출력을 송신 버퍼가 찰 때까지 읽어 보냅니다.
+void Server::handleStreamRead(int pipe_fd)
+{
+    std::map<int, int>::iterator pipe = _streamPipes.find(pipe_fd);
+    if (pipe == _streamPipes.end())
+        return;
+    int client_fd = pipe->second;
+    OutgoingStream &out = _outgoingStreams[client_fd];
+    std::string &buf = _outgoingData[client_fd];
+    size_t &body_size = _pendingRecords[client_fd].body_size;
+    char data[CGI_READ_SIZE];
+    while (out.stream && buf.size() < CGI_STREAM_BUFFER)
+    {
+        ssize_t bytes_read = read(pipe_fd, data, sizeof(data));
+        if (bytes_read > 0)
+        {
+            if (out.stream->discard)
+                continue;
+            if (out.stream->chunked)
+                appendChunk(buf, data, bytes_read);
+            else
+                buf.append(data, bytes_read);
+            body_size += bytes_read;
+            continue;
+        }
+        if (bytes_read == -1 && errno == EINTR)
+            continue;
+        if (bytes_read == -1 && (errno == EAGAIN || errno == EWOULDBLOCK))
+            break;
+        if (bytes_read == -1)
+            LogConfig::reportInternalError("CGI output read failed: " + std::string(strerror(errno)));
+        endStream(client_fd, bytes_read == 0);
+    }
+    if (out.stream && buf.size() >= CGI_STREAM_BUFFER)
+        pauseStream(client_fd);
+    if (writePendingData(client_fd))
+        finishResponse(client_fd);
+}
+
+// 클라이언트가 받지 못하는 동안 파이프를 읽지 않습니다. (파이프가 차면 스크립트가 쓰기에서 기다림)
+void Server::pauseStream(int client_fd)
+{
+    OutgoingStream &out = _outgoingStreams[client_fd];
+    if (out.paused || !out.stream)
+        return;
+    _poller->remove(out.stream->fd);
+    out.paused = true;
+}
+
+void Server::resumeStream(int client_fd)
+{
+    std::map<int, OutgoingStream>::iterator it = _outgoingStreams.find(client_fd);
+    if (it == _outgoingStreams.end() || !it->second.paused || !it->second.stream)
+        return;
+    if (!_poller->add(it->second.stream->fd, POLLER_READ))
+    {
+        LogConfig::reportInternalError("Failed to resume CGI output for client_fd " + intToString(client_fd));
+        endStream(client_fd, false);
+        return;
+    }
+    it->second.paused = false;
+}
+
+// 파이프를 닫습니다. eof이면 본문 끝을 표시하고, 아니면 본문이 잘렸으므로 남은 버퍼를 보낸 뒤 연결을 닫습니다.
+void Server::endStream(int client_fd, bool eof)
+{
+    std::map<int, OutgoingStream>::iterator it = _outgoingStreams.find(client_fd);
+    if (it == _outgoingStreams.end() || !it->second.stream)
+        return;
+    closeStreamInput(client_fd);
+    CgiStream *stream = it->second.stream;
+    if (!it->second.paused)
+        _poller->remove(stream->fd);
+    _streamPipes.erase(stream->fd);
+    if (eof && stream->chunked)
+        _outgoingData[client_fd].append("0\r\n\r\n", 5);
+    stream->eof = eof;
+    if (!eof)
+        it->second.close_after = true;
+    std::map<int, RequestTiming>::iterator timing = _timings.find(client_fd);
+    if (timing != _timings.end())
+        timing->second.mark(PHASE_UPSTREAM_END);
+    Metrics::observeCgi(monotonicMicros() - stream->start_us, eof);
+    it->second.stream = NULL;
+    it->second.paused = false;
+    CGIHandler::release(stream);
+}
+
+void Server::releaseStream(int client_fd)
+{
+    endStream(client_fd, false);
+    _outgoingStreams.erase(client_fd);
+}
@@ -0,0 +1,99 @@
+#include "Server.hpp"
+#include <poll.h>
+
+// 풀 스레드에서 연결의 아레나와 타이밍으로 응답을 만듭니다. (그동안 이벤트 루프는 이 연결의 상태를 건드리지 않음)
+void ResponseTask::run()
+{
+    TimingScope timing_scope(timing);
+    ArenaScope arena_scope(arena);
+    try
+    {
+        response = Response::buildResponse(*request, *server_config, location);
+    }
+    catch (const std::exception &e)
+    {
+        LogConfig::reportInternalError(std::string("Response task failed: ") + e.what());
+        response = Response::createErrorResponse(500, *server_config);
+    }
+}
+
+void ResponseTask::complete()
+{
+    loop->postCompletion(this);
+}
+
+// 디스크를 쓰는 응답이면 IoPool에 맡깁니다. 맡겼으면 true (응답은 completeTask()에서 보냄)
+bool Server::dispatchResponse(int client_fd, const Request &request, const ServerConfig &server_config,
+                              const LocationConfig *location)
+{
+    IoQueue queue = Response::ioQueue(request, location);
+    if (queue == IO_QUEUE_NONE)
+        return false;
+    // 응답 객체의 헤더도 연결의 아레나에 할당되도록 ArenaScope 안에서 만듭니다.
+    ResponseTask *task = new ResponseTask();
+    task->loop = this;
+    task->fd = client_fd;
+    task->request = &request;
+    task->server_config = &server_config;
+    task->location = location;
+    task->config = _config;
+    task->arena = getArena(client_fd);
+    task->timing = &_timings[client_fd];
+    retainConfig(_config);
+    if (!IoPool::submit(queue, task))
+    {
+        releaseConfig(task->config);
+        delete task;
+        return false;
+    }
+    _inflight[client_fd] = task;
+    return true;
+}
+
+// (풀 스레드에서 호출) 대기열이 비어 있었을 때만 깨웁니다.
+void Server::postCompletion(ResponseTask *task)
+{
+    pthread_mutex_lock(&_wake_lock);
+    bool was_empty = _handoff.empty() && _completed.empty();
+    _completed.push_back(task);
+    pthread_mutex_unlock(&_wake_lock);
+    if (was_empty)
+        wake();
+}
+
+// 끝난 작업의 응답을 보냅니다. 작업 중에 연결이 끊겼으면 이제 닫습니다.
+void Server::completeTask(ResponseTask *task)
+{
+    int client_fd = task->fd;
+    _inflight.erase(client_fd);
+    bool detached = _detached.find(client_fd) != _detached.end();
+    // 끊긴 연결도 만든 응답으로 접근 로그를 남깁니다.
+    if (detached)
+        queueRecord(client_fd, *task->server_config, task->location, task->response, task->config);
+    else
+        queueResponse(client_fd, *task->server_config, task->location, task->response, task->config);
+    // 송신이 실패하면 연결과 아레나가 해제되므로 아레나를 쓰는 응답 객체는 먼저 정리합니다.
+    releaseConfig(task->config);
+    delete task;
+    if (detached)
+    {
+        closeConnection(client_fd);
+        return;
+    }
+    if (writePendingData(client_fd))
+        finishResponse(client_fd);
+}
+
+// 맡긴 작업이 모두 돌아올 때까지 기다립니다. (종료할 때 연결을 닫기 전에 호출)
+void Server::waitForTasks()
+{
+    while (!_inflight.empty())
+    {
+        struct pollfd wake_fd;
+        wake_fd.fd = _wake_fds[0];
+        wake_fd.events = POLLIN;
+        wake_fd.revents = 0;
+        poll(&wake_fd, 1, LOOP_CHECK_MS);
+        handleWake();
+    }
+}
@@ -0,0 +1,221 @@
+#include "Server.hpp"
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#ifdef __linux__
+#include <sys/eventfd.h>
+#endif
+
+// 워커 루프: 주 루프의 설정을 함께 쓰고, poller와 연결별 상태는 따로 가집니다. 리스너는 갖지 않습니다.
+Server::Server(Server *group)
+    : _config_file(group->_config_file), _executable(group->_executable), _config(group->_config), _poller(NULL),
+      _is_running(false), _completion_io(false), _worker_connections(group->_worker_connections),
+      _reject_overflow(group->_reject_overflow), _accept_paused(false), _accept_resume_us(0), _reserve_fd(-1),
+      _shutdown_timeout_us(group->_shutdown_timeout_us), _draining(false), _drain_deadline_us(0), _upgrade_pid(-1),
+      _upgrade_fd(-1), _group(group), _next_loop(0), _connection_count(0),
+      _config_generation(group->_config_generation), _drain_requested(false), _stop_requested(false)
+{
+    pthread_mutex_init(&_config_lock, NULL);
+    pthread_mutex_init(&_wake_lock, NULL);
+    _wake_fds[0] = _wake_fds[1] = -1;
+    // 주 루프 스레드에서 만들므로 설정이 바뀌는 중일 수 없습니다.
+    retainConfig(_config);
+    createPoller();
+    if (!openWakeFd())
+    {
+        std::string reason = strerror(errno);
+        closeWakeFd();
+        releaseConfig(_config);
+        pthread_mutex_destroy(&_config_lock);
+        pthread_mutex_destroy(&_wake_lock);
+        throw std::runtime_error("event loop wake fd: " + reason);
+    }
+}
+
+// 주 루프 외에 count - 1개의 워커 루프 스레드를 시작합니다. 시그널은 주 스레드만 받습니다.
+void Server::startLoops(size_t count)
+{
+    if (count <= 1)
+        return;
+    sigset_t all, old;
+    sigfillset(&all);
+    pthread_sigmask(SIG_SETMASK, &all, &old);
+    for (size_t i = 1; i < count; ++i)
+    {
+        Server *loop = NULL;
+        try
+        {
+            loop = new Server(this);
+        }
+        catch (const std::exception &e)
+        {
+            LogConfig::reportInternalError(std::string("Failed to create event loop: ") + e.what());
+            break;
+        }
+        pthread_t thread;
+        int err = pthread_create(&thread, NULL, runLoop, loop);
+        if (err != 0)
+        {
+            LogConfig::reportInternalError("Failed to start event loop thread: " + std::string(strerror(err)));
+            delete loop;
+            break;
+        }
+        _loops.push_back(loop);
+        _threads.push_back(thread);
+    }
+    pthread_sigmask(SIG_SETMASK, &old, NULL);
+    LogConfig::reportInfo("Running " + sizeToString(_loops.size() + 1) + " event loop threads");
+}
+
+// 워커 루프를 멈추고 기다립니다. 종료 대기로 이미 끝난 루프는 바로 합류합니다.
+void Server::stopLoops()
+{
+    for (size_t i = 0; i < _loops.size(); ++i)
+    {
+        __atomic_store_n(&_loops[i]->_stop_requested, true, __ATOMIC_RELEASE);
+        _loops[i]->wake();
+    }
+    for (size_t i = 0; i < _threads.size(); ++i)
+        pthread_join(_threads[i], NULL);
+    for (size_t i = 0; i < _loops.size(); ++i)
+        delete _loops[i];
+    _loops.clear();
+    _threads.clear();
+}
+
+void *Server::runLoop(void *arg)
+{
+    Server *loop = static_cast<Server *>(arg);
+    loop->start();
+    // 시간 안에 끝나지 않은 연결은 이 스레드에서 닫아 접근 로그까지 남깁니다.
+    loop->closeAllConnections();
+    BufferPool::releaseThreadCache();
+    return NULL;
+}
+
+// 워커 루프가 반복마다 주 루프의 상태를 따라갑니다. 멈춰야 하면 false
+bool Server::followGroup()
+{
+    if (__atomic_load_n(&_stop_requested, __ATOMIC_ACQUIRE))
+        return false;
+    if (__atomic_load_n(&_group->_config_generation, __ATOMIC_ACQUIRE) != _config_generation)
+    {
+        // 참조를 잡는 동안 주 루프가 이전 설정을 놓지 못하도록 잠급니다.
+        pthread_mutex_lock(&_group->_config_lock);
+        ConfigSnapshot *next = _group->_config;
+        retainConfig(next);
+        _config_generation = _group->_config_generation;
+        pthread_mutex_unlock(&_group->_config_lock);
+        releaseConfig(_config);
+        _config = next;
+    }
+    if (!_draining && __atomic_load_n(&_drain_requested, __ATOMIC_ACQUIRE))
+        beginDrain();
+    return true;
+}
+
+// 받은 연결을 주 루프와 워커 루프에 차례로 맡깁니다.
+void Server::handOff(int client_fd, in_addr_t addr)
+{
+    size_t index = _next_loop++ % (_loops.size() + 1);
+    if (index == 0)
+        registerClient(client_fd, addr);
+    else
+        _loops[index - 1]->enqueueClient(client_fd, addr);
+}
+
+// (주 루프 스레드에서 호출) 대기열이 비어 있었을 때만 깨웁니다. 그 뒤의 연결은 같은 깨움에서 함께 가져갑니다.
+void Server::enqueueClient(int client_fd, in_addr_t addr)
+{
+    PendingClient client;
+    client.fd = client_fd;
+    client.addr = addr;
+    pthread_mutex_lock(&_wake_lock);
+    bool was_empty = _handoff.empty() && _completed.empty();
+    _handoff.push_back(client);
+    pthread_mutex_unlock(&_wake_lock);
+    if (was_empty)
+        wake();
+}
+
+// 다른 스레드가 이 루프를 깨우는 fd를 만들어 poller에 넣습니다. Linux는 eventfd 하나를 읽기/쓰기에 함께 씁니다.
+bool Server::openWakeFd()
+{
+#ifdef __linux__
+    int fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (fd == -1)
+        return false;
+    _wake_fds[0] = _wake_fds[1] = fd;
+#else
+    if (pipe(_wake_fds) == -1 || !setNonBlocking(_wake_fds[0]) || !setNonBlocking(_wake_fds[1]))
+        return false;
+    fcntl(_wake_fds[0], F_SETFD, FD_CLOEXEC);
+    fcntl(_wake_fds[1], F_SETFD, FD_CLOEXEC);
+#endif
+    return _poller->add(_wake_fds[0], POLLER_READ);
+}
+
+void Server::closeWakeFd()
+{
+    if (_wake_fds[1] != -1 && _wake_fds[1] != _wake_fds[0])
+        close(_wake_fds[1]);
+    if (_wake_fds[0] != -1)
+        close(_wake_fds[0]);
+    _wake_fds[0] = _wake_fds[1] = -1;
+}
+
+// 넘겨받은 연결을 등록하고 IoPool에서 끝난 응답을 보냅니다.
+void Server::handleWake()
+{
+    char drain[64];
+    while (read(_wake_fds[0], drain, sizeof(drain)) > 0)
+        ;
+    std::vector<PendingClient> pending;
+    std::vector<ResponseTask *> completed;
+    pthread_mutex_lock(&_wake_lock);
+    pending.swap(_handoff);
+    completed.swap(_completed);
+    pthread_mutex_unlock(&_wake_lock);
+    for (size_t i = 0; i < pending.size(); ++i)
+        registerClient(pending[i].fd, pending[i].addr);
+    for (size_t i = 0; i < completed.size(); ++i)
+        completeTask(completed[i]);
+}
+
+void Server::registerClient(int client_fd, in_addr_t addr)
+{
+    bool added = _completion_io ? _poller->addReceiver(client_fd) : _poller->add(client_fd, POLLER_READ);
+    if (!added)
+    {
+        LogConfig::reportInternalError("Failed to add client_fd " + intToString(client_fd) + " to poller");
+        close(client_fd);
+        countConnection(-1);
+        return;
+    }
+    _peerAddrs[client_fd] = addr;
+    _timings[client_fd].reset();
+    Metrics::add(METRIC_HANDLED);
+}
+
+void Server::wake()
+{
+#ifdef __linux__
+    uint64_t one = 1;
+    ssize_t written = write(_wake_fds[1], &one, sizeof(one));
+#else
+    char byte = 1;
+    // pipe가 가득 차 있으면 이미 깨울 일이 남아 있는 것입니다.
+    ssize_t written = write(_wake_fds[1], &byte, 1);
+#endif
+    (void)written;
+}
+
+size_t Server::connectionCount() const
+{
+    return __atomic_load_n(&_group->_connection_count, __ATOMIC_RELAXED);
+}
+
+void Server::countConnection(long delta)
+{
+    __atomic_add_fetch(&_group->_connection_count, static_cast<size_t>(delta), __ATOMIC_RELAXED);
+}
@@ -5,35 +5,55 @@ extern const LocationConfig *matchLocationConfig(const Request &request, const S
 
 ServerConfig &Server::findMatchingServerConfig(int fd)
 {
-    for (size_t s = 0; s < _server_configs.size(); ++s)
+    // 리스너 목록은 주 루프만 바꾸고 읽습니다. 클라이언트 연결은 첫 서버 블록을 씁니다.
+    for (size_t s = 0; _group == this && s < _config->servers.size(); ++s)
     {
-        for (size_t sock = 0; sock < _server_configs[s].server_sockets.size(); ++sock)
+        for (size_t sock = 0; sock < _config->servers[s].server_sockets.size(); ++sock)
         {
-            if (fd == _server_configs[s].server_sockets[sock])
-                return _server_configs[s];
+            if (fd == _config->servers[s].server_sockets[sock])
+                return _config->servers[s];
         }
     }
-    return _server_configs[0];
-}
-
-std::set<int> &Server::getClosedFds()
-{
-    static std::set<int> closed;
-    return closed;
+    return _config->servers[0];
 }
 
 void Server::safelyCloseClient(int client_fd)
 {
-    static std::set<int> closed_fds;
-    if (closed_fds.find(client_fd) != closed_fds.end())
+    // 이미 닫은 연결이면 무시합니다. (fd 번호는 accept에서 재사용될 수 있으므로 열린 연결 목록으로 판단)
+    if (_peerAddrs.erase(client_fd) == 0)
         return;
-    if (!_poller->remove(client_fd))
+    countConnection(-1);
+    // 응답 작업 중에 끊긴 연결은 그때 이미 poller에서 뺐습니다.
+    if (_detached.erase(client_fd) == 0 && !_poller->remove(client_fd))
     {
         std::cerr << "Warning: Failed to remove fd " << intToString(client_fd) << " from poller" << std::endl;
     }
     // shutdown(client_fd, SHUT_WR);
     close(client_fd);
-    closed_fds.insert(client_fd);
+}
+
+// 연결과 연결별 상태를 모두 정리합니다. 보내던 응답이 있으면 (중단되었더라도) 먼저 기록합니다.
+void Server::closeConnection(int client_fd)
+{
+    if (_inflight.find(client_fd) != _inflight.end() || _sending.find(client_fd) != _sending.end())
+    {
+        // IoPool 작업이 요청과 아레나를, 제출한 송신이 송신 버퍼를 쓰는 중이므로 완료되면 닫습니다.
+        // (그때까지 fd 번호도 재사용되지 않고, remove()가 송신을 취소하므로 곧 완료됩니다)
+        if (_detached.insert(client_fd).second)
+            _poller->remove(client_fd);
+        return;
+    }
+    flushRecord(client_fd);
+    releaseConnLimit(client_fd);
+    _delayed.erase(client_fd);
+    safelyCloseClient(client_fd);
+    releaseRecvChain(client_fd);
+    _requestMap.erase(client_fd);
+    _outgoingData.erase(client_fd);
+    releaseFile(client_fd);
+    releaseStream(client_fd);
+    releaseArena(client_fd);
+    _timings.erase(client_fd);
 }
 
 bool Server::processClientRequest(int client_fd, const ServerConfig &server_config, const std::string &request_str,
@@ -41,50 +61,210 @@ bool Server::processClientRequest(int client_fd, const ServerConfig &server_conf
 {
     consumed = 0;
     bool isPartial = false;
-    Request request;
+    RequestTiming &timing = _timings[client_fd];
+    // 핸들러(realpath, CGI)에서도 단계 시각을 남길 수 있도록 현재 요청의 타이밍을 설정합니다.
+    TimingScope timing_scope(&timing);
+    // 이 요청에서 생성되는 헤더 맵/응답은 연결의 아레나에서 할당됩니다.
+    ArenaScope arena_scope(getArena(client_fd));
+    _requestMap.erase(client_fd);
+    Request &request = _requestMap[client_fd];
     if (!request.parse(request_str, consumed, isPartial))
     {
+        _requestMap.erase(client_fd);
         sendBadRequestResponse(client_fd, server_config);
         return false;
     }
     if (isPartial)
     {
+        _requestMap.erase(client_fd);
         consumed = 0;
         return true;
     }
-    _requestMap[client_fd] = request;
+    timing.mark(PHASE_PARSED);
+    std::map<int, in_addr_t>::const_iterator peer = _peerAddrs.find(client_fd);
+    if (peer != _peerAddrs.end())
+        request.setRemoteAddr(peer->second);
     const LocationConfig *matched_location = matchLocationConfig(request, server_config);
     if (matched_location == 0)
     {
         LogConfig::reportInternalError("No matching location found for path: " + request.getPath());
-        Response res = Response::createErrorResponse(404, server_config);
-        res.setHeader("Connection", "close");
-        sendResponse(client_fd, res);
+        {
+            Response res = Response::createErrorResponse(404, server_config);
+            res.setHeader("Connection", "close");
+            queueRecord(client_fd, server_config, NULL, res);
+            queueDirectResponse(client_fd, res);
+        }
+        writePendingData(client_fd);
+        return false;
+    }
+    LimitResult limit = checkLimits(client_fd, *matched_location);
+    if (limit == LIMIT_DELAY)
+    {
+        // 요청은 수신 버퍼에 그대로 남고, 재개 시각에 runDelayedRequests()가 다시 처리합니다.
+        _requestMap.erase(client_fd);
+        consumed = 0;
+        return true;
+    }
+    if (limit == LIMIT_REJECT)
+    {
+        {
+            Response res = Response::createErrorResponse(503, server_config);
+            res.setHeader("Retry-After", "1");
+            res.setHeader("Connection", "close");
+            queueRecord(client_fd, server_config, matched_location, res);
+            queueDirectResponse(client_fd, res);
+        }
+        writePendingData(client_fd);
         return false;
     }
-    Response res = Response::buildResponse(request, server_config, matched_location);
-    res.setHeader("Connection", "close");
-    sendResponse(client_fd, res);
     consumed = request_str.size();
+    // 파일 시스템을 쓰는 응답은 IoPool에서 만들고, 돌아오면 completeTask()가 보냅니다.
+    if (dispatchResponse(client_fd, request, server_config, matched_location))
+        return true;
+    {
+        Response res = Response::buildResponse(request, server_config, matched_location);
+        queueResponse(client_fd, server_config, matched_location, res, _config);
+    }
+    // 송신이 실패하면 연결과 아레나가 해제되므로 아레나를 쓰는 응답 객체는 먼저 정리합니다.
+    writePendingData(client_fd);
     return true;
 }
 
-void Server::sendResponse(int client_fd, const Response &response)
+// 만든 응답에 공통 헤더를 붙여 송신 버퍼에 넣습니다. config는 server_config, location이 속한 스냅샷
+void Server::queueResponse(int client_fd, const ServerConfig &server_config, const LocationConfig *location,
+                           Response &response, ConfigSnapshot *config)
 {
-    std::string response_str = response.toString();
-    _outgoingData[client_fd] += response_str;
-    writePendingData(client_fd);
+    RequestTiming &timing = _timings[client_fd];
+    timing.mark(PHASE_HANDLED);
+    if (server_config.server_timing)
+    {
+        std::string server_timing;
+        timing.serverTiming(server_timing);
+        response.setHeader("Server-Timing", server_timing);
+    }
+    response.setHeader("Connection", "close");
+    queueRecord(client_fd, server_config, location, response, config);
+    response.serialize(_outgoingData[client_fd]);
+    attachFile(client_fd, response);
+    attachStream(client_fd, response);
+}
+
+Arena *Server::getArena(int client_fd)
+{
+    std::map<int, Arena *>::iterator it = _arenas.find(client_fd);
+    if (it != _arenas.end())
+        return it->second;
+    Arena *arena = new Arena();
+    _arenas[client_fd] = arena;
+    return arena;
+}
+
+void Server::releaseArena(int client_fd)
+{
+    std::map<int, Arena *>::iterator it = _arenas.find(client_fd);
+    if (it == _arenas.end())
+        return;
+    delete it->second;
+    _arenas.erase(it);
+}
+
+RecvChain *Server::getRecvChain(int client_fd)
+{
+    std::map<int, RecvChain *>::iterator it = _recvChains.find(client_fd);
+    if (it != _recvChains.end())
+        return it->second;
+    RecvChain *chain = new RecvChain();
+    _recvChains[client_fd] = chain;
+    return chain;
+}
+
+void Server::releaseRecvChain(int client_fd)
+{
+    std::map<int, RecvChain *>::iterator it = _recvChains.find(client_fd);
+    if (it == _recvChains.end())
+        return;
+    delete it->second;
+    _recvChains.erase(it);
+}
+
+// 공통 헤더 없이 송신 버퍼에 넣기만 합니다. 보내기(writePendingData)는 호출한 쪽이 응답 객체를 정리한 뒤에 합니다.
+// (송신이 실패하면 연결과 아레나가 해제되므로 아레나를 쓰는 응답 객체가 그보다 오래 살면 안 됨)
+void Server::queueDirectResponse(int client_fd, const Response &response)
+{
+    response.serialize(_outgoingData[client_fd]);
+    attachFile(client_fd, response);
 }
 
 void Server::sendBadRequestResponse(int client_fd, const ServerConfig &server_config)
 {
-    Response res;
-    res.setStatus(BAD_REQUEST_404);
-    std::string error_body = "<h1>400 Bad Request</h1>";
-    if (server_config.error_pages.find(400) != server_config.error_pages.end())
-        error_body = server_config.error_pages.at(400);
-    res.setBody(error_body);
-    res.setHeader("Content-Length", intToString(error_body.length()));
-    res.setHeader("Content-Type", "text/html");
-    sendResponse(client_fd, res);
+    {
+        Response res;
+        res.setStatus(400);
+        std::string error_body = "<h1>400 Bad Request</h1>";
+        if (server_config.error_pages.find(400) != server_config.error_pages.end())
+            error_body = server_config.error_pages.at(400);
+        res.setBody(error_body);
+        res.setHeader("Content-Type", "text/html");
+        queueRecord(client_fd, server_config, NULL, res);
+        queueDirectResponse(client_fd, res);
+    }
+    writePendingData(client_fd);
+}
+
+// 송신을 시작하는 응답의 기록 정보를 보관합니다. 마지막 바이트를 보냈거나 연결이 닫힐 때 flushRecord()로 기록합니다.
+// config가 없으면 현재 설정(_config)의 server_config/location입니다.
+void Server::queueRecord(int client_fd, const ServerConfig &server_config, const LocationConfig *location,
+                         const Response &response, ConfigSnapshot *config)
+{
+    ResponseRecord &record = _pendingRecords[client_fd];
+    if (!config)
+        config = _config;
+    // 보내는 동안 SIGHUP으로 설정이 바뀌어도 기록할 때까지 server_config/location이 유효하도록 스냅샷을 잡아 둡니다.
+    retainConfig(config);
+    releaseConfig(record.config);
+    record.config = config;
+    record.server_config = &server_config;
+    record.location = location;
+    record.status = response.getStatusCode();
+    record.body_size = response.getBodySize();
+}
+
+void Server::flushRecord(int client_fd)
+{
+    std::map<int, ResponseRecord>::iterator it = _pendingRecords.find(client_fd);
+    if (it == _pendingRecords.end())
+        return;
+    ResponseRecord record = it->second;
+    _pendingRecords.erase(it);
+    std::map<int, Request>::const_iterator request = _requestMap.find(client_fd);
+    recordResponse(client_fd, *record.server_config, request != _requestMap.end() ? &request->second : NULL,
+                   record.location, record.status, record.body_size);
+    releaseConfig(record.config);
+}
+
+// 응답 하나에 대한 메트릭, 접근 로그, 느린 요청 로그를 남깁니다. location이 없으면 지연 시간은 기록하지 않습니다.
+void Server::recordResponse(int client_fd, const ServerConfig &server_config, const Request *request,
+                            const LocationConfig *location, int status, size_t body_size)
+{
+    std::map<int, RequestTiming>::const_iterator timing = _timings.find(client_fd);
+    uint64_t total_us = (timing != _timings.end()) ? timing->second.total() : 0;
+    Metrics::countResponse(status);
+    if (location && total_us)
+        Metrics::observeRequest(location->metrics_id, total_us);
+    bool slow = server_config.slow_request_log_id >= 0 && total_us >= server_config.slow_request_threshold_us;
+    if (server_config.access_log_id < 0 && !slow)
+        return;
+    AccessLogEntry entry;
+    std::map<int, in_addr_t>::const_iterator it = _peerAddrs.find(client_fd);
+    if (it != _peerAddrs.end())
+        entry.remote_addr = it->second;
+    entry.request = request;
+    entry.status = status;
+    entry.body_bytes_sent = body_size;
+    if (timing != _timings.end())
+        entry.timing = &timing->second;
+    if (server_config.access_log_id >= 0)
+        AccessLog::log(server_config.access_log_id, server_config, entry);
+    if (slow)
+        AccessLog::log(server_config.slow_request_log_id, server_config, entry);
 }
@@ -1,69 +1,228 @@
 #include "Server.hpp"
 #include "ServerWriteHelper.hpp"
+#include <algorithm>
 #include <cstring>
 #include <errno.h>
 #include <fcntl.h>
-#include <set>
 
-void Server::writePendingData(int client_fd)
+// 송신 버퍼와 이어 보낼 파일 본문을 보낼 수 있는 만큼 보냅니다. 모두 보냈으면 true (CGI 출력은 EOF까지)
+// io_uring이면 제출만 하고, 완료되었을 때 handleSent()가 다시 부릅니다.
+bool Server::writePendingData(int client_fd)
 {
-    static std::set<int> closed_fds;
-    if (closed_fds.find(client_fd) != closed_fds.end())
-        return;
     std::string &buf = _outgoingData[client_fd];
-    if (!writePendingDataHelper(_poller.get(), client_fd, buf))
+    std::map<int, OutgoingFile>::iterator file = _outgoingFiles.find(client_fd);
+    std::map<int, OutgoingStream>::iterator stream = _outgoingStreams.find(client_fd);
+    OutgoingFile *body = file != _outgoingFiles.end() ? &file->second : NULL;
+    size_t pending = buf.size() + (body ? body->file->size - body->offset : 0);
+    bool ok = _completion_io ? submitSend(client_fd, buf, body)
+                             : writePendingDataHelper(_poller.get(), client_fd, buf, body);
+    if (!ok)
     {
-        safelyCloseClient(client_fd);
-        _outgoingData.erase(client_fd);
-        // closed_fds.insert(client_fd);
-        return;
+        closeConnection(client_fd);
+        return false;
     }
-    if (!buf.empty())
+    std::map<int, OutgoingSend>::const_iterator sending = _sending.find(client_fd);
+    size_t remaining = buf.size() + (body ? body->file->size - body->offset : 0) +
+                       (sending != _sending.end() ? sending->second.head.size() : 0);
+    std::map<int, RequestTiming>::iterator timing = _timings.find(client_fd);
+    if (timing != _timings.end() && remaining < pending)
+        timing->second.markOnce(PHASE_FIRST_BYTE);
+    if (stream != _outgoingStreams.end() && stream->second.paused && buf.size() < CGI_STREAM_BUFFER)
+        resumeStream(client_fd);
+    if (remaining > 0 || (stream != _outgoingStreams.end() && stream->second.stream))
+        return false;
+    if (body)
+        releaseFile(client_fd);
+    if (timing != _timings.end())
+        timing->second.mark(PHASE_LAST_BYTE);
+    return true;
+}
+
+// 보내지 못한 응답 바이트가 남아 있는지
+bool Server::outputPending(int client_fd) const
+{
+    std::map<int, std::string>::const_iterator out = _outgoingData.find(client_fd);
+    if (out != _outgoingData.end() && !out->second.empty())
+        return true;
+    return _outgoingFiles.find(client_fd) != _outgoingFiles.end() ||
+           _outgoingStreams.find(client_fd) != _outgoingStreams.end() || _sending.find(client_fd) != _sending.end();
+}
+
+// 직렬화한 헤더 뒤에 응답의 매핑된 본문을 이어 보내도록 참조를 잡아 둡니다.
+void Server::attachFile(int client_fd, const Response &response)
+{
+    MappedFile *file = response.getFile();
+    if (!file)
         return;
-    if (checkKeepAliveNeeded(client_fd))
-    {
-        if (!_poller->modify(client_fd, POLLER_READ))
-        {
-            if (errno != ENOENT)
-                // 만약 errno가 ENOENT이면 이미 제거된 것으로 간주하고 무시할 수 있습니다.
-                LogConfig::reportInternalError("writePendingData: Failed to reset to READ event for client_fd " +
-                                               intToString(client_fd));
-            safelyCloseClient(client_fd);
-            _outgoingData.erase(client_fd);
-            // closed_fds.insert(client_fd);
-        }
-    }
-    else
+    FileCache::retain(file);
+    releaseFile(client_fd);
+    OutgoingFile &body = _outgoingFiles[client_fd];
+    body.file = file;
+    body.offset = 0;
+}
+
+void Server::releaseFile(int client_fd)
+{
+    std::map<int, OutgoingFile>::iterator it = _outgoingFiles.find(client_fd);
+    if (it == _outgoingFiles.end())
+        return;
+    FileCache::release(it->second.file);
+    _outgoingFiles.erase(it);
+}
+
+// 응답을 모두 보낸 뒤: 기록하고, keep-alive이면 다음 요청을 위해 상태를 비우고 아니면 연결을 닫습니다.
+void Server::finishResponse(int client_fd)
+{
+    flushRecord(client_fd);
+    releaseConnLimit(client_fd);
+    if (!checkKeepAliveNeeded(client_fd))
     {
-        safelyCloseClient(client_fd);
-        _outgoingData.erase(client_fd);
+        closeConnection(client_fd);
+        return;
     }
+    _requestMap.erase(client_fd);
+    _outgoingData.erase(client_fd);
+    releaseFile(client_fd);
+    releaseStream(client_fd);
+    // 요청에 사용한 메모리를 한 번에 돌려받고 다음 keep-alive 요청에 재사용합니다.
+    std::map<int, Arena *>::iterator arena = _arenas.find(client_fd);
+    if (arena != _arenas.end())
+        arena->second->reset();
+    _timings[client_fd].reset();
 }
 
 bool Server::checkKeepAliveNeeded(int client_fd)
 {
-    if (_requestMap.find(client_fd) == _requestMap.end())
+    // 종료 중에는 응답을 보낸 뒤 연결을 닫습니다.
+    if (_draining || _requestMap.find(client_fd) == _requestMap.end())
         return false;
-    Request &req = _requestMap[client_fd];
-    std::string httpVersion = req.getHTTPVersion();
-    std::map<std::string, std::string> headers = req.getHeaders();
-    std::string connHeader = (headers.find("Connection") != headers.end()) ? headers["Connection"] : "";
-    connHeader = toLower(connHeader);
+    std::map<int, OutgoingStream>::const_iterator stream = _outgoingStreams.find(client_fd);
+    if (stream != _outgoingStreams.end() && stream->second.close_after)
+        return false;
+    const Request &req = _requestMap[client_fd];
+    const std::string &httpVersion = req.getHTTPVersion();
+    const HeaderMap &headers = req.getHeaders();
+    HeaderMap::const_iterator conn_it = headers.find("Connection");
+    static const std::string empty;
+    const std::string &connHeader = (conn_it != headers.end()) ? conn_it->second : empty;
     if (httpVersion == "HTTP/1.1" || httpVersion == "HTTP/2.0")
-        return (connHeader != "close");
+        return !iequals(connHeader, "close");
     else if (httpVersion == "HTTP/1.0")
-        return (connHeader == "keep-alive");
+        return iequals(connHeader, "keep-alive");
     return false;
 }
 
+// 준비 이벤트(또는 io_uring의 송신 완료)에서 남은 응답을 이어서 보내고, 다 보냈으면 마무리합니다.
 void Server::handleClientWrite(int client_fd)
 {
-    if (_outgoingData.find(client_fd) == _outgoingData.end() || _outgoingData[client_fd].empty())
+    if (!_completion_io && !outputPending(client_fd))
     {
         _poller->modify(client_fd, POLLER_READ);
         return;
     }
-    writePendingData(client_fd);
+    if (!writePendingData(client_fd))
+    {
+        // 보낼 것은 다 보냈고 CGI 출력을 기다리는 중이면 쓰기 이벤트를 끕니다.
+        std::map<int, std::string>::const_iterator out = _outgoingData.find(client_fd);
+        if (out != _outgoingData.end() && out->second.empty() && _sending.find(client_fd) == _sending.end() &&
+            _outgoingStreams.find(client_fd) != _outgoingStreams.end())
+            _poller->modify(client_fd, POLLER_READ);
+        return;
+    }
+    // 송신 중에 멈춰 두었던 읽기를 다시 시작합니다.
+    if (!_poller->modify(client_fd, POLLER_READ))
+    {
+        if (errno != ENOENT)
+            LogConfig::reportInternalError("handleClientWrite: Failed to reset to READ event for client_fd " +
+                                           intToString(client_fd));
+        closeConnection(client_fd);
+        return;
+    }
+    finishResponse(client_fd);
+}
+
+// io_uring: 송신 버퍼와 파일 본문을 SENDMSG 하나로 제출합니다. 버퍼는 완료될 때까지 _sending으로 옮겨 두고,
+// 그동안 쌓이는 CGI 출력은 다음 제출에 보냅니다. 이미 제출한 송신이 있으면 그 완료를 기다립니다.
+bool Server::submitSend(int client_fd, std::string &buf, OutgoingFile *file)
+{
+    if (_sending.find(client_fd) != _sending.end())
+        return true;
+    size_t file_len = file ? file->file->size - file->offset : 0;
+    if (buf.empty() && file_len == 0)
+        return true;
+    OutgoingSend &send = _sending[client_fd];
+    send.head.swap(buf);
+    send.file_len = file_len;
+    struct iovec iov[2];
+    int iovcnt = 0;
+    if (!send.head.empty())
+    {
+        iov[iovcnt].iov_base = const_cast<char *>(send.head.data());
+        iov[iovcnt++].iov_len = send.head.size();
+    }
+    if (file_len > 0)
+    {
+        iov[iovcnt].iov_base = const_cast<char *>(file->file->data + file->offset);
+        iov[iovcnt++].iov_len = file_len;
+    }
+    if (!_poller->send(client_fd, iov, iovcnt))
+    {
+        LogConfig::reportInternalError("submitSend: Failed to submit send for client_fd " + intToString(client_fd) +
+                                       ": " + strerror(errno));
+        buf.swap(send.head);
+        _sending.erase(client_fd);
+        return false;
+    }
+    // 응답을 다 보낼 때까지는 다음 요청을 받지 않습니다.
+    _poller->modify(client_fd, POLLER_WRITE);
+    return true;
+}
+
+// io_uring: 제출한 송신이 끝났습니다. 못 보낸 바이트는 송신 버퍼 앞에 되돌리고 준비 이벤트처럼 이어서 보냅니다.
+void Server::handleSent(int client_fd, int result)
+{
+    std::map<int, OutgoingSend>::iterator it = _sending.find(client_fd);
+    if (it == _sending.end())
+        return;
+    std::string head;
+    head.swap(it->second.head);
+    _sending.erase(it);
+    // 송신 중에 끊긴 연결은 송신 버퍼를 해제할 수 있게 된 지금 닫습니다.
+    if (_detached.find(client_fd) != _detached.end() || result <= 0)
+    {
+        closeConnection(client_fd);
+        return;
+    }
+    size_t sent = static_cast<size_t>(result);
+    Metrics::add(METRIC_BYTES_OUT, sent);
+    std::map<int, RequestTiming>::iterator timing = _timings.find(client_fd);
+    if (timing != _timings.end())
+        timing->second.markOnce(PHASE_FIRST_BYTE);
+    size_t from_head = std::min(sent, head.size());
+    if (from_head < head.size())
+        _outgoingData[client_fd].insert(0, head, from_head, std::string::npos);
+    std::map<int, OutgoingFile>::iterator file = _outgoingFiles.find(client_fd);
+    if (file != _outgoingFiles.end())
+        file->second.offset += sent - from_head;
+    handleClientWrite(client_fd);
+}
+
+// 종료할 때: 연결을 닫으며 취소한 송신의 완료를 받을 때까지 기다립니다. (그 전에는 송신 버퍼를 해제할 수 없음)
+void Server::waitForSends()
+{
+    for (int round = 0; !_sending.empty() && round < IO_URING_SEND_CANCEL_ROUNDS; ++round)
+    {
+        std::vector<Event> events;
+        if (_poller->poll(events, LOOP_CHECK_MS) < 0)
+            break;
+        for (size_t i = 0; i < events.size(); ++i)
+        {
+            if (events[i].events & POLLER_SENT)
+                handleSent(events[i].fd, events[i].result);
+        }
+    }
+    if (!_sending.empty())
+        LogConfig::reportInternalError("Exiting with " + sizeToString(_sending.size()) + " sends still in flight");
 }
 
 bool Server::setNonBlocking(int fd)
@@ -78,14 +237,14 @@ bool Server::setNonBlocking(int fd)
 
 bool Server::isServerSocket(int fd, ServerConfig **matched_server) const
 {
-    for (size_t s = 0; s < _server_configs.size(); ++s)
+    for (size_t s = 0; s < _config->servers.size(); ++s)
     {
-        for (size_t sock = 0; sock < _server_configs[s].server_sockets.size(); ++sock)
+        for (size_t sock = 0; sock < _config->servers[s].server_sockets.size(); ++sock)
         {
-            if (fd == _server_configs[s].server_sockets[sock])
+            if (fd == _config->servers[s].server_sockets[sock])
             {
                 if (matched_server)
-                    *matched_server = const_cast<ServerConfig *>(&_server_configs[s]);
+                    *matched_server = const_cast<ServerConfig *>(&_config->servers[s]);
                 return true;
             }
         }
@@ -1,23 +1,56 @@
 #include "ServerWriteHelper.hpp"
 #include "Log.hpp"
+#include "Metrics.hpp"
 #include "Utils.hpp"
+#include <algorithm>
 #include <cstring>
 #include <errno.h>
 #include <string>
+#include <sys/uio.h>
 
 // 데이터를 모두 보내는 함수
-static bool sendAllData(Poller *poller, int client_fd, std::string &buf)
+// 헤더와 매핑된 본문을 iovec 두 개로 묶어 보냅니다. (writev와 같지만 MSG_NOSIGNAL을 주려고 sendmsg 사용)
+static bool sendAllData(Poller *poller, int client_fd, std::string &buf, OutgoingFile *file)
 {
-    while (!buf.empty())
+    while (!buf.empty() || (file && file->offset < file->file->size))
     {
-        ssize_t sent = send(client_fd, buf.c_str(), buf.size(), 0);
+        struct iovec iov[2];
+        struct msghdr msg;
+        std::memset(&msg, 0, sizeof(msg));
+        msg.msg_iov = iov;
+        if (!buf.empty())
+        {
+            iov[msg.msg_iovlen].iov_base = const_cast<char *>(buf.data());
+            iov[msg.msg_iovlen].iov_len = buf.size();
+            ++msg.msg_iovlen;
+        }
+        if (file && file->offset < file->file->size)
+        {
+            iov[msg.msg_iovlen].iov_base = const_cast<char *>(file->file->data + file->offset);
+            iov[msg.msg_iovlen].iov_len = file->file->size - file->offset;
+            ++msg.msg_iovlen;
+        }
+        ssize_t sent = sendmsg(client_fd, &msg, MSG_NOSIGNAL);
         if (sent > 0)
-            buf.erase(0, sent); // 전송한 만큼 버퍼에서 제거합니다.
+        {
+            Metrics::add(METRIC_BYTES_OUT, sent);
+            size_t from_buf = std::min(static_cast<size_t>(sent), buf.size());
+            buf.erase(0, from_buf); // 전송한 만큼 버퍼에서 제거합니다.
+            if (file)
+                file->offset += sent - from_buf;
+        }
         else if (sent == 0)
             return false; // send()가 0을 반환하는 경우는 보통 발생하지 않으므로 오류 처리
-        else // sent == -1 인 경우, errno를 사용하지 않으므로 임시 조건으로 처리합니다.
+        else if (errno == EFAULT && file)
+        {
+            // 보내는 중에 매핑한 파일이 잘려 나갔습니다. (응답 길이를 지킬 수 없으므로 연결을 닫음)
+            LogConfig::reportInternalError("sendAllData: mapped file truncated: " + file->file->path);
+            return false;
+        }
+        else // sent == -1 인 경우 (EAGAIN 등), 쓰기 이벤트에서 재시도합니다.
         {
-            if (!poller->modify(client_fd, POLLER_READ | POLLER_WRITE))
+            // 응답을 다 보낼 때까지는 다음 요청을 읽지 않습니다.
+            if (!poller->modify(client_fd, POLLER_WRITE))
             {
                 LogConfig::reportInternalError("sendAllData: Failed to modify events for client_fd " +
                                                intToString(client_fd));
@@ -30,8 +63,7 @@ static bool sendAllData(Poller *poller, int client_fd, std::string &buf)
 }
 
 // writePendingDataHelper()는 sendAllData()를 호출하여 전송을 진행합니다.
-bool writePendingDataHelper(Poller *poller, int client_fd, std::string &buf)
+bool writePendingDataHelper(Poller *poller, int client_fd, std::string &buf, OutgoingFile *file)
 {
-    return sendAllData(poller, client_fd, buf);
+    return sendAllData(poller, client_fd, buf, file);
 }
-
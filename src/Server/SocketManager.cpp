@@ -51,9 +51,9 @@ void SocketManager::bindSocket(int sockfd, int port)
     }
 }
 
-void SocketManager::startListening(int sockfd, int port)
+void SocketManager::startListening(int sockfd, int port, int backlog)
 {
-    if (listen(sockfd, SOMAXCONN) < 0)
+    if (listen(sockfd, backlog) < 0)
     {
         std::string errMsg = "listen() failed for port " + intToString(port) + ": " + strerror(errno);
         LogConfig::reportInternalError(errMsg);
@@ -62,6 +62,15 @@ void SocketManager::startListening(int sockfd, int port)
     }
 }
 
+int SocketManager::openListener(int port, int backlog)
+{
+    int sockfd = createSocket(port);
+    setSocketNonBlocking(sockfd, port);
+    bindSocket(sockfd, port);
+    startListening(sockfd, port, backlog);
+    return sockfd;
+}
+
 bool SocketManager::readFromSocketOnce(int client_socket, std::string &data)
 {
     char buf[BUFFER_SIZE];
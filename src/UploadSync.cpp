@@ -0,0 +1,137 @@
+#include "UploadSync.hpp"
+#include "Log.hpp"
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <pthread.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <unistd.h>
+#include <vector>
+
+// commit()을 부른 스레드의 스택에 있는 요청. 처리되면 flusher가 done을 켭니다.
+struct SyncRequest
+{
+    int fd;
+    dev_t dev;
+    bool done;
+    bool ok;
+};
+
+static pthread_mutex_t g_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t g_wake = PTHREAD_COND_INITIALIZER; // flusher를 깨움
+static pthread_cond_t g_done = PTHREAD_COND_INITIALIZER; // 한 묶음이 끝남
+static std::vector<SyncRequest *> g_pending;
+static pthread_t g_thread;
+static bool g_started = false;
+static bool g_stopping = false;
+
+static void deadlineAfter(struct timespec &ts, long ms)
+{
+    struct timeval now;
+    gettimeofday(&now, NULL);
+    long usec = now.tv_usec + ms * 1000;
+    ts.tv_sec = now.tv_sec + usec / 1000000;
+    ts.tv_nsec = (usec % 1000000) * 1000;
+}
+
+bool UploadSync::commit(int fd)
+{
+    SyncRequest request;
+    struct stat st;
+    if (fstat(fd, &st) != 0)
+        return false;
+    request.fd = fd;
+    request.dev = st.st_dev;
+    request.done = false;
+    request.ok = false;
+
+    pthread_mutex_lock(&g_lock);
+    if (!g_started && !g_stopping)
+    {
+        // 시그널은 주 스레드만 받습니다.
+        sigset_t all, old;
+        sigfillset(&all);
+        pthread_sigmask(SIG_SETMASK, &all, &old);
+        int err = pthread_create(&g_thread, NULL, flusherMain, NULL);
+        pthread_sigmask(SIG_SETMASK, &old, NULL);
+        if (err != 0)
+            LogConfig::reportInternalError("Failed to start upload fsync thread: " + std::string(strerror(err)));
+        g_started = (err == 0);
+    }
+    if (!g_started)
+    {
+        // 스레드가 없으면 혼자 fsync합니다.
+        pthread_mutex_unlock(&g_lock);
+        return fsync(fd) == 0;
+    }
+    g_pending.push_back(&request);
+    if (g_pending.size() == 1 || g_pending.size() >= UPLOAD_FSYNC_BATCH_MAX)
+        pthread_cond_signal(&g_wake);
+    while (!request.done)
+        pthread_cond_wait(&g_done, &g_lock);
+    pthread_mutex_unlock(&g_lock);
+    return request.ok;
+}
+
+void *UploadSync::flusherMain(void *)
+{
+    pthread_mutex_lock(&g_lock);
+    for (;;)
+    {
+        while (g_pending.empty() && !g_stopping)
+            pthread_cond_wait(&g_wake, &g_lock);
+        if (g_pending.empty())
+            break;
+        // 첫 요청이 들어온 뒤 잠시 더 모읍니다.
+        struct timespec deadline;
+        deadlineAfter(deadline, UPLOAD_FSYNC_BATCH_MS);
+        while (!g_stopping && g_pending.size() < UPLOAD_FSYNC_BATCH_MAX &&
+               pthread_cond_timedwait(&g_wake, &g_lock, &deadline) != ETIMEDOUT)
+            ;
+        std::vector<SyncRequest *> batch;
+        batch.swap(g_pending);
+        pthread_mutex_unlock(&g_lock);
+
+        // 같은 파일 시스템의 요청은 syncfs() 한 번이 모두 덮습니다.
+        std::vector<bool> synced(batch.size(), false);
+        for (size_t i = 0; i < batch.size(); ++i)
+        {
+            if (synced[i])
+                continue;
+            bool ok = syncfs(batch[i]->fd) == 0;
+            if (!ok)
+                LogConfig::reportInternalError("syncfs failed for upload: " + std::string(strerror(errno)));
+            for (size_t j = i; j < batch.size(); ++j)
+            {
+                if (!synced[j] && batch[j]->dev == batch[i]->dev)
+                {
+                    batch[j]->ok = ok;
+                    synced[j] = true;
+                }
+            }
+        }
+
+        pthread_mutex_lock(&g_lock);
+        for (size_t i = 0; i < batch.size(); ++i)
+            batch[i]->done = true;
+        pthread_cond_broadcast(&g_done);
+    }
+    pthread_mutex_unlock(&g_lock);
+    return NULL;
+}
+
+void UploadSync::stop()
+{
+    pthread_mutex_lock(&g_lock);
+    bool started = g_started;
+    g_stopping = true;
+    pthread_cond_signal(&g_wake);
+    pthread_mutex_unlock(&g_lock);
+    if (started)
+        pthread_join(g_thread, NULL);
+    pthread_mutex_lock(&g_lock);
+    g_started = false;
+    g_stopping = false;
+    pthread_mutex_unlock(&g_lock);
+}
@@ -1,28 +1,11 @@
 #include "Utils.hpp"
+#include "MimeTypes.hpp"
+#include <ctime>
 
+// 설정의 types 표에서 찾습니다. (MimeTypes)
 std::string getMimeType(const std::string &path)
 {
-    size_t dot = path.find_last_of('.');
-    if (dot != std::string::npos)
-    {
-        std::string ext = path.substr(dot + 1);
-        if (ext == "html" || ext == "htm")
-            return "text/html";
-        if (ext == "css")
-            return "text/css";
-        if (ext == "js")
-            return "application/javascript";
-        if (ext == "png")
-            return "image/png";
-        if (ext == "jpg" || ext == "jpeg")
-            return "image/jpeg";
-        if (ext == "gif")
-            return "image/gif";
-        if (ext == "txt")
-            return "text/plain";
-        // 필요한 MIME 타입 추가
-    }
-    return "application/octet-stream"; // 기본 MIME 타입
+    return MimeTypes::lookup(path);
 }
 
 std::string normalizePath(const std::string &path)
@@ -87,12 +70,60 @@ std::string trim(const std::string &str)
     return str.substr(first, (last - first + 1));
 }
 
+static const char DIGIT_PAIRS[] = "00010203040506070809"
+                                  "10111213141516171819"
+                                  "20212223242526272829"
+                                  "30313233343536373839"
+                                  "40414243444546474849"
+                                  "50515253545556575859"
+                                  "60616263646566676869"
+                                  "70717273747576777879"
+                                  "80818283848586878889"
+                                  "90919293949596979899";
+
+// 두 자리씩 뒤에서부터 채우는 정수 -> ASCII 변환 (buf는 최소 20바이트)
+size_t formatDecimal(char *buf, unsigned long value)
+{
+    char tmp[20];
+    char *p = tmp + sizeof(tmp);
+    while (value >= 100)
+    {
+        unsigned long idx = (value % 100) * 2;
+        value /= 100;
+        *--p = DIGIT_PAIRS[idx + 1];
+        *--p = DIGIT_PAIRS[idx];
+    }
+    if (value >= 10)
+    {
+        *--p = DIGIT_PAIRS[value * 2 + 1];
+        *--p = DIGIT_PAIRS[value * 2];
+    }
+    else
+        *--p = static_cast<char>('0' + value);
+    size_t len = tmp + sizeof(tmp) - p;
+    memcpy(buf, p, len);
+    return len;
+}
+
 // C++98 호환을 위한 int to string 변환 함수 정의
 std::string intToString(int number)
 {
-    std::stringstream ss;
-    ss << number;
-    return ss.str();
+    char buf[24];
+    size_t len = 0;
+    unsigned long value = static_cast<unsigned long>(number);
+    if (number < 0)
+    {
+        buf[len++] = '-';
+        value = 0UL - value;
+    }
+    len += formatDecimal(buf + len, value);
+    return std::string(buf, len);
+}
+
+std::string sizeToString(size_t number)
+{
+    char buf[24];
+    return std::string(buf, formatDecimal(buf, number));
 }
 
 // 파일 이름 정제를 위한 함수 객체(디렉토리 트래버셜 방지)
@@ -279,4 +310,11 @@ size_t parseClientBodySize(const std::string &str)
     std::istringstream iss(numPart);
     iss >> number;
     return number * multiplier;
-}
\ No newline at end of file
+}
+
+uint64_t monotonicMicros()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1000000 + ts.tv_nsec / 1000;
+}
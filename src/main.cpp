@@ -1,14 +1,37 @@
 #include "Server.hpp"
 
 volatile sig_atomic_t shutdown_flag = 0;
+volatile sig_atomic_t reload_flag = 0;
+volatile sig_atomic_t upgrade_flag = 0;
 Server *g_server = NULL;
 
 void signalHandler(int signum)
 {
-    std::cerr << "\nReceived signal " << signum << ", shutting down server..." << std::endl;
+    std::cerr << "\nReceived signal " << signum << ", shutting down server (again to force)..." << std::endl;
     shutdown_flag = 1;
 }
 
+// 로그 파일 교체(logrotate) 후 다시 열기
+void reopenLogsHandler(int signum)
+{
+    (void)signum;
+    AsyncLog::requestReopen();
+}
+
+// 설정 파일 다시 읽기 (SIGHUP)
+void reloadHandler(int signum)
+{
+    (void)signum;
+    reload_flag = 1;
+}
+
+// 새 바이너리를 실행해 리스너를 넘기기 (SIGUSR2)
+void upgradeHandler(int signum)
+{
+    (void)signum;
+    upgrade_flag = 1;
+}
+
 int main(int argc, char *argv[])
 {
     // 인자 개수 확인
@@ -23,11 +46,16 @@ int main(int argc, char *argv[])
 
     std::signal(SIGINT, signalHandler);
     std::signal(SIGTERM, signalHandler);
+    std::signal(SIGUSR1, reopenLogsHandler);
+    std::signal(SIGHUP, reloadHandler);
+    std::signal(SIGUSR2, upgradeHandler);
+    // CGI가 stdin을 닫은 뒤 요청 본문을 쓰면 write()가 EPIPE를 돌려주게 합니다. (자식에서는 기본값으로 되돌림)
+    std::signal(SIGPIPE, SIG_IGN);
 
     try
     {
         std::cerr << "Starting server with config file: " << configFile << std::endl;
-        g_server = new Server(configFile);
+        g_server = new Server(configFile, argv[0]);
         g_server->start(); // 블로킹 호출
         // server.start()가 블로킹 호출이므로 아래 메시지는 보이지 않을 수 있다
         std::cerr << "Server stopped." << std::endl;
@@ -0,0 +1,624 @@
+// webserv_bench: epoll 기반 HTTP 부하 생성기
+//
+//   webserv_bench -m <mix file> [-h host] [-p port] [-c connections] [-d seconds]
+//                 [-P pipeline depth] [-k 0|1] [-n scenario name]
+//
+// mix 파일 형식 (한 줄에 요청 하나, #은 주석):
+//   <weight> <METHOD> <path> [<body file> [<content type...>]]
+// 결과는 JSON 한 줄로 표준 출력에 씁니다.
+
+#include <algorithm>
+#include <arpa/inet.h>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <deque>
+#include <fcntl.h>
+#include <fstream>
+#include <map>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <signal.h>
+#include <sstream>
+#include <stdint.h>
+#include <string>
+#include <strings.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <vector>
+
+static const size_t READ_CHUNK = 65536;
+
+struct Options
+{
+    std::string host;
+    int port;
+    int connections;
+    int duration;
+    int pipeline;
+    bool keep_alive;
+    std::string mix_file;
+    std::string name;
+
+    Options() : host("127.0.0.1"), port(8080), connections(16), duration(5), pipeline(1), keep_alive(true)
+    {
+    }
+};
+
+struct RequestTemplate
+{
+    std::string raw;
+    unsigned weight;
+};
+
+enum ParseState
+{
+    READ_HEADERS,
+    READ_BODY,
+    READ_CHUNK_SIZE,
+    READ_CHUNK_DATA,
+    READ_CHUNK_TRAILER,
+    READ_UNTIL_CLOSE
+};
+
+struct Connection
+{
+    int fd;
+    std::string out;
+    size_t out_off;
+    std::deque<uint64_t> inflight; // 요청을 보낸 시각 (파이프라이닝 순서)
+    std::string in;                // 헤더/청크 크기 줄 누적
+    ParseState state;
+    size_t body_left;
+    int status;
+    bool close_after;
+
+    Connection()
+        : fd(-1), out_off(0), state(READ_HEADERS), body_left(0), status(0), close_after(false)
+    {
+    }
+};
+
+struct Results
+{
+    uint64_t requests;
+    uint64_t errors;
+    uint64_t reconnects;
+    uint64_t server_closes; // keep-alive인데 서버가 먼저 닫은 연결 (Connection: close 또는 EOF)
+    uint64_t bytes_read;
+    std::vector<uint32_t> latencies_us;
+    std::map<int, uint64_t> statuses;
+
+    Results() : requests(0), errors(0), reconnects(0), server_closes(0), bytes_read(0)
+    {
+    }
+};
+
+static uint64_t nowMicros()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1000000 + ts.tv_nsec / 1000;
+}
+
+static bool readFile(const std::string &path, std::string &out)
+{
+    std::ifstream file(path.c_str(), std::ios::binary);
+    if (!file)
+        return false;
+    std::ostringstream ss;
+    ss << file.rdbuf();
+    out = ss.str();
+    return true;
+}
+
+static bool loadMix(const Options &opt, std::vector<RequestTemplate> &mix)
+{
+    std::ifstream file(opt.mix_file.c_str());
+    if (!file)
+    {
+        fprintf(stderr, "cannot open mix file %s\n", opt.mix_file.c_str());
+        return false;
+    }
+    std::string line;
+    while (std::getline(file, line))
+    {
+        if (line.empty() || line[0] == '#')
+            continue;
+        std::istringstream iss(line);
+        RequestTemplate req;
+        std::string method, path, body_file, content_type;
+        if (!(iss >> req.weight >> method >> path))
+            continue;
+        std::string body;
+        if (iss >> body_file)
+        {
+            if (!readFile(body_file, body))
+            {
+                fprintf(stderr, "cannot read body file %s\n", body_file.c_str());
+                return false;
+            }
+            std::getline(iss, content_type);
+            size_t start = content_type.find_first_not_of(" \t");
+            content_type = (start == std::string::npos) ? "" : content_type.substr(start);
+        }
+        std::ostringstream raw;
+        raw << method << " " << path << " HTTP/1.1\r\nHost: " << opt.host << ":" << opt.port << "\r\n";
+        raw << "User-Agent: webserv_bench\r\n";
+        if (!opt.keep_alive)
+            raw << "Connection: close\r\n";
+        if (!body_file.empty())
+        {
+            if (!content_type.empty())
+                raw << "Content-Type: " << content_type << "\r\n";
+            raw << "Content-Length: " << body.size() << "\r\n";
+        }
+        raw << "\r\n" << body;
+        req.raw = raw.str();
+        if (req.weight > 0)
+            mix.push_back(req);
+    }
+    if (mix.empty())
+        fprintf(stderr, "mix file %s has no requests\n", opt.mix_file.c_str());
+    return !mix.empty();
+}
+
+class Bench
+{
+  public:
+    Bench(const Options &opt, const std::vector<RequestTemplate> &mix)
+        : _opt(opt), _mix(mix), _total_weight(0), _epfd(-1)
+    {
+        for (size_t i = 0; i < mix.size(); ++i)
+            _total_weight += mix[i].weight;
+        memset(&_addr, 0, sizeof(_addr));
+    }
+
+    ~Bench()
+    {
+        for (size_t i = 0; i < _conns.size(); ++i)
+        {
+            if (_conns[i].fd != -1)
+                close(_conns[i].fd);
+        }
+        if (_epfd != -1)
+            close(_epfd);
+    }
+
+    bool run(Results &results, double &elapsed)
+    {
+        if (!resolve())
+            return false;
+        _epfd = epoll_create(1);
+        if (_epfd == -1)
+        {
+            perror("epoll_create");
+            return false;
+        }
+        _conns.resize(_opt.connections);
+        for (size_t i = 0; i < _conns.size(); ++i)
+        {
+            if (!connectOne(i))
+                return false;
+        }
+        uint64_t start = nowMicros();
+        uint64_t deadline = start + static_cast<uint64_t>(_opt.duration) * 1000000;
+        std::vector<struct epoll_event> events(_conns.size() + 1);
+        while (true)
+        {
+            uint64_t now = nowMicros();
+            if (now >= deadline)
+                break;
+            int n = epoll_wait(_epfd, &events[0], events.size(), 100);
+            if (n < 0 && errno != EINTR)
+            {
+                perror("epoll_wait");
+                return false;
+            }
+            for (int i = 0; i < n; ++i)
+                handleEvent(events[i].data.u32, events[i].events, results);
+        }
+        elapsed = (nowMicros() - start) / 1000000.0;
+        return true;
+    }
+
+  private:
+    const Options &_opt;
+    const std::vector<RequestTemplate> &_mix;
+    unsigned _total_weight;
+    int _epfd;
+    struct sockaddr_in _addr;
+    std::vector<Connection> _conns;
+
+    bool resolve()
+    {
+        struct addrinfo hints, *res = NULL;
+        memset(&hints, 0, sizeof(hints));
+        hints.ai_family = AF_INET;
+        hints.ai_socktype = SOCK_STREAM;
+        if (getaddrinfo(_opt.host.c_str(), NULL, &hints, &res) != 0 || !res)
+        {
+            fprintf(stderr, "cannot resolve %s\n", _opt.host.c_str());
+            return false;
+        }
+        memcpy(&_addr, res->ai_addr, sizeof(_addr));
+        _addr.sin_port = htons(_opt.port);
+        freeaddrinfo(res);
+        return true;
+    }
+
+    bool connectOne(size_t index)
+    {
+        Connection &conn = _conns[index];
+        conn = Connection();
+        conn.fd = socket(AF_INET, SOCK_STREAM, 0);
+        if (conn.fd == -1)
+        {
+            perror("socket");
+            return false;
+        }
+        fcntl(conn.fd, F_SETFL, fcntl(conn.fd, F_GETFL, 0) | O_NONBLOCK);
+        int one = 1;
+        setsockopt(conn.fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        if (connect(conn.fd, reinterpret_cast<struct sockaddr *>(&_addr), sizeof(_addr)) == -1 &&
+            errno != EINPROGRESS)
+        {
+            perror("connect");
+            close(conn.fd);
+            conn.fd = -1;
+            return false;
+        }
+        fillPipeline(conn);
+        struct epoll_event ev;
+        memset(&ev, 0, sizeof(ev));
+        ev.events = EPOLLIN | EPOLLOUT;
+        ev.data.u32 = static_cast<uint32_t>(index);
+        epoll_ctl(_epfd, EPOLL_CTL_ADD, conn.fd, &ev);
+        return true;
+    }
+
+    // 보냈지만 응답을 받지 못한 요청(파이프라인)은 오류로 셉니다.
+    void reconnect(size_t index, Results &results)
+    {
+        Connection &conn = _conns[index];
+        results.errors += conn.inflight.size();
+        epoll_ctl(_epfd, EPOLL_CTL_DEL, conn.fd, NULL);
+        close(conn.fd);
+        ++results.reconnects;
+        if (!connectOne(index))
+            ++results.errors;
+    }
+
+    const RequestTemplate &pick()
+    {
+        unsigned r = static_cast<unsigned>(rand()) % _total_weight;
+        for (size_t i = 0; i < _mix.size(); ++i)
+        {
+            if (r < _mix[i].weight)
+                return _mix[i];
+            r -= _mix[i].weight;
+        }
+        return _mix[0];
+    }
+
+    void fillPipeline(Connection &conn)
+    {
+        size_t depth = _opt.keep_alive ? static_cast<size_t>(_opt.pipeline) : 1;
+        uint64_t now = nowMicros();
+        while (conn.inflight.size() < depth)
+        {
+            conn.out.append(pick().raw);
+            conn.inflight.push_back(now);
+        }
+    }
+
+    void updateInterest(size_t index)
+    {
+        Connection &conn = _conns[index];
+        struct epoll_event ev;
+        memset(&ev, 0, sizeof(ev));
+        ev.events = EPOLLIN;
+        if (conn.out_off < conn.out.size())
+            ev.events |= EPOLLOUT;
+        ev.data.u32 = static_cast<uint32_t>(index);
+        epoll_ctl(_epfd, EPOLL_CTL_MOD, conn.fd, &ev);
+    }
+
+    void handleEvent(size_t index, uint32_t events, Results &results)
+    {
+        Connection &conn = _conns[index];
+        if (events & EPOLLOUT)
+        {
+            while (conn.out_off < conn.out.size())
+            {
+                ssize_t n = send(conn.fd, conn.out.data() + conn.out_off, conn.out.size() - conn.out_off,
+                                 MSG_NOSIGNAL);
+                if (n <= 0)
+                {
+                    if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+                        break;
+                    failConnection(index, results);
+                    return;
+                }
+                conn.out_off += n;
+            }
+            if (conn.out_off == conn.out.size())
+            {
+                conn.out.clear();
+                conn.out_off = 0;
+            }
+            updateInterest(index);
+        }
+        if (events & (EPOLLIN | EPOLLHUP | EPOLLERR))
+        {
+            char buf[READ_CHUNK];
+            ssize_t n = recv(conn.fd, buf, sizeof(buf), 0);
+            if (n > 0)
+            {
+                results.bytes_read += n;
+                if (!feed(index, buf, n, results))
+                    return;
+            }
+            else if (n == 0 || (errno != EAGAIN && errno != EWOULDBLOCK))
+            {
+                if (conn.state == READ_UNTIL_CLOSE && !conn.inflight.empty())
+                    completeResponse(conn, results);
+                else if (!conn.inflight.empty())
+                {
+                    failConnection(index, results);
+                    return;
+                }
+                if (_opt.keep_alive)
+                    ++results.server_closes;
+                reconnect(index, results);
+            }
+        }
+    }
+
+    void failConnection(size_t index, Results &results)
+    {
+        if (_conns[index].inflight.empty())
+            ++results.errors;
+        reconnect(index, results);
+    }
+
+    void completeResponse(Connection &conn, Results &results)
+    {
+        uint64_t now = nowMicros();
+        uint64_t latency = now - conn.inflight.front();
+        conn.inflight.pop_front();
+        ++results.requests;
+        ++results.statuses[conn.status];
+        results.latencies_us.push_back(latency > 0xffffffffULL ? 0xffffffffU : static_cast<uint32_t>(latency));
+        conn.state = READ_HEADERS;
+        conn.in.clear();
+    }
+
+    // 응답 바이트를 상태 기계에 넣습니다. 연결을 다시 만들었으면 false
+    bool feed(size_t index, const char *data, size_t len, Results &results)
+    {
+        Connection &conn = _conns[index];
+        size_t pos = 0;
+        while (pos < len)
+        {
+            if (conn.state == READ_BODY || conn.state == READ_CHUNK_DATA)
+            {
+                size_t take = std::min(conn.body_left, len - pos);
+                conn.body_left -= take;
+                pos += take;
+                if (conn.body_left > 0)
+                    break;
+                if (conn.state == READ_CHUNK_DATA)
+                {
+                    conn.state = READ_CHUNK_SIZE;
+                    continue;
+                }
+                if (!finishResponse(index, results))
+                    return false;
+                continue;
+            }
+            if (conn.state == READ_UNTIL_CLOSE)
+                return true;
+            // 헤더, 청크 크기 줄, 트레일러는 줄 단위로 누적합니다.
+            const char *terminator = (conn.state == READ_HEADERS) ? "\r\n\r\n" : "\r\n";
+            size_t term_len = strlen(terminator);
+            size_t old = conn.in.size();
+            conn.in.append(data + pos, len - pos);
+            size_t found = conn.in.find(terminator, old >= term_len ? old - term_len + 1 : 0);
+            if (found == std::string::npos)
+                return true;
+            size_t used = found + term_len - old;
+            pos += used;
+            std::string block = conn.in.substr(0, found);
+            conn.in.clear();
+            if (conn.state == READ_HEADERS)
+            {
+                if (!parseHeaders(conn, block))
+                {
+                    failConnection(index, results);
+                    return false;
+                }
+                if (conn.state == READ_BODY && conn.body_left == 0 && !finishResponse(index, results))
+                    return false;
+            }
+            else if (conn.state == READ_CHUNK_SIZE)
+            {
+                size_t size = strtoul(block.c_str(), NULL, 16);
+                if (size == 0)
+                    conn.state = READ_CHUNK_TRAILER;
+                else
+                {
+                    conn.state = READ_CHUNK_DATA;
+                    conn.body_left = size + 2; // 데이터 뒤의 CRLF 포함
+                }
+            }
+            else if (conn.state == READ_CHUNK_TRAILER && block.empty())
+            {
+                if (!finishResponse(index, results))
+                    return false;
+            }
+        }
+        return true;
+    }
+
+    bool finishResponse(size_t index, Results &results)
+    {
+        Connection &conn = _conns[index];
+        bool close_after = conn.close_after;
+        completeResponse(conn, results);
+        if (close_after || !_opt.keep_alive)
+        {
+            if (close_after && _opt.keep_alive)
+                ++results.server_closes;
+            reconnect(index, results);
+            return false;
+        }
+        fillPipeline(conn);
+        updateInterest(index);
+        return true;
+    }
+
+    bool parseHeaders(Connection &conn, const std::string &block)
+    {
+        if (block.compare(0, 5, "HTTP/") != 0)
+            return false;
+        size_t sp = block.find(' ');
+        conn.status = sp == std::string::npos ? 0 : atoi(block.c_str() + sp + 1);
+        conn.close_after = false;
+        conn.state = READ_UNTIL_CLOSE;
+        conn.body_left = 0;
+        std::istringstream lines(block);
+        std::string line;
+        std::getline(lines, line);
+        while (std::getline(lines, line))
+        {
+            if (!line.empty() && line[line.size() - 1] == '\r')
+                line.erase(line.size() - 1);
+            size_t colon = line.find(':');
+            if (colon == std::string::npos)
+                continue;
+            std::string name = line.substr(0, colon);
+            std::string value = line.substr(colon + 1);
+            value.erase(0, value.find_first_not_of(" \t"));
+            if (strcasecmp(name.c_str(), "Content-Length") == 0 && conn.state != READ_CHUNK_SIZE)
+            {
+                conn.state = READ_BODY;
+                conn.body_left = strtoul(value.c_str(), NULL, 10);
+            }
+            else if (strcasecmp(name.c_str(), "Transfer-Encoding") == 0 && strcasecmp(value.c_str(), "chunked") == 0)
+                conn.state = READ_CHUNK_SIZE;
+            else if (strcasecmp(name.c_str(), "Connection") == 0 && strcasecmp(value.c_str(), "close") == 0)
+                conn.close_after = true;
+        }
+        if (conn.status == 204 || conn.status == 304 || (conn.status >= 100 && conn.status < 200))
+        {
+            conn.state = READ_BODY;
+            conn.body_left = 0;
+        }
+        return true;
+    }
+};
+
+static uint32_t percentile(const std::vector<uint32_t> &sorted, double p)
+{
+    if (sorted.empty())
+        return 0;
+    size_t index = static_cast<size_t>(p * sorted.size());
+    if (index >= sorted.size())
+        index = sorted.size() - 1;
+    return sorted[index];
+}
+
+static void usage(const char *prog)
+{
+    fprintf(stderr,
+            "Usage: %s -m <mix file> [-h host] [-p port] [-c connections] [-d seconds] [-P pipeline] [-k 0|1] "
+            "[-n name]\n",
+            prog);
+}
+
+int main(int argc, char *argv[])
+{
+    Options opt;
+    int ch;
+    while ((ch = getopt(argc, argv, "h:p:c:d:P:k:m:n:")) != -1)
+    {
+        switch (ch)
+        {
+        case 'h':
+            opt.host = optarg;
+            break;
+        case 'p':
+            opt.port = atoi(optarg);
+            break;
+        case 'c':
+            opt.connections = atoi(optarg);
+            break;
+        case 'd':
+            opt.duration = atoi(optarg);
+            break;
+        case 'P':
+            opt.pipeline = atoi(optarg);
+            break;
+        case 'k':
+            opt.keep_alive = atoi(optarg) != 0;
+            break;
+        case 'm':
+            opt.mix_file = optarg;
+            break;
+        case 'n':
+            opt.name = optarg;
+            break;
+        default:
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (opt.mix_file.empty() || opt.connections < 1 || opt.duration < 1 || opt.pipeline < 1)
+    {
+        usage(argv[0]);
+        return 1;
+    }
+    if (opt.name.empty())
+        opt.name = opt.mix_file;
+    signal(SIGPIPE, SIG_IGN);
+    srand(static_cast<unsigned>(time(NULL)));
+
+    std::vector<RequestTemplate> mix;
+    if (!loadMix(opt, mix))
+        return 1;
+    Results results;
+    double elapsed = 0;
+    {
+        Bench bench(opt, mix);
+        if (!bench.run(results, elapsed))
+            return 1;
+    }
+    std::sort(results.latencies_us.begin(), results.latencies_us.end());
+    // 서버가 연결을 매번 닫으면 keep-alive/파이프라이닝 시나리오도 연결당 요청 하나를 재는 셈입니다.
+    if (opt.keep_alive && results.server_closes > 0)
+        fprintf(stderr,
+                "warning: %s: server closed %llu keep-alive connections; pipelined requests left unanswered are "
+                "counted as errors\n",
+                opt.name.c_str(), static_cast<unsigned long long>(results.server_closes));
+
+    printf("{\"scenario\":\"%s\",\"connections\":%d,\"pipeline\":%d,\"keep_alive\":%s,\"duration_s\":%.3f,"
+           "\"requests\":%llu,\"errors\":%llu,\"reconnects\":%llu,\"server_closes\":%llu,\"rps\":%.1f,\"read_mb_per_s\":%.2f,"
+           "\"latency_us\":{\"p50\":%u,\"p99\":%u,\"p999\":%u,\"max\":%u},\"status\":{",
+           opt.name.c_str(), opt.connections, opt.pipeline, opt.keep_alive ? "true" : "false", elapsed,
+           static_cast<unsigned long long>(results.requests), static_cast<unsigned long long>(results.errors),
+           static_cast<unsigned long long>(results.reconnects),
+           static_cast<unsigned long long>(results.server_closes), elapsed > 0 ? results.requests / elapsed : 0.0,
+           elapsed > 0 ? results.bytes_read / elapsed / (1024 * 1024) : 0.0, percentile(results.latencies_us, 0.50),
+           percentile(results.latencies_us, 0.99), percentile(results.latencies_us, 0.999),
+           results.latencies_us.empty() ? 0 : results.latencies_us.back());
+    for (std::map<int, uint64_t>::const_iterator it = results.statuses.begin(); it != results.statuses.end(); ++it)
+        printf("%s\"%d\":%llu", it == results.statuses.begin() ? "" : ",", it->first,
+               static_cast<unsigned long long>(it->second));
+    printf("}}\n");
+    return 0;
+}
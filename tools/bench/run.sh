@@ -0,0 +1,81 @@
+#!/bin/bash
+# make bench에서 호출됩니다. config/default.conf로 서버를 띄우고 고정 시나리오를 실행해
+# 결과를 JSON(tools/bench/results/<commit>.json)으로 남깁니다.
+#   BENCH_DURATION  시나리오당 실행 시간(초), 기본 5
+#   BENCH_PORT      서버 포트, 기본 8080
+set -e
+cd "$(dirname "$0")/../.."
+
+BENCH=tools/bench/webserv_bench
+SCENARIOS=tools/bench/scenarios
+WORK=tools/bench/work
+OUT_DIR=tools/bench/results
+DURATION=${BENCH_DURATION:-5}
+PORT=${BENCH_PORT:-8080}
+SERVER_PID=
+
+cleanup()
+{
+    if [ -n "$SERVER_PID" ]; then
+        kill -INT "$SERVER_PID" 2>/dev/null || true
+        wait "$SERVER_PID" 2>/dev/null || true
+    fi
+    rm -rf www/html/bench "$WORK"
+    rm -f uploads/bench.txt
+}
+trap cleanup EXIT
+
+mkdir -p "$WORK" "$OUT_DIR" www/html/bench
+head -c 1024 /dev/zero | tr '\0' 'a' > www/html/bench/small.html
+truncate -s 100M www/html/bench/large.bin
+{
+    printf -- '--webservbenchboundary\r\n'
+    printf 'Content-Disposition: form-data; name="file"; filename="bench.txt"\r\n'
+    printf 'Content-Type: text/plain\r\n\r\n'
+    head -c 16384 /dev/zero | tr '\0' 'b'
+    printf '\r\n--webservbenchboundary--\r\n'
+} > "$WORK/upload.body"
+
+./webserv config/default.conf > "$WORK/server.log" 2>&1 &
+SERVER_PID=$!
+for i in $(seq 1 100); do
+    if (exec 3<>/dev/tcp/127.0.0.1/$PORT) 2>/dev/null; then
+        break
+    fi
+    if ! kill -0 "$SERVER_PID" 2>/dev/null; then
+        echo "webserv failed to start:" >&2
+        cat "$WORK/server.log" >&2
+        exit 1
+    fi
+    sleep 0.1
+done
+
+run()
+{
+    local name=$1
+    shift
+    "$BENCH" -p "$PORT" -d "$DURATION" -n "$name" "$@"
+}
+
+RESULTS=()
+RESULTS+=("$(run static_small -m $SCENARIOS/static_small.mix -c 32)")
+RESULTS+=("$(run static_small_pipelined -m $SCENARIOS/static_small.mix -c 32 -P 8)")
+RESULTS+=("$(run static_small_no_keepalive -m $SCENARIOS/static_small.mix -c 32 -k 0)")
+RESULTS+=("$(run static_large -m $SCENARIOS/static_large.mix -c 2)")
+RESULTS+=("$(run cgi -m $SCENARIOS/cgi.mix -c 4)")
+RESULTS+=("$(run upload -m $SCENARIOS/upload.mix -c 8)")
+RESULTS+=("$(run not_found -m $SCENARIOS/not_found.mix -c 32)")
+RESULTS+=("$(run mixed -m $SCENARIOS/mixed.mix -c 32)")
+
+COMMIT=$(git rev-parse --short HEAD 2>/dev/null || echo unknown)
+OUT="$OUT_DIR/$COMMIT.json"
+{
+    printf '{"commit":"%s","date":"%s","duration_s":%s,"results":[\n' "$COMMIT" "$(date -u +%Y-%m-%dT%H:%M:%SZ)" "$DURATION"
+    for i in "${!RESULTS[@]}"; do
+        [ "$i" -gt 0 ] && printf ',\n'
+        printf '  %s' "${RESULTS[$i]}"
+    done
+    printf '\n]}\n'
+} > "$OUT"
+cat "$OUT"
+echo "Results written to $OUT" >&2
@@ -0,0 +1,190 @@
+// webserv 동작 확인 (make check에서 run.sh 전에 실행)
+//
+// 서버 소스를 링크해 네트워크 없이 확인할 수 있는 것만 봅니다.
+//   - HttpTokenizer: 선택된 SIMD 구현(avx2/sse4.2)이 바이트 단위 기준 구현과 같은 위치를 찾는지
+//     (길이 0~96, 정렬되지 않은 시작 위치, 특수 바이트를 모든 위치에 넣어 봄)
+//   - Response::toString: 1xx/204/304에는 본문과 Content-Length가 없고, 그 외에는 Content-Length가 있음
+//   - Response 헤더: addHeader/setCookie는 같은 이름(Set-Cookie)을 모두 남기고 setHeader는 교체함
+
+#include "HttpTokenizer.hpp"
+#include "Response.hpp"
+#include "Utils.hpp"
+
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+// main.cpp를 링크하지 않으므로 여기서 정의합니다.
+volatile sig_atomic_t shutdown_flag = 0;
+volatile sig_atomic_t reload_flag = 0;
+volatile sig_atomic_t upgrade_flag = 0;
+
+static int g_failures = 0;
+
+#define CHECK(cond)                                                                                                    \
+    do                                                                                                                 \
+    {                                                                                                                  \
+        if (!(cond))                                                                                                   \
+        {                                                                                                              \
+            fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond);                                  \
+            ++g_failures;                                                                                              \
+        }                                                                                                              \
+    } while (0)
+
+static size_t referenceFindCtl(const char *buf, size_t len)
+{
+    for (size_t i = 0; i < len; ++i)
+    {
+        unsigned char c = static_cast<unsigned char>(buf[i]);
+        if ((c < 0x20 && c != '\t') || c == 0x7f)
+            return i;
+    }
+    return len;
+}
+
+static size_t referenceFindNonToken(const char *buf, size_t len)
+{
+    for (size_t i = 0; i < len; ++i)
+    {
+        if (!HttpTokenizer::isTokenChar(static_cast<unsigned char>(buf[i])))
+            return i;
+    }
+    return len;
+}
+
+static void compareTokenizer(const char *buf, size_t len)
+{
+    size_t ctl = HttpTokenizer::findCtl(buf, len);
+    CHECK(ctl == referenceFindCtl(buf, len));
+    size_t non_token = referenceFindNonToken(buf, len);
+    CHECK(HttpTokenizer::isToken(buf, len) == (len != 0 && non_token == len));
+    size_t colon = len + 1;
+    bool named = HttpTokenizer::scanHeaderName(buf, len, colon);
+    bool expected = non_token != 0 && non_token != len && buf[non_token] == ':';
+    CHECK(named == expected);
+    if (named && expected)
+        CHECK(colon == non_token);
+    if (g_failures)
+    {
+        fprintf(stderr, "  tokenizer (%s) input length %lu:", HttpTokenizer::implementationName(),
+                static_cast<unsigned long>(len));
+        for (size_t i = 0; i < len; ++i)
+            fprintf(stderr, " %02x", static_cast<unsigned char>(buf[i]));
+        fprintf(stderr, "\n");
+        exit(1);
+    }
+}
+
+static void checkTokenizer()
+{
+    static const unsigned char SPECIAL[] = {0x00, '\t', '\n', '\r', 0x1f, ' ', '!', '"', '(', ':', '~', 0x7f, 0x80, 0xff};
+    static const size_t MAX_LEN = 96;
+    static const size_t MAX_SHIFT = 16;
+    char storage[MAX_LEN + MAX_SHIFT];
+    for (size_t shift = 0; shift < MAX_SHIFT; ++shift)
+    {
+        char *buf = storage + shift;
+        for (size_t len = 0; len <= MAX_LEN; ++len)
+        {
+            for (size_t i = 0; i < len; ++i)
+                buf[i] = static_cast<char>('a' + i % 26);
+            compareTokenizer(buf, len);
+            for (size_t pos = 0; pos < len; ++pos)
+            {
+                for (size_t s = 0; s < sizeof(SPECIAL); ++s)
+                {
+                    char saved = buf[pos];
+                    buf[pos] = static_cast<char>(SPECIAL[s]);
+                    compareTokenizer(buf, len);
+                    buf[pos] = saved;
+                }
+            }
+        }
+    }
+    // 임의의 바이트 (고정 시드)
+    unsigned seed = 12345;
+    for (int round = 0; round < 20000; ++round)
+    {
+        size_t len = round % (MAX_LEN + 1);
+        for (size_t i = 0; i < len; ++i)
+        {
+            seed = seed * 1103515245 + 12345;
+            // 대부분 tchar, 가끔 구분자/제어 문자
+            unsigned char c = static_cast<unsigned char>(seed >> 16);
+            storage[i] = (c & 0x0f) ? static_cast<char>('A' + c % 26) : static_cast<char>(c);
+        }
+        compareTokenizer(storage, len);
+    }
+    printf("tokenizer (%s) matches the byte-wise reference\n", HttpTokenizer::implementationName());
+}
+
+static size_t countOccurrences(const std::string &haystack, const std::string &needle)
+{
+    size_t count = 0;
+    for (size_t pos = haystack.find(needle); pos != std::string::npos; pos = haystack.find(needle, pos + 1))
+        ++count;
+    return count;
+}
+
+static std::string serialize(int status, const std::string &body)
+{
+    Response response;
+    response.setStatus(status);
+    response.setBody(body);
+    return response.toString();
+}
+
+static void checkResponse()
+{
+    static const int BODYLESS[] = {100, 101, 204, 304};
+    for (size_t i = 0; i < sizeof(BODYLESS) / sizeof(BODYLESS[0]); ++i)
+    {
+        std::string out = serialize(BODYLESS[i], "");
+        CHECK(out.find("Content-Length:") == std::string::npos);
+        CHECK(out.size() >= 4 && out.compare(out.size() - 4, 4, "\r\n\r\n") == 0);
+        // 본문이 있어도 보내지 않습니다.
+        out = serialize(BODYLESS[i], "ignored");
+        CHECK(out.find("Content-Length:") == std::string::npos);
+        CHECK(out.find("ignored") == std::string::npos);
+    }
+    static const int WITH_BODY[] = {200, 201, 404, 500};
+    for (size_t i = 0; i < sizeof(WITH_BODY) / sizeof(WITH_BODY[0]); ++i)
+    {
+        std::string out = serialize(WITH_BODY[i], "hello");
+        size_t header_end = out.find("\r\n\r\n");
+        CHECK(header_end != std::string::npos);
+        CHECK(out.find("Content-Length: 5\r\n") < header_end);
+        CHECK(out.compare(header_end + 4, std::string::npos, "hello") == 0);
+        // 빈 본문도 길이 0을 알립니다.
+        CHECK(serialize(WITH_BODY[i], "").find("Content-Length: 0\r\n") != std::string::npos);
+    }
+
+    Response response;
+    response.setStatus(200);
+    response.addHeader("Set-Cookie", "a=1");
+    response.addHeader("Set-Cookie", "b=2");
+    response.setCookie("c", "3");
+    response.setHeader("X-Check", "first");
+    response.setHeader("X-Check", "second");
+    response.setBody("ok");
+    std::string out = response.toString();
+    CHECK(countOccurrences(out, "Set-Cookie: ") == 3);
+    CHECK(out.find("Set-Cookie: a=1\r\n") != std::string::npos);
+    CHECK(out.find("Set-Cookie: b=2\r\n") != std::string::npos);
+    CHECK(countOccurrences(out, "X-Check: ") == 1);
+    CHECK(out.find("X-Check: second\r\n") != std::string::npos);
+    printf("response serialization checks done\n");
+}
+
+int main()
+{
+    checkTokenizer();
+    checkResponse();
+    if (g_failures)
+    {
+        fprintf(stderr, "%d checks failed\n", g_failures);
+        return 1;
+    }
+    return 0;
+}
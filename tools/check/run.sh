@@ -0,0 +1,242 @@
+#!/bin/bash
+# make check에서 호출됩니다. 작업 디렉터리에 설정과 CGI 스크립트를 만들어 서버를 띄우고
+# 응답 헤더/상태와 디스크 결과를 확인합니다. 하나라도 어긋나면 0이 아닌 값으로 끝납니다.
+#   CHECK_PORT  서버 포트, 기본 8080
+set -e
+cd "$(dirname "$0")/../.."
+
+WORK=tools/check/work
+PORT=${CHECK_PORT:-8080}
+BASE=http://127.0.0.1:$PORT
+SERVER_PID=
+FAILURES=0
+
+cleanup()
+{
+    if [ -n "$SERVER_PID" ]; then
+        kill -INT "$SERVER_PID" 2>/dev/null || true
+        wait "$SERVER_PID" 2>/dev/null || true
+    fi
+    rm -rf "$WORK"
+}
+trap cleanup EXIT
+
+# $1: 추가할 location 블록
+write_config()
+{
+    cat > "$WORK/check.conf" <<EOF
+include mime.types;
+
+server {
+    listen $PORT;
+    server_name localhost;
+    root ./$WORK/www;
+    index index.html;
+    access_log off;
+
+    location / {
+        methods GET;
+    }
+
+    location /files {
+        methods POST HEAD PATCH DELETE OPTIONS;
+        upload_directory ./$WORK/uploads;
+        upload_resumable on;
+    }
+
+    location /metrics {
+        methods GET;
+        metrics;
+    }
+
+    location /cgi-bin {
+        methods GET;
+        cgi_extension .sh;
+        cgi_path /bin/bash;
+        root ./$WORK/cgi-bin;
+    }
+$1
+}
+EOF
+}
+
+fail()
+{
+    echo "FAIL: $*" >&2
+    FAILURES=$((FAILURES + 1))
+}
+
+# 응답 헤더를 $WORK/headers, 본문을 $WORK/body에 받습니다.
+fetch()
+{
+    curl -s --max-time 5 -D "$WORK/headers" -o "$WORK/body" "$@" || true
+    tr -d '\r' < "$WORK/headers" > "$WORK/headers.lf"
+}
+
+status_is()
+{
+    local expected=$1
+    shift
+    fetch "$@"
+    local status
+    status=$(head -n 1 "$WORK/headers.lf" | cut -d ' ' -f 2)
+    if [ "$status" != "$expected" ]; then
+        fail "$* -> status '$status', expected $expected"
+        return 1
+    fi
+}
+
+header_count()
+{
+    grep -ci "^$1:" "$WORK/headers.lf" || true
+}
+
+header_value()
+{
+    grep -i "^$1:" "$WORK/headers.lf" | head -n 1 | cut -d ' ' -f 2-
+}
+
+rm -rf "$WORK"
+mkdir -p "$WORK/www" "$WORK/uploads" "$WORK/cgi-bin"
+cp config/mime.types "$WORK/"
+write_config ""
+head -c 3000 /dev/zero | tr '\0' 'a' > "$WORK/www/index.html"
+cat > "$WORK/cgi-bin/no_content.sh" <<'EOF'
+printf 'Status: 204 No Content\r\n\r\n'
+EOF
+cat > "$WORK/cgi-bin/cookies.sh" <<'EOF'
+printf 'Status: 201 Created\r\nSet-Cookie: a=1\r\nSet-Cookie: b=2\r\nContent-Type: text/plain\r\n\r\ncreated'
+EOF
+cat > "$WORK/cgi-bin/redirect.sh" <<'EOF'
+printf 'Location: /index.html\r\n\r\n'
+EOF
+cat > "$WORK/cgi-bin/no_content_body.sh" <<'EOF'
+printf 'Status: 204 No Content\r\n\r\nstray body'
+EOF
+# stdout을 닫은 뒤에도 정리를 마칠 수 있어야 함 (서버가 종료시키지 않음)
+cat > "$WORK/cgi-bin/cleanup.sh" <<'EOF'
+printf 'Content-Type: text/plain\r\n\r\ndone'
+exec 1>&-
+sleep 1
+touch cleanup.done
+EOF
+
+# 리스너에 SO_REUSEADDR가 없으므로 직전 실행의 연결이 TIME_WAIT인 동안은 bind가 실패합니다. (최대 60초 재시도)
+for attempt in $(seq 1 60); do
+    ./webserv "$WORK/check.conf" > "$WORK/server.log" 2>&1 &
+    SERVER_PID=$!
+    for i in $(seq 1 100); do
+        if (exec 3<>/dev/tcp/127.0.0.1/$PORT) 2>/dev/null || ! kill -0 "$SERVER_PID" 2>/dev/null; then
+            break
+        fi
+        sleep 0.1
+    done
+    if kill -0 "$SERVER_PID" 2>/dev/null; then
+        break
+    fi
+    wait "$SERVER_PID" 2>/dev/null || true
+    SERVER_PID=
+    if ! grep -q "Address already in use" "$WORK/server.log"; then
+        break
+    fi
+    sleep 1
+done
+if [ -z "$SERVER_PID" ]; then
+    echo "webserv failed to start:" >&2
+    cat "$WORK/server.log" >&2
+    exit 1
+fi
+
+# 정적 파일: 200에 본문 길이와 같은 Content-Length
+if status_is 200 "$BASE/"; then
+    [ "$(header_value Content-Length)" = 3000 ] || fail "GET / Content-Length '$(header_value Content-Length)'"
+    [ "$(wc -c < "$WORK/body")" -eq 3000 ] || fail "GET / body size"
+fi
+
+# CGI Status: 헤더가 상태 코드가 되고, 204에는 본문/Content-Length/Transfer-Encoding이 없음
+if status_is 204 "$BASE/cgi-bin/no_content.sh"; then
+    [ "$(header_count Content-Length)" = 0 ] || fail "CGI 204 has Content-Length"
+    [ "$(header_count Transfer-Encoding)" = 0 ] || fail "CGI 204 has Transfer-Encoding"
+    [ ! -s "$WORK/body" ] || fail "CGI 204 has a body"
+fi
+if status_is 201 "$BASE/cgi-bin/cookies.sh"; then
+    [ "$(header_count Set-Cookie)" = 2 ] || fail "CGI Set-Cookie count $(header_count Set-Cookie), expected 2"
+    [ "$(header_count Status)" = 0 ] || fail "CGI Status header passed through"
+    [ "$(cat "$WORK/body")" = created ] || fail "CGI 201 body '$(cat "$WORK/body")'"
+fi
+status_is 302 "$BASE/cgi-bin/redirect.sh" || true
+# 204 뒤에 스크립트가 쓴 본문은 버림 (curl은 남는 바이트를 보여 주지 않으므로 직접 읽음)
+exec 3<>"/dev/tcp/127.0.0.1/$PORT"
+printf 'GET /cgi-bin/no_content_body.sh HTTP/1.1\r\nHost: localhost\r\n\r\n' >&3
+RAW=$(timeout 5 cat <&3 | tr -d '\r')
+exec 3<&-
+case "$RAW" in
+"HTTP/1.1 204"*) ;;
+*) fail "CGI 204 with output -> '$(printf '%s' "$RAW" | head -n 1)'" ;;
+esac
+case "$RAW" in
+*"stray body"*) fail "CGI 204 forwarded the script's body" ;;
+esac
+if status_is 200 "$BASE/cgi-bin/cleanup.sh"; then
+    for i in $(seq 1 30); do
+        [ -e "$WORK/cgi-bin/cleanup.done" ] && break
+        sleep 0.1
+    done
+    [ -e "$WORK/cgi-bin/cleanup.done" ] || fail "CGI killed after closing stdout"
+fi
+
+# 이어 올리기: 마지막 PATCH에서 파일이 생기고 세션(.info)이 지워지며, 있는 파일은 덮어쓰지 않음
+TUS=(-H "Tus-Resumable: 1.0.0")
+PATCH=("${TUS[@]}" -X PATCH -H "Content-Type: application/offset+octet-stream")
+if status_is 201 "${TUS[@]}" -X POST -H "Upload-Length: 10" \
+    -H "Upload-Metadata: filename $(printf done.txt | base64)" "$BASE/files"; then
+    LOCATION=$(header_value Location)
+    ID=${LOCATION##*/}
+    [ -f "$WORK/uploads/.sessions/$ID.info" ] || fail "tus session $ID has no .info"
+    if status_is 204 "${PATCH[@]}" -H "Upload-Offset: 0" --data-binary 01234 "$BASE$LOCATION"; then
+        [ "$(header_value Upload-Offset)" = 5 ] || fail "tus offset after first PATCH '$(header_value Upload-Offset)'"
+        [ "$(header_count Content-Length)" = 0 ] || fail "tus 204 has Content-Length"
+    fi
+    status_is 204 "${PATCH[@]}" -H "Upload-Offset: 5" --data-binary 56789 "$BASE$LOCATION" || true
+    [ "$(cat "$WORK/uploads/done.txt" 2>/dev/null)" = 0123456789 ] || fail "tus upload content"
+    [ ! -e "$WORK/uploads/.sessions/$ID.info" ] || fail "tus .info left after completion"
+    [ ! -e "$WORK/uploads/.sessions/$ID.part" ] || fail "tus .part left after completion"
+    status_is 404 "${TUS[@]}" -I "$BASE$LOCATION" || true
+fi
+status_is 409 "${TUS[@]}" -X POST -H "Upload-Length: 3" \
+    -H "Upload-Metadata: filename $(printf done.txt | base64)" "$BASE/files" || true
+if status_is 201 "${TUS[@]}" -X POST -H "Upload-Length: 3" \
+    -H "Upload-Metadata: filename $(printf late.txt | base64)" "$BASE/files"; then
+    LOCATION=$(header_value Location)
+    printf keep > "$WORK/uploads/late.txt"
+    status_is 409 "${PATCH[@]}" -H "Upload-Offset: 0" --data-binary abc "$BASE$LOCATION" || true
+    [ "$(cat "$WORK/uploads/late.txt")" = keep ] || fail "tus overwrote an existing file"
+fi
+
+# 설정 다시 읽기: 새 location이 바로 응답하고 /metrics에 나타남
+write_config "
+    location /added {
+        methods GET;
+        root ./$WORK/www;
+    }"
+kill -HUP "$SERVER_PID"
+RELOADED=
+for i in $(seq 1 50); do
+    if [ "$(curl -s --max-time 5 -o /dev/null -w '%{http_code}' "$BASE/added/index.html")" = 200 ]; then
+        RELOADED=1
+        break
+    fi
+    sleep 0.1
+done
+if [ -z "$RELOADED" ]; then
+    fail "GET /added after reload"
+elif status_is 200 "$BASE/metrics"; then
+    grep -q 'location="/added"' "$WORK/body" || fail "/metrics has no series for location /added"
+fi
+
+if [ "$FAILURES" -ne 0 ]; then
+    echo "$FAILURES checks failed. Server log:" >&2
+    cat "$WORK/server.log" >&2
+    exit 1
+fi
+echo "All behaviour checks passed"
@@ -0,0 +1,169 @@
+// webserv 파서/직렬화 퍼즈 타깃 (libFuzzer, AFL)
+//
+// libFuzzer:  make fuzz && ./tools/fuzz/webserv_fuzz tools/fuzz/corpus
+// AFL:        afl-clang-fast++ 로 WEBSERV_FUZZ_MAIN을 정의해 빌드하면 파일 인자를 읽습니다.
+// 재현:       make fuzz-replay  (g++ + ASan, 코퍼스 전체를 한 번씩 실행)
+//
+// 크래시뿐 아니라 아래 불변식이 깨져도 abort()합니다. 파서를 성능 목적으로
+// 다시 작성할 때 같은 코퍼스로 동작이 바뀌지 않았는지 확인하는 용도입니다.
+//   - parse: consumed <= 입력 크기, 부분 요청이면 consumed == 0,
+//            완성된 요청을 다시 파싱하면 같은 결과, 완성된 요청의 앞부분은 완성으로 보지 않음
+//   - normalizePath: 결과가 비어 있지 않고 두 번 적용해도 같음
+//   - urlDecode: 결과가 입력보다 길지 않음
+//   - matchLocationConfig: 매칭된 location 경로는 요청 경로의 접두사
+//   - Response::toString: 헤더 끝 뒤의 본문이 그대로이고 Content-Length와 일치
+
+#include "Arena.hpp"
+#include "Request.hpp"
+#include "Response.hpp"
+#include "ServerConfig.hpp"
+#include "Utils.hpp"
+
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <stdint.h>
+#include <string>
+
+extern const LocationConfig *matchLocationConfig(const Request &request, const ServerConfig &server_config);
+
+// main.cpp를 링크하지 않으므로 여기서 정의합니다.
+volatile sig_atomic_t shutdown_flag = 0;
+volatile sig_atomic_t reload_flag = 0;
+volatile sig_atomic_t upgrade_flag = 0;
+
+#define FUZZ_CHECK(cond)                                                                                               \
+    do                                                                                                                 \
+    {                                                                                                                  \
+        if (!(cond))                                                                                                   \
+        {                                                                                                              \
+            fprintf(stderr, "%s:%d: invariant failed: %s\n", __FILE__, __LINE__, #cond);                              \
+            abort();                                                                                                   \
+        }                                                                                                              \
+    } while (0)
+
+static const ServerConfig &fuzzServerConfig()
+{
+    static ServerConfig config;
+    if (config.locations.empty())
+    {
+        static const char *PATHS[] = {"/", "/upload", "/cgi-bin", "/api/v1", "/a/b/c"};
+        for (size_t i = 0; i < sizeof(PATHS) / sizeof(PATHS[0]); ++i)
+        {
+            LocationConfig location;
+            location.path = PATHS[i];
+            config.locations.push_back(location);
+        }
+    }
+    return config;
+}
+
+static void fuzzParse(const std::string &data, Arena &arena)
+{
+    ArenaScope scope(&arena);
+    Request request;
+    int consumed = 0;
+    bool partial = false;
+    if (!request.parse(data, consumed, partial))
+        return;
+    FUZZ_CHECK(consumed >= 0 && static_cast<size_t>(consumed) <= data.size());
+    if (partial)
+    {
+        FUZZ_CHECK(consumed == 0);
+        return;
+    }
+    FUZZ_CHECK(consumed > 0);
+
+    std::string exact = data.substr(0, consumed);
+    Request again;
+    int consumed_again = 0;
+    bool partial_again = false;
+    FUZZ_CHECK(again.parse(exact, consumed_again, partial_again));
+    FUZZ_CHECK(!partial_again && consumed_again == consumed);
+    FUZZ_CHECK(again.getMethod() == request.getMethod() && again.getPath() == request.getPath());
+    FUZZ_CHECK(again.getHeaders().size() == request.getHeaders().size());
+    FUZZ_CHECK(again.getBody() == request.getBody());
+    FUZZ_CHECK(again.getUploadedFiles().size() == request.getUploadedFiles().size());
+
+    Request truncated;
+    int consumed_truncated = 0;
+    bool partial_truncated = false;
+    if (truncated.parse(exact.substr(0, exact.size() - 1), consumed_truncated, partial_truncated))
+        FUZZ_CHECK(partial_truncated || consumed_truncated < consumed);
+
+    const LocationConfig *location = matchLocationConfig(request, fuzzServerConfig());
+    if (location)
+        FUZZ_CHECK(request.getPath().compare(0, location->path.size(), location->path) == 0);
+}
+
+static void fuzzPaths(const std::string &data)
+{
+    std::string normalized = normalizePath(data);
+    FUZZ_CHECK(!normalized.empty());
+    FUZZ_CHECK(normalizePath(normalized) == normalized);
+    FUZZ_CHECK(urlDecode(data).size() <= data.size());
+}
+
+static void fuzzSerialize(const std::string &data)
+{
+    Response response;
+    int status = 100 + static_cast<int>(data.size() % 500);
+    response.setStatus(status);
+    response.setHeader("Content-Type", "application/octet-stream");
+    response.setBody(data);
+    std::string out = response.toString();
+    size_t header_end = out.find("\r\n\r\n");
+    FUZZ_CHECK(header_end != std::string::npos);
+    // 1xx/204/304에는 본문도 Content-Length도 없습니다.
+    if (status < 200 || status == 204 || status == 304)
+    {
+        FUZZ_CHECK(header_end + 4 == out.size());
+        FUZZ_CHECK(out.find("Content-Length:") == std::string::npos);
+        return;
+    }
+    FUZZ_CHECK(out.compare(header_end + 4, std::string::npos, data) == 0);
+    FUZZ_CHECK(out.find("Content-Length: " + sizeToString(data.size()) + "\r\n") < header_end);
+}
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *bytes, size_t size)
+{
+    static Arena arena;
+    std::string data(reinterpret_cast<const char *>(bytes), size);
+    fuzzParse(data, arena);
+    arena.reset();
+    fuzzPaths(data);
+    fuzzSerialize(data);
+    return 0;
+}
+
+#ifdef WEBSERV_FUZZ_MAIN
+// libFuzzer 없이 파일(또는 표준 입력)을 하나씩 실행합니다. AFL 및 코퍼스 재현용
+int main(int argc, char **argv)
+{
+    if (argc == 1)
+    {
+        std::ostringstream content;
+        content << std::cin.rdbuf();
+        std::string data = content.str();
+        LLVMFuzzerTestOneInput(reinterpret_cast<const uint8_t *>(data.data()), data.size());
+        return 0;
+    }
+    for (int i = 1; i < argc; ++i)
+    {
+        std::ifstream file(argv[i], std::ios::binary);
+        if (!file)
+        {
+            fprintf(stderr, "cannot open %s\n", argv[i]);
+            return 1;
+        }
+        std::ostringstream content;
+        content << file.rdbuf();
+        std::string data = content.str();
+        LLVMFuzzerTestOneInput(reinterpret_cast<const uint8_t *>(data.data()), data.size());
+    }
+    return 0;
+}
+#endif
@@ -0,0 +1,390 @@
+// webserv_microbench: 파서/직렬화 경로 마이크로벤치마크
+//
+//   webserv_microbench [-t milliseconds] [-f filter] [corpus dir]
+//
+// 케이스마다 목표 시간 동안 반복 실행하고 ns/op, 힙 할당 횟수/op, 할당 바이트/op,
+// 아레나 블록 할당/op를 출력합니다. 할당 횟수는 이 파일의 전역 operator new로 셉니다.
+// corpus dir(기본 tools/fuzz/corpus)의 파일은 각각 parse/<파일명> 케이스가 됩니다.
+
+#include "Arena.hpp"
+#include "MimeTypes.hpp"
+#include "Request.hpp"
+#include "Response.hpp"
+#include "ServerConfig.hpp"
+#include "Utils.hpp"
+
+#include <algorithm>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <dirent.h>
+#include <fstream>
+#include <new>
+#include <sstream>
+#include <string>
+#include <time.h>
+#include <vector>
+
+extern const LocationConfig *matchLocationConfig(const Request &request, const ServerConfig &server_config);
+
+// main.cpp를 링크하지 않으므로 여기서 정의합니다.
+volatile sig_atomic_t shutdown_flag = 0;
+volatile sig_atomic_t reload_flag = 0;
+volatile sig_atomic_t upgrade_flag = 0;
+
+static unsigned long g_allocs = 0;
+static unsigned long g_alloc_bytes = 0;
+
+void *operator new(size_t size) throw(std::bad_alloc)
+{
+    ++g_allocs;
+    g_alloc_bytes += size;
+    void *p = malloc(size ? size : 1);
+    if (!p)
+        throw std::bad_alloc();
+    return p;
+}
+
+void *operator new[](size_t size) throw(std::bad_alloc)
+{
+    return operator new(size);
+}
+
+// 인라인되면 GCC가 malloc/free 짝을 new/delete 불일치로 오인합니다.
+__attribute__((noinline)) void operator delete(void *p) throw()
+{
+    free(p);
+}
+
+void operator delete[](void *p) throw()
+{
+    operator delete(p);
+}
+
+struct BenchCase;
+typedef void (*BenchFn)(const BenchCase &);
+
+struct BenchCase
+{
+    std::string name;
+    BenchFn fn;
+    std::string input;
+    const Request *request;
+    const Response *response;
+};
+
+static Arena g_arena;
+static ServerConfig g_server_config;
+static volatile size_t g_sink = 0; // 결과를 버리지 않도록 누적합니다.
+
+// 서버와 같이 요청마다 아레나를 설정하고 처리 후 reset()합니다.
+static void benchParse(const BenchCase &c)
+{
+    {
+        ArenaScope scope(&g_arena);
+        Request request;
+        int consumed = 0;
+        bool partial = false;
+        if (request.parse(c.input, consumed, partial))
+            g_sink += consumed + request.getHeaders().size() + request.getUploadedFiles().size();
+    }
+    g_arena.reset();
+}
+
+static void benchNormalize(const BenchCase &c)
+{
+    g_sink += normalizePath(c.input).size();
+}
+
+static void benchUrlDecode(const BenchCase &c)
+{
+    g_sink += urlDecode(c.input).size();
+}
+
+static void benchMime(const BenchCase &c)
+{
+    g_sink += MimeTypes::lookup(c.input).size();
+}
+
+static void benchMatch(const BenchCase &c)
+{
+    g_sink += reinterpret_cast<size_t>(matchLocationConfig(*c.request, g_server_config));
+}
+
+static void benchSerialize(const BenchCase &c)
+{
+    g_sink += c.response->toString().size();
+}
+
+static uint64_t nowNanos()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1000000000ULL + ts.tv_nsec;
+}
+
+static void runCase(const BenchCase &c, uint64_t budget_ns)
+{
+    c.fn(c); // 첫 실행의 지연 초기화 비용은 제외합니다.
+    unsigned long iterations = 0;
+    unsigned long batch = 1;
+    unsigned long allocs = g_allocs;
+    unsigned long alloc_bytes = g_alloc_bytes;
+    size_t arena_blocks = Arena::stats().block_allocs + Arena::stats().oversize_allocs;
+    uint64_t start = nowNanos();
+    uint64_t elapsed = 0;
+    while (elapsed < budget_ns)
+    {
+        for (unsigned long i = 0; i < batch; ++i)
+            c.fn(c);
+        iterations += batch;
+        elapsed = nowNanos() - start;
+        if (batch < 1024)
+            batch *= 2;
+    }
+    allocs = g_allocs - allocs;
+    alloc_bytes = g_alloc_bytes - alloc_bytes;
+    arena_blocks = Arena::stats().block_allocs + Arena::stats().oversize_allocs - arena_blocks;
+    double n = static_cast<double>(iterations);
+    printf("%-42s %10lu %14.1f %10.2f %12.0f %10.2f\n", c.name.c_str(), iterations, elapsed / n, allocs / n,
+           alloc_bytes / n, arena_blocks / n);
+}
+
+static std::string buildRequest(const std::string &request_line, const std::vector<std::string> &headers,
+                                const std::string &body)
+{
+    std::string out = request_line + "\r\n";
+    for (size_t i = 0; i < headers.size(); ++i)
+        out += headers[i] + "\r\n";
+    if (!body.empty())
+        out += "Content-Length: " + sizeToString(body.size()) + "\r\n";
+    out += "\r\n";
+    return out + body;
+}
+
+static std::vector<std::string> browserHeaders()
+{
+    std::vector<std::string> h;
+    h.push_back("Host: localhost:8080");
+    h.push_back("User-Agent: Mozilla/5.0 (X11; Linux x86_64; rv:128.0) Gecko/20100101 Firefox/128.0");
+    h.push_back("Accept: text/html,application/xhtml+xml,application/xml;q=0.9,*/*;q=0.8");
+    h.push_back("Accept-Language: en-US,en;q=0.5");
+    h.push_back("Accept-Encoding: gzip, deflate, br");
+    h.push_back("Connection: keep-alive");
+    h.push_back("Referer: http://localhost:8080/");
+    h.push_back("Cookie: session_id=4f2a9c0d1e; theme=dark");
+    h.push_back("Upgrade-Insecure-Requests: 1");
+    h.push_back("Cache-Control: max-age=0");
+    return h;
+}
+
+static std::string multipartBody(const std::string &boundary, size_t parts, size_t file_size)
+{
+    std::string body;
+    for (size_t i = 0; i < parts; ++i)
+    {
+        body += "--" + boundary + "\r\n";
+        body += "Content-Disposition: form-data; name=\"field" + sizeToString(i) + "\"\r\n\r\n";
+        body += "value " + sizeToString(i) + "\r\n";
+    }
+    if (file_size)
+    {
+        body += "--" + boundary + "\r\n";
+        body += "Content-Disposition: form-data; name=\"file\"; filename=\"data.bin\"\r\n";
+        body += "Content-Type: application/octet-stream\r\n\r\n";
+        for (size_t i = 0; i < file_size; ++i)
+            body += static_cast<char>('a' + i % 26);
+        body += "\r\n";
+    }
+    return body + "--" + boundary + "--\r\n";
+}
+
+static std::string deepPath(size_t depth, bool dot_segments)
+{
+    std::string path;
+    for (size_t i = 0; i < depth; ++i)
+    {
+        path += "/dir" + sizeToString(i);
+        if (dot_segments && i % 3 == 0)
+            path += "/./x/..//";
+    }
+    return path + "/index.html";
+}
+
+static void addCase(std::vector<BenchCase> &cases, const std::string &name, BenchFn fn, const std::string &input)
+{
+    BenchCase c;
+    c.name = name;
+    c.fn = fn;
+    c.input = input;
+    c.request = NULL;
+    c.response = NULL;
+    cases.push_back(c);
+}
+
+static void addParseCases(std::vector<BenchCase> &cases)
+{
+    std::vector<std::string> headers = browserHeaders();
+    addCase(cases, "parse/get_browser", benchParse, buildRequest("GET /index.html HTTP/1.1", headers, ""));
+    addCase(cases, "parse/get_query", benchParse,
+            buildRequest("GET /cgi-bin/index.py?q=web%20serv&page=2&sort=name+asc HTTP/1.1", headers, ""));
+
+    std::vector<std::string> many;
+    for (size_t i = 0; i < 500; ++i)
+        many.push_back("X-Header-" + sizeToString(i) + ": v" + sizeToString(i));
+    addCase(cases, "parse/many_small_headers_500", benchParse, buildRequest("GET / HTTP/1.1", many, ""));
+
+    std::vector<std::string> huge(1, "Host: localhost");
+    huge.push_back("Cookie: " + std::string(64 * 1024, 'c'));
+    addCase(cases, "parse/huge_header_64k", benchParse, buildRequest("GET / HTTP/1.1", huge, ""));
+
+    addCase(cases, "parse/deep_path_200", benchParse, buildRequest("GET " + deepPath(200, true) + " HTTP/1.1", headers, ""));
+
+    std::string form = "name=alice&comment=" + std::string(512, 'x');
+    std::vector<std::string> form_headers = headers;
+    form_headers.push_back("Content-Type: application/x-www-form-urlencoded");
+    addCase(cases, "parse/post_form", benchParse, buildRequest("POST /submit HTTP/1.1", form_headers, form));
+
+    std::vector<std::string> mp_headers = headers;
+    mp_headers.push_back("Content-Type: multipart/form-data; boundary=----webservbench");
+    addCase(cases, "parse/multipart_small", benchParse,
+            buildRequest("POST /upload HTTP/1.1", mp_headers, multipartBody("----webservbench", 2, 1024)));
+    addCase(cases, "parse/multipart_1000_parts", benchParse,
+            buildRequest("POST /upload HTTP/1.1", mp_headers, multipartBody("----webservbench", 1000, 0)));
+    addCase(cases, "parse/multipart_4mb", benchParse,
+            buildRequest("POST /upload HTTP/1.1", mp_headers, multipartBody("----webservbench", 2, 4 << 20)));
+
+    // 본문이 아직 덜 도착한 요청 (수신 중 반복 파싱되는 경우)
+    std::string partial = buildRequest("POST /upload HTTP/1.1", mp_headers, multipartBody("----webservbench", 2, 1 << 20));
+    addCase(cases, "parse/partial_body_1mb", benchParse, partial.substr(0, partial.size() / 2));
+}
+
+static void addCorpusCases(std::vector<BenchCase> &cases, const std::string &dir)
+{
+    DIR *d = opendir(dir.c_str());
+    if (!d)
+        return;
+    std::vector<std::string> names;
+    while (struct dirent *entry = readdir(d))
+    {
+        if (entry->d_name[0] != '.')
+            names.push_back(entry->d_name);
+    }
+    closedir(d);
+    std::sort(names.begin(), names.end());
+    for (size_t i = 0; i < names.size(); ++i)
+    {
+        std::ifstream file((dir + "/" + names[i]).c_str(), std::ios::binary);
+        std::ostringstream content;
+        content << file.rdbuf();
+        addCase(cases, "parse/corpus/" + names[i], benchParse, content.str());
+    }
+}
+
+static void addPathCases(std::vector<BenchCase> &cases)
+{
+    addCase(cases, "normalizePath/short", benchNormalize, "/images/logo.png");
+    addCase(cases, "normalizePath/dot_segments", benchNormalize, "/a/./b/../../c//d/./e/../f/");
+    addCase(cases, "normalizePath/deep_200", benchNormalize, deepPath(200, true));
+
+    addCase(cases, "urlDecode/plain", benchUrlDecode, "/uploads/report-2024-final.pdf");
+    addCase(cases, "urlDecode/query", benchUrlDecode, "q=web+server&name=%EC%9B%B9%EC%84%9C%EB%B2%84");
+    std::string encoded;
+    for (size_t i = 0; i < 1024; ++i)
+        encoded += "%2F";
+    addCase(cases, "urlDecode/all_escaped_3k", benchUrlDecode, encoded);
+
+    addCase(cases, "mimeType/html", benchMime, "/www/html/index.html");
+    addCase(cases, "mimeType/woff2_upper", benchMime, "/static/fonts/Inter-Regular.WOFF2");
+    addCase(cases, "mimeType/unknown", benchMime, "/downloads/archive.unknownext");
+}
+
+// 설정 파일 한 개 분량의 location 목록과 매칭 대상 요청을 준비합니다.
+static void addMatchCases(std::vector<BenchCase> &cases, std::vector<Request *> &requests)
+{
+    static const char *LOCATIONS[] = {"/",        "/static",   "/images",  "/upload", "/uploads", "/cgi-bin",
+                                      "/api",     "/api/v1",   "/api/v2",  "/docs",   "/status",  "/metrics",
+                                      "/private", "/redirect", "/cookies", "/files",  "/dir0",    "/dir0/dir1"};
+    for (size_t i = 0; i < sizeof(LOCATIONS) / sizeof(LOCATIONS[0]); ++i)
+    {
+        LocationConfig location;
+        location.path = LOCATIONS[i];
+        g_server_config.locations.push_back(location);
+    }
+    static const char *PATHS[] = {"/", "/api/v1/users/42", "/nomatch/at/all"};
+    static const char *NAMES[] = {"match/root", "match/nested_api", "match/fallback"};
+    for (size_t i = 0; i < 4; ++i)
+    {
+        std::string path = i < 3 ? PATHS[i] : deepPath(200, false);
+        Request *request = new Request();
+        int consumed = 0;
+        bool partial = false;
+        request->parse("GET " + path + " HTTP/1.1\r\nHost: localhost\r\n\r\n", consumed, partial);
+        requests.push_back(request);
+        addCase(cases, i < 3 ? NAMES[i] : "match/deep_path_200", benchMatch, "");
+        cases.back().request = request;
+    }
+}
+
+static void addSerializeCases(std::vector<BenchCase> &cases, std::vector<Response *> &responses)
+{
+    static const size_t SIZES[] = {0, 1024, 1 << 20};
+    static const char *NAMES[] = {"toString/empty_204", "toString/html_1k", "toString/file_1mb"};
+    for (size_t i = 0; i < 3; ++i)
+    {
+        Response *response = new Response();
+        response->setStatus(SIZES[i] ? 200 : 204);
+        response->setHeader("Content-Type", "text/html");
+        response->setHeader("Connection", "close");
+        response->setHeader("Cache-Control", "no-cache");
+        response->setCookie("session_id", "4f2a9c0d1e", "/", 3600);
+        response->setBody(std::string(SIZES[i], 'x'));
+        responses.push_back(response);
+        addCase(cases, NAMES[i], benchSerialize, "");
+        cases.back().response = response;
+    }
+}
+
+int main(int argc, char **argv)
+{
+    uint64_t budget_ms = 200;
+    std::string filter;
+    std::string corpus_dir = "tools/fuzz/corpus";
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        if (arg == "-t" && i + 1 < argc)
+            budget_ms = strtoul(argv[++i], NULL, 10);
+        else if (arg == "-f" && i + 1 < argc)
+            filter = argv[++i];
+        else if (arg[0] == '-')
+        {
+            fprintf(stderr, "usage: %s [-t milliseconds] [-f filter] [corpus dir]\n", argv[0]);
+            return 1;
+        }
+        else
+            corpus_dir = arg;
+    }
+
+    std::vector<BenchCase> cases;
+    std::vector<Request *> requests;
+    std::vector<Response *> responses;
+    addParseCases(cases);
+    addCorpusCases(cases, corpus_dir);
+    addPathCases(cases);
+    addMatchCases(cases, requests);
+    addSerializeCases(cases, responses);
+
+    printf("%-42s %10s %14s %10s %12s %10s\n", "case", "iters", "ns/op", "allocs/op", "bytes/op", "arena/op");
+    for (size_t i = 0; i < cases.size(); ++i)
+    {
+        if (filter.empty() || cases[i].name.find(filter) != std::string::npos)
+            runCase(cases[i], budget_ms * 1000000ULL);
+    }
+    for (size_t i = 0; i < requests.size(); ++i)
+        delete requests[i];
+    for (size_t i = 0; i < responses.size(); ++i)
+        delete responses[i];
+    return g_sink == 0xdeadbeef;
+}